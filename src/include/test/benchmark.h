@@ -25,6 +25,7 @@ struct BenchmarkResults
     struct timespec mean;           ///< The average time of every function call.
     struct timespec stddev;         ///< The standard deviation of all measurements.
     struct timespec percentiles[5]; ///< 1%, 25%, 50% (median), 75%, 99% percentiles.
+    size_t bytes;                   ///< Bytes processed per call; 0 if throughput isn't reported.
 };
 
 
@@ -43,6 +44,23 @@ void benchmark_print_results(struct BenchmarkResults * results);
 struct BenchmarkResults benchmark(void (*function)(void));
 
 
+/// Benchmark \p function when each call processes \p bytes bytes.
+///
+/// The number of calls is scaled down as \p bytes grows so that large inputs
+/// can be benchmarked in a reasonable time, and the printed results include
+/// the throughput in GB/s.
+struct BenchmarkResults benchmark_throughput(void (*function)(void), size_t bytes);
+
+
+/// Benchmark \p function when each call processes \p bytes bytes, measuring
+/// exactly \p calls calls.
+///
+/// This is for functions so slow for the bytes they process that calling
+/// them as often as benchmark_throughput() would takes too long.
+struct BenchmarkResults benchmark_throughput_calls(void (*function)(void), size_t bytes,
+                                                   size_t calls);
+
+
 /// Benchmark \p \_\_function\_\_ and use \p \_\_name\_\_ to identify it in the print out.
 #define BENCH_WITH_NAME(__function__, __name__)                                                    \
     do                                                                                             \
@@ -57,6 +75,29 @@ struct BenchmarkResults benchmark(void (*function)(void));
 #define BENCH(__function__) BENCH_WITH_NAME(__function__, STR(__function__));
 
 
+/// Benchmark \p \_\_function\_\_, which processes \p \_\_bytes\_\_ per call, and print
+/// out the results and throughput using \p \_\_name\_\_ to identify it.
+#define BENCH_THROUGHPUT(__function__, __name__, __bytes__)                                        \
+    do                                                                                             \
+    {                                                                                              \
+        struct BenchmarkResults results = benchmark_throughput(__function__, __bytes__);           \
+        results.name = __name__;                                                                   \
+        benchmark_print_results(&results);                                                         \
+    } while (0)
+
+
+/// Benchmark \p \_\_function\_\_ like BENCH_THROUGHPUT, but with only
+/// \p \_\_calls\_\_ measured calls.
+#define BENCH_THROUGHPUT_CALLS(__function__, __name__, __bytes__, __calls__)                       \
+    do                                                                                             \
+    {                                                                                              \
+        struct BenchmarkResults results =                                                          \
+            benchmark_throughput_calls(__function__, __bytes__, __calls__);                        \
+        results.name = __name__;                                                                   \
+        benchmark_print_results(&results);                                                         \
+    } while (0)
+
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
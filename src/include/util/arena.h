@@ -0,0 +1,106 @@
+/// \file
+/// A region (bump) allocator for many short-lived allocations.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// The default alignment of allocations made by arena_alloc().
+#define ARENA_DEFAULT_ALIGNMENT (sizeof(void *) > sizeof(double) ? sizeof(void *) : sizeof(double))
+
+
+/// A block of memory owned by an ::arena. The layout is private to arena.c.
+struct arena_chunk;
+
+
+/// A region allocator.
+///
+/// Memory is handed out by bumping an offset through large chunks obtained
+/// from \rst :cppref:`~c/memory/malloc` \rst_end. Individual allocations
+/// can't be freed; instead the whole arena is reset, or rolled back to a
+/// mark, in constant time. Chunks are kept after a reset so an arena that is
+/// reset in a loop stops calling `malloc` once it has grown large enough.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct arena arena;
+///     arena_init(&arena, 0);
+///     for (size_t i = 0; i < n_requests; ++i)
+///     {
+///         struct string copy;
+///         string_copy_arena(&copy, requests + i, &arena);
+///         handle(&copy);
+///         arena_reset(&arena);
+///     }
+///     arena_free(&arena);
+/// \rst_end
+struct arena
+{
+    struct arena_chunk * first;   ///< The first chunk in the list of chunks.
+    struct arena_chunk * current; ///< The chunk allocations are currently made from.
+    size_t chunk_size;            ///< The minimum size of new chunks in bytes.
+};
+
+
+/// A position in an ::arena that it can be rolled back to.
+struct arena_mark
+{
+    struct arena_chunk * chunk; ///< The chunk that was current when the mark was made.
+    size_t used;                ///< The number of bytes used in \p chunk.
+};
+
+
+/// Initialise an empty arena that allocates chunks of at least \p chunk_size bytes.
+///
+/// No memory is allocated until the first call to arena_alloc(). If
+/// \p chunk_size is `0` a default of 64 KiB is used.
+void arena_init(struct arena * arena, size_t chunk_size);
+
+
+/// Return all the memory owned by \p arena to the system.
+///
+/// \p arena can be reused after calling arena_init() again.
+void arena_free(struct arena * arena);
+
+
+/// Allocate \p size bytes from \p arena aligned to ::ARENA_DEFAULT_ALIGNMENT.
+/// \return A pointer to the memory or `NULL` if allocation fails.
+void * arena_alloc(struct arena * arena, size_t size);
+
+
+/// Allocate \p size bytes from \p arena aligned to \p alignment.
+///
+/// \param alignment Must be a power of two.
+/// \return A pointer to the memory or `NULL` if allocation fails.
+void * arena_alloc_aligned(struct arena * arena, size_t size, size_t alignment);
+
+
+/// Return the current position of \p arena so that it can be restored with arena_rollback().
+struct arena_mark arena_mark(struct arena const * arena);
+
+
+/// Release every allocation made from \p arena since \p mark was created.
+///
+/// Marks made after \p mark are invalidated.
+void arena_rollback(struct arena * arena, struct arena_mark mark);
+
+
+/// Release every allocation made from \p arena but keep its chunks for reuse.
+void arena_reset(struct arena * arena);
+
+
+/// Return the total number of bytes of chunk memory owned by \p arena.
+size_t arena_capacity(struct arena const * arena);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -72,12 +72,25 @@ struct cli
 
 /// Parse the arguments supplied to the application on the command line.
 ///
+/// An unsupported argument is reported along with the closest supported
+/// one, found with cli_suggest(), before the usage is printed.
+///
 /// \param cli  The ::cli object that defines the supported arguments.
 /// \param argc The length of the \p argv array.
 /// \param argv An array of strings representing the arguments and their values.
 void cli_parse(struct cli * cli, int argc, char * argv[]);
 
 
+/// Return the name of the optional argument of \p cli that \p arg is most likely a typo of.
+///
+/// Long and short names are both considered. A name is only suggested if
+/// it's within a third of the length of \p arg in edit distance, and of
+/// equally close names the first one is suggested.
+///
+/// \return The name, or `NULL` if no name is close enough.
+char const * cli_suggest(struct cli const * cli, char const * arg);
+
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
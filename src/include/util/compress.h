@@ -0,0 +1,105 @@
+/// \file
+/// Compress short strings with a table of common substrings.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// A table of up to 255 symbols, substrings of 1 to 8 bytes, that strings are encoded with.
+///
+/// Every byte of an encoded string is the code of a symbol, or an escape
+/// code followed by a byte that isn't covered by any symbol, so each string
+/// is encoded and decoded independently of the others and can be read at
+/// random. This is the scheme of FSST (Fast Static Symbol Table compression).
+///
+/// Encoding takes the longest symbol that matches at each position, found
+/// with a few probes of a hash table of the symbols of 3 bytes or more and
+/// otherwise a lookup of the next two bytes. Decoding copies 8 bytes per
+/// code and advances by the symbol's length, so it's fast enough to do on
+/// every read. Because a table always encodes a string the same way, two
+/// strings encoded with the same table are equal if and only if their
+/// encodings are, so string_is_equal() compares them without decoding.
+///
+/// A compressor is never modified after it's trained so it can be shared between threads.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string_compressor * compressor = string_compressor_train(sample, sample_count);
+///     char encoded[2 * MAX_SIZE];
+///     size_t size = string_compressor_encode(encoded, compressor, &url);
+///     ...
+///     char decoded[MAX_SIZE];
+///     string_compressor_decode(decoded, sizeof(decoded), compressor,
+///                              &(struct string){encoded, size});
+///     string_compressor_free(compressor);
+/// \rst_end
+struct string_compressor;
+
+
+/// Train a compressor on the \p count strings in \p sample.
+///
+/// Training makes five passes over the sample. Each pass encodes it with the
+/// symbols chosen so far, counts how often each symbol, escaped byte and
+/// pair of consecutive ones appear, and then keeps the 255 of those and of
+/// their concatenations that would have saved the most bytes. A sample of a
+/// few thousand strings, or about 16 KiB, is usually enough.
+///
+/// \return The compressor or `NULL` if allocation fails.
+struct string_compressor * string_compressor_train(struct string const * sample, size_t count);
+
+
+/// De-allocate \p compressor.
+void string_compressor_free(struct string_compressor * compressor);
+
+
+/// Return the number of symbols in \p compressor.
+size_t string_compressor_symbol_count(struct string_compressor const * compressor);
+
+
+/// Encode \p input with \p compressor and store the result in \p output.
+///
+/// \p output must have room for `2 * input->size` bytes, which is the size
+/// when no symbol matches.
+///
+/// \return The size of the encoded string.
+size_t string_compressor_encode(char * output, struct string_compressor const * compressor,
+                                struct string const * input);
+
+
+/// Decode \p encoded, which was encoded with \p compressor, and store the result in \p output.
+///
+/// No more than \p capacity bytes are stored, but the returned size is
+/// always the size of the whole decoded string.
+///
+/// \return The size of the decoded string.
+size_t string_compressor_decode(char * output, size_t capacity,
+                                struct string_compressor const * compressor,
+                                struct string const * encoded);
+
+
+/// Return the size \p encoded, which was encoded with \p compressor, will have once decoded.
+size_t string_compressor_decoded_size(struct string_compressor const * compressor,
+                                      struct string const * encoded);
+
+
+/// Return true if \p encoded, which was encoded with \p compressor, decodes to \p string.
+///
+/// This stops at the first symbol that differs, without decoding the rest.
+/// To compare two encoded strings use string_is_equal() on the encodings.
+bool string_compressor_is_equal(struct string_compressor const * compressor,
+                                struct string const * encoded, struct string const * string);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,73 @@
+/// \file
+/// Detect and select the instruction set used by the vectorized util functions.
+#pragma once
+
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Defined when the compiler can build the x86 SIMD kernels.
+///
+/// The kernels are compiled with per-function target attributes so the rest
+/// of the project can still be built for a baseline x86 processor.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_X86_KERNELS 1
+#endif
+
+
+/// The instruction sets the vectorized util functions can dispatch to.
+///
+/// The values are ordered so that a processor supporting an instruction set
+/// also supports every instruction set with a smaller value.
+enum cpu_isa
+{
+    CPU_ISA_SCALAR, ///< Portable C; used as the fallback and as the test reference.
+    CPU_ISA_SSE2,   ///< 16-byte vectors.
+    CPU_ISA_AVX2,   ///< 32-byte vectors.
+    CPU_ISA_AVX512, ///< 64-byte vectors (requires AVX-512BW).
+};
+
+
+/// Return the name of \p isa.
+char const * cpu_isa_to_string(enum cpu_isa isa);
+
+
+/// Return the best instruction set supported by the processor and operating system.
+enum cpu_isa cpu_isa_supported();
+
+
+/// Return the instruction set the vectorized util functions currently dispatch to.
+///
+/// The first time it is called, unless an instruction set has been selected
+/// already, it calls cpu_init() to select one.
+enum cpu_isa cpu_isa_get();
+
+
+/// Make the vectorized util functions dispatch to \p isa.
+///
+/// \return `true` if \p isa is supported and was selected and `false` otherwise,
+///         in which case the selection is unchanged.
+bool cpu_isa_set(enum cpu_isa isa);
+
+
+/// Initialise the instruction set selection.
+///
+/// This lowers the selected instruction set to the value of the `CPU_ISA`
+/// environment variable, which should be one of `Scalar`, `SSE2`, `AVX2` or
+/// `AVX512`. If the variable does not exist the best supported instruction
+/// set is used, and if it names one the processor doesn't support a warning
+/// is logged and the best supported one is used instead. An invalid value
+/// is an error and exits.
+///
+/// It's called by cpu_isa_get() the first time, so it only needs calling to
+/// read the variable again.
+void cpu_init();
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,122 @@
+/// \file
+/// Tokenize CSV and TSV data into fields, either whole or one chunk at a time.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Return codes for csv_reader_next().
+enum csv_rc
+{
+    /// A field was stored and the record has more fields.
+    CSV_RC_FIELD,
+    /// The last field of a record was stored.
+    CSV_RC_RECORD,
+    /// Every field that ends in the current chunk has been returned. Pass the
+    /// next chunk to csv_reader_feed() to continue.
+    CSV_RC_NEED_INPUT,
+    /// The final chunk has ended and every field has been returned.
+    CSV_RC_END,
+    /// Allocation failed.
+    CSV_RC_ERROR,
+};
+
+
+/// A tokenizer of delimiter separated values, as described by RFC 4180.
+///
+/// Records end with `\n` or `\r\n` and fields are separated by a delimiter,
+/// usually `,` or `\t`. A field that starts and ends with `"` is quoted: it
+/// can contain delimiters, newlines and quotes, which are escaped by
+/// doubling them, and is returned without the surrounding quotes. Malformed
+/// input isn't rejected; a `"` anywhere starts or ends a quoted section, and
+/// fields that aren't entirely quoted are returned as they are. An empty
+/// line is a record with one empty field.
+///
+/// The input is read 64 bytes at a time with the instruction set selected by
+/// cpu_isa_get(), which finds the quotes, delimiters and newlines as bit
+/// masks. Whether each byte is inside quotes is the prefix XOR of the quote
+/// mask, carried from one block to the next, so the delimiters and newlines
+/// inside quotes are discarded without a branch per byte.
+///
+/// Fields are views of the input. Only the fields with escaped quotes, and
+/// the fields that straddle two chunks, are copied into buffers owned by the
+/// reader.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct csv_reader reader;
+///     csv_reader_init(&reader, ',');
+///     csv_reader_feed(&reader, &contents, true);
+///
+///     struct string field;
+///     enum csv_rc rc;
+///     while ((rc = csv_reader_next(&reader, &field)) == CSV_RC_FIELD || rc == CSV_RC_RECORD)
+///         process(&field, rc == CSV_RC_RECORD);
+///     csv_reader_free(&reader);
+/// \rst_end
+struct csv_reader
+{
+    struct string chunk;             ///< The input being tokenized.
+    size_t start;                    ///< The offset in \p chunk of the next field.
+    size_t block;                    ///< The offset in \p chunk of the block \p mask describes.
+    size_t next_block;               ///< The offset in \p chunk of the next block to read.
+    uint64_t mask;                   ///< The delimiters and newlines in the block not yet used.
+    uint64_t inside;                 ///< All ones if the next block starts inside quotes.
+    struct string_builder pending;   ///< The start of a field that straddles chunks.
+    struct string_builder unescaped; ///< The last field returned with its quotes unescaped.
+    char delimiter;                  ///< The byte that separates fields.
+    bool final;                      ///< `true` if \p chunk is the last chunk.
+    bool record_start;               ///< `true` if the next field starts a record.
+    bool pending_returned;           ///< `true` if the last field returned was \p pending.
+};
+
+
+/// Initialise \p reader to split fields about \p delimiter.
+///
+/// \p delimiter mustn't be `"`, `\r` or `\n`. No memory is allocated until a
+/// field needs copying.
+void csv_reader_init(struct csv_reader * reader, char delimiter);
+
+
+/// De-allocate the buffers of \p reader.
+void csv_reader_free(struct csv_reader * reader);
+
+
+/// Make \p chunk the input of \p reader.
+///
+/// A whole buffer can be tokenized by passing it as the only chunk. Otherwise
+/// pass each chunk after csv_reader_next() returns ::CSV_RC_NEED_INPUT, until
+/// the last, for which \p final must be `true`. Chunks can be cut anywhere,
+/// even within a field or between `\r` and `\n`. \p chunk isn't copied and
+/// must outlive the fields returned from it.
+void csv_reader_feed(struct csv_reader * reader, struct string const * chunk, bool final);
+
+
+/// Store a view of the next field in \p field.
+///
+/// \note \p field is only valid until the next call, and until the chunk it
+///       came from is released.
+///
+/// \return One of the following codes:
+///     - ::CSV_RC_FIELD: The next field was stored and its record continues.
+///     - ::CSV_RC_RECORD: The last field of a record was stored.
+///     - ::CSV_RC_NEED_INPUT: Call csv_reader_feed() with the next chunk.
+///     - ::CSV_RC_END: There are no fields left.
+///     - ::CSV_RC_ERROR: A field couldn't be copied because allocation failed.
+enum csv_rc csv_reader_next(struct csv_reader * reader, struct string * field);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
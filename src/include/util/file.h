@@ -0,0 +1,183 @@
+/// \file
+/// Read files as strings, either whole or one record at a time, and write arrays of strings.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Hints for file_map() about how the file will be read.
+///
+/// Flags can be combined with `|`. They only affect performance, and hints
+/// the operating system doesn't support are ignored.
+enum file_map_flags
+{
+    FILE_MAP_SEQUENTIAL = 1 << 0, ///< The file will be read from start to end.
+    FILE_MAP_WILLNEED = 1 << 1,   ///< Start reading the whole file in the background.
+    FILE_MAP_HUGEPAGE = 1 << 2,   ///< Back the view with huge pages if possible.
+    FILE_MAP_POPULATE = 1 << 3,   ///< Read the whole file before returning.
+};
+
+
+/// Map the file at \p path into memory and store a read-only view of it in \p contents.
+///
+/// Nothing is copied: pages of the file are read on demand the first time
+/// they're touched, and are shared with the operating system's file cache,
+/// so every `string_view_` function works on the whole file without using
+/// any extra memory. The view isn't `'\0'` terminated and mustn't be written to.
+///
+/// An empty file gives an empty view with \p data `NULL`. On systems
+/// without `mmap` the file is read into an allocated buffer instead.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string contents;
+///     if (!file_map(&contents, path, FILE_MAP_SEQUENTIAL))
+///         return false;
+///
+///     struct string_split_iter iter;
+///     struct string line;
+///     string_split_iter_init(&iter, &contents, '\n');
+///     while (string_split_iter_next(&iter, &line))
+///         process(&line);
+///     file_unmap(&contents);
+/// \rst_end
+///
+/// \note \p contents must be released by calling file_unmap().
+///
+/// \param contents The view of the file.
+/// \param path     The path of the file to map.
+/// \param flags    A combination of ::file_map_flags or `0`.
+/// \return `true` on success and `false`, with `errno` set, if the file
+///         can't be opened or mapped.
+bool file_map(struct string * contents, char const * path, unsigned flags);
+
+
+/// Release a view made by file_map() and make \p contents empty.
+///
+/// Views of \p contents, such as the pieces of a split, are invalidated.
+void file_unmap(struct string * contents);
+
+
+/// Return codes for file_reader_next().
+enum file_reader_rc
+{
+    /// A record was stored.
+    FILE_READER_RC_OK,
+    /// The input has ended and every record has been returned.
+    FILE_READER_RC_END,
+    /// A record didn't fit in the buffer. The start of it was stored and the
+    /// rest will be skipped.
+    FILE_READER_RC_TOO_LONG,
+    /// Reading failed and `errno` describes why.
+    FILE_READER_RC_ERROR,
+};
+
+
+/// A reader of delimited records, such as lines, from a file descriptor.
+///
+/// Unlike file_map() this works on pipes, sockets and terminals, and reads
+/// unbounded input with a fixed amount of memory. The buffer is filled with
+/// reads as large as the free space in it and records are returned as views
+/// of the buffer. When a record straddles the end of the buffer only that
+/// record's bytes are moved to the start of the buffer before reading more.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct file_reader reader;
+///     if (!file_reader_init(&reader, STDIN_FILENO, '\n', 0))
+///         return false;
+///
+///     struct string line;
+///     enum file_reader_rc rc;
+///     while ((rc = file_reader_next(&reader, &line)) == FILE_READER_RC_OK)
+///         process(&line);
+///     file_reader_free(&reader);
+/// \rst_end
+struct file_reader
+{
+    int fd;          ///< The file descriptor records are read from.
+    char * buffer;   ///< The buffer of bytes read from \p fd.
+    size_t capacity; ///< The size of \p buffer in bytes.
+    size_t start;    ///< The offset of the next record in \p buffer.
+    size_t scanned;  ///< The offset up to which there is no delimiter after \p start.
+    size_t end;      ///< The offset of the end of the bytes read into \p buffer.
+    char delimiter;  ///< The byte that ends each record.
+    bool skipping;   ///< `true` while skipping the rest of a record that was too long.
+    bool eof;        ///< `true` once a read has reached the end of the input.
+};
+
+
+/// Initialise \p reader to read records ending in \p delimiter from \p fd.
+///
+/// \p fd isn't closed by the reader. If \p capacity is `0` a default of
+/// 256 KiB is used. Records of \p capacity bytes or more can't be returned whole.
+///
+/// \return `true` on success and `false` if allocation fails.
+bool file_reader_init(struct file_reader * reader, int fd, char delimiter, size_t capacity);
+
+
+/// De-allocate the buffer of \p reader.
+void file_reader_free(struct file_reader * reader);
+
+
+/// Store a view of the next record, without its delimiter, in \p record.
+///
+/// The final record doesn't need a delimiter; if the input ends with one
+/// there's no empty record after it. Reads that are interrupted by a signal
+/// are retried.
+///
+/// \note \p record is only valid until the next call.
+///
+/// \return One of the following codes:
+///     - ::FILE_READER_RC_OK: The next record was stored in \p record.
+///     - ::FILE_READER_RC_END: There are no records left.
+///     - ::FILE_READER_RC_TOO_LONG: The record doesn't fit in the buffer.
+///       Its first `capacity` bytes were stored in \p record and the next
+///       call returns the record after it.
+///     - ::FILE_READER_RC_ERROR: Reading failed; `errno` is set.
+enum file_reader_rc file_reader_next(struct file_reader * reader, struct string * record);
+
+
+/// Write the \p count strings in \p strings to \p fd, with \p separator between each two.
+///
+/// This has the same output as writing the result of string_join_array(),
+/// without copying the strings into one buffer first: the pieces are passed
+/// to `writev` in batches of up to `IOV_MAX`, and runs of pieces shorter
+/// than 128 bytes are copied into a small staging buffer so they use one
+/// entry instead of one each. Partial writes are continued and writes that
+/// are interrupted by a signal are retried. On systems without `writev`
+/// each entry is written separately.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     if (!file_write_strings(STDOUT_FILENO, lines, line_count, &string_literal("\n")))
+///         perror("write");
+/// \rst_end
+///
+/// \param fd        The file descriptor to write to.
+/// \param strings   The strings to write.
+/// \param count     The number of strings in \p strings.
+/// \param separator The string written between each two strings, or `NULL` for none.
+/// \return `true` on success and `false`, with `errno` set, if writing fails.
+///         Some of the strings may have been written.
+bool file_write_strings(int fd, struct string const * strings, size_t count,
+                        struct string const * separator);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
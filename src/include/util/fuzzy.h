@@ -0,0 +1,88 @@
+/// \file
+/// Measure how many edits apart strings are and find the closest ones.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Return the Levenshtein distance between \p a and \p b.
+///
+/// The distance is the fewest single byte insertions, deletions and
+/// substitutions that turn one string into the other. Rather than filling
+/// the whole table of distances between prefixes, one byte at a time, each
+/// column of the table is stored as two bit vectors of the steps up and down
+/// between rows, and a column is computed from the previous one with a
+/// dozen bitwise operations per 64 rows. This is Myers' algorithm as
+/// formulated by Hyyrö. The shorter string is used for the rows so strings
+/// of up to 64 bytes take a single word per column and longer ones are
+/// processed in blocks of 64 rows.
+///
+/// \return The distance, or `SIZE_MAX` if both strings are over 64 bytes
+///         long and allocation fails.
+size_t string_edit_distance(struct string const * a, struct string const * b);
+
+
+/// Return true if \p a and \p b are no more than \p max_distance edits apart.
+///
+/// This is faster than comparing string_edit_distance() with \p max_distance
+/// because it stops as soon as the distance is known to be greater. Strings
+/// whose sizes differ by more than \p max_distance aren't compared at all,
+/// and only the blocks of rows that can still be within \p max_distance of
+/// the diagonal are computed for each column, as in Ukkonen's cut-off.
+///
+/// \return The result, or `false` if both strings are over 64 bytes long
+///         and allocation fails.
+bool string_edit_distance_within(struct string const * a, struct string const * b,
+                                 size_t max_distance);
+
+
+/// A candidate found by string_find_closest().
+struct string_candidate
+{
+    size_t index;    ///< The index of the candidate in the array searched.
+    size_t distance; ///< The edit distance from the candidate to the query.
+};
+
+
+/// Find the candidates closest to \p query by edit distance.
+///
+/// The positions of each byte of \p query are computed once and reused for
+/// every candidate. Once \p capacity candidates have been found, only those
+/// closer than the furthest of them are looked for, so most candidates are
+/// rejected after a few bytes or without being compared at all.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string_candidate closest;
+///     if (string_find_closest(&closest, 1, &name, known_names, known_count, 2) == 1)
+///         printf("Did you mean %.*s?\n", (int)known_names[closest.index].size,
+///                known_names[closest.index].data);
+/// \rst_end
+///
+/// \param output       Where the candidates are stored, closest first. Ties
+///                     are in the order of \p candidates.
+/// \param capacity     The most candidates to store.
+/// \param query        The string to find.
+/// \param candidates   The strings to search.
+/// \param count        The number of strings in \p candidates.
+/// \param max_distance The greatest distance a candidate may be from \p query.
+/// \return The number of candidates stored, or `0` if \p query is over 64
+///         bytes long and allocation fails.
+size_t string_find_closest(struct string_candidate * output, size_t capacity,
+                           struct string const * query, struct string const * candidates,
+                           size_t count, size_t max_distance);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,78 @@
+/// \file
+/// Intern strings so that equal strings share the same memory.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// A thread-safe table of interned strings (atoms).
+///
+/// Interning a string returns a view of the table's canonical copy of it, so
+/// every atom with the same contents has the same \p data pointer and
+/// string_is_same() is a valid, constant-time equality test between atoms.
+///
+/// Lookups never take a lock. Inserts lock one of many independent shards,
+/// chosen by the string's hash, so threads inserting different strings rarely
+/// contend. Atoms stay valid until the table is freed.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct intern_table * table = intern_table_make();
+///     struct string info, key;
+///     intern_string(table, &string_literal("Info"), &info);
+///     intern_string(table, &input, &key);
+///     if (string_is_same(&key, &info))
+///         ...
+///     intern_table_free(table);
+/// \rst_end
+struct intern_table;
+
+
+/// Allocate an empty table.
+/// \return The table or `NULL` if allocation fails.
+struct intern_table * intern_table_make();
+
+
+/// De-allocate \p table and every atom it owns.
+///
+/// No other thread may be using \p table.
+void intern_table_free(struct intern_table * table);
+
+
+/// Store the atom for \p string in \p atom, adding it to \p table if needed.
+///
+/// The atom's contents are followed by a `'\0'` so it can also be used as a
+/// C string. Safe to call concurrently from any number of threads.
+///
+/// \return `true` on success and `false` if allocation fails.
+bool intern_string(struct intern_table * table, struct string const * string,
+                   struct string * atom);
+
+
+/// Store the atom for \p string in \p atom if \p string has been interned.
+///
+/// This never modifies \p table and never blocks. Safe to call concurrently
+/// with intern_string().
+///
+/// \return `true` if \p string has been interned and `false` otherwise.
+bool intern_lookup(struct intern_table const * table, struct string const * string,
+                   struct string * atom);
+
+
+/// Return the number of atoms in \p table.
+size_t intern_table_size(struct intern_table const * table);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
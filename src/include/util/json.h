@@ -0,0 +1,218 @@
+/// \file
+/// Tokenize JSON into views of the input, either whole or one chunk at a time.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// The most objects and arrays a ::json_reader can have open at once.
+#define JSON_MAX_DEPTH 1024
+
+
+/// Return codes for json_reader_next().
+enum json_rc
+{
+    /// A token was stored.
+    JSON_RC_TOKEN,
+    /// Every token that ends in the current chunk has been returned. Pass the
+    /// next chunk to json_reader_feed() to continue.
+    JSON_RC_NEED_INPUT,
+    /// The final chunk has ended and every token has been returned.
+    JSON_RC_END,
+    /// The input isn't valid JSON. The offset of the problem is stored in the
+    /// reader's `offset`.
+    JSON_RC_INVALID,
+    /// Allocation failed.
+    JSON_RC_ERROR,
+};
+
+
+/// The types of token returned by json_reader_next().
+enum json_token_type
+{
+    JSON_TOKEN_OBJECT_START, ///< A `{`.
+    JSON_TOKEN_OBJECT_END,   ///< A `}`.
+    JSON_TOKEN_ARRAY_START,  ///< A `[`.
+    JSON_TOKEN_ARRAY_END,    ///< A `]`.
+    JSON_TOKEN_KEY,          ///< A string that names a member of an object.
+    JSON_TOKEN_STRING,       ///< A string that is a value.
+    JSON_TOKEN_NUMBER,       ///< A number.
+    JSON_TOKEN_TRUE,         ///< `true`.
+    JSON_TOKEN_FALSE,        ///< `false`.
+    JSON_TOKEN_NULL,         ///< `null`.
+};
+
+
+/// A token returned by json_reader_next().
+struct json_token
+{
+    enum json_token_type type; ///< What the token is.
+    /// The bytes of the token. Keys and strings are the bytes between the
+    /// quotes with any escapes left in; pass them to json_string_decode() to
+    /// decode them. Numbers can be converted with json_number_to_int64() and
+    /// json_number_to_double().
+    struct string text;
+};
+
+
+/// The masks of the bytes of a block of input. The layout is private to json.c.
+struct json_block;
+
+
+/// A tokenizer of JSON, as described by RFC 8259.
+///
+/// Tokens are returned in the order they appear, like the events of a SAX
+/// parser, and the grammar is checked as they are, so the input is rejected
+/// at the first token that's out of place. Literals must be spelled right
+/// and numbers must start with a digit or a minus sign, but the rest of a
+/// number, like the contents of a string, is only checked when it's
+/// converted or decoded. The input may hold several values one after
+/// another, such as the lines of a JSON Lines file.
+///
+/// The input is read 64 bytes at a time with the instruction set selected by
+/// cpu_isa_get(), which finds the quotes, backslashes, structural characters
+/// and whitespace as bit masks. The quotes escaped by an odd run of
+/// backslashes are removed with a few additions and shifts, whether each
+/// byte is inside a string is the prefix XOR of the quotes that are left, and
+/// numbers and literals are the runs of bytes that are none of these. The
+/// structural characters outside strings, the quotes and the starts of the
+/// runs make a mask of where tokens start, and the end of each token is
+/// found from the masks too, so the bytes within strings and numbers are
+/// never looked at one at a time. The instruction set is read when each
+/// chunk is fed.
+///
+/// Tokens are views of the input, so a whole buffer, such as a file mapped
+/// with file_map(), is tokenized without copying anything. Only the tokens
+/// that straddle two chunks are copied into a buffer owned by the reader.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string contents;
+///     if (!file_map(&contents, path, FILE_MAP_SEQUENTIAL))
+///         return false;
+///
+///     struct json_reader reader;
+///     json_reader_init(&reader);
+///     json_reader_feed(&reader, &contents, true);
+///
+///     struct json_token token;
+///     enum json_rc rc;
+///     while ((rc = json_reader_next(&reader, &token)) == JSON_RC_TOKEN)
+///         process(&token);
+///     json_reader_free(&reader);
+///     file_unmap(&contents);
+/// \rst_end
+struct json_reader
+{
+    struct string chunk;                   ///< The input being tokenized.
+    size_t chunk_offset;                   ///< The offset of \p chunk in the whole input.
+    size_t start;                          ///< The offset in \p chunk of the token being read.
+    size_t block;                          ///< The offset in \p chunk of the current block.
+    size_t next_block;                     ///< The offset in \p chunk of the next block to read.
+    uint64_t mask;                         ///< The token boundaries in the block not yet read.
+    uint64_t inside;                       ///< All ones if the next block starts inside a string.
+    uint64_t escaped;                      ///< `1` if the first byte of the next block is escaped.
+    uint64_t scalar;                       ///< `1` if the last byte read is in a number or literal.
+    uint64_t scalars;                      ///< The bytes of numbers and literals in the block.
+    struct string_builder pending;         ///< The start of a token that straddles chunks.
+    uint64_t objects[JSON_MAX_DEPTH / 64]; ///< A bit per open container, set for objects.
+    size_t depth;                          ///< The number of open objects and arrays.
+    size_t offset;                         ///< The offset in the input of the last token or error.
+    int expect;                            ///< What the grammar allows next.
+    int open;                              ///< The kind of token being read, if any.
+    bool final;                            ///< `true` if \p chunk is the last chunk.
+    bool pending_returned;                 ///< `true` if the last token returned was \p pending.
+    /// The kernel that classifies whole blocks, chosen by json_reader_feed().
+    void (*classify)(struct json_block * block, char const * data);
+};
+
+
+/// Initialise \p reader. No memory is allocated until a token needs copying.
+void json_reader_init(struct json_reader * reader);
+
+
+/// De-allocate the buffer of \p reader.
+void json_reader_free(struct json_reader * reader);
+
+
+/// Make \p chunk the input of \p reader.
+///
+/// A whole buffer can be tokenized by passing it as the only chunk. Otherwise
+/// pass each chunk after json_reader_next() returns ::JSON_RC_NEED_INPUT,
+/// until the last, for which \p final must be `true`. Chunks can be cut
+/// anywhere, even within a string or an escape. \p chunk isn't copied and
+/// must outlive the tokens returned from it.
+void json_reader_feed(struct json_reader * reader, struct string const * chunk, bool final);
+
+
+/// Store the next token in \p token.
+///
+/// \note The text of \p token is only valid until the next call, and until
+///       the chunk it came from is released.
+///
+/// \return One of the following codes:
+///     - ::JSON_RC_TOKEN: The next token was stored.
+///     - ::JSON_RC_NEED_INPUT: Call json_reader_feed() with the next chunk.
+///     - ::JSON_RC_END: There are no tokens left.
+///     - ::JSON_RC_INVALID: The input isn't valid JSON. The reader can't be
+///       used again until it's initialised again.
+///     - ::JSON_RC_ERROR: A token couldn't be copied because allocation failed.
+enum json_rc json_reader_next(struct json_reader * reader, struct json_token * token);
+
+
+/// Store up to \p capacity tokens in \p tokens and the number stored in \p count.
+///
+/// This is the same as calling json_reader_next() until it returns
+/// something other than a token or \p capacity tokens are stored, but
+/// without a call for each token. A token that straddles chunks ends the
+/// batch it's in, so a batch can be short even though more tokens follow.
+///
+/// \note The text of the tokens is only valid until the next call, and until
+///       the chunks they came from are released.
+///
+/// \return ::JSON_RC_TOKEN if more tokens may follow those stored, which is
+///         always the case when \p tokens is full, and otherwise the code
+///         json_reader_next() would return after the last token stored.
+enum json_rc json_reader_next_batch(struct json_reader * reader, struct json_token * tokens,
+                                    size_t capacity, size_t * count);
+
+
+/// Decode the escapes in \p string, the text of a key or string token, into \p output.
+///
+/// Escaped code points, including surrogate pairs, are encoded as UTF-8.
+/// The decoded string is never longer than \p string, so \p output needs
+/// room for `string->size` bytes. Strings without escapes are copied as
+/// they are, so check for a backslash first to avoid copying them.
+///
+/// \return The size of the decoded string, or `SIZE_MAX` if \p string has
+///         an escape that isn't valid, a lone surrogate or a control character.
+size_t json_string_decode(char * output, struct string const * string);
+
+
+/// Convert the text of a number token to an integer.
+///
+/// \return `true` on success and `false` if \p number isn't a valid number,
+///         has a fraction or an exponent or is out of range.
+bool json_number_to_int64(int64_t * result, struct string const * number);
+
+
+/// Convert the text of a number token to the nearest double.
+///
+/// \return `true` on success and `false` if \p number isn't a valid number.
+bool json_number_to_double(double * result, struct string const * number);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
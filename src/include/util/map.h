@@ -0,0 +1,138 @@
+/// \file
+/// A hash map keyed by strings.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// A key and its value in a ::string_map.
+struct string_map_entry
+{
+    struct string key; ///< A view of the key; the map doesn't copy keys.
+    void * value;      ///< The value, which may be modified in place.
+};
+
+
+/// An open-addressing hash map from strings to pointers.
+///
+/// The slots are split into groups of 16, each with 16 control bytes that
+/// hold 7 bits of the hash of the key in each slot, so a lookup compares the
+/// control bytes of a whole group with one SIMD comparison and only compares
+/// keys whose control byte matches. Lookups therefore rarely touch more than
+/// one cache line of control bytes and one entry.
+///
+/// The map stores views of its keys rather than copies, so the contents of
+/// every key must stay valid, and unchanged, while it is in the map. Keys
+/// returned by intern_string() or allocated from an ::arena are convenient.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string_map map;
+///     string_map_init(&map);
+///     string_map_insert(&map, &string_literal("info"), &info_handler);
+///
+///     struct string_map_entry * entry = string_map_find(&map, &name);
+///     if (entry != NULL)
+///         handle(entry->value);
+///     string_map_free(&map);
+/// \rst_end
+struct string_map
+{
+    unsigned char * control;           ///< The control byte of every slot.
+    struct string_map_entry * entries; ///< The entry in every slot.
+    size_t capacity;                   ///< The number of slots; `0` or a multiple of 16.
+    size_t size;                       ///< The number of entries.
+    size_t growth_left;                ///< The number of empty slots that can be used.
+    uint64_t seed;                     ///< The seed of the hash of the keys.
+};
+
+
+/// Initialise an empty map. No memory is allocated.
+void string_map_init(struct string_map * map);
+
+
+/// De-allocate the memory owned by \p map and make it empty.
+///
+/// The keys and values themselves aren't freed.
+void string_map_free(struct string_map * map);
+
+
+/// Return the number of entries in \p map.
+size_t string_map_size(struct string_map const * map);
+
+
+/// Make room for \p count entries in total so inserting them won't allocate.
+///
+/// \return `true` on success and `false` if allocation fails.
+bool string_map_reserve(struct string_map * map, size_t count);
+
+
+/// Map \p key to \p value, replacing the value if \p key is already present.
+///
+/// \p key's contents must outlive the entry. If \p key is already present the
+/// entry keeps its original key.
+///
+/// \return `true` on success and `false` if allocation fails, in which case
+///         \p map is unchanged.
+bool string_map_insert(struct string_map * map, struct string const * key, void * value);
+
+
+/// Return the entry for \p key or `NULL` if \p key isn't in \p map.
+///
+/// The entry is invalidated by the next insertion or erasure.
+struct string_map_entry * string_map_find(struct string_map const * map,
+                                          struct string const * key);
+
+
+/// Find the entries of many keys at once.
+///
+/// Store the entry for each of the \p count \p keys, or `NULL` if it isn't in
+/// \p map, in \p output, which must have room for \p count pointers. This is
+/// faster than calling string_map_find() on each key when the map is too
+/// large for the cache, because the memory for several keys is prefetched
+/// before any of it is needed.
+///
+/// \return The number of keys that were found.
+size_t string_map_find_batch(struct string_map_entry ** output, struct string_map const * map,
+                             struct string const * keys, size_t count);
+
+
+/// Remove the entry for \p key from \p map.
+///
+/// \return `true` if \p key was in \p map and `false` otherwise.
+bool string_map_erase(struct string_map * map, struct string const * key);
+
+
+/// Return the next entry of \p map, in no particular order.
+///
+/// \p position must be `0` for the first call and is advanced past the
+/// returned entry. The map mustn't be modified during iteration.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     size_t position = 0;
+///     struct string_map_entry * entry;
+///     while ((entry = string_map_next(&map, &position)) != NULL)
+///         free(entry->value);
+/// \rst_end
+///
+/// \return The entry or `NULL` if there are no more entries.
+struct string_map_entry * string_map_next(struct string_map const * map, size_t * position);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
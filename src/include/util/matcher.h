@@ -0,0 +1,160 @@
+/// \file
+/// Search text for many patterns at once.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// A compiled set of patterns that can be searched for in a single pass.
+///
+/// The patterns are compiled into an Aho-Corasick automaton, so searching
+/// takes time proportional to the size of the text plus the number of
+/// matches, however many patterns there are. Bytes that don't appear in any
+/// pattern share one transition, and the states near the root, which most
+/// bytes of a typical text visit, have a dense row of transitions so they
+/// cost one load per byte. Deeper states store only their children and fall
+/// back to shallower states on a mismatch.
+///
+/// A matcher is never modified after it's made so it can be shared between threads.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string patterns[] = {string_literal("he"), string_literal("she")};
+///     struct string_matcher * matcher = string_matcher_make(patterns, 2);
+///     struct string_match * matches;
+///     size_t count = string_matcher_find_all(&matches, matcher, &text);
+///     for (size_t i = 0; i < count; ++i)
+///         handle(patterns + matches[i].pattern, matches[i].offset);
+///     free(matches);
+///     string_matcher_free(matcher);
+/// \rst_end
+struct string_matcher;
+
+
+/// A match of one of the patterns of a ::string_matcher.
+struct string_match
+{
+    size_t offset;  ///< The offset of the match in the text.
+    size_t pattern; ///< The index of the pattern that matched.
+};
+
+
+/// Compile the \p count strings in \p patterns into a matcher.
+///
+/// The patterns are copied so they don't need to outlive the matcher. Empty
+/// patterns never match, and if several patterns are equal only the first
+/// of them is reported.
+///
+/// \return The matcher or `NULL` if allocation fails.
+struct string_matcher * string_matcher_make(struct string const * patterns, size_t count);
+
+
+/// De-allocate \p matcher.
+void string_matcher_free(struct string_matcher * matcher);
+
+
+/// Find every occurrence of every pattern in \p text and store them in \p output.
+///
+/// Matches may overlap. They are ordered by where they end and, for matches
+/// that end at the same offset, from longest to shortest.
+///
+/// \note \p output must be deallocated by calling \rst :cppref:`~c/memory/free` \rst_end.
+///
+/// \return The number of matches stored in \p output. If there are no matches
+///         or allocation fails `0` is returned and \p output is set to `NULL`.
+size_t string_matcher_find_all(struct string_match ** output,
+                               struct string_matcher const * matcher,
+                               struct string const * text);
+
+
+/// Store a copy of \p text in \p output with matches replaced by the corresponding
+/// element of \p replacements.
+///
+/// Matches are chosen from left to right without overlapping. Of the matches
+/// that start at the same offset the longest is chosen. \p replacements must
+/// have one element per pattern passed to string_matcher_make(). The size of
+/// \p output is computed before it's allocated so it's allocated exactly once.
+///
+/// \note \p output must be deallocated by calling string_free().
+///
+/// \return `true` on success and `false` if allocation fails.
+bool string_matcher_replace_all(struct string * output, struct string_matcher const * matcher,
+                                struct string const * text,
+                                struct string const * replacements);
+
+
+/// A compiled set of prefixes that text can be tested against in one pass.
+///
+/// The prefixes are compiled into a compressed trie: a node only exists
+/// where prefixes branch or end, and the edge into it is labelled with all
+/// the bytes between it and its parent. Finding every prefix of a text is
+/// one walk down the trie, comparing each byte of the text at most once, so
+/// it takes time proportional to the length of the longest matching prefix
+/// however many prefixes there are. The nodes are in breadth-first order in
+/// one array of 16-byte entries, with the children of each node next to each
+/// other, and the first bytes of their edges in a separate byte array that
+/// is searched with memchr().
+///
+/// A prefix matcher is never modified after it's made so it can be shared between threads.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string routes[] = {string_literal("/api/"), string_literal("/api/v2/")};
+///     struct string_prefix_matcher * router = string_prefix_matcher_make(routes, 2);
+///     size_t route = string_prefix_matcher_longest(router, &path);
+///     if (route != STRING_NPOS)
+///         handle(routes + route, &path);
+///     string_prefix_matcher_free(router);
+/// \rst_end
+struct string_prefix_matcher;
+
+
+/// Compile the \p count strings in \p prefixes into a prefix matcher.
+///
+/// The prefixes are copied so they don't need to outlive the matcher. An
+/// empty prefix matches every text, and if several prefixes are equal only
+/// the first of them is reported.
+///
+/// \return The prefix matcher or `NULL` if allocation fails.
+struct string_prefix_matcher * string_prefix_matcher_make(struct string const * prefixes,
+                                                          size_t count);
+
+
+/// De-allocate \p matcher.
+void string_prefix_matcher_free(struct string_prefix_matcher * matcher);
+
+
+/// Return the index of the longest prefix of \p text in \p matcher, or ::STRING_NPOS if
+/// none of the prefixes are prefixes of \p text.
+size_t string_prefix_matcher_longest(struct string_prefix_matcher const * matcher,
+                                     struct string const * text);
+
+
+/// Find every prefix of \p text in \p matcher and store their indices in \p output,
+/// from shortest to longest.
+///
+/// No more than \p capacity indices are stored, but all the matches are
+/// counted, so if the result is larger than \p capacity it's the capacity
+/// needed to store them all.
+///
+/// \return The number of prefixes of \p text in \p matcher.
+size_t string_prefix_matcher_all(size_t * output, size_t capacity,
+                                 struct string_prefix_matcher const * matcher,
+                                 struct string const * text);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -13,6 +13,10 @@ extern "C" {
 
 
 /// Convert \p string to a boolean and store the result to \p result.
+///
+/// `false`, `0` and `off` are false and `true`, `1` and `on` are true. The
+/// comparisons ignore the case of ASCII letters, see string_is_equal_ignore_case().
+///
 /// \return `true` if the conversion succeeds and `false` otherwise.
 bool parse_bool(char const * string, bool * result);
 
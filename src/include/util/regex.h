@@ -0,0 +1,99 @@
+/// \file
+/// Match regular expressions against strings in linear time.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// A compiled regular expression.
+///
+/// The pattern is compiled into a Thompson NFA, which is run as a DFA whose
+/// states are the sets of NFA instructions that are alive. States are only
+/// built the first time a search reaches them and are then cached, so every
+/// byte of the text costs one table lookup once the common paths have been
+/// seen, and searching takes time linear in the size of the text however the
+/// pattern is written. Bytes that every part of the pattern treats alike
+/// share a class, which keeps the rows of the table short. When the cache
+/// fills up it's cleared and built again as the search goes on.
+///
+/// If every match starts with the same bytes, searching skips to the next
+/// occurrence of them with string_find() instead of running the DFA over
+/// text that can't start a match.
+///
+/// The syntax is a common subset of POSIX extended and Perl regular
+/// expressions:
+///
+/// - `.` matches any byte but a newline.
+/// - `[abc]`, `[a-z]` and `[^abc]` match one byte of a set or not in it.
+/// - `\d`, `\w` and `\s` match an ASCII digit, word byte or space, and `\D`,
+///   `\W` and `\S` any other byte. They may also be used in sets.
+/// - `\n`, `\r`, `\t`, `\f`, `\v` and `\xHH` match a byte. Any other escaped
+///   byte that isn't a letter or digit matches itself.
+/// - `*`, `+`, `?`, `{m}`, `{m,}` and `{m,n}` repeat what comes before them,
+///   as many times as possible, or as few if followed by `?`. Counts may be
+///   at most 1000.
+/// - `a|b` matches either side, preferring the left.
+/// - `(...)` and `(?:...)` group. Groups don't capture.
+/// - `^` and `$` match at the start and end of the text.
+///
+/// Matching works on bytes, so patterns and text needn't be null-terminated
+/// and may contain null bytes.
+///
+/// \note Searching adds to the cache, so a regex can't be searched by more
+///       than one thread at a time.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string_regex * regex = string_regex_make(&string_literal("took (\\d+)ms"));
+///     struct string match;
+///     if (string_regex_find(&match, regex, &line))
+///         printf("%.*s\n", (int)match.size, match.data);
+///     string_regex_free(regex);
+/// \rst_end
+struct string_regex;
+
+
+/// Compile \p pattern into a regex.
+///
+/// \return The regex or `NULL` if \p pattern isn't valid or allocation fails.
+struct string_regex * string_regex_make(struct string const * pattern);
+
+
+/// De-allocate \p regex.
+void string_regex_free(struct string_regex * regex);
+
+
+/// Return true if \p regex matches any part of \p text.
+///
+/// This stops at the first match found, so it's faster than
+/// string_regex_find() when where the match is doesn't matter.
+bool string_regex_is_match(struct string_regex * regex, struct string const * text);
+
+
+/// Find the leftmost match of \p regex in \p text and store a view of it in \p match.
+///
+/// Of the matches that start at the same offset, the one chosen is the one
+/// that a backtracking matcher such as Perl's would find. That includes
+/// repetitions of sub-patterns that can match the empty string, such as
+/// `(a*?)*`, which stop once a repetition matches nothing, as Perl's do. The
+/// DFA finds where that match ends in one pass over \p text, and then a DFA
+/// of the reversed pattern runs back from there to find where it starts.
+///
+/// \return `true` if there's a match and `false` otherwise.
+bool string_regex_find(struct string * match, struct string_regex * regex,
+                       struct string const * text);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,126 @@
+/// \file
+/// A rope for large strings that are edited in the middle.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// A node of a ::rope. The layout is private to rope.c.
+struct rope_node;
+
+
+/// A string stored as a balanced tree of short pieces.
+///
+/// Inserting, erasing and finding a position take \p O(log n) time, however
+/// large the string is, because only the pieces at the edited positions are
+/// touched. The tree is a treap ordered by position, which stays balanced
+/// with high probability whatever the pattern of edits.
+///
+/// Neighbouring pieces that fit in one are merged as the rope is edited, and
+/// each piece is allocated to fit, so the rope takes little more memory than
+/// the string it holds however it's edited.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct rope rope;
+///     rope_init(&rope);
+///     rope_insert(&rope, 0, &contents);
+///     rope_erase(&rope, 10, 20);
+///     rope_insert(&rope, 10, &string_literal("replacement"));
+///
+///     struct rope_iter iter;
+///     struct string piece;
+///     rope_iter_init(&iter, &rope, 0, rope_size(&rope));
+///     while (rope_iter_next(&iter, &piece))
+///         write(fd, piece.data, piece.size);
+///     rope_free(&rope);
+/// \rst_end
+struct rope
+{
+    struct rope_node * root; ///< The root of the tree or `NULL` if the rope is empty.
+    uint64_t seed;           ///< The state of the generator of node priorities.
+};
+
+
+/// An iterator over the pieces of a range of a ::rope.
+struct rope_iter
+{
+    struct rope const * rope; ///< The rope being iterated over.
+    size_t position;          ///< The position of the next piece.
+    size_t end;               ///< The end of the range.
+};
+
+
+/// Initialise an empty rope. No memory is allocated.
+void rope_init(struct rope * rope);
+
+
+/// De-allocate all the memory owned by \p rope and make it empty.
+void rope_free(struct rope * rope);
+
+
+/// Return the number of bytes in \p rope.
+size_t rope_size(struct rope const * rope);
+
+
+/// Insert a copy of \p string into \p rope before the byte at \p position.
+///
+/// \p position must be at most rope_size().
+///
+/// \return `true` on success and `false` if allocation fails, in which case
+///         \p rope is unchanged.
+bool rope_insert(struct rope * rope, size_t position, struct string const * string);
+
+
+/// Erase the bytes `[from, to)` of \p rope.
+///
+/// \p to must be at most rope_size(). Erasing can't fail: the pieces left
+/// around the erased bytes are only merged if there's memory to.
+void rope_erase(struct rope * rope, size_t from, size_t to);
+
+
+/// Copy the bytes `[from, to)` of \p rope into \p result.
+///
+/// \note \p result must be deallocated by calling string_free().
+///
+/// \return `true` on success and `false` if allocation fails.
+bool rope_copy_slice(struct string * result, struct rope const * rope, size_t from, size_t to);
+
+
+/// Copy all of \p rope into the contiguous string \p result.
+///
+/// \note \p result must be deallocated by calling string_free().
+///
+/// \return `true` on success and `false` if allocation fails.
+bool rope_flatten(struct string * result, struct rope const * rope);
+
+
+/// Initialise \p iter to iterate over the pieces of `rope[from, to)` in order.
+///
+/// \p to must be at most rope_size(). The iterator is invalidated by any
+/// edit to \p rope.
+void rope_iter_init(struct rope_iter * iter, struct rope const * rope, size_t from, size_t to);
+
+
+/// Store a view of the next piece of the range in \p piece.
+///
+/// Finding each piece takes \p O(log n) time and doesn't allocate.
+///
+/// \return `true` if \p piece was set and `false` if the range is finished.
+bool rope_iter_next(struct rope_iter * iter, struct string * piece);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
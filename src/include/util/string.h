@@ -5,6 +5,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 
 #ifdef __cplusplus
@@ -24,6 +25,10 @@ struct string
 typedef struct string str_t;
 
 
+/// See util/arena.h.
+struct arena;
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Construction and destruction
 ////////////////////////////////////////////////////////////////////////////////
@@ -71,6 +76,22 @@ void string_view_cstr(struct string * string, char * to_view);
 void string_free(struct string * string);
 
 
+/// Allocate a new string from \p arena and store the result in \p string.
+///
+/// Behaves like string_make() except the memory is released by resetting
+/// or rolling back \p arena rather than by calling string_free().
+void string_make_arena(struct string * string, size_t size, struct arena * arena);
+
+
+/// Create a copy of \p to_copy in \p string using memory from \p arena.
+void string_copy_arena(struct string * string, struct string const * to_copy,
+                       struct arena * arena);
+
+
+/// Create a copy of \p to_copy in \p string using memory from \p arena.
+void string_copy_cstr_arena(struct string * string, char const * to_copy, struct arena * arena);
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Comparison
 ////////////////////////////////////////////////////////////////////////////////
@@ -88,6 +109,28 @@ bool string_is_equal(struct string const * string, struct string const * other);
 bool string_is_equal_cstr(struct string const * string, char const * other);
 
 
+/// Compare the contents of \p string and \p other lexicographically as unsigned bytes.
+///
+/// A string sorts before every longer string it's a prefix of.
+///
+/// \return A negative value if \p string sorts first, `0` if the contents are the same
+///         and a positive value if \p other sorts first.
+int string_compare(struct string const * string, struct string const * other);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Hashing
+////////////////////////////////////////////////////////////////////////////////
+
+
+/// Return a 64-bit hash of the contents of \p string.
+///
+/// This is a fast non-cryptographic hash suitable for hash tables. Different
+/// values of \p seed give independent hash functions, which can be used to
+/// make the hashes unpredictable to an attacker.
+uint64_t string_hash(struct string const * string, uint64_t seed);
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Contains
 ////////////////////////////////////////////////////////////////////////////////
@@ -109,6 +152,56 @@ bool string_end_with_cstr(struct string const * string, char const * suffix);
 bool string_ends_with(struct string const * string, struct string const * suffix);
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Searching
+////////////////////////////////////////////////////////////////////////////////
+
+
+/// Return the number of times \p to_count occurs in \p string.
+///
+/// The search is vectorized with the instruction set selected by cpu_isa_get().
+size_t string_count_char(struct string const * string, char to_count);
+
+
+/// The value returned by the `string_find` family of functions when there is no match.
+#define STRING_NPOS SIZE_MAX
+
+
+/// Return the offset of the first occurrence of \p needle in \p haystack.
+///
+/// Neither string needs to be null-terminated and nothing is copied. Needles
+/// of up to 32 bytes are found by comparing blocks of \p haystack against
+/// the needle's first and last bytes with the instruction set selected by
+/// cpu_isa_get() and only comparing the candidates in full. Longer needles use
+/// the Two-Way algorithm, which is linear in the worst case and needs no
+/// extra memory.
+///
+/// \return The offset of the match, `0` if \p needle is empty or ::STRING_NPOS
+///         if there is no match.
+size_t string_find(struct string const * haystack, struct string const * needle);
+
+
+/// Return the offset of the last occurrence of \p needle in \p haystack.
+///
+/// Uses the same algorithms as string_find() but searches backwards.
+///
+/// \return The offset of the match, `haystack->size` if \p needle is empty or
+///         ::STRING_NPOS if there is no match.
+size_t string_rfind(struct string const * haystack, struct string const * needle);
+
+
+/// Find every non-overlapping occurrence of \p needle in \p haystack and store their
+/// offsets in \p output.
+///
+/// \note \p output must be deallocated by calling \rst :cppref:`~c/memory/free` \rst_end.
+///
+/// \return The number of offsets stored in \p output. If there are no matches,
+///         \p needle is empty or allocation fails `0` is returned and \p output
+///         is set to `NULL`.
+size_t string_find_all(size_t ** output, struct string const * haystack,
+                       struct string const * needle);
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Joining
 ////////////////////////////////////////////////////////////////////////////////
@@ -120,6 +213,13 @@ bool string_ends_with(struct string const * string, struct string const * suffix
 void string_join_array(struct string * result, struct string const * strings, size_t count);
 
 
+/// Concatenate `[strings, strings + count)` and store the result in \p result.
+///
+/// The result is allocated from \p arena.
+void string_join_array_arena(struct string * result, struct string const * strings, size_t count,
+                             struct arena * arena);
+
+
 /// Concatenate a variable number of ::string objects and store the result in \p result.
 #define string_join(result, ...)                                                                   \
     do                                                                                             \
@@ -129,6 +229,98 @@ void string_join_array(struct string * result, struct string const * strings, si
     } while (0)
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Building
+////////////////////////////////////////////////////////////////////////////////
+
+
+/// A string that is built by appending to it.
+///
+/// The memory grows geometrically, so appending \p n bytes one piece at a
+/// time costs amortized \p O(n) and only \p O(log n) allocations. When the
+/// string is complete string_builder_finish() hands the memory over to a
+/// ::string without copying it.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string_builder builder;
+///     string_builder_init(&builder);
+///     string_builder_append_cstr(&builder, "count=");
+///     string_builder_append_uint(&builder, count);
+///     string_builder_append_char(&builder, ',');
+///     struct string result;
+///     string_builder_finish(&builder, &result);
+///     ...
+///     string_free(&result);
+/// \rst_end
+struct string_builder
+{
+    char * data;     ///< The contents, which are not null-terminated.
+    size_t size;     ///< The number of bytes appended.
+    size_t capacity; ///< The number of bytes allocated for \p data.
+};
+
+
+/// Initialise an empty builder. No memory is allocated.
+void string_builder_init(struct string_builder * builder);
+
+
+/// De-allocate the memory owned by \p builder and make it empty.
+void string_builder_free(struct string_builder * builder);
+
+
+/// Make the size of \p builder zero but keep its memory for reuse.
+void string_builder_clear(struct string_builder * builder);
+
+
+/// Make sure \p additional more bytes can be appended to \p builder without allocating.
+/// \return `true` on success and `false` if allocation fails.
+bool string_builder_reserve(struct string_builder * builder, size_t additional);
+
+
+/// Release the memory of \p builder that isn't used by its contents.
+/// \return `true` on success and `false` if allocation fails, in which case
+///         \p builder is unchanged.
+bool string_builder_shrink(struct string_builder * builder);
+
+
+/// Append \p string to \p builder.
+/// \return `true` on success and `false` if allocation fails, in which case
+///         \p builder is unchanged.
+bool string_builder_append(struct string_builder * builder, struct string const * string);
+
+
+/// Append the null-terminated \p string to \p builder.
+/// \return `true` on success and `false` if allocation fails.
+bool string_builder_append_cstr(struct string_builder * builder, char const * string);
+
+
+/// Append \p c to \p builder.
+/// \return `true` on success and `false` if allocation fails.
+bool string_builder_append_char(struct string_builder * builder, char c);
+
+
+/// Append the decimal representation of \p value to \p builder.
+/// \return `true` on success and `false` if allocation fails.
+bool string_builder_append_int(struct string_builder * builder, int64_t value);
+
+
+/// Append the decimal representation of \p value to \p builder.
+/// \return `true` on success and `false` if allocation fails.
+bool string_builder_append_uint(struct string_builder * builder, uint64_t value);
+
+
+/// Move the contents of \p builder into \p result, leaving \p builder empty.
+///
+/// The memory is handed over without copying, so \p result may own more
+/// memory than its size. Call string_builder_shrink() first to avoid that.
+///
+/// \note \p result must be deallocated by calling string_free().
+void string_builder_finish(struct string_builder * builder, struct string * result);
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Slicing
 ////////////////////////////////////////////////////////////////////////////////
@@ -140,6 +332,11 @@ void string_join_array(struct string * result, struct string const * strings, si
 void string_copy_slice(struct string * string, struct string * to_slice, size_t from, size_t to);
 
 
+/// Copy `to_slice[from, to)` into \p string using memory from \p arena.
+void string_copy_slice_arena(struct string * string, struct string const * to_slice, size_t from,
+                             size_t to, struct arena * arena);
+
+
 /// View `to_slice[from, to)` from \p string.
 void string_view_slice(struct string * string, struct string * to_slice, size_t from, size_t to);
 
@@ -160,8 +357,18 @@ void string_view_slice(struct string * string, struct string * to_slice, size_t
 size_t string_copy_split(struct string ** output, struct string const * to_split, char pivot);
 
 
+/// Split the contents of \p to_split about \p pivot and store the pieces in \p output.
+///
+/// Behaves like string_copy_split() except that \p output and the pieces are
+/// allocated from \p arena in a single allocation.
+size_t string_copy_split_arena(struct string ** output, struct string const * to_split,
+                               char pivot, struct arena * arena);
+
+
 /// Split the contents of \p to_split about \p pivot and store references to the pieces in \p output.
 ///
+/// The pivots are found with the instruction set selected by cpu_isa_get().
+///
 /// \note \p output must be deallocated by calling \rst :cppref:`~c/memory/free` \rst_end.
 ///
 /// \param output   The resulting pieces from the split.
@@ -171,6 +378,382 @@ size_t string_copy_split(struct string ** output, struct string const * to_split
 size_t string_view_split(struct string ** output, struct string const * to_split, char pivot);
 
 
+/// Split \p to_split about \p pivot on up to \p thread_count threads and store references to
+/// the pieces in \p output.
+///
+/// The result is the same as string_view_split(). The input is cut into one
+/// chunk per thread, with each cut moved forward to just after a pivot so no
+/// piece straddles two chunks. The threads count the pivots in their chunks,
+/// a prefix sum of the counts gives each chunk the offset of its first piece
+/// in \p output, and then the threads fill in their pieces in parallel.
+///
+/// Each thread is given at least 1 MiB, so smaller inputs use fewer threads
+/// and are split on the calling thread if they're below 2 MiB. The calling
+/// thread splits the first chunk itself. If a thread can't be started its
+/// chunk is split on the calling thread instead.
+///
+/// \note \p output must be deallocated by calling \rst :cppref:`~c/memory/free` \rst_end.
+///
+/// \param output       The resulting pieces from the split.
+/// \param to_split     The string to split into pieces.
+/// \param pivot        The character to split about.
+/// \param thread_count The most threads to use, including the calling thread. Must be at least `1`.
+/// \return The number of strings stored in \p output. If allocation fails `0` is
+///         returned and \p output is set to `NULL`.
+size_t string_view_split_parallel(struct string ** output, struct string const * to_split,
+                                  char pivot, size_t thread_count);
+
+
+/// Iterate over the pieces of a string split about a pivot, one piece at a time.
+///
+/// Unlike string_view_split() the iterator does not allocate and only scans
+/// as far as the piece it returns, so callers can stop early or stream pieces
+/// to the next stage. It yields the same pieces as string_view_split().
+///
+/// The input is scanned 64 bytes at a time with the instruction set selected
+/// by cpu_isa_get() and the pivots in the current block are cached as a bit
+/// mask, so each input byte is only compared once.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string_split_iter iter;
+///     struct string field;
+///     string_split_iter_init(&iter, &record, ',');
+///     while (string_split_iter_next(&iter, &field))
+///         process(&field);
+/// \rst_end
+struct string_split_iter
+{
+    struct string to_split; ///< The string being split.
+    size_t start;           ///< The offset of the next piece in \p to_split.
+    size_t block;           ///< The offset of the 64-byte block that \p mask describes.
+    uint64_t mask;          ///< The pivots in the current block that haven't been yielded.
+    char pivot;             ///< The character to split about.
+    bool done;              ///< `true` once the final piece has been yielded.
+};
+
+
+/// Prepare \p iter to split \p to_split about \p pivot.
+///
+/// \p to_split is not copied so it must outlive \p iter.
+void string_split_iter_init(struct string_split_iter * iter, struct string const * to_split,
+                            char pivot);
+
+
+/// Store a view of the next piece from \p iter in \p piece.
+/// \return `true` if a piece was stored and `false` if there are no pieces left.
+bool string_split_iter_next(struct string_split_iter * iter, struct string * piece);
+
+
+/// A compact index of the pieces of a string split about a pivot.
+///
+/// string_view_split() stores a 16-byte `struct string` per piece, which for
+/// short fields is several times the size of the input itself. The index
+/// stores only the offset of the end of each piece from the start of the
+/// input, in 2 bytes when the input is under 64 KiB, 4 bytes when it's under
+/// 4 GiB and 8 bytes otherwise. Each piece starts just after the end of the
+/// one before it, so string_split_index_get() rebuilds it from two offsets.
+/// Reading the pieces in order with string_split_index_get_range() touches
+/// an eighth or a quarter as much memory as reading the array of views.
+///
+/// Example usage:
+/// \rst_block
+/// .. code-block:: c
+///
+///     struct string_split_index index;
+///     if (!string_split_index_make(&index, &input, ','))
+///         return false;
+///
+///     struct string fields[256];
+///     size_t count;
+///     for (size_t i = 0; i < index.count; i += count)
+///     {
+///         count = string_split_index_get_range(fields, &index, i, 256);
+///         for (size_t j = 0; j < count; ++j)
+///             process(fields + j);
+///     }
+///     string_split_index_free(&index);
+/// \rst_end
+struct string_split_index
+{
+    char * data;        ///< The start of the string that was split.
+    void * ends;        ///< The offset from \p data of the end of each piece.
+    size_t count;       ///< The number of pieces.
+    size_t offset_size; ///< The size of each offset in \p ends: 2, 4 or 8 bytes.
+};
+
+
+/// Split \p to_split about \p pivot and store an index of the pieces in \p index.
+///
+/// The pieces are the same as those of string_view_split() and the pivots
+/// are found with the instruction set selected by cpu_isa_get(). \p to_split
+/// isn't copied so it must outlive \p index.
+///
+/// \note \p index must be released by calling string_split_index_free().
+///
+/// \return `true` on success and `false` if allocation fails.
+bool string_split_index_make(struct string_split_index * index, struct string const * to_split,
+                             char pivot);
+
+
+/// De-allocate the offsets of \p index.
+void string_split_index_free(struct string_split_index * index);
+
+
+/// Store a view of piece \p i of \p index in \p piece.
+///
+/// \p i must be less than the number of pieces in \p index.
+void string_split_index_get(struct string * piece, struct string_split_index const * index,
+                            size_t i);
+
+
+/// Store views of up to \p count pieces of \p index, starting at piece \p first, in \p output.
+///
+/// This is faster than calling string_split_index_get() for each piece, so
+/// to read every piece in order decode a batch of a few hundred at a time
+/// into a buffer that stays in the cache.
+///
+/// \return The number of pieces stored, which is less than \p count when
+///         there are fewer than \p count pieces from \p first.
+size_t string_split_index_get_range(struct string * output,
+                                    struct string_split_index const * index, size_t first,
+                                    size_t count);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Character sets
+////////////////////////////////////////////////////////////////////////////////
+
+
+/// A set of characters, such as the delimiters to split a string about.
+///
+/// Besides a plain 256-entry membership table the set stores two 16-entry
+/// nibble tables. The vectorized kernels classify 32 or 64 bytes per step by
+/// looking up each byte's low nibble in a nibble table with a byte shuffle
+/// and testing the bit selected by its high nibble, so any set can be matched
+/// without branching per byte.
+struct string_char_set
+{
+    bool contains[256];         ///< `contains[(unsigned char)c]` is `true` if `c` is in the set.
+    unsigned char low[16];      ///< Bit `h` of `low[l]` is set if byte `h * 16 + l` is in the set.
+    unsigned char low_high[16]; ///< Bit `h` of `low_high[l]` is set if byte `128 + h * 16 + l` is.
+    bool has_high;              ///< `true` if the set contains any byte greater than 127.
+};
+
+
+/// Initialise \p set to contain exactly the characters in \p chars.
+void string_char_set_init(struct string_char_set * set, struct string const * chars);
+
+
+/// Initialise \p set to contain exactly the characters in the C string \p chars.
+void string_char_set_init_cstr(struct string_char_set * set, char const * chars);
+
+
+/// Return the number of characters in \p string that are in \p set.
+size_t string_count_any(struct string const * string, struct string_char_set const * set);
+
+
+/// Split \p to_split about every character in \p delimiters and store references to the
+/// pieces in \p output.
+///
+/// Without \p collapse the result is the same as splitting about each
+/// delimiter in turn, so consecutive delimiters produce empty pieces. With
+/// \p collapse empty pieces are dropped, so runs of delimiters act as a single
+/// delimiter and leading or trailing delimiters are ignored, which is usually
+/// what's wanted when splitting about whitespace.
+///
+/// The delimiters are found with the instruction set selected by cpu_isa_get().
+/// The byte shuffles need AVX2, so ::CPU_ISA_SSE2 uses the scalar kernel.
+///
+/// \note \p output must be deallocated by calling \rst :cppref:`~c/memory/free` \rst_end.
+///
+/// \param output     The resulting pieces from the split.
+/// \param to_split   The string to split into pieces.
+/// \param delimiters The characters to split about.
+/// \param collapse   Drop empty pieces if `true`.
+/// \return The number of strings stored in \p output. If allocation fails `0` is
+///         returned and \p output is set to `NULL`.
+size_t string_view_split_any(struct string ** output, struct string const * to_split,
+                             struct string_char_set const * delimiters, bool collapse);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Case
+////////////////////////////////////////////////////////////////////////////////
+
+
+/// Convert the ASCII letters in \p string to lower case in place.
+///
+/// Only the letters `A` to `Z` and `a` to `z` have a case; every other byte,
+/// including those of multi-byte UTF-8 sequences, is left as it is. Like
+/// every function in this section this ignores the locale and finds the
+/// letters 16, 32 or 64 bytes at a time with a pair of range comparisons,
+/// using the instruction set selected by cpu_isa_get().
+void string_to_lower(struct string * string);
+
+
+/// Convert the ASCII letters in \p string to upper case in place.
+void string_to_upper(struct string * string);
+
+
+/// Copy \p to_copy to \p string with its ASCII letters converted to lower case.
+///
+/// \note \p string must be deallocated by calling string_free().
+void string_copy_lower(struct string * string, struct string const * to_copy);
+
+
+/// Copy \p to_copy to \p string with its ASCII letters converted to upper case.
+///
+/// \note \p string must be deallocated by calling string_free().
+void string_copy_upper(struct string * string, struct string const * to_copy);
+
+
+/// Return true if the contents of \p string and \p other are the same, ignoring the case
+/// of ASCII letters.
+bool string_is_equal_ignore_case(struct string const * string, struct string const * other);
+
+
+/// Return true if \p string starts with \p prefix, ignoring the case of ASCII letters.
+bool string_starts_with_ignore_case(struct string const * string, struct string const * prefix);
+
+
+/// Return the offset of the first occurrence of \p needle in \p haystack,
+/// ignoring the case of ASCII letters.
+///
+/// Uses the same algorithms as string_find(). The vectorized kernels find
+/// candidates by comparing blocks with the case bit set against the needle's
+/// lower case first and last bytes, which matches both cases of a letter
+/// with a single comparison.
+///
+/// \return The offset of the match, `0` if \p needle is empty or ::STRING_NPOS
+///         if there is no match.
+size_t string_find_ignore_case(struct string const * haystack, struct string const * needle);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorting
+////////////////////////////////////////////////////////////////////////////////
+
+
+/// Sort `[strings, strings + count)` into the order of string_compare().
+///
+/// This is a most significant digit radix sort. Each pass buckets a range of
+/// strings by their byte at the current depth, with strings that end before
+/// it first, and then the buckets are sorted from the next byte. The bytes
+/// of a pass are read once into a contiguous array, so each string's data is
+/// only touched once per pass, and a range whose strings all share the next
+/// bytes skips straight past their common prefix. Buckets of fewer than 64
+/// strings are sorted by multikey quicksort, or by insertion sort if \p
+/// stable is set.
+///
+/// Without \p stable buckets are permuted in place. With it they're
+/// distributed through a buffer of \p count strings, so strings with the
+/// same contents keep their order.
+///
+/// \param strings The strings to sort. Only the views are moved; their contents aren't.
+/// \param count   The number of strings.
+/// \param stable  `true` to keep strings with the same contents in their original order.
+/// \return `false` if allocation failed, in which case \p strings is unchanged.
+bool string_sort(struct string * strings, size_t count, bool stable);
+
+
+/// Sort `[strings, strings + count)` on up to \p thread_count threads.
+///
+/// The result is the same as string_sort(). The first pass is split between
+/// the threads: each counts the first bytes of a slice of the strings, a
+/// prefix sum of the counts gives each slice its place in every bucket, and
+/// the threads distribute their slices in parallel. The buckets are then
+/// dealt out to the threads in runs of about equal size, and each thread
+/// sorts its runs like string_sort().
+///
+/// Each thread is given at least 65536 strings, so fewer use fewer threads
+/// and are sorted on the calling thread if there are fewer than 131072. If
+/// a thread can't be started its work is done on the calling thread instead.
+///
+/// \param strings      The strings to sort.
+/// \param count        The number of strings.
+/// \param stable       `true` to keep strings with the same contents in their original order.
+/// \param thread_count The most threads to use, including the calling thread. Must be at least
+///                     `1`.
+/// \return `false` if allocation failed, in which case \p strings is unchanged.
+bool string_sort_parallel(struct string * strings, size_t count, bool stable,
+                          size_t thread_count);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Small strings
+////////////////////////////////////////////////////////////////////////////////
+
+
+/// The number of bytes an ::sso_string can store without allocating.
+#define SSO_STRING_CAPACITY 24
+
+
+/// A string that stores short contents inline and only allocates when they don't fit.
+///
+/// The \p string member is an ordinary ::string view of the contents, so
+/// `&sso.string` can be passed to any of the `string_*` functions that take a
+/// `struct string const *` at no cost. Its \p data member points at \p buffer
+/// when the contents fit in ::SSO_STRING_CAPACITY bytes and at heap memory
+/// otherwise.
+///
+/// \warning Because \p string may point into the struct itself an ::sso_string
+///          must not be copied by assignment; use sso_string_move() instead.
+struct sso_string
+{
+    struct string string;              ///< A view of the contents.
+    char buffer[SSO_STRING_CAPACITY];  ///< The inline storage for short contents.
+};
+
+
+/// Make \p string hold \p size uninitialized bytes.
+///
+/// If allocation fails \p string will be empty.
+///
+/// When the string is no longer needed it should be passed to sso_string_free().
+void sso_string_make(struct sso_string * string, size_t size);
+
+
+/// Create a copy of \p to_copy in \p string.
+void sso_string_copy(struct sso_string * string, struct string const * to_copy);
+
+
+/// Create a copy of \p to_copy in \p string.
+void sso_string_copy_cstr(struct sso_string * string, char const * to_copy);
+
+
+/// Copy `to_slice[from, to)` into \p string.
+void sso_string_copy_slice(struct sso_string * string, struct string const * to_slice,
+                           size_t from, size_t to);
+
+
+/// Concatenate `[strings, strings + count)` and store the result in \p result.
+void sso_string_join_array(struct sso_string * result, struct string const * strings,
+                           size_t count);
+
+
+/// Move the contents of \p to_move into \p string, leaving \p to_move empty.
+///
+/// Heap contents are transferred without copying. The contents \p string
+/// held before are freed, so it must have been made by one of the
+/// `sso_string_*` functions. Moving a string into itself does nothing.
+void sso_string_move(struct sso_string * string, struct sso_string * to_move);
+
+
+/// De-allocate any heap memory owned by \p string and make it empty.
+void sso_string_free(struct sso_string * string);
+
+
+/// Return true if the contents of \p string are stored inline.
+bool sso_string_is_inline(struct sso_string const * string);
+
+
+/// Return true if the contents of \p string and \p other is the same.
+bool sso_string_is_equal(struct sso_string const * string, struct sso_string const * other);
+
+
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,46 @@
+/// \file
+/// Validate, measure and truncate UTF-8 encoded strings.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "util/string.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// Return `true` if \p string is valid UTF-8.
+///
+/// Valid UTF-8 is as defined by the Unicode standard: overlong encodings,
+/// surrogates, code points above U+10FFFF and truncated sequences are all
+/// invalid. An empty string is valid.
+///
+/// The AVX2 and AVX-512 kernels check 32 or 64 bytes at a time with the
+/// lookup tables of Keiser and Lemire's algorithm, which classifies every
+/// pair of adjacent bytes without decoding them. The SSE2 kernel skips runs
+/// of ASCII 16 bytes at a time and decodes the rest. The instruction set is
+/// selected by cpu_isa_get().
+bool utf8_is_valid(struct string const * string);
+
+
+/// Return the number of code points in \p string.
+///
+/// This is the number of bytes that aren't continuation bytes, so it's only
+/// meaningful if \p string is valid UTF-8, see utf8_is_valid().
+size_t utf8_count_codepoints(struct string const * string);
+
+
+/// View the longest prefix of \p string that has at most \p max_size bytes
+/// and doesn't end part way through a code point.
+///
+/// \p string must be valid UTF-8 for the result to be.
+void utf8_view_truncate(struct string * result, struct string const * string, size_t max_size);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -35,9 +35,9 @@ void benchmark_init(const char * name)
 
     // Print out a header for the table of benchmarks.
     // clang-format off
-    puts("--------------------------+-----------+-----------+-----------+-----------+-----------+-----------\n"
-         " name                     |      mean |    stddev |       min |        1% |       99% |       max \n"
-         "--------------------------+-----------+-----------+-----------+-----------+-----------+-----------");
+    puts("--------------------------+-----------+-----------+-----------+-----------+-----------+-----------+---------\n"
+         " name                     |      mean |    stddev |       min |        1% |       99% |       max |    GB/s \n"
+         "--------------------------+-----------+-----------+-----------+-----------+-----------+-----------+---------");
     // clang-format on
 
     // Measure how long it takes to execute an empty function to get an
@@ -54,7 +54,7 @@ void benchmark_init(const char * name)
 
 void benchmark_print_results(struct BenchmarkResults * results)
 {
-    printf(" %-24s | %9lli | %9lli | %9lli | %9lli | %9lli | %9lli\n", results->name,
+    printf(" %-24s | %9lli | %9lli | %9lli | %9lli | %9lli | %9lli |", results->name,
            1000000000LL * results->mean.tv_sec + results->mean.tv_nsec,
            1000000000LL * results->stddev.tv_sec + results->stddev.tv_nsec,
            1000000000LL * results->minimum.tv_sec + results->minimum.tv_nsec,
@@ -62,6 +62,13 @@ void benchmark_print_results(struct BenchmarkResults * results)
            1000000000LL * results->percentiles[0].tv_sec + results->percentiles[0].tv_nsec,
            1000000000LL * results->percentiles[4].tv_sec + results->percentiles[4].tv_nsec,
            1000000000LL * results->maximum.tv_sec + results->maximum.tv_nsec);
+
+    // Bytes per nanosecond is the same as gigabytes per second.
+    double mean_ns = 1e9 * timespec_to_double_s(&results->mean);
+    if (results->bytes > 0 && mean_ns > 0)
+        printf(" %7.2f\n", (double)results->bytes / mean_ns);
+    else
+        printf("\n");
 }
 
 
@@ -218,21 +225,60 @@ struct BenchmarkResults benchmark_statistics(struct timespec * measurements,
 }
 
 
-struct BenchmarkResults benchmark(void (*function)(void))
+static struct BenchmarkResults benchmark_run(void (*function)(void), size_t num_measurements,
+                                             size_t warm_up_measurements, size_t iterations)
 {
-    const unsigned num_measurements = 1000;
-    const unsigned iterations = 1000;
-
-    struct timespec * measurements = benchmark_measure(function, num_measurements, 10, iterations);
+    struct timespec * measurements =
+        benchmark_measure(function, num_measurements, warm_up_measurements, iterations);
     if (measurements == NULL)
     {
-        error("Failed to allocate memory for %i measurements\n", num_measurements);
+        error("Failed to allocate memory for %zu measurements\n", num_measurements);
         exit(1);
     }
 
     struct BenchmarkResults results =
         benchmark_statistics(measurements, num_measurements, iterations);
+    results.bytes = 0;
 
     free(measurements);
     return results;
 }
+
+
+struct BenchmarkResults benchmark(void (*function)(void))
+{
+    return benchmark_run(function, 1000, 10, 1000);
+}
+
+
+struct BenchmarkResults benchmark_throughput(void (*function)(void), size_t bytes)
+{
+    // Aim for each measurement to process about 1 MiB and for the whole benchmark
+    // to process about 64 MiB, but always take enough measurements to compute
+    // the statistics even if the input is much larger than that.
+    const size_t bytes_per_measurement = 1 << 20;
+    const size_t bytes_per_benchmark = 64 << 20;
+    size_t iterations = 1;
+    if (bytes > 0 && bytes < bytes_per_measurement)
+        iterations = bytes_per_measurement / bytes;
+    size_t num_measurements = bytes_per_benchmark / (iterations * (bytes > 0 ? bytes : 1));
+    if (num_measurements < 5)
+        num_measurements = 5;
+    if (num_measurements > 1000)
+        num_measurements = 1000;
+
+    struct BenchmarkResults results = benchmark_run(function, num_measurements, 1, iterations);
+    results.bytes = bytes;
+    return results;
+}
+
+
+struct BenchmarkResults benchmark_throughput_calls(void (*function)(void), size_t bytes,
+                                                   size_t calls)
+{
+    assert(calls > 0);
+
+    struct BenchmarkResults results = benchmark_run(function, calls, 1, 1);
+    results.bytes = bytes;
+    return results;
+}
@@ -0,0 +1,178 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "util/arena.h"
+
+
+/// The chunk size used when arena_init() is passed `0`.
+#define ARENA_DEFAULT_CHUNK_SIZE ((size_t)64 << 10)
+
+
+// The chunks form a singly linked list. The chunks before `arena->current`
+// are full, and the chunks after it are left over from before a reset or
+// rollback and are reused before any new chunk is allocated.
+struct arena_chunk
+{
+    struct arena_chunk * next; // The next chunk in the list.
+    size_t size;               // The number of bytes in `data`.
+    size_t used;               // The number of bytes of `data` handed out.
+    // Aligning `data` to the default alignment means default-aligned
+    // allocations never need padding at the start of a chunk.
+    _Alignas(ARENA_DEFAULT_ALIGNMENT) char data[];
+};
+
+
+void arena_init(struct arena * arena, size_t chunk_size)
+{
+    assert(arena);
+
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->chunk_size = (chunk_size > 0) ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+}
+
+
+void arena_free(struct arena * arena)
+{
+    assert(arena);
+
+    struct arena_chunk * chunk = arena->first;
+    while (chunk != NULL)
+    {
+        struct arena_chunk * next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    arena->first = NULL;
+    arena->current = NULL;
+}
+
+
+// Return the offset in `chunk->data` at which an allocation of `size` bytes
+// aligned to `alignment` would start, or `SIZE_MAX` if it doesn't fit.
+static size_t arena_chunk_fit(struct arena_chunk const * chunk, size_t size, size_t alignment)
+{
+    uintptr_t address = (uintptr_t)(chunk->data + chunk->used);
+    size_t padding = (size_t)(-address & (alignment - 1));
+    size_t offset = chunk->used + padding;
+    if (offset > chunk->size || chunk->size - offset < size)
+        return SIZE_MAX;
+    return offset;
+}
+
+
+// Allocate a chunk big enough for `size` bytes aligned to `alignment` and
+// link it in after the current chunk.
+static struct arena_chunk * arena_chunk_push(struct arena * arena, size_t size, size_t alignment)
+{
+    size_t data_size = arena->chunk_size;
+    size_t worst_case = size + (alignment > ARENA_DEFAULT_ALIGNMENT ? alignment : 0);
+    if (worst_case < size)
+        return NULL;
+    if (data_size < worst_case)
+        data_size = worst_case;
+
+    struct arena_chunk * chunk = malloc(sizeof(struct arena_chunk) + data_size);
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->size = data_size;
+    chunk->used = 0;
+    if (arena->current == NULL)
+    {
+        chunk->next = arena->first;
+        arena->first = chunk;
+    }
+    else
+    {
+        chunk->next = arena->current->next;
+        arena->current->next = chunk;
+    }
+    return chunk;
+}
+
+
+void * arena_alloc(struct arena * arena, size_t size)
+{
+    return arena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+
+void * arena_alloc_aligned(struct arena * arena, size_t size, size_t alignment)
+{
+    assert(arena);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    // Fast path: bump the offset in the current chunk.
+    struct arena_chunk * chunk = arena->current;
+    size_t offset = (chunk != NULL) ? arena_chunk_fit(chunk, size, alignment) : SIZE_MAX;
+
+    // Otherwise move on to the next left-over chunk, or allocate a new one if
+    // there isn't one or it's too small for this allocation.
+    if (offset == SIZE_MAX)
+    {
+        chunk = (arena->current != NULL) ? arena->current->next : arena->first;
+        if (chunk != NULL)
+        {
+            chunk->used = 0;
+            offset = arena_chunk_fit(chunk, size, alignment);
+        }
+        if (offset == SIZE_MAX)
+        {
+            chunk = arena_chunk_push(arena, size, alignment);
+            if (chunk == NULL)
+                return NULL;
+            offset = arena_chunk_fit(chunk, size, alignment);
+            assert(offset != SIZE_MAX);
+        }
+        arena->current = chunk;
+    }
+
+    chunk->used = offset + size;
+    return chunk->data + offset;
+}
+
+
+struct arena_mark arena_mark(struct arena const * arena)
+{
+    assert(arena);
+
+    struct arena_mark mark;
+    mark.chunk = arena->current;
+    mark.used = (arena->current != NULL) ? arena->current->used : 0;
+    return mark;
+}
+
+
+void arena_rollback(struct arena * arena, struct arena_mark mark)
+{
+    assert(arena);
+
+    arena->current = mark.chunk;
+    if (mark.chunk != NULL)
+        mark.chunk->used = mark.used;
+}
+
+
+void arena_reset(struct arena * arena)
+{
+    assert(arena);
+
+    arena->current = arena->first;
+    if (arena->first != NULL)
+        arena->first->used = 0;
+}
+
+
+size_t arena_capacity(struct arena const * arena)
+{
+    assert(arena);
+
+    size_t capacity = 0;
+    for (struct arena_chunk const * chunk = arena->first; chunk != NULL; chunk = chunk->next)
+        capacity += chunk->size;
+    return capacity;
+}
@@ -5,8 +5,10 @@
 #include <string.h>
 
 #include "util/cli.h"
+#include "util/fuzzy.h"
 #include "util/log.h"
 #include "util/parse.h"
+#include "util/string.h"
 
 
 static char * cli_action_name(enum cli_action action)
@@ -210,7 +212,11 @@ void cli_parse(struct cli * cli, int argc, char * argv[])
         if (parsed)
             continue;
 
-        error("Argument %i is unsupported: %s\n", i, arg);
+        char const * suggestion = cli_suggest(cli, arg);
+        if (suggestion != NULL)
+            error("Argument %i is unsupported: %s. Did you mean %s?\n", i, arg, suggestion);
+        else
+            error("Argument %i is unsupported: %s\n", i, arg);
         print_usage(cli);
         exit(CLI_RC_UNSUPPORTED_ARGUMENT);
     }
@@ -223,3 +229,35 @@ void cli_parse(struct cli * cli, int argc, char * argv[])
         exit(CLI_RC_MISSING_REQUIRED_ARGUMENTS);
     }
 }
+
+
+char const * cli_suggest(struct cli const * cli, char const * arg)
+{
+    assert(cli);
+    assert(arg);
+
+    struct string * names = malloc(2 * cli->size * sizeof(*names));
+    if (names == NULL)
+        return NULL;
+
+    size_t count = 0;
+    for (struct cli_arg const * cli_arg = cli->args; cli_arg != cli->args + cli->size; ++cli_arg)
+    {
+        if (cli_arg_is_positional(cli_arg))
+            continue;
+        if (cli_arg->long_name != NULL)
+            string_view_cstr(names + count++, cli_arg->long_name);
+        if (cli_arg->short_name != NULL)
+            string_view_cstr(names + count++, cli_arg->short_name);
+    }
+
+    struct string query;
+    string_view_cstr(&query, (char *)arg);
+    struct string_candidate closest;
+    char const * suggestion = NULL;
+    if (string_find_closest(&closest, 1, &query, names, count, query.size / 3) == 1)
+        suggestion = names[closest.index].data;
+
+    free(names);
+    return suggestion;
+}
@@ -0,0 +1,450 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/compress.h"
+#include "util/string.h"
+
+
+// Symbols are handled as 64-bit words holding their bytes in little-endian
+// order, zero padded, so a symbol matches the next bytes of a string if it's
+// equal to the low bytes of the next 8 bytes loaded as a word.
+//
+// Matches are packed as `length << 8 | code`, so one load gives both.
+
+
+// The code that escapes the byte after it.
+#define COMPRESS_ESCAPE 255
+
+// The symbols of 3 bytes or more are in a hash table indexed by a hash of
+// their first 3 bytes. Symbols that share their first 3 bytes, such as
+// `http` and `https`, always collide, so a symbol whose slot is taken goes in
+// one of the next few, and a lookup checks those slots up to the first
+// empty one.
+#define COMPRESS_HASH_BITS 10
+#define COMPRESS_HASH_SIZE ((size_t)1 << COMPRESS_HASH_BITS)
+#define COMPRESS_HASH_PROBES 4
+
+#define COMPRESS_ROUNDS 5
+
+// While training the symbols are numbered by their codes and each escaped
+// byte `b` by `256 + b`.
+#define COMPRESS_IDS 512
+
+
+struct compress_slot
+{
+    uint64_t symbol; // The symbol's bytes.
+    uint16_t match;  // The symbol's length and code, or 0 if the slot is empty.
+};
+
+
+struct string_compressor
+{
+    uint64_t symbols[256];                          // The bytes of each code's symbol.
+    unsigned char lengths[256];                     // The length of each code's symbol.
+    size_t symbol_count;                            // The number of codes in use.
+    uint16_t byte_matches[256];                     // The match for each single byte.
+    uint16_t short_matches[65536];                  // The longest match of 1 or 2 bytes for
+                                                    // each pair of bytes.
+    struct compress_slot slots[COMPRESS_HASH_SIZE]; // The symbols of 3 bytes or more.
+};
+
+
+// A symbol that could be added to the table and the bytes it would save.
+struct compress_candidate
+{
+    uint64_t symbol;
+    size_t gain;
+    unsigned length;
+};
+
+
+// Load the next `size` bytes of `data`, or the next 8 if there are more.
+static inline uint64_t compress_load(char const * data, size_t size)
+{
+    uint64_t word = 0;
+    if (size >= 8)
+        memcpy(&word, data, 8);
+    else
+        memcpy(&word, data, size);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+
+// Store the 8 bytes of `word` at `data`.
+static inline void compress_store(char * data, uint64_t word)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    memcpy(data, &word, 8);
+}
+
+
+// Return a mask of the first `length` bytes of a word, for `length` from 1 to 8.
+static inline uint64_t compress_mask(size_t length)
+{
+    return UINT64_MAX >> (64 - 8 * length);
+}
+
+
+static inline size_t compress_hash(uint64_t word)
+{
+    return (size_t)(((word & 0xFFFFFF) * 0x9E3779B97F4A7C15ull) >> (64 - COMPRESS_HASH_BITS));
+}
+
+
+// Return the longest symbol that the next `size` bytes, loaded in `word`,
+// start with, or an escape of length 1.
+static inline uint16_t compress_match(struct string_compressor const * compressor, uint64_t word,
+                                      size_t size)
+{
+    // Symbols aren't in order of length, so look at all the probes for the longest.
+    size_t const hash = compress_hash(word);
+    uint16_t best = 0;
+    for (size_t probe = 0; probe < COMPRESS_HASH_PROBES; ++probe)
+    {
+        struct compress_slot const * slot =
+            compressor->slots + ((hash + probe) & (COMPRESS_HASH_SIZE - 1));
+        size_t const length = slot->match >> 8;
+        if (length == 0)
+            break;
+        if (length <= size && slot->match > best &&
+            ((word ^ slot->symbol) & compress_mask(length)) == 0)
+            best = slot->match;
+    }
+    if (best != 0)
+        return best;
+    if (size >= 2)
+        return compressor->short_matches[word & 0xFFFF];
+    return compressor->byte_matches[word & 0xFF];
+}
+
+
+// Add `symbol` to `compressor` unless it's full or all the hash slots the
+// symbol may go in are taken.
+//
+// Symbols are added in order of decreasing gain, so when the slots are full
+// the symbol left out is the one that saves the fewest bytes.
+static void compress_add(struct string_compressor * compressor, uint64_t symbol, unsigned length)
+{
+    if (compressor->symbol_count == COMPRESS_ESCAPE)
+        return;
+
+    uint16_t const code = (uint16_t)compressor->symbol_count;
+    if (length >= 3)
+    {
+        size_t const hash = compress_hash(symbol);
+        struct compress_slot * slot = NULL;
+        for (size_t probe = 0; probe < COMPRESS_HASH_PROBES && slot == NULL; ++probe)
+        {
+            slot = compressor->slots + ((hash + probe) & (COMPRESS_HASH_SIZE - 1));
+            if (slot->match != 0)
+                slot = NULL;
+        }
+        if (slot == NULL)
+            return;
+        slot->symbol = symbol;
+        slot->match = (uint16_t)(length << 8 | code);
+    }
+    compressor->symbols[code] = symbol;
+    compressor->lengths[code] = (unsigned char)length;
+    ++compressor->symbol_count;
+}
+
+
+// Fill in the tables of single bytes and pairs from the symbols.
+static void compress_build(struct string_compressor * compressor)
+{
+    for (size_t b = 0; b < 256; ++b)
+        compressor->byte_matches[b] = 1 << 8 | COMPRESS_ESCAPE;
+    for (size_t code = 0; code < compressor->symbol_count; ++code)
+        if (compressor->lengths[code] == 1)
+            compressor->byte_matches[compressor->symbols[code]] = (uint16_t)(1 << 8 | code);
+
+    for (size_t pair = 0; pair < 65536; ++pair)
+        compressor->short_matches[pair] = compressor->byte_matches[pair & 0xFF];
+    for (size_t code = 0; code < compressor->symbol_count; ++code)
+        if (compressor->lengths[code] == 2)
+            compressor->short_matches[compressor->symbols[code]] = (uint16_t)(2 << 8 | code);
+}
+
+
+// Encode `sample` with `compressor`, adding up how often each symbol and
+// escaped byte occurs in `counts`, and how often each pair of them occur one
+// after the other in `pair_counts`.
+static void compress_count(struct string_compressor const * compressor,
+                           struct string const * sample, size_t count, size_t * counts,
+                           size_t * pair_counts)
+{
+    for (size_t s = 0; s < count; ++s)
+    {
+        size_t previous = COMPRESS_IDS;
+        for (size_t i = 0; i < sample[s].size;)
+        {
+            size_t const size = sample[s].size - i;
+            uint64_t const word = compress_load(sample[s].data + i, size);
+            uint16_t const match = compress_match(compressor, word, size);
+            size_t const code = match & 0xFF;
+            size_t const id = (code == COMPRESS_ESCAPE) ? 256 + (word & 0xFF) : code;
+
+            // Count the first byte on its own too, so that single bytes stay
+            // candidates once longer symbols cover them.
+            ++counts[id];
+            if (code != COMPRESS_ESCAPE && (match >> 8) > 1)
+                ++counts[256 + (word & 0xFF)];
+            if (previous != COMPRESS_IDS)
+                ++pair_counts[previous * COMPRESS_IDS + id];
+            previous = id;
+            i += match >> 8;
+        }
+    }
+}
+
+
+static int compress_candidate_compare_symbol(void const * lhs, void const * rhs)
+{
+    struct compress_candidate const * a = lhs;
+    struct compress_candidate const * b = rhs;
+    if (a->length != b->length)
+        return (a->length > b->length) - (a->length < b->length);
+    return (a->symbol > b->symbol) - (a->symbol < b->symbol);
+}
+
+
+static int compress_candidate_compare_gain(void const * lhs, void const * rhs)
+{
+    struct compress_candidate const * a = lhs;
+    struct compress_candidate const * b = rhs;
+    if (a->gain != b->gain)
+        return (a->gain < b->gain) - (a->gain > b->gain);
+    return compress_candidate_compare_symbol(lhs, rhs);
+}
+
+
+// Store the symbols and escaped bytes counted in `counts`, and the
+// concatenations of the pairs counted in `pair_counts`, in `candidates` with
+// the bytes they'd save. Return the number of distinct candidates.
+static size_t compress_candidates(struct compress_candidate * candidates,
+                                  struct string_compressor const * compressor,
+                                  size_t const * counts, size_t const * pair_counts)
+{
+    uint64_t symbols[COMPRESS_IDS];
+    unsigned lengths[COMPRESS_IDS];
+    for (size_t id = 0; id < COMPRESS_IDS; ++id)
+    {
+        symbols[id] = (id < 256) ? compressor->symbols[id] : id - 256;
+        lengths[id] = (id < 256) ? compressor->lengths[id] : 1;
+    }
+
+    size_t count = 0;
+    for (size_t id = 0; id < COMPRESS_IDS; ++id)
+    {
+        if (counts[id] > 0)
+            candidates[count++] = (struct compress_candidate){symbols[id], counts[id] * lengths[id],
+                                                              lengths[id]};
+        if (counts[id] == 0 || lengths[id] == 8)
+            continue;
+
+        for (size_t next = 0; next < COMPRESS_IDS; ++next)
+        {
+            size_t const pair_count = pair_counts[id * COMPRESS_IDS + next];
+            if (pair_count == 0)
+                continue;
+            unsigned length = lengths[id] + lengths[next];
+            length = (length < 8) ? length : 8;
+            uint64_t symbol = (symbols[id] | symbols[next] << (8 * lengths[id])) &
+                              compress_mask(length);
+            candidates[count++] = (struct compress_candidate){symbol, pair_count * length, length};
+        }
+    }
+
+    // The same symbol can come from several pairs, so add up their gains.
+    qsort(candidates, count, sizeof(*candidates), compress_candidate_compare_symbol);
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (distinct > 0 && compress_candidate_compare_symbol(candidates + distinct - 1,
+                                                              candidates + i) == 0)
+            candidates[distinct - 1].gain += candidates[i].gain;
+        else
+            candidates[distinct++] = candidates[i];
+    }
+    return distinct;
+}
+
+
+struct string_compressor * string_compressor_train(struct string const * sample, size_t count)
+{
+    assert(sample || count == 0);
+
+    struct string_compressor * compressor = calloc(1, sizeof(struct string_compressor));
+    size_t * counts = malloc((COMPRESS_IDS + COMPRESS_IDS * COMPRESS_IDS) * sizeof(size_t));
+    struct compress_candidate * candidates =
+        malloc((COMPRESS_IDS + COMPRESS_IDS * COMPRESS_IDS) * sizeof(struct compress_candidate));
+    if (compressor == NULL || counts == NULL || candidates == NULL)
+    {
+        free(candidates);
+        free(counts);
+        free(compressor);
+        return NULL;
+    }
+
+    // Start with no symbols, so every byte is escaped, and replace the
+    // symbols each round with the candidates that would save the most.
+    compress_build(compressor);
+    for (size_t round = 0; round < COMPRESS_ROUNDS; ++round)
+    {
+        memset(counts, 0, (COMPRESS_IDS + COMPRESS_IDS * COMPRESS_IDS) * sizeof(size_t));
+        compress_count(compressor, sample, count, counts, counts + COMPRESS_IDS);
+        size_t candidate_count =
+            compress_candidates(candidates, compressor, counts, counts + COMPRESS_IDS);
+        qsort(candidates, candidate_count, sizeof(*candidates), compress_candidate_compare_gain);
+
+        compressor->symbol_count = 0;
+        memset(compressor->slots, 0, sizeof(compressor->slots));
+        for (size_t i = 0; i < candidate_count; ++i)
+            compress_add(compressor, candidates[i].symbol, candidates[i].length);
+        compress_build(compressor);
+    }
+
+    free(candidates);
+    free(counts);
+    return compressor;
+}
+
+
+void string_compressor_free(struct string_compressor * compressor)
+{
+    free(compressor);
+}
+
+
+size_t string_compressor_symbol_count(struct string_compressor const * compressor)
+{
+    assert(compressor);
+
+    return compressor->symbol_count;
+}
+
+
+size_t string_compressor_encode(char * output, struct string_compressor const * compressor,
+                                struct string const * input)
+{
+    assert(output || input->size == 0);
+    assert(compressor);
+    assert(input);
+
+    unsigned char * out = (unsigned char *)output;
+    for (size_t i = 0; i < input->size;)
+    {
+        size_t const size = input->size - i;
+        uint64_t const word = compress_load(input->data + i, size);
+        uint16_t const match = compress_match(compressor, word, size);
+        *out++ = (unsigned char)match;
+        if ((match & 0xFF) == COMPRESS_ESCAPE)
+            *out++ = (unsigned char)word;
+        i += match >> 8;
+    }
+    return (size_t)(out - (unsigned char *)output);
+}
+
+
+size_t string_compressor_decode(char * output, size_t capacity,
+                                struct string_compressor const * compressor,
+                                struct string const * encoded)
+{
+    assert(output || capacity == 0);
+    assert(compressor);
+    assert(encoded);
+
+    unsigned char const * in = (unsigned char const *)encoded->data;
+    unsigned char const * end = in + encoded->size;
+    size_t size = 0;
+    while (in < end)
+    {
+        unsigned const code = *in++;
+        if (code == COMPRESS_ESCAPE)
+        {
+            assert(in < end);
+            if (size < capacity)
+                output[size] = (char)*in;
+            ++in;
+            ++size;
+            continue;
+        }
+
+        // Copy all 8 bytes of the symbol while there's room, since a fixed
+        // size copy is a single store, and only the symbol's length near the end.
+        size_t const length = compressor->lengths[code];
+        if (size + 8 <= capacity)
+            compress_store(output + size, compressor->symbols[code]);
+        else if (size < capacity)
+        {
+            char bytes[8];
+            compress_store(bytes, compressor->symbols[code]);
+            memcpy(output + size, bytes, (length < capacity - size) ? length : capacity - size);
+        }
+        size += length;
+    }
+    return size;
+}
+
+
+size_t string_compressor_decoded_size(struct string_compressor const * compressor,
+                                      struct string const * encoded)
+{
+    assert(compressor);
+    assert(encoded);
+
+    size_t size = 0;
+    for (size_t i = 0; i < encoded->size; ++i)
+    {
+        unsigned char const code = (unsigned char)encoded->data[i];
+        if (code == COMPRESS_ESCAPE)
+        {
+            ++i;
+            ++size;
+        }
+        else
+            size += compressor->lengths[code];
+    }
+    return size;
+}
+
+
+bool string_compressor_is_equal(struct string_compressor const * compressor,
+                                struct string const * encoded, struct string const * string)
+{
+    assert(compressor);
+    assert(encoded);
+    assert(string);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < encoded->size; ++i)
+    {
+        unsigned char const code = (unsigned char)encoded->data[i];
+        if (code == COMPRESS_ESCAPE)
+        {
+            if (offset == string->size || string->data[offset] != encoded->data[++i])
+                return false;
+            ++offset;
+            continue;
+        }
+
+        size_t const length = compressor->lengths[code];
+        if (length > string->size - offset)
+            return false;
+        uint64_t const word = compress_load(string->data + offset, length);
+        if (((word ^ compressor->symbols[code]) & compress_mask(length)) != 0)
+            return false;
+        offset += length;
+    }
+    return offset == string->size;
+}
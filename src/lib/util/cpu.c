@@ -0,0 +1,87 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "util/cpu.h"
+#include "util/env.h"
+#include "util/log.h"
+#include "util/util.h"
+
+
+static char const * cpu_isa_names[] = {"Scalar", "SSE2", "AVX2", "AVX512"};
+
+
+static_assert(CPU_ISA_AVX512 + 1 == ARRAY_SIZE(cpu_isa_names),
+              "cpu_isa and cpu_isa_names do not match.");
+
+
+// A negative value means the instruction set has not been selected yet. It's
+// read by the kernels of every thread, so it's atomic, but nothing else is
+// published with it so relaxed ordering is enough.
+static _Atomic int cpu_isa_selected = -1;
+
+
+char const * cpu_isa_to_string(enum cpu_isa isa)
+{
+    assert(isa <= CPU_ISA_AVX512);
+    return cpu_isa_names[isa];
+}
+
+
+enum cpu_isa cpu_isa_supported()
+{
+#ifdef CPU_X86_KERNELS
+    // The result of __builtin_cpu_supports also accounts for whether the
+    // operating system saves the wider registers on a context switch.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        return CPU_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return CPU_ISA_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return CPU_ISA_SSE2;
+#endif
+    return CPU_ISA_SCALAR;
+}
+
+
+enum cpu_isa cpu_isa_get()
+{
+    int isa = atomic_load_explicit(&cpu_isa_selected, memory_order_relaxed);
+    if (UNLIKELY(isa < 0))
+    {
+        cpu_init();
+        isa = atomic_load_explicit(&cpu_isa_selected, memory_order_relaxed);
+    }
+    return (enum cpu_isa)isa;
+}
+
+
+bool cpu_isa_set(enum cpu_isa isa)
+{
+    if (isa > cpu_isa_supported())
+        return false;
+
+    atomic_store_explicit(&cpu_isa_selected, (int)isa, memory_order_relaxed);
+    return true;
+}
+
+
+void cpu_init()
+{
+    int isa = cpu_isa_supported();
+    enum env_rc rc = env_get_enum("CPU_ISA", &isa, cpu_isa_names, ARRAY_SIZE(cpu_isa_names));
+    if (rc == ENV_RC_INVALID_VALUE)
+    {
+        error("Environment variable CPU_ISA has an invalid value.\n");
+        exit(1);
+    }
+
+    if (!cpu_isa_set(isa))
+    {
+        warning("CPU_ISA=%s is not supported by this processor; using %s.\n",
+                cpu_isa_to_string(isa), cpu_isa_to_string(cpu_isa_supported()));
+        cpu_isa_set(cpu_isa_supported());
+    }
+}
@@ -0,0 +1,319 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/csv.h"
+#include "util/string.h"
+
+#ifdef CPU_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Block classification
+////////////////////////////////////////////////////////////////////////////////
+
+
+// Each kernel classifies a 64-byte block, storing a bit mask of its quotes
+// in `quotes` and returning a bit mask of its delimiters and newlines. Bit
+// `i` describes byte `i` of the block.
+
+
+// Classify the first `size` bytes of `data`, which may be fewer than 64.
+static uint64_t csv_classify_scalar(char const * data, size_t size, char delimiter,
+                                    uint64_t * quotes)
+{
+    uint64_t separators = 0;
+    *quotes = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        separators |= (uint64_t)(data[i] == delimiter || data[i] == '\n') << i;
+        *quotes |= (uint64_t)(data[i] == '"') << i;
+    }
+    return separators;
+}
+
+
+#ifdef CPU_X86_KERNELS
+
+
+static __attribute__((target("sse2"))) uint64_t
+csv_classify_sse2(char const * data, char delimiter, uint64_t * quotes)
+{
+    __m128i const quote = _mm_set1_epi8('"');
+    __m128i const separator = _mm_set1_epi8(delimiter);
+    __m128i const newline = _mm_set1_epi8('\n');
+    uint64_t separators = 0;
+    *quotes = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i block = _mm_loadu_si128((__m128i const *)(data + 16 * i));
+        __m128i ends = _mm_or_si128(_mm_cmpeq_epi8(block, separator),
+                                    _mm_cmpeq_epi8(block, newline));
+        separators |= (uint64_t)(uint16_t)_mm_movemask_epi8(ends) << (16 * i);
+        *quotes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, quote)) << (16 * i);
+    }
+    return separators;
+}
+
+
+static __attribute__((target("avx2"))) uint64_t
+csv_classify_avx2(char const * data, char delimiter, uint64_t * quotes)
+{
+    __m256i const quote = _mm256_set1_epi8('"');
+    __m256i const separator = _mm256_set1_epi8(delimiter);
+    __m256i const newline = _mm256_set1_epi8('\n');
+    uint64_t separators = 0;
+    *quotes = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256i block = _mm256_loadu_si256((__m256i const *)(data + 32 * i));
+        __m256i ends = _mm256_or_si256(_mm256_cmpeq_epi8(block, separator),
+                                       _mm256_cmpeq_epi8(block, newline));
+        separators |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ends) << (32 * i);
+        *quotes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, quote))
+                   << (32 * i);
+    }
+    return separators;
+}
+
+
+static __attribute__((target("avx512f,avx512bw"))) uint64_t
+csv_classify_avx512(char const * data, char delimiter, uint64_t * quotes)
+{
+    __m512i block = _mm512_loadu_si512((void const *)data);
+    *quotes = _mm512_cmpeq_epi8_mask(block, _mm512_set1_epi8('"'));
+    return _mm512_cmpeq_epi8_mask(block, _mm512_set1_epi8(delimiter)) |
+           _mm512_cmpeq_epi8_mask(block, _mm512_set1_epi8('\n'));
+}
+
+
+#endif // CPU_X86_KERNELS
+
+
+// Classify the first `min(size, 64)` bytes of `data`.
+static inline uint64_t csv_classify(char const * data, size_t size, char delimiter,
+                                    uint64_t * quotes)
+{
+    if (size >= 64)
+    {
+        switch (cpu_isa_get())
+        {
+#ifdef CPU_X86_KERNELS
+            case CPU_ISA_AVX512:
+                return csv_classify_avx512(data, delimiter, quotes);
+            case CPU_ISA_AVX2:
+                return csv_classify_avx2(data, delimiter, quotes);
+            case CPU_ISA_SSE2:
+                return csv_classify_sse2(data, delimiter, quotes);
+#endif
+            default:
+                size = 64;
+                break;
+        }
+    }
+    return csv_classify_scalar(data, size, delimiter, quotes);
+}
+
+
+// Return a mask with bit `i` set if an odd number of bits `0` to `i` of
+// `mask` are set. For a mask of quotes these are the bytes inside quotes,
+// counting each opening quote as inside and each closing quote as outside.
+//
+// This is what a carry-less multiplication by all ones computes, but the
+// instruction isn't part of any of the instruction sets the kernels are
+// selected by, and six shifts cost about the same.
+static inline uint64_t csv_prefix_xor(uint64_t mask)
+{
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Reader
+////////////////////////////////////////////////////////////////////////////////
+
+
+void csv_reader_init(struct csv_reader * reader, char delimiter)
+{
+    assert(reader);
+    assert(delimiter != '"' && delimiter != '\r' && delimiter != '\n');
+
+    reader->chunk = (struct string){NULL, 0};
+    reader->start = 0;
+    reader->block = 0;
+    reader->next_block = 0;
+    reader->mask = 0;
+    reader->inside = 0;
+    string_builder_init(&reader->pending);
+    string_builder_init(&reader->unescaped);
+    reader->delimiter = delimiter;
+    reader->final = false;
+    reader->record_start = true;
+    reader->pending_returned = false;
+}
+
+
+void csv_reader_free(struct csv_reader * reader)
+{
+    assert(reader);
+
+    string_builder_free(&reader->pending);
+    string_builder_free(&reader->unescaped);
+}
+
+
+void csv_reader_feed(struct csv_reader * reader, struct string const * chunk, bool final)
+{
+    assert(reader);
+    assert(chunk);
+
+    reader->chunk = *chunk;
+    reader->start = 0;
+    reader->block = 0;
+    reader->next_block = 0;
+    reader->mask = 0;
+    reader->final = final;
+}
+
+
+// Read the next block of the chunk into the reader's mask, discarding the
+// delimiters and newlines inside quotes. Return false at the end of the chunk.
+static bool csv_reader_load(struct csv_reader * reader)
+{
+    if (reader->next_block >= reader->chunk.size)
+        return false;
+
+    uint64_t quotes;
+    char const * data = reader->chunk.data + reader->next_block;
+    size_t size = reader->chunk.size - reader->next_block;
+    uint64_t separators = csv_classify(data, size, reader->delimiter, &quotes);
+
+    // Bits past the end of a short block copy the state after its last byte,
+    // so the top bit is always the state to carry into the next block.
+    uint64_t inside = csv_prefix_xor(quotes) ^ reader->inside;
+    reader->inside = 0 - (inside >> 63);
+    reader->mask = separators & ~inside;
+    reader->block = reader->next_block;
+    reader->next_block += 64;
+    return true;
+}
+
+
+// Remove the quotes around `field` if it's quoted, copying it to the
+// reader's buffer if it contains escaped quotes.
+static bool csv_reader_unquote(struct csv_reader * reader, struct string * field)
+{
+    if (field->size < 2 || field->data[0] != '"' || field->data[field->size - 1] != '"')
+        return true;
+
+    char const * data = field->data + 1;
+    char const * end = field->data + field->size - 1;
+    char const * quote = memchr(data, '"', (size_t)(end - data));
+    if (quote == NULL)
+    {
+        field->data += 1;
+        field->size -= 2;
+        return true;
+    }
+
+    // Copy up to and including each quote, then skip the quote that escaped it.
+    string_builder_clear(&reader->unescaped);
+    while (quote != NULL)
+    {
+        struct string const piece = {(char *)data, (size_t)(quote - data) + 1};
+        if (!string_builder_append(&reader->unescaped, &piece))
+            return false;
+        data = quote + 1;
+        if (data < end && *data == '"')
+            ++data;
+        quote = (data < end) ? memchr(data, '"', (size_t)(end - data)) : NULL;
+    }
+    struct string const rest = {(char *)data, (size_t)(end - data)};
+    if (!string_builder_append(&reader->unescaped, &rest))
+        return false;
+
+    field->data = reader->unescaped.data;
+    field->size = reader->unescaped.size;
+    return true;
+}
+
+
+// Store the field that ends at offset `end` of the chunk in `field`,
+// prefixed by the pending bytes from earlier chunks if there are any.
+static enum csv_rc csv_reader_field(struct csv_reader * reader, struct string * field, size_t end,
+                                    bool record_end)
+{
+    field->data = reader->chunk.data + reader->start;
+    field->size = end - reader->start;
+    if (reader->pending.size > 0)
+    {
+        if (!string_builder_append(&reader->pending, field))
+            return CSV_RC_ERROR;
+        field->data = reader->pending.data;
+        field->size = reader->pending.size;
+        reader->pending_returned = true;
+    }
+
+    if (record_end && field->size > 0 && field->data[field->size - 1] == '\r')
+        --field->size;
+    if (!csv_reader_unquote(reader, field))
+        return CSV_RC_ERROR;
+
+    reader->record_start = record_end;
+    return record_end ? CSV_RC_RECORD : CSV_RC_FIELD;
+}
+
+
+enum csv_rc csv_reader_next(struct csv_reader * reader, struct string * field)
+{
+    assert(reader);
+    assert(field);
+
+    if (reader->pending_returned)
+    {
+        string_builder_clear(&reader->pending);
+        reader->pending_returned = false;
+    }
+
+    while (reader->mask == 0)
+    {
+        if (csv_reader_load(reader))
+            continue;
+
+        // There are no separators left in the chunk, so the rest of it is the
+        // start of a field that ends in a later chunk, or the final field.
+        if (!reader->final)
+        {
+            struct string const rest = {reader->chunk.data + reader->start,
+                                        reader->chunk.size - reader->start};
+            if (!string_builder_append(&reader->pending, &rest))
+                return CSV_RC_ERROR;
+            reader->start = reader->chunk.size;
+            return CSV_RC_NEED_INPUT;
+        }
+        if (reader->start == reader->chunk.size && reader->pending.size == 0 &&
+            reader->record_start)
+            return CSV_RC_END;
+
+        enum csv_rc rc = csv_reader_field(reader, field, reader->chunk.size, true);
+        reader->start = reader->chunk.size;
+        reader->pending_returned = true;
+        return rc;
+    }
+
+    size_t end = reader->block + (size_t)__builtin_ctzll(reader->mask);
+    reader->mask &= reader->mask - 1;
+    enum csv_rc rc = csv_reader_field(reader, field, end, reader->chunk.data[end] == '\n');
+    reader->start = end + 1;
+    return rc;
+}
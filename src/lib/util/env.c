@@ -13,7 +13,6 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <assert.h>
-#include <ctype.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -71,10 +70,7 @@ enum env_rc env_get_bool(char const * name, bool * result)
     if (rc != ENV_RC_OK)
         return rc;
 
-    // Convert the environment variable value to lower-case.
-    for (size_t i = 0; i < len; ++i)
-        buffer[i] = tolower(buffer[i]);
-
+    // parse_bool() ignores case, so the value doesn't need converting first.
     bool success = parse_bool(buffer, result);
     if (!success)
         return ENV_RC_INVALID_VALUE;
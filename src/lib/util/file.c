@@ -0,0 +1,421 @@
+// mmap, madvise, UIO_MAXIOV and the Linux-specific flags are only declared
+// when the POSIX and BSD extensions are requested.
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <limits.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "util/file.h"
+#include "util/string.h"
+
+
+#ifdef _WIN32
+
+
+// Without mmap the whole file is read into a buffer, which file_unmap() frees.
+bool file_map(struct string * contents, char const * path, unsigned flags)
+{
+    assert(contents);
+    assert(path);
+    (void)flags;
+
+    contents->data = NULL;
+    contents->size = 0;
+
+    FILE * file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    long size = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    struct string buffer;
+    string_make(&buffer, (size_t)size);
+    if (buffer.size != (size_t)size || fread(buffer.data, 1, buffer.size, file) != buffer.size)
+    {
+        string_free(&buffer);
+        fclose(file);
+        return false;
+    }
+
+    fclose(file);
+    *contents = buffer;
+    return true;
+}
+
+
+void file_unmap(struct string * contents)
+{
+    assert(contents);
+    string_free(contents);
+}
+
+
+#else
+
+
+bool file_map(struct string * contents, char const * path, unsigned flags)
+{
+    assert(contents);
+    assert(path);
+
+    contents->data = NULL;
+    contents->size = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return false;
+    }
+
+    if ((uintmax_t)status.st_size > SIZE_MAX)
+    {
+        close(fd);
+        errno = EFBIG;
+        return false;
+    }
+
+    // mmap can't map zero bytes, and an empty view needs no memory anyway.
+    size_t size = (size_t)status.st_size;
+    if (size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    int map_flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (flags & FILE_MAP_POPULATE)
+        map_flags |= MAP_POPULATE;
+#endif
+    void * data = mmap(NULL, size, PROT_READ, map_flags, fd, 0);
+    int error = errno;
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        errno = error;
+        return false;
+    }
+
+    // The advice is only a hint so failures are ignored.
+    if (flags & FILE_MAP_SEQUENTIAL)
+        madvise(data, size, MADV_SEQUENTIAL);
+    if (flags & FILE_MAP_WILLNEED)
+        madvise(data, size, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+    if (flags & FILE_MAP_HUGEPAGE)
+        madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+    contents->data = data;
+    contents->size = size;
+    return true;
+}
+
+
+void file_unmap(struct string * contents)
+{
+    assert(contents);
+
+    if (contents->data != NULL)
+        munmap(contents->data, contents->size);
+    contents->data = NULL;
+    contents->size = 0;
+}
+
+
+#endif
+
+
+#define FILE_READER_DEFAULT_CAPACITY ((size_t)256 << 10)
+
+
+bool file_reader_init(struct file_reader * reader, int fd, char delimiter, size_t capacity)
+{
+    assert(reader);
+
+    reader->capacity = (capacity > 0) ? capacity : FILE_READER_DEFAULT_CAPACITY;
+    reader->buffer = malloc(reader->capacity);
+    if (reader->buffer == NULL)
+        return false;
+
+    reader->fd = fd;
+    reader->start = 0;
+    reader->scanned = 0;
+    reader->end = 0;
+    reader->delimiter = delimiter;
+    reader->skipping = false;
+    reader->eof = false;
+    return true;
+}
+
+
+void file_reader_free(struct file_reader * reader)
+{
+    assert(reader);
+
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->capacity = 0;
+}
+
+
+// Read as much as fits after the end of the buffered bytes.
+static enum file_reader_rc file_reader_fill(struct file_reader * reader)
+{
+    for (;;)
+    {
+        size_t space = reader->capacity - reader->end;
+#ifdef _WIN32
+        int count = _read(reader->fd, reader->buffer + reader->end,
+                          (unsigned)((space < INT_MAX) ? space : INT_MAX));
+#else
+        ssize_t count = read(reader->fd, reader->buffer + reader->end, space);
+#endif
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+            return FILE_READER_RC_ERROR;
+
+        reader->eof = count == 0;
+        reader->end += (size_t)count;
+        return FILE_READER_RC_OK;
+    }
+}
+
+
+enum file_reader_rc file_reader_next(struct file_reader * reader, struct string * record)
+{
+    assert(reader);
+    assert(record);
+
+    for (;;)
+    {
+        char * found = (reader->scanned < reader->end)
+                           ? memchr(reader->buffer + reader->scanned, reader->delimiter,
+                                    reader->end - reader->scanned)
+                           : NULL;
+        if (found != NULL)
+        {
+            size_t record_end = (size_t)(found - reader->buffer);
+            bool skipped = reader->skipping;
+            record->data = reader->buffer + reader->start;
+            record->size = record_end - reader->start;
+            reader->start = record_end + 1;
+            reader->scanned = reader->start;
+            reader->skipping = false;
+            if (skipped)
+                continue;
+            return FILE_READER_RC_OK;
+        }
+        reader->scanned = reader->end;
+
+        // The bytes after the final delimiter are the final record.
+        if (reader->eof)
+        {
+            if (reader->start == reader->end || reader->skipping)
+                return FILE_READER_RC_END;
+            record->data = reader->buffer + reader->start;
+            record->size = reader->end - reader->start;
+            reader->start = reader->end;
+            return FILE_READER_RC_OK;
+        }
+
+        if (reader->skipping)
+            reader->start = reader->end;
+        if (reader->start == reader->end)
+        {
+            reader->start = 0;
+            reader->scanned = 0;
+            reader->end = 0;
+        }
+        else if (reader->end == reader->capacity)
+        {
+            // The record fills the whole buffer so return its start and skip the rest.
+            if (reader->start == 0)
+            {
+                record->data = reader->buffer;
+                record->size = reader->capacity;
+                reader->start = reader->end;
+                reader->skipping = true;
+                return FILE_READER_RC_TOO_LONG;
+            }
+
+            // Move the partial record to the start of the buffer to make room.
+            memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+            reader->end -= reader->start;
+            reader->scanned = reader->end;
+            reader->start = 0;
+        }
+
+        if (file_reader_fill(reader) != FILE_READER_RC_OK)
+            return FILE_READER_RC_ERROR;
+    }
+}
+
+
+// Pieces shorter than FILE_WRITE_SMALL bytes are copied into the staging
+// buffer, where consecutive ones share an entry. A batch is written when it
+// has FILE_WRITE_ENTRY_COUNT entries or its staging buffer is full. The
+// count is the system's limit for one writev call, or at least the POSIX
+// minimum of 16, and no more than 1024 so the batch fits on the stack.
+#define FILE_WRITE_SMALL 128
+#define FILE_WRITE_STAGING_SIZE ((size_t)16 << 10)
+
+#if defined(IOV_MAX)
+#define FILE_WRITE_MAX_ENTRIES IOV_MAX
+#elif defined(UIO_MAXIOV)
+#define FILE_WRITE_MAX_ENTRIES UIO_MAXIOV
+#else
+#define FILE_WRITE_MAX_ENTRIES 16
+#endif
+
+#if FILE_WRITE_MAX_ENTRIES < 1024
+#define FILE_WRITE_ENTRY_COUNT FILE_WRITE_MAX_ENTRIES
+#else
+#define FILE_WRITE_ENTRY_COUNT 1024
+#endif
+
+
+#ifdef _WIN32
+// The same layout as POSIX so batches are built the same way, but each
+// entry is written with its own call.
+struct iovec
+{
+    void * iov_base;
+    size_t iov_len;
+};
+#endif
+
+
+struct file_write_batch
+{
+    int fd;
+    // The number of entries used.
+    size_t count;
+    // The number of bytes used in the staging buffer.
+    size_t staged;
+    // true if the last entry is the staging buffer's, so small pieces can be added to it.
+    bool staging_last;
+    struct iovec entries[FILE_WRITE_ENTRY_COUNT];
+    char staging[FILE_WRITE_STAGING_SIZE];
+};
+
+
+// Write every entry of the batch and empty it.
+static bool file_write_flush(struct file_write_batch * batch)
+{
+    struct iovec * entry = batch->entries;
+    struct iovec * end = batch->entries + batch->count;
+    batch->count = 0;
+    batch->staged = 0;
+    batch->staging_last = false;
+
+    while (entry != end)
+    {
+#ifdef _WIN32
+        int written = _write(batch->fd, entry->iov_base,
+                             (unsigned)((entry->iov_len < INT_MAX) ? entry->iov_len : INT_MAX));
+#else
+        ssize_t written = writev(batch->fd, entry, (int)(end - entry));
+#endif
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0)
+            return false;
+
+        // Skip the entries that were written whole and the written start of the next one.
+        size_t remaining = (size_t)written;
+        while (entry != end && remaining >= entry->iov_len)
+            remaining -= entry++->iov_len;
+        if (remaining > 0)
+        {
+            entry->iov_base = (char *)entry->iov_base + remaining;
+            entry->iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+
+// Add `size` bytes at `data` to the batch, writing it first if it's full.
+static bool file_write_add(struct file_write_batch * batch, char const * data, size_t size)
+{
+    if (size == 0)
+        return true;
+
+    if (size >= FILE_WRITE_SMALL)
+    {
+        if (batch->count == FILE_WRITE_ENTRY_COUNT && !file_write_flush(batch))
+            return false;
+        batch->entries[batch->count++] = (struct iovec){(void *)data, size};
+        batch->staging_last = false;
+        return true;
+    }
+
+    if (batch->staged + size > FILE_WRITE_STAGING_SIZE && !file_write_flush(batch))
+        return false;
+    if (!batch->staging_last)
+    {
+        if (batch->count == FILE_WRITE_ENTRY_COUNT && !file_write_flush(batch))
+            return false;
+        batch->entries[batch->count++] = (struct iovec){batch->staging + batch->staged, 0};
+        batch->staging_last = true;
+    }
+    memcpy(batch->staging + batch->staged, data, size);
+    batch->staged += size;
+    batch->entries[batch->count - 1].iov_len += size;
+    return true;
+}
+
+
+bool file_write_strings(int fd, struct string const * strings, size_t count,
+                        struct string const * separator)
+{
+    assert(strings || count == 0);
+
+    struct file_write_batch batch;
+    batch.fd = fd;
+    batch.count = 0;
+    batch.staged = 0;
+    batch.staging_last = false;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i > 0 && separator != NULL && !file_write_add(&batch, separator->data, separator->size))
+            return false;
+        if (!file_write_add(&batch, strings[i].data, strings[i].size))
+            return false;
+    }
+    return file_write_flush(&batch);
+}
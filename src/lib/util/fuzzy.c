@@ -0,0 +1,326 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/fuzzy.h"
+#include "util/string.h"
+
+
+// The pattern is the rows of the table of distances and the text is its
+// columns. Each column is stored as two bit vectors per block of 64 rows:
+// bit `i` of `plus` is set when row `i + 1` is one more than row `i`, and of
+// `minus` when it's one less. The distance in the bottom row of each block
+// is kept as its score. The top row, the distance from the empty pattern,
+// goes up by one in every column, so one is always stepped into block 0.
+#define FUZZY_BLOCK_SIZE 64
+
+
+struct fuzzy_pattern
+{
+    size_t size;
+    size_t block_count;
+    uint64_t * peq;       // The rows of each byte value, the blocks of each value together.
+    uint64_t * plus;      // The steps up in each block.
+    uint64_t * minus;     // The steps down in each block.
+    size_t * scores;      // The distance in the bottom row of each block.
+    uint64_t single[256]; // `peq` when the pattern fits in one block.
+};
+
+
+// Find the rows of each byte in `string`. If `text` isn't NULL, the pattern
+// is only compared with `text`, and for one block only the rows of the
+// bytes in it are cleared, which is quicker for short strings than
+// clearing the rows of every byte value.
+static bool fuzzy_pattern_init(struct fuzzy_pattern * pattern, struct string const * string,
+                               struct string const * text)
+{
+    pattern->size = string->size;
+    pattern->block_count = (string->size + FUZZY_BLOCK_SIZE - 1) / FUZZY_BLOCK_SIZE;
+    pattern->plus = NULL;
+    pattern->minus = NULL;
+    pattern->scores = NULL;
+
+    size_t const blocks = pattern->block_count;
+    if (blocks <= 1 && text != NULL && text->size < 256)
+    {
+        for (size_t j = 0; j < text->size; ++j)
+            pattern->single[(unsigned char)text->data[j]] = 0;
+        pattern->peq = pattern->single;
+    }
+    else if (blocks <= 1)
+    {
+        memset(pattern->single, 0, sizeof(pattern->single));
+        pattern->peq = pattern->single;
+    }
+    else
+    {
+        // One allocation holds the masks and the state of every block.
+        pattern->peq = calloc((256 + 2) * blocks, sizeof(uint64_t));
+        pattern->scores = malloc(blocks * sizeof(size_t));
+        if (pattern->peq == NULL || pattern->scores == NULL)
+        {
+            free(pattern->peq);
+            free(pattern->scores);
+            return false;
+        }
+        pattern->plus = pattern->peq + 256 * blocks;
+        pattern->minus = pattern->plus + blocks;
+    }
+
+    for (size_t i = 0; i < string->size; ++i)
+        pattern->peq[(unsigned char)string->data[i] * blocks + i / FUZZY_BLOCK_SIZE] |=
+            (uint64_t)1 << (i % FUZZY_BLOCK_SIZE);
+    return true;
+}
+
+
+static void fuzzy_pattern_free(struct fuzzy_pattern * pattern)
+{
+    if (pattern->peq != pattern->single)
+    {
+        free(pattern->peq);
+        free(pattern->scores);
+    }
+}
+
+
+// Return the distance from a pattern of one block to `text`, or
+// `max_distance + 1` if it's greater.
+static size_t fuzzy_distance_single(struct fuzzy_pattern const * pattern,
+                                    struct string const * text, size_t max_distance)
+{
+    uint64_t const high = (uint64_t)1 << (pattern->size - 1);
+    uint64_t plus = ~(uint64_t)0;
+    uint64_t minus = 0;
+    size_t score = pattern->size;
+    for (size_t j = 0; j < text->size; ++j)
+    {
+        uint64_t const eq = pattern->peq[(unsigned char)text->data[j]];
+        uint64_t const xv = eq | minus;
+        uint64_t const xh = (((eq & plus) + plus) ^ plus) | eq;
+        uint64_t ph = minus | ~(xh | plus);
+        uint64_t mh = plus & xh;
+        score += (ph & high) != 0;
+        score -= (mh & high) != 0;
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        plus = mh | ~(xv | ph);
+        minus = ph & xv;
+
+        // The bottom row falls by at most one per column left, and once every
+        // row is over the limit no later column can come back under it.
+        size_t const left = text->size - 1 - j;
+        if (score > max_distance + left ||
+            (score >= max_distance + pattern->size && j >= max_distance))
+            return max_distance + 1;
+    }
+    return score;
+}
+
+
+// Advance one block by a column whose byte is in the rows `eq`, given the
+// step `in` into its top row, and return the step out of its bottom row,
+// which is the bit `high`.
+static int fuzzy_advance_block(uint64_t * plus, uint64_t * minus, uint64_t eq, int in,
+                               uint64_t high)
+{
+    uint64_t const xv = eq | *minus;
+    if (in < 0)
+        eq |= 1;
+    uint64_t const xh = (((eq & *plus) + *plus) ^ *plus) | eq;
+    uint64_t ph = *minus | ~(xh | *plus);
+    uint64_t mh = *plus & xh;
+    int const out = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+
+    ph <<= 1;
+    mh <<= 1;
+    if (in < 0)
+        mh |= 1;
+    else if (in > 0)
+        ph |= 1;
+    *plus = mh | ~(xv | ph);
+    *minus = ph & xv;
+    return out;
+}
+
+
+// Return the distance from a pattern of several blocks to `text`, or
+// `max_distance + 1` if it's greater.
+//
+// Only the blocks up to `active` are computed. Every row after them is over
+// max_distance, and since the distances along a path through the table never
+// fall, those rows can't lead to a distance within it. A block is started
+// when a path could enter it, from values that are at least the real ones,
+// which is enough to get every value within max_distance right. Blocks whose
+// rows are all over max_distance are dropped from the end.
+static size_t fuzzy_distance_blocks(struct fuzzy_pattern * pattern, struct string const * text,
+                                    size_t max_distance)
+{
+    size_t const blocks = pattern->block_count;
+    size_t const last = blocks - 1;
+    uint64_t const last_high = (uint64_t)1 << ((pattern->size - 1) % FUZZY_BLOCK_SIZE);
+    uint64_t const high = (uint64_t)1 << (FUZZY_BLOCK_SIZE - 1);
+
+    size_t const first_rows = (max_distance < pattern->size) ? max_distance : pattern->size;
+    size_t active = (first_rows == 0) ? 0 : (first_rows - 1) / FUZZY_BLOCK_SIZE;
+    for (size_t b = 0; b <= active; ++b)
+    {
+        pattern->plus[b] = ~(uint64_t)0;
+        pattern->minus[b] = 0;
+        pattern->scores[b] = (b == last) ? pattern->size : (b + 1) * FUZZY_BLOCK_SIZE;
+    }
+
+    for (size_t j = 0; j < text->size; ++j)
+    {
+        uint64_t const * eq = pattern->peq + (unsigned char)text->data[j] * blocks;
+        int step = 1;
+        for (size_t b = 0; b <= active; ++b)
+        {
+            step = fuzzy_advance_block(pattern->plus + b, pattern->minus + b, eq[b], step,
+                                       (b == last) ? last_high : high);
+            pattern->scores[b] += (size_t)step;
+        }
+
+        // Start the next block if its top row could be within the limit,
+        // from the bottom row of the active block in this column or the last.
+        size_t const bottom = pattern->scores[active];
+        size_t const previous = bottom - (size_t)step;
+        if (active < last && (previous <= max_distance || bottom < max_distance))
+        {
+            ++active;
+            size_t const rows =
+                (active == last) ? pattern->size - active * FUZZY_BLOCK_SIZE : FUZZY_BLOCK_SIZE;
+            pattern->plus[active] = ~(uint64_t)0;
+            pattern->minus[active] = 0;
+            pattern->scores[active] = previous + rows;
+            step = fuzzy_advance_block(pattern->plus + active, pattern->minus + active,
+                                       eq[active], step, (active == last) ? last_high : high);
+            pattern->scores[active] += (size_t)step;
+        }
+
+        size_t rows = (active == last) ? pattern->size - active * FUZZY_BLOCK_SIZE
+                                       : FUZZY_BLOCK_SIZE;
+        while (active > 0 && pattern->scores[active] >= max_distance + rows)
+        {
+            --active;
+            rows = FUZZY_BLOCK_SIZE;
+        }
+        if (active == 0 && pattern->scores[0] >= max_distance + rows && j >= max_distance)
+            return max_distance + 1;
+
+        size_t const left = text->size - 1 - j;
+        if (active == last && pattern->scores[last] > max_distance + left)
+            return max_distance + 1;
+    }
+
+    if (active < last || pattern->scores[last] > max_distance)
+        return max_distance + 1;
+    return pattern->scores[last];
+}
+
+
+// Return the distance from `pattern` to `text`, or `max_distance + 1` if
+// it's greater.
+static size_t fuzzy_distance(struct fuzzy_pattern * pattern, struct string const * text,
+                             size_t max_distance)
+{
+    // The distance is at most the size of the longer string, which also
+    // keeps the sums of max_distance and row numbers from overflowing.
+    size_t const longer = (pattern->size > text->size) ? pattern->size : text->size;
+    if (max_distance > longer)
+        max_distance = longer;
+
+    size_t const difference = (pattern->size > text->size) ? pattern->size - text->size
+                                                           : text->size - pattern->size;
+    if (difference > max_distance)
+        return max_distance + 1;
+    if (pattern->size == 0)
+        return text->size;
+    if (pattern->block_count == 1)
+        return fuzzy_distance_single(pattern, text, max_distance);
+    return fuzzy_distance_blocks(pattern, text, max_distance);
+}
+
+
+// Return the distance between `a` and `b` using the shorter as the pattern,
+// `max_distance + 1` if it's greater or `SIZE_MAX` if allocation fails.
+static size_t fuzzy_distance_strings(struct string const * a, struct string const * b,
+                                     size_t max_distance)
+{
+    if (a->size > b->size)
+    {
+        struct string const * swap = a;
+        a = b;
+        b = swap;
+    }
+
+    struct fuzzy_pattern pattern;
+    if (!fuzzy_pattern_init(&pattern, a, b))
+        return SIZE_MAX;
+    size_t const distance = fuzzy_distance(&pattern, b, max_distance);
+    fuzzy_pattern_free(&pattern);
+    return distance;
+}
+
+
+size_t string_edit_distance(struct string const * a, struct string const * b)
+{
+    assert(a);
+    assert(b);
+
+    return fuzzy_distance_strings(a, b, SIZE_MAX - 1);
+}
+
+
+bool string_edit_distance_within(struct string const * a, struct string const * b,
+                                 size_t max_distance)
+{
+    assert(a);
+    assert(b);
+
+    size_t const distance = fuzzy_distance_strings(a, b, max_distance);
+    return distance != SIZE_MAX && distance <= max_distance;
+}
+
+
+size_t string_find_closest(struct string_candidate * output, size_t capacity,
+                           struct string const * query, struct string const * candidates,
+                           size_t count, size_t max_distance)
+{
+    assert(output || capacity == 0);
+    assert(query);
+    assert(candidates || count == 0);
+
+    struct fuzzy_pattern pattern;
+    if (capacity == 0 || !fuzzy_pattern_init(&pattern, query, NULL))
+        return 0;
+
+    size_t found = 0;
+    size_t limit = max_distance;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t const distance = fuzzy_distance(&pattern, candidates + i, limit);
+        if (distance > limit)
+            continue;
+
+        // Insert after the candidates that are as close, dropping the
+        // furthest once the output is full.
+        size_t j = (found < capacity) ? found++ : capacity - 1;
+        for (; j > 0 && output[j - 1].distance > distance; --j)
+            output[j] = output[j - 1];
+        output[j] = (struct string_candidate){i, distance};
+
+        // From now on only candidates closer than the furthest are wanted.
+        if (found == capacity)
+        {
+            if (output[capacity - 1].distance == 0)
+                break;
+            limit = output[capacity - 1].distance - 1;
+        }
+    }
+
+    fuzzy_pattern_free(&pattern);
+    return found;
+}
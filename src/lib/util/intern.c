@@ -0,0 +1,305 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "util/arena.h"
+#include "util/intern.h"
+#include "util/string.h"
+
+
+// The table is split into shards by the high bits of each string's hash.
+// Every shard is an open-addressing hash table with linear probing whose
+// slots are atomic pointers to atoms, so readers can probe it without a lock.
+//
+// Writers take the shard's lock, re-probe, and publish a new atom with a
+// release store after it has been fully written. When a shard fills up the
+// writer copies the slots to a larger array and publishes that instead.
+// Readers may still be probing the old array so it is kept, on a list of
+// retired arrays, until the table is freed. As arrays double in size the
+// retired arrays never use more memory than the live one.
+#define INTERN_SHARD_BITS 6
+#define INTERN_SHARDS (1 << INTERN_SHARD_BITS)
+#define INTERN_INITIAL_CAPACITY 16
+
+
+struct intern_atom
+{
+    uint64_t hash; // The hash of the contents, compared before the contents.
+    size_t size;   // The size of the contents in bytes.
+    char data[];   // The contents followed by a '\0'.
+};
+
+
+struct intern_slots
+{
+    struct intern_slots * retired;          // The array this one replaced.
+    size_t mask;                            // The number of slots minus one.
+    _Atomic(struct intern_atom *) slots[];  // The slots; NULL when empty.
+};
+
+
+// Align shards to a cache line so writers in different shards don't contend.
+struct intern_shard
+{
+    _Alignas(64) _Atomic(struct intern_slots *) slots;
+    mtx_t lock;          // Held by writers.
+    size_t count;        // The number of atoms; only accessed under `lock`.
+    struct arena atoms;  // Memory for the atoms; only accessed under `lock`.
+};
+
+
+struct intern_table
+{
+    uint64_t seed;
+    struct intern_shard shards[INTERN_SHARDS];
+};
+
+
+static struct intern_slots * intern_slots_make(size_t capacity)
+{
+    struct intern_slots * slots =
+        malloc(sizeof(struct intern_slots) + capacity * sizeof(slots->slots[0]));
+    if (slots == NULL)
+        return NULL;
+
+    slots->retired = NULL;
+    slots->mask = capacity - 1;
+    for (size_t i = 0; i < capacity; ++i)
+        atomic_init(&slots->slots[i], NULL);
+    return slots;
+}
+
+
+struct intern_table * intern_table_make()
+{
+    // The shards are over-aligned so malloc isn't guaranteed to align them.
+    struct intern_table * table =
+        aligned_alloc(_Alignof(struct intern_table), sizeof(struct intern_table));
+    if (table == NULL)
+        return NULL;
+
+    // Seed the hash from the table's address and the time so that the layout
+    // of the table can't easily be predicted.
+    table->seed = (uint64_t)(uintptr_t)table ^ ((uint64_t)time(NULL) << 32);
+
+    for (size_t i = 0; i < INTERN_SHARDS; ++i)
+    {
+        struct intern_shard * shard = table->shards + i;
+        struct intern_slots * slots = intern_slots_make(INTERN_INITIAL_CAPACITY);
+        if (slots == NULL || mtx_init(&shard->lock, mtx_plain) != thrd_success)
+        {
+            free(slots);
+            for (size_t j = 0; j < i; ++j)
+            {
+                free(atomic_load_explicit(&table->shards[j].slots, memory_order_relaxed));
+                mtx_destroy(&table->shards[j].lock);
+            }
+            free(table);
+            return NULL;
+        }
+        atomic_init(&shard->slots, slots);
+        shard->count = 0;
+        arena_init(&shard->atoms, 0);
+    }
+
+    return table;
+}
+
+
+void intern_table_free(struct intern_table * table)
+{
+    if (table == NULL)
+        return;
+
+    for (size_t i = 0; i < INTERN_SHARDS; ++i)
+    {
+        struct intern_shard * shard = table->shards + i;
+        struct intern_slots * slots = atomic_load_explicit(&shard->slots, memory_order_relaxed);
+        while (slots != NULL)
+        {
+            struct intern_slots * retired = slots->retired;
+            free(slots);
+            slots = retired;
+        }
+        mtx_destroy(&shard->lock);
+        arena_free(&shard->atoms);
+    }
+
+    free(table);
+}
+
+
+static inline struct intern_shard * intern_shard_of(struct intern_table const * table,
+                                                    uint64_t hash)
+{
+    return (struct intern_shard *)(table->shards + (hash >> (64 - INTERN_SHARD_BITS)));
+}
+
+
+// Probe `slots` for `string`. Return the atom if it's found, otherwise return
+// NULL and store the index of the empty slot that ended the probe in `empty`.
+static struct intern_atom * intern_probe(struct intern_slots * slots, struct string const * string,
+                                         uint64_t hash, size_t * empty)
+{
+    for (size_t i = hash & slots->mask;; i = (i + 1) & slots->mask)
+    {
+        struct intern_atom * atom = atomic_load_explicit(&slots->slots[i], memory_order_acquire);
+        if (atom == NULL)
+        {
+            *empty = i;
+            return NULL;
+        }
+
+        if (atom->hash == hash && atom->size == string->size &&
+            (string->size == 0 || memcmp(atom->data, string->data, string->size) == 0))
+            return atom;
+    }
+}
+
+
+static inline void intern_atom_view(struct intern_atom * atom, struct string * view)
+{
+    view->data = atom->data;
+    view->size = atom->size;
+}
+
+
+// Find the atom for `string` without taking a lock.
+static struct intern_atom * intern_find(struct intern_shard * shard, struct string const * string,
+                                        uint64_t hash)
+{
+    struct intern_slots * slots = atomic_load_explicit(&shard->slots, memory_order_acquire);
+    size_t empty;
+    return intern_probe(slots, string, hash, &empty);
+}
+
+
+bool intern_lookup(struct intern_table const * table, struct string const * string,
+                   struct string * atom)
+{
+    assert(table);
+    assert(string);
+    assert(atom);
+
+    uint64_t hash = string_hash(string, table->seed);
+    struct intern_atom * found = intern_find(intern_shard_of(table, hash), string, hash);
+    if (found == NULL)
+        return false;
+
+    intern_atom_view(found, atom);
+    return true;
+}
+
+
+// Double the number of slots in `shard`. Must be called with the lock held.
+static bool intern_shard_grow(struct intern_shard * shard)
+{
+    struct intern_slots * old = atomic_load_explicit(&shard->slots, memory_order_relaxed);
+    struct intern_slots * grown = intern_slots_make(2 * (old->mask + 1));
+    if (grown == NULL)
+        return false;
+
+    for (size_t i = 0; i <= old->mask; ++i)
+    {
+        struct intern_atom * atom = atomic_load_explicit(&old->slots[i], memory_order_relaxed);
+        if (atom == NULL)
+            continue;
+
+        size_t j = atom->hash & grown->mask;
+        while (atomic_load_explicit(&grown->slots[j], memory_order_relaxed) != NULL)
+            j = (j + 1) & grown->mask;
+        atomic_store_explicit(&grown->slots[j], atom, memory_order_relaxed);
+    }
+
+    grown->retired = old;
+    atomic_store_explicit(&shard->slots, grown, memory_order_release);
+    return true;
+}
+
+
+bool intern_string(struct intern_table * table, struct string const * string,
+                   struct string * atom)
+{
+    assert(table);
+    assert(string);
+    assert(atom);
+
+    // Most calls find an existing atom so try without the lock first.
+    uint64_t hash = string_hash(string, table->seed);
+    struct intern_shard * shard = intern_shard_of(table, hash);
+    struct intern_atom * found = intern_find(shard, string, hash);
+    if (found != NULL)
+    {
+        intern_atom_view(found, atom);
+        return true;
+    }
+
+    mtx_lock(&shard->lock);
+
+    // Another thread may have added the string since the lookup.
+    struct intern_slots * slots = atomic_load_explicit(&shard->slots, memory_order_relaxed);
+    size_t empty;
+    found = intern_probe(slots, string, hash, &empty);
+    if (found != NULL)
+    {
+        mtx_unlock(&shard->lock);
+        intern_atom_view(found, atom);
+        return true;
+    }
+
+    // Keep the load factor at or below one half so probes stay short.
+    if (2 * (shard->count + 1) > slots->mask + 1)
+    {
+        if (!intern_shard_grow(shard))
+        {
+            mtx_unlock(&shard->lock);
+            return false;
+        }
+        slots = atomic_load_explicit(&shard->slots, memory_order_relaxed);
+        intern_probe(slots, string, hash, &empty);
+    }
+
+    struct intern_atom * created =
+        arena_alloc_aligned(&shard->atoms, sizeof(struct intern_atom) + string->size + 1,
+                            _Alignof(struct intern_atom));
+    if (created == NULL)
+    {
+        mtx_unlock(&shard->lock);
+        return false;
+    }
+    created->hash = hash;
+    created->size = string->size;
+    if (string->size > 0)
+        memcpy(created->data, string->data, string->size);
+    created->data[string->size] = '\0';
+
+    // Publish the atom only after it has been written.
+    atomic_store_explicit(&slots->slots[empty], created, memory_order_release);
+    shard->count += 1;
+    mtx_unlock(&shard->lock);
+
+    intern_atom_view(created, atom);
+    return true;
+}
+
+
+size_t intern_table_size(struct intern_table const * table)
+{
+    assert(table);
+
+    // Cast away const to take the locks; the table itself isn't modified.
+    struct intern_table * mutable_table = (struct intern_table *)table;
+    size_t size = 0;
+    for (size_t i = 0; i < INTERN_SHARDS; ++i)
+    {
+        mtx_lock(&mutable_table->shards[i].lock);
+        size += mutable_table->shards[i].count;
+        mtx_unlock(&mutable_table->shards[i].lock);
+    }
+    return size;
+}
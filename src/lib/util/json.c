@@ -0,0 +1,866 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/json.h"
+#include "util/string.h"
+
+#ifdef CPU_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Block classification
+////////////////////////////////////////////////////////////////////////////////
+
+
+// The bytes of a 64-byte block that matter to the tokenizer. Bit `i` of each
+// mask describes byte `i` of the block.
+struct json_block
+{
+    uint64_t quotes;      // `"`
+    uint64_t backslashes; // `\`
+    uint64_t structurals; // `{`, `}`, `[`, `]`, `:` and `,`
+    uint64_t spaces;      // Space, tab, newline and carriage return
+};
+
+
+static inline bool json_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+// Classify the first `size` bytes of `data`, which may be fewer than 64.
+static void json_classify_scalar(struct json_block * block, char const * data, size_t size)
+{
+    *block = (struct json_block){0, 0, 0, 0};
+    for (size_t i = 0; i < size; ++i)
+    {
+        char const c = data[i];
+        block->quotes |= (uint64_t)(c == '"') << i;
+        block->backslashes |= (uint64_t)(c == '\\') << i;
+        block->structurals |= (uint64_t)(c == '{' || c == '}' || c == '[' || c == ']' ||
+                                         c == ':' || c == ',')
+                              << i;
+        block->spaces |= (uint64_t)json_is_space(c) << i;
+    }
+}
+
+
+#ifdef CPU_X86_KERNELS
+
+
+// The brackets and braces differ only in bit 5, so setting it in every byte
+// leaves two values to compare with instead of four.
+
+
+static __attribute__((target("sse2"))) void json_classify_sse2(struct json_block * block,
+                                                               char const * data)
+{
+    *block = (struct json_block){0, 0, 0, 0};
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i bytes = _mm_loadu_si128((__m128i const *)(data + 16 * i));
+        __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+        __m128i structurals = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+                         _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(':')),
+                         _mm_cmpeq_epi8(bytes, _mm_set1_epi8(','))));
+        __m128i spaces = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')),
+                         _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+        __m128i quotes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+        __m128i backslashes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+        block->quotes |= (uint64_t)(uint16_t)_mm_movemask_epi8(quotes) << (16 * i);
+        block->backslashes |= (uint64_t)(uint16_t)_mm_movemask_epi8(backslashes) << (16 * i);
+        block->structurals |= (uint64_t)(uint16_t)_mm_movemask_epi8(structurals) << (16 * i);
+        block->spaces |= (uint64_t)(uint16_t)_mm_movemask_epi8(spaces) << (16 * i);
+    }
+}
+
+
+static __attribute__((target("avx2"))) void json_classify_avx2(struct json_block * block,
+                                                               char const * data)
+{
+    *block = (struct json_block){0, 0, 0, 0};
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256i bytes = _mm256_loadu_si256((__m256i const *)(data + 32 * i));
+        __m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+        __m256i structurals = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(','))));
+        __m256i spaces = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r'))));
+        __m256i quotes = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"'));
+        __m256i backslashes = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\'));
+        block->quotes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(quotes) << (32 * i);
+        block->backslashes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(backslashes) << (32 * i);
+        block->structurals |= (uint64_t)(uint32_t)_mm256_movemask_epi8(structurals) << (32 * i);
+        block->spaces |= (uint64_t)(uint32_t)_mm256_movemask_epi8(spaces) << (32 * i);
+    }
+}
+
+
+static __attribute__((target("avx512f,avx512bw"))) void
+json_classify_avx512(struct json_block * block, char const * data)
+{
+    __m512i bytes = _mm512_loadu_si512((void const *)data);
+    __m512i lower = _mm512_or_si512(bytes, _mm512_set1_epi8(0x20));
+    block->quotes = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('"'));
+    block->backslashes = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\\'));
+    block->structurals = _mm512_cmpeq_epi8_mask(lower, _mm512_set1_epi8('{')) |
+                         _mm512_cmpeq_epi8_mask(lower, _mm512_set1_epi8('}')) |
+                         _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(':')) |
+                         _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(','));
+    block->spaces = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(' ')) |
+                    _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\t')) |
+                    _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\n')) |
+                    _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('\r'));
+}
+
+
+#endif // CPU_X86_KERNELS
+
+
+static void json_classify_scalar_block(struct json_block * block, char const * data)
+{
+    json_classify_scalar(block, data, 64);
+}
+
+
+// Return a mask of the bytes escaped by a backslash, given a mask of the
+// backslashes. `carry` is 1 if the first byte is escaped by a backslash at
+// the end of the previous block, and is set to whether the first byte of the
+// next block is.
+//
+// In a run of backslashes every second one escapes the next byte, so the
+// byte after the run is escaped if the run is odd. Adding the starts of the
+// runs that begin on odd bits to the backslashes carries each of those runs
+// along to the byte after it, which flips the parity of the bits the run
+// escapes from the even ones to the odd ones.
+static inline uint64_t json_escaped(uint64_t backslashes, uint64_t * carry)
+{
+    uint64_t const even_bits = 0x5555555555555555;
+    if (backslashes == 0)
+    {
+        uint64_t const escaped = *carry;
+        *carry = 0;
+        return escaped;
+    }
+
+    backslashes &= ~*carry;
+    uint64_t const follows_backslash = (backslashes << 1) | *carry;
+    uint64_t const odd_starts = backslashes & ~even_bits & ~follows_backslash;
+    uint64_t sums;
+    *carry = __builtin_add_overflow(odd_starts, backslashes, &sums);
+    return (even_bits ^ (sums << 1)) & follows_backslash;
+}
+
+
+// Return a mask with bit `i` set if an odd number of bits `0` to `i` of
+// `mask` are set, as csv_prefix_xor() does.
+static inline uint64_t json_prefix_xor(uint64_t mask)
+{
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Reader
+////////////////////////////////////////////////////////////////////////////////
+
+
+// What the grammar allows next.
+enum json_expect
+{
+    JSON_EXPECT_VALUE,        // At the top level or after a `:` or a `,` in an array.
+    JSON_EXPECT_VALUE_OR_END, // After a `[`.
+    JSON_EXPECT_KEY,          // After a `,` in an object.
+    JSON_EXPECT_KEY_OR_END,   // After a `{`.
+    JSON_EXPECT_COLON,        // After a key.
+    JSON_EXPECT_COMMA_OR_END, // After a value in an object or an array.
+};
+
+
+// The kind of token whose end hasn't been found yet.
+enum json_open
+{
+    JSON_OPEN_NONE,
+    JSON_OPEN_KEY,
+    JSON_OPEN_STRING,
+    JSON_OPEN_SCALAR, // A number or a literal.
+};
+
+
+void json_reader_init(struct json_reader * reader)
+{
+    assert(reader);
+
+    reader->chunk = (struct string){NULL, 0};
+    reader->chunk_offset = 0;
+    reader->start = 0;
+    reader->block = 0;
+    reader->next_block = 0;
+    reader->mask = 0;
+    reader->inside = 0;
+    reader->escaped = 0;
+    reader->scalar = 0;
+    reader->scalars = 0;
+    string_builder_init(&reader->pending);
+    reader->depth = 0;
+    reader->offset = 0;
+    reader->expect = JSON_EXPECT_VALUE;
+    reader->open = JSON_OPEN_NONE;
+    reader->final = false;
+    reader->pending_returned = false;
+    reader->classify = json_classify_scalar_block;
+}
+
+
+void json_reader_free(struct json_reader * reader)
+{
+    assert(reader);
+
+    string_builder_free(&reader->pending);
+}
+
+
+void json_reader_feed(struct json_reader * reader, struct string const * chunk, bool final)
+{
+    assert(reader);
+    assert(chunk);
+
+    reader->chunk_offset += reader->chunk.size;
+    reader->chunk = *chunk;
+    reader->start = 0;
+    reader->block = 0;
+    reader->next_block = 0;
+    reader->mask = 0;
+    reader->final = final;
+
+    // The kernel is chosen once per chunk rather than for each block.
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            reader->classify = json_classify_avx512;
+            break;
+        case CPU_ISA_AVX2:
+            reader->classify = json_classify_avx2;
+            break;
+        case CPU_ISA_SSE2:
+            reader->classify = json_classify_sse2;
+            break;
+#endif
+        default:
+            reader->classify = json_classify_scalar_block;
+            break;
+    }
+}
+
+
+// Read the next block of the chunk into the reader's mask of where tokens
+// start and strings end. Return false at the end of the chunk.
+static bool json_reader_load(struct json_reader * reader)
+{
+    if (reader->next_block >= reader->chunk.size)
+        return false;
+
+    struct json_block block;
+    char const * data = reader->chunk.data + reader->next_block;
+    size_t size = reader->chunk.size - reader->next_block;
+    if (size >= 64)
+        reader->classify(&block, data);
+    else
+        json_classify_scalar(&block, data, size);
+
+    // Bytes past the end of a short block count as spaces, and the state to
+    // carry into the next block is that after its last byte.
+    uint64_t past_end = 0;
+    if (size < 64)
+        past_end = UINT64_MAX << size;
+    else
+        size = 64;
+    block.spaces |= past_end;
+
+    uint64_t escaped = json_escaped(block.backslashes, &reader->escaped);
+    if (size < 64)
+        reader->escaped = (escaped >> size) & 1;
+    uint64_t quotes = block.quotes & ~escaped;
+    uint64_t inside = json_prefix_xor(quotes) ^ reader->inside;
+    reader->inside = 0 - (inside >> 63);
+
+    // Numbers and literals are the runs of bytes that are none of the others,
+    // so they start where the mask of them turns on and end where it turns
+    // off. Only the starts go in the mask, and the ends are looked up when
+    // they're needed. Bytes past the end of the block could be part of a
+    // number continued in the next chunk, so none ends there.
+    uint64_t scalar = ~(block.structurals | block.spaces | quotes | inside);
+    uint64_t starts = scalar & ~((scalar << 1) | reader->scalar);
+    reader->scalar = (scalar >> (size - 1)) & 1;
+    reader->scalars = scalar | past_end;
+
+    reader->mask = (block.structurals & ~inside) | quotes | starts;
+    reader->block = reader->next_block;
+    reader->next_block += 64;
+    return true;
+}
+
+
+// Remove the next boundary from the mask, loading blocks as needed, and
+// return its offset in the chunk, or `SIZE_MAX` at the end of the chunk.
+static inline size_t json_reader_pop(struct json_reader * reader)
+{
+    while (reader->mask == 0)
+    {
+        if (!json_reader_load(reader))
+            return SIZE_MAX;
+    }
+    size_t const position = reader->block + (size_t)__builtin_ctzll(reader->mask);
+    reader->mask &= reader->mask - 1;
+    return position;
+}
+
+
+static inline bool json_reader_in_object(struct json_reader const * reader)
+{
+    size_t const top = reader->depth - 1;
+    return (reader->objects[top / 64] >> (top % 64)) & 1;
+}
+
+
+static inline bool json_reader_expects_value(struct json_reader const * reader)
+{
+    return reader->expect == JSON_EXPECT_VALUE || reader->expect == JSON_EXPECT_VALUE_OR_END;
+}
+
+
+// Update what the grammar allows after a value ends.
+static inline void json_reader_value_end(struct json_reader * reader)
+{
+    reader->expect = (reader->depth == 0) ? JSON_EXPECT_VALUE : JSON_EXPECT_COMMA_OR_END;
+}
+
+
+static enum json_rc json_reader_invalid(struct json_reader * reader, size_t position)
+{
+    reader->offset = reader->chunk_offset + position;
+    return JSON_RC_INVALID;
+}
+
+
+// Keep the start of the token the chunk ends in, to be joined to the rest of
+// it from the next chunk.
+static enum json_rc json_reader_need_input(struct json_reader * reader)
+{
+    struct string const rest = {reader->chunk.data + reader->start,
+                                reader->chunk.size - reader->start};
+    if (!string_builder_append(&reader->pending, &rest))
+        return JSON_RC_ERROR;
+    reader->start = reader->chunk.size;
+    return JSON_RC_NEED_INPUT;
+}
+
+
+// Store the text that ends at offset `end` of the chunk in `token`, prefixed
+// by the pending bytes from earlier chunks if there are any.
+static bool json_reader_text(struct json_reader * reader, struct json_token * token, size_t end)
+{
+    token->text.data = reader->chunk.data + reader->start;
+    token->text.size = end - reader->start;
+    if (reader->pending.size > 0)
+    {
+        if (!string_builder_append(&reader->pending, &token->text))
+            return false;
+        token->text.data = reader->pending.data;
+        token->text.size = reader->pending.size;
+        reader->pending_returned = true;
+    }
+    return true;
+}
+
+
+// Return the number or literal that starts at offset `start` of the chunk,
+// or in an earlier chunk. `after` is the mask of bytes of the block that
+// aren't part of one, from the start of the token on.
+static enum json_rc json_reader_scalar(struct json_reader * reader, struct json_token * token,
+                                       uint64_t after)
+{
+    // A token that reaches the end of the block ends at the first byte of a
+    // later one that isn't part of it.
+    while (after == 0)
+    {
+        if (!json_reader_load(reader))
+            break;
+        after = ~reader->scalars;
+    }
+    if (after == 0 && !reader->final)
+    {
+        reader->open = JSON_OPEN_SCALAR;
+        return json_reader_need_input(reader);
+    }
+
+    size_t const end =
+        (after == 0) ? reader->chunk.size : reader->block + (size_t)__builtin_ctzll(after);
+    reader->open = JSON_OPEN_NONE;
+    if (!json_reader_text(reader, token, end))
+        return JSON_RC_ERROR;
+
+    // Literals are checked in full, and numbers only by their first byte. The
+    // rest of a number is checked when it's converted.
+    struct string const * text = &token->text;
+    switch (text->data[0])
+    {
+        case 't':
+            token->type = JSON_TOKEN_TRUE;
+            if (!string_is_equal_cstr(text, "true"))
+                return JSON_RC_INVALID;
+            break;
+        case 'f':
+            token->type = JSON_TOKEN_FALSE;
+            if (!string_is_equal_cstr(text, "false"))
+                return JSON_RC_INVALID;
+            break;
+        case 'n':
+            token->type = JSON_TOKEN_NULL;
+            if (!string_is_equal_cstr(text, "null"))
+                return JSON_RC_INVALID;
+            break;
+        default:
+            token->type = JSON_TOKEN_NUMBER;
+            if (text->data[0] != '-' && (text->data[0] < '0' || text->data[0] > '9'))
+                return JSON_RC_INVALID;
+            break;
+    }
+    json_reader_value_end(reader);
+    return JSON_RC_TOKEN;
+}
+
+
+// Return the key or string whose opening quote has been read.
+static enum json_rc json_reader_string(struct json_reader * reader, struct json_token * token)
+{
+    // Inside a string the only boundary is the closing quote.
+    size_t const end = json_reader_pop(reader);
+    if (end == SIZE_MAX)
+    {
+        if (!reader->final)
+            return json_reader_need_input(reader);
+        return json_reader_invalid(reader, reader->chunk.size);
+    }
+
+    if (!json_reader_text(reader, token, end))
+        return JSON_RC_ERROR;
+    if (reader->open == JSON_OPEN_KEY)
+    {
+        token->type = JSON_TOKEN_KEY;
+        reader->expect = JSON_EXPECT_COLON;
+    }
+    else
+    {
+        token->type = JSON_TOKEN_STRING;
+        json_reader_value_end(reader);
+    }
+    reader->open = JSON_OPEN_NONE;
+    return JSON_RC_TOKEN;
+}
+
+
+// Return the bracket or brace at offset `position` of the chunk.
+static enum json_rc json_reader_bracket(struct json_reader * reader, struct json_token * token,
+                                        size_t position)
+{
+    char const c = reader->chunk.data[position];
+    bool const object = (c == '{' || c == '}');
+    if (c == '{' || c == '[')
+    {
+        if (!json_reader_expects_value(reader) || reader->depth == JSON_MAX_DEPTH)
+            return json_reader_invalid(reader, position);
+
+        uint64_t const bit = (uint64_t)1 << (reader->depth % 64);
+        if (object)
+            reader->objects[reader->depth / 64] |= bit;
+        else
+            reader->objects[reader->depth / 64] &= ~bit;
+        ++reader->depth;
+        reader->expect = object ? JSON_EXPECT_KEY_OR_END : JSON_EXPECT_VALUE_OR_END;
+        token->type = object ? JSON_TOKEN_OBJECT_START : JSON_TOKEN_ARRAY_START;
+    }
+    else
+    {
+        int const empty = object ? JSON_EXPECT_KEY_OR_END : JSON_EXPECT_VALUE_OR_END;
+        if (reader->depth == 0 || json_reader_in_object(reader) != object ||
+            (reader->expect != empty && reader->expect != JSON_EXPECT_COMMA_OR_END))
+            return json_reader_invalid(reader, position);
+
+        --reader->depth;
+        json_reader_value_end(reader);
+        token->type = object ? JSON_TOKEN_OBJECT_END : JSON_TOKEN_ARRAY_END;
+    }
+
+    token->text = (struct string){reader->chunk.data + position, 1};
+    reader->offset = reader->chunk_offset + position;
+    return JSON_RC_TOKEN;
+}
+
+
+// Release the pending bytes if they've been returned as a token, which is
+// only valid until the next call.
+static inline void json_reader_release(struct json_reader * reader)
+{
+    if (reader->pending_returned)
+    {
+        string_builder_clear(&reader->pending);
+        reader->pending_returned = false;
+    }
+}
+
+
+static inline enum json_rc json_reader_token(struct json_reader * reader,
+                                             struct json_token * token)
+{
+    // Finish the token the last chunk ended in.
+    if (reader->open == JSON_OPEN_SCALAR)
+        return json_reader_scalar(reader, token, 0);
+    if (reader->open != JSON_OPEN_NONE)
+        return json_reader_string(reader, token);
+
+    for (;;)
+    {
+        size_t const position = json_reader_pop(reader);
+        if (position == SIZE_MAX)
+        {
+            if (!reader->final)
+                return JSON_RC_NEED_INPUT;
+            if (reader->depth > 0)
+                return json_reader_invalid(reader, reader->chunk.size);
+            return JSON_RC_END;
+        }
+
+        switch (reader->chunk.data[position])
+        {
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+                return json_reader_bracket(reader, token, position);
+            case ':':
+                if (reader->expect != JSON_EXPECT_COLON)
+                    return json_reader_invalid(reader, position);
+                reader->expect = JSON_EXPECT_VALUE;
+                break;
+            case ',':
+                if (reader->expect != JSON_EXPECT_COMMA_OR_END)
+                    return json_reader_invalid(reader, position);
+                reader->expect =
+                    json_reader_in_object(reader) ? JSON_EXPECT_KEY : JSON_EXPECT_VALUE;
+                break;
+            case '"':
+                if (reader->expect == JSON_EXPECT_KEY || reader->expect == JSON_EXPECT_KEY_OR_END)
+                    reader->open = JSON_OPEN_KEY;
+                else if (json_reader_expects_value(reader))
+                    reader->open = JSON_OPEN_STRING;
+                else
+                    return json_reader_invalid(reader, position);
+                reader->start = position + 1;
+                reader->offset = reader->chunk_offset + position;
+                return json_reader_string(reader, token);
+            default:
+                if (!json_reader_expects_value(reader))
+                    return json_reader_invalid(reader, position);
+                reader->start = position;
+                reader->offset = reader->chunk_offset + position;
+                return json_reader_scalar(
+                    reader, token, ~reader->scalars & (UINT64_MAX << (position - reader->block)));
+        }
+    }
+}
+
+
+enum json_rc json_reader_next(struct json_reader * reader, struct json_token * token)
+{
+    assert(reader);
+    assert(token);
+
+    json_reader_release(reader);
+    return json_reader_token(reader, token);
+}
+
+
+enum json_rc json_reader_next_batch(struct json_reader * reader, struct json_token * tokens,
+                                    size_t capacity, size_t * count)
+{
+    assert(reader);
+    assert(tokens);
+    assert(capacity > 0);
+    assert(count);
+
+    // A token made of pending bytes ends the batch, as the next token that
+    // straddles chunks would be appended to the same buffer.
+    json_reader_release(reader);
+    enum json_rc rc = JSON_RC_TOKEN;
+    size_t size = 0;
+    while (size < capacity && !reader->pending_returned)
+    {
+        rc = json_reader_token(reader, tokens + size);
+        if (rc != JSON_RC_TOKEN)
+            break;
+        ++size;
+    }
+    *count = size;
+    return rc;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Decoding
+////////////////////////////////////////////////////////////////////////////////
+
+
+// Parse the four hex digits at `data` into `code`.
+static bool json_parse_hex4(uint32_t * code, char const * data, char const * end)
+{
+    if (end - data < 4)
+        return false;
+
+    *code = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        char const c = data[i];
+        uint32_t digit;
+        if (c >= '0' && c <= '9')
+            digit = (uint32_t)(c - '0');
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+            digit = (uint32_t)((c | 0x20) - 'a' + 10);
+        else
+            return false;
+        *code = (*code << 4) | digit;
+    }
+    return true;
+}
+
+
+// Encode `code` as UTF-8 at `output` and return the number of bytes written.
+static size_t json_encode_utf8(char * output, uint32_t code)
+{
+    if (code < 0x80)
+    {
+        output[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800)
+    {
+        output[0] = (char)(0xC0 | (code >> 6));
+        output[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000)
+    {
+        output[0] = (char)(0xE0 | (code >> 12));
+        output[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        output[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    output[0] = (char)(0xF0 | (code >> 18));
+    output[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    output[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    output[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+
+size_t json_string_decode(char * output, struct string const * string)
+{
+    assert(output);
+    assert(string);
+
+    char * out = output;
+    char const * data = string->data;
+    char const * end = data + string->size;
+    while (data < end)
+    {
+        char const * backslash = memchr(data, '\\', (size_t)(end - data));
+        char const * run_end = (backslash == NULL) ? end : backslash;
+        for (char const * c = data; c < run_end; ++c)
+        {
+            if ((unsigned char)*c < 0x20)
+                return SIZE_MAX;
+        }
+        memcpy(out, data, (size_t)(run_end - data));
+        out += run_end - data;
+        data = run_end;
+        if (data == end)
+            break;
+
+        if (end - data < 2)
+            return SIZE_MAX;
+        char const escape = data[1];
+        data += 2;
+        switch (escape)
+        {
+            case '"':
+            case '\\':
+            case '/':
+                *out++ = escape;
+                break;
+            case 'b':
+                *out++ = '\b';
+                break;
+            case 'f':
+                *out++ = '\f';
+                break;
+            case 'n':
+                *out++ = '\n';
+                break;
+            case 'r':
+                *out++ = '\r';
+                break;
+            case 't':
+                *out++ = '\t';
+                break;
+            case 'u':
+            {
+                uint32_t code;
+                if (!json_parse_hex4(&code, data, end))
+                    return SIZE_MAX;
+                data += 4;
+                if (code >= 0xDC00 && code < 0xE000)
+                    return SIZE_MAX;
+                if (code >= 0xD800 && code < 0xDC00)
+                {
+                    // A high surrogate must be followed by an escaped low one.
+                    uint32_t low;
+                    if (end - data < 6 || data[0] != '\\' || data[1] != 'u' ||
+                        !json_parse_hex4(&low, data + 2, end) || low < 0xDC00 || low >= 0xE000)
+                        return SIZE_MAX;
+                    data += 6;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                out += json_encode_utf8(out, code);
+                break;
+            }
+            default:
+                return SIZE_MAX;
+        }
+    }
+    return (size_t)(out - output);
+}
+
+
+// Return the size of the number at the start of `data`, as the grammar of
+// RFC 8259 has it, or 0 if it doesn't start with one.
+static size_t json_number_size(char const * data, size_t size)
+{
+    size_t i = 0;
+    if (i < size && data[i] == '-')
+        ++i;
+    if (i < size && data[i] == '0')
+        ++i;
+    else if (i < size && data[i] >= '1' && data[i] <= '9')
+        while (i < size && data[i] >= '0' && data[i] <= '9')
+            ++i;
+    else
+        return 0;
+
+    if (i < size && data[i] == '.')
+    {
+        size_t const digits = ++i;
+        while (i < size && data[i] >= '0' && data[i] <= '9')
+            ++i;
+        if (i == digits)
+            return 0;
+    }
+    if (i < size && (data[i] == 'e' || data[i] == 'E'))
+    {
+        ++i;
+        if (i < size && (data[i] == '+' || data[i] == '-'))
+            ++i;
+        size_t const digits = i;
+        while (i < size && data[i] >= '0' && data[i] <= '9')
+            ++i;
+        if (i == digits)
+            return 0;
+    }
+    return i;
+}
+
+
+bool json_number_to_int64(int64_t * result, struct string const * number)
+{
+    assert(result);
+    assert(number);
+
+    char const * data = number->data;
+    size_t size = number->size;
+    bool const negative = (size > 0 && data[0] == '-');
+    if (negative)
+    {
+        ++data;
+        --size;
+    }
+    if (size == 0 || (size > 1 && data[0] == '0'))
+        return false;
+
+    // Accumulate the negative value, which has the larger range.
+    int64_t value = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (data[i] < '0' || data[i] > '9')
+            return false;
+        int const digit = data[i] - '0';
+        if (value < (INT64_MIN + digit) / 10)
+            return false;
+        value = value * 10 - digit;
+    }
+    if (!negative && value == INT64_MIN)
+        return false;
+
+    *result = negative ? value : -value;
+    return true;
+}
+
+
+bool json_number_to_double(double * result, struct string const * number)
+{
+    assert(result);
+    assert(number);
+
+    if (number->size == 0 || json_number_size(number->data, number->size) != number->size)
+        return false;
+
+    // strtod() needs a null-terminated string, which a token isn't.
+    char buffer[64];
+    char * copy = buffer;
+    if (number->size >= sizeof(buffer))
+    {
+        copy = malloc(number->size + 1);
+        if (copy == NULL)
+            return false;
+    }
+    memcpy(copy, number->data, number->size);
+    copy[number->size] = '\0';
+    *result = strtod(copy, NULL);
+    if (copy != buffer)
+        free(copy);
+    return true;
+}
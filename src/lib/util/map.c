@@ -0,0 +1,477 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "util/cpu.h"
+#include "util/map.h"
+#include "util/string.h"
+
+#ifdef CPU_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+// The slots are split into groups of STRING_MAP_GROUP. The low 7 bits of a
+// key's hash are stored in its slot's control byte and the rest choose the
+// first group to probe. Probing visits groups in a triangular sequence, which
+// visits every group once as the number of groups is a power of two, and
+// stops at the first group with an empty slot.
+//
+// An erased slot is marked deleted, rather than empty, if its group has no
+// empty slot, as a probe for another key may have passed through the group.
+// Deleted slots are reused by insertions but still count against the load
+// factor until the next rehash, which guarantees every probe finds an empty slot.
+#define STRING_MAP_GROUP 16
+#define STRING_MAP_EMPTY 0x80
+#define STRING_MAP_DELETED 0xFE
+
+// The map is rehashed when this fraction of the slots are full or deleted.
+#define STRING_MAP_LOAD_NUMERATOR 7
+#define STRING_MAP_LOAD_DENOMINATOR 8
+
+// The number of keys string_map_find_batch() prefetches ahead of probing.
+#define STRING_MAP_BATCH 16
+
+
+static inline size_t string_map_first_group(struct string_map const * map, uint64_t hash)
+{
+    return (size_t)(hash >> 7) & (map->capacity / STRING_MAP_GROUP - 1);
+}
+
+
+static inline unsigned char string_map_tag(uint64_t hash)
+{
+    return (unsigned char)(hash & 0x7F);
+}
+
+
+static inline bool string_map_key_is_equal(struct string const * key, struct string const * other)
+{
+    return key->size == other->size &&
+           (key->size == 0 || memcmp(key->data, other->data, key->size) == 0);
+}
+
+
+static inline size_t string_map_max_load(size_t capacity)
+{
+    return capacity / STRING_MAP_LOAD_DENOMINATOR * STRING_MAP_LOAD_NUMERATOR;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Probing kernels
+////////////////////////////////////////////////////////////////////////////////
+
+
+// Return a mask of the slots of the group at `control` whose control byte is `byte`.
+static inline uint32_t string_map_match_scalar(unsigned char const * control, unsigned char byte)
+{
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < STRING_MAP_GROUP; ++i)
+        mask |= (uint32_t)(control[i] == byte) << i;
+    return mask;
+}
+
+
+// Return a mask of the slots of the group at `control` that are empty or deleted.
+static inline uint32_t string_map_match_free_scalar(unsigned char const * control)
+{
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < STRING_MAP_GROUP; ++i)
+        mask |= (uint32_t)(control[i] >> 7) << i;
+    return mask;
+}
+
+
+#ifdef CPU_X86_KERNELS
+
+
+static inline __attribute__((target("sse2"), always_inline)) uint32_t
+string_map_match_sse2(unsigned char const * control, unsigned char byte)
+{
+    __m128i group = _mm_load_si128((__m128i const *)control);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+}
+
+
+// The sign bit of a control byte is set exactly when the slot is empty or deleted.
+static inline __attribute__((target("sse2"), always_inline)) uint32_t
+string_map_match_free_sse2(unsigned char const * control)
+{
+    return (uint32_t)_mm_movemask_epi8(_mm_load_si128((__m128i const *)control));
+}
+
+
+#endif
+
+
+/// @cond Doxygen_Suppress
+#define STRING_MAP_KERNELS(isa, attributes)                                                        \
+    /* Return the slot holding `key`, or SIZE_MAX if it isn't in the map. */                       \
+    static inline __attribute__((always_inline)) attributes size_t string_map_probe_##isa(         \
+        struct string_map const * map, struct string const * key, uint64_t hash)                   \
+    {                                                                                              \
+        size_t const group_mask = map->capacity / STRING_MAP_GROUP - 1;                            \
+        unsigned char const tag = string_map_tag(hash);                                            \
+        size_t group = string_map_first_group(map, hash);                                          \
+        for (size_t step = 1;; group = (group + step++) & group_mask)                              \
+        {                                                                                          \
+            unsigned char const * control = map->control + group * STRING_MAP_GROUP;               \
+            for (uint32_t mask = string_map_match_##isa(control, tag); mask != 0;                  \
+                 mask &= mask - 1)                                                                 \
+            {                                                                                      \
+                size_t slot = group * STRING_MAP_GROUP + (size_t)__builtin_ctz(mask);              \
+                if (string_map_key_is_equal(&map->entries[slot].key, key))                         \
+                    return slot;                                                                   \
+            }                                                                                      \
+            if (string_map_match_##isa(control, STRING_MAP_EMPTY) != 0)                            \
+                return SIZE_MAX;                                                                   \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static attributes size_t string_map_find_##isa(                                                \
+        struct string_map const * map, struct string const * key, uint64_t hash)                   \
+    {                                                                                              \
+        return string_map_probe_##isa(map, key, hash);                                             \
+    }                                                                                              \
+                                                                                                   \
+    /* Return the first empty or deleted slot in the probe sequence of `hash`. */                  \
+    static attributes size_t string_map_find_free_##isa(struct string_map const * map,             \
+                                                        uint64_t hash)                             \
+    {                                                                                              \
+        size_t const group_mask = map->capacity / STRING_MAP_GROUP - 1;                            \
+        size_t group = string_map_first_group(map, hash);                                          \
+        for (size_t step = 1;; group = (group + step++) & group_mask)                              \
+        {                                                                                          \
+            uint32_t mask = string_map_match_free_##isa(map->control + group * STRING_MAP_GROUP);  \
+            if (mask != 0)                                                                         \
+                return group * STRING_MAP_GROUP + (size_t)__builtin_ctz(mask);                     \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static attributes bool string_map_group_has_empty_##isa(unsigned char const * control)         \
+    {                                                                                              \
+        return string_map_match_##isa(control, STRING_MAP_EMPTY) != 0;                             \
+    }                                                                                              \
+                                                                                                   \
+    /* Hash and prefetch the first group of every key in a batch, then the */                      \
+    /* first candidate entry of every key, and only then probe for each key. */                    \
+    static attributes size_t string_map_find_batch_##isa(                                          \
+        struct string_map_entry ** output, struct string_map const * map,                          \
+        struct string const * keys, size_t count)                                                  \
+    {                                                                                              \
+        uint64_t hashes[STRING_MAP_BATCH];                                                         \
+        size_t found = 0;                                                                          \
+        for (size_t i = 0; i < count; i += STRING_MAP_BATCH)                                       \
+        {                                                                                          \
+            size_t const n = (count - i < STRING_MAP_BATCH) ? count - i : STRING_MAP_BATCH;        \
+            for (size_t j = 0; j < n; ++j)                                                         \
+            {                                                                                      \
+                hashes[j] = string_hash(keys + i + j, map->seed);                                  \
+                __builtin_prefetch(map->control +                                                  \
+                                   string_map_first_group(map, hashes[j]) * STRING_MAP_GROUP);     \
+            }                                                                                      \
+            for (size_t j = 0; j < n; ++j)                                                         \
+            {                                                                                      \
+                size_t group = string_map_first_group(map, hashes[j]);                             \
+                uint32_t mask = string_map_match_##isa(map->control + group * STRING_MAP_GROUP,    \
+                                                       string_map_tag(hashes[j]));                 \
+                if (mask != 0)                                                                     \
+                    __builtin_prefetch(map->entries + group * STRING_MAP_GROUP +                   \
+                                       __builtin_ctz(mask));                                       \
+            }                                                                                      \
+            for (size_t j = 0; j < n; ++j)                                                         \
+            {                                                                                      \
+                size_t slot = string_map_probe_##isa(map, keys + i + j, hashes[j]);                \
+                output[i + j] = (slot != SIZE_MAX) ? map->entries + slot : NULL;                   \
+                found += slot != SIZE_MAX;                                                         \
+            }                                                                                      \
+        }                                                                                          \
+        return found;                                                                              \
+    }
+//! @endcond
+
+
+STRING_MAP_KERNELS(scalar, )
+#ifdef CPU_X86_KERNELS
+STRING_MAP_KERNELS(sse2, __attribute__((target("sse2"))))
+#endif
+
+
+// The groups are 16 bytes, so wider vectors don't help and every x86
+// instruction set uses the SSE2 kernels.
+static size_t string_map_find_slot(struct string_map const * map, struct string const * key,
+                                   uint64_t hash)
+{
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+        case CPU_ISA_AVX2:
+        case CPU_ISA_SSE2:
+            return string_map_find_sse2(map, key, hash);
+#endif
+        default:
+            return string_map_find_scalar(map, key, hash);
+    }
+}
+
+
+static size_t string_map_find_free(struct string_map const * map, uint64_t hash)
+{
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+        case CPU_ISA_AVX2:
+        case CPU_ISA_SSE2:
+            return string_map_find_free_sse2(map, hash);
+#endif
+        default:
+            return string_map_find_free_scalar(map, hash);
+    }
+}
+
+
+static bool string_map_group_has_empty(unsigned char const * control)
+{
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+        case CPU_ISA_AVX2:
+        case CPU_ISA_SSE2:
+            return string_map_group_has_empty_sse2(control);
+#endif
+        default:
+            return string_map_group_has_empty_scalar(control);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Construction, destruction and rehashing
+////////////////////////////////////////////////////////////////////////////////
+
+
+void string_map_init(struct string_map * map)
+{
+    assert(map);
+
+    map->control = NULL;
+    map->entries = NULL;
+    map->capacity = 0;
+    map->size = 0;
+    map->growth_left = 0;
+
+    // Seed the hash from the map's address and the time so that the layout
+    // of the map can't easily be predicted.
+    map->seed = (uint64_t)(uintptr_t)map ^ ((uint64_t)time(NULL) << 32);
+}
+
+
+void string_map_free(struct string_map * map)
+{
+    assert(map);
+
+    free(map->control);
+    map->control = NULL;
+    map->entries = NULL;
+    map->capacity = 0;
+    map->size = 0;
+    map->growth_left = 0;
+}
+
+
+size_t string_map_size(struct string_map const * map)
+{
+    assert(map);
+    return map->size;
+}
+
+
+// Move every entry to a new array of `capacity` slots, dropping deleted slots.
+static bool string_map_rehash(struct string_map * map, size_t capacity)
+{
+    // The control bytes and entries share one allocation, with the control
+    // bytes first so that every group is aligned for vector loads.
+    if (capacity > SIZE_MAX / (1 + sizeof(struct string_map_entry)))
+        return false;
+    unsigned char * control =
+        aligned_alloc(STRING_MAP_GROUP, capacity * (1 + sizeof(struct string_map_entry)));
+    if (control == NULL)
+        return false;
+    memset(control, STRING_MAP_EMPTY, capacity);
+
+    struct string_map old = *map;
+    map->control = control;
+    map->entries = (struct string_map_entry *)(control + capacity);
+    map->capacity = capacity;
+    map->growth_left = string_map_max_load(capacity) - map->size;
+
+    for (size_t i = 0; i < old.capacity; ++i)
+    {
+        if (old.control[i] & 0x80)
+            continue;
+
+        uint64_t hash = string_hash(&old.entries[i].key, map->seed);
+        size_t slot = string_map_find_free(map, hash);
+        control[slot] = string_map_tag(hash);
+        map->entries[slot] = old.entries[i];
+    }
+
+    free(old.control);
+    return true;
+}
+
+
+bool string_map_reserve(struct string_map * map, size_t count)
+{
+    assert(map);
+
+    if (count <= map->size + map->growth_left)
+        return true;
+
+    size_t capacity = STRING_MAP_GROUP;
+    while (string_map_max_load(capacity) < count)
+    {
+        if (capacity > SIZE_MAX / 2)
+            return false;
+        capacity *= 2;
+    }
+    return string_map_rehash(map, capacity);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Insertion, lookup and erasure
+////////////////////////////////////////////////////////////////////////////////
+
+
+bool string_map_insert(struct string_map * map, struct string const * key, void * value)
+{
+    assert(map);
+    assert(key);
+
+    uint64_t hash = string_hash(key, map->seed);
+    if (map->size > 0)
+    {
+        size_t slot = string_map_find_slot(map, key, hash);
+        if (slot != SIZE_MAX)
+        {
+            map->entries[slot].value = value;
+            return true;
+        }
+    }
+
+    size_t slot = (map->capacity > 0) ? string_map_find_free(map, hash) : 0;
+    if (map->capacity == 0 || (map->control[slot] == STRING_MAP_EMPTY && map->growth_left == 0))
+    {
+        // Grow if the map is more than half full, otherwise rehashing in
+        // place is enough to reclaim the deleted slots.
+        size_t capacity = (map->capacity == 0) ? STRING_MAP_GROUP : map->capacity;
+        if (map->size + 1 > string_map_max_load(capacity) / 2)
+        {
+            if (capacity > SIZE_MAX / 2)
+                return false;
+            capacity *= 2;
+        }
+        if (!string_map_rehash(map, capacity))
+            return false;
+        slot = string_map_find_free(map, hash);
+    }
+
+    map->growth_left -= map->control[slot] == STRING_MAP_EMPTY;
+    map->control[slot] = string_map_tag(hash);
+    map->entries[slot].key = *key;
+    map->entries[slot].value = value;
+    map->size += 1;
+    return true;
+}
+
+
+struct string_map_entry * string_map_find(struct string_map const * map,
+                                          struct string const * key)
+{
+    assert(map);
+    assert(key);
+
+    if (map->size == 0)
+        return NULL;
+
+    size_t slot = string_map_find_slot(map, key, string_hash(key, map->seed));
+    return (slot != SIZE_MAX) ? map->entries + slot : NULL;
+}
+
+
+size_t string_map_find_batch(struct string_map_entry ** output, struct string_map const * map,
+                             struct string const * keys, size_t count)
+{
+    assert(output);
+    assert(map);
+    assert(keys || count == 0);
+
+    if (map->size == 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+            output[i] = NULL;
+        return 0;
+    }
+
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+        case CPU_ISA_AVX2:
+        case CPU_ISA_SSE2:
+            return string_map_find_batch_sse2(output, map, keys, count);
+#endif
+        default:
+            return string_map_find_batch_scalar(output, map, keys, count);
+    }
+}
+
+
+bool string_map_erase(struct string_map * map, struct string const * key)
+{
+    assert(map);
+    assert(key);
+
+    if (map->size == 0)
+        return false;
+
+    size_t slot = string_map_find_slot(map, key, string_hash(key, map->seed));
+    if (slot == SIZE_MAX)
+        return false;
+
+    unsigned char const * group = map->control + slot / STRING_MAP_GROUP * STRING_MAP_GROUP;
+    if (string_map_group_has_empty(group))
+    {
+        map->control[slot] = STRING_MAP_EMPTY;
+        map->growth_left += 1;
+    }
+    else
+        map->control[slot] = STRING_MAP_DELETED;
+    map->size -= 1;
+    return true;
+}
+
+
+struct string_map_entry * string_map_next(struct string_map const * map, size_t * position)
+{
+    assert(map);
+    assert(position);
+
+    for (size_t i = *position; i < map->capacity; ++i)
+    {
+        if (map->control[i] & 0x80)
+            continue;
+        *position = i + 1;
+        return map->entries + i;
+    }
+    *position = map->capacity;
+    return NULL;
+}
@@ -0,0 +1,770 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/matcher.h"
+#include "util/string.h"
+
+
+// The states of the automaton are the nodes of a trie of the patterns,
+// numbered in breadth-first order. That puts the children of each state next
+// to each other, so a state only needs the number of its first child and how
+// many children it has, and every state stores the byte class of the edge
+// that leads to it. It also puts the shallow states first, and those are
+// given a dense row of transitions with the failure links already followed.
+//
+// Bytes are mapped to classes first: every byte that appears in a pattern
+// gets a class of its own and the remaining bytes share one class, which
+// keeps the dense rows short.
+#define MATCHER_NONE UINT32_MAX
+
+// Set in the transitions of the dense rows when a pattern ends in the next
+// state, so scanning doesn't have to look at the state to find out.
+#define MATCHER_OUTPUT ((uint32_t)1 << 31)
+
+// Scanning skips ahead over bytes that leave the root where it is if at
+// most this many bytes start a pattern. With more, runs of such bytes are too
+// short for skipping to pay for its mispredicted branches.
+#define MATCHER_SKIP_STARTS 4
+
+// States at most this deep get dense rows, as long as the rows fit in
+// MATCHER_MAX_DENSE entries.
+#define MATCHER_DENSE_DEPTH 3
+#define MATCHER_MAX_DENSE ((size_t)1 << 20)
+
+
+struct string_matcher_state
+{
+    uint32_t fail;        // The state for the longest proper suffix that is in the trie.
+    uint32_t first_child; // The first child; children are consecutive.
+    uint32_t child_count; // The number of children.
+    uint32_t depth;       // The length of the prefix this state represents.
+    uint32_t pattern;     // The pattern that ends here or MATCHER_NONE.
+    uint32_t output;      // The next state on the failure path that ends a pattern, or 0.
+};
+
+
+struct string_matcher
+{
+    unsigned char classes[256];            // The class of each byte.
+    bool skip;                             // Whether to skip bytes that don't start a pattern.
+    bool starts[256];                      // Whether each byte starts a pattern.
+    size_t start_count;                    // The number of bytes that start a pattern.
+    unsigned char start;                   // A byte that starts a pattern.
+    size_t class_count;                    // The number of byte classes.
+    size_t row_shift;                      // The log2 of the padded size of a dense row.
+    uint32_t state_count;                  // The number of states.
+    uint32_t dense_count;                  // The number of states with dense rows.
+    uint32_t * dense;                      // `dense_count` rows of transitions per class.
+    unsigned char * labels;                // The class of the edge into each state.
+    struct string_matcher_state * states;  // The states in breadth-first order.
+};
+
+
+// A trie node while the patterns are being added. Children form a linked
+// list sorted by class.
+struct matcher_node
+{
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint32_t pattern;
+    unsigned char label;
+};
+
+
+struct matcher_trie
+{
+    struct matcher_node * nodes;
+    uint32_t size;
+    uint32_t capacity;
+};
+
+
+// Return the child of `parent` labelled `label`, adding it if `create` is set.
+// Return MATCHER_NONE if there is no such child or allocation fails.
+static uint32_t matcher_trie_child(struct matcher_trie * trie, uint32_t parent, unsigned char label,
+                                   bool create)
+{
+    uint32_t * link = &trie->nodes[parent].first_child;
+    while (*link != MATCHER_NONE && trie->nodes[*link].label < label)
+        link = &trie->nodes[*link].next_sibling;
+    if (*link != MATCHER_NONE && trie->nodes[*link].label == label)
+        return *link;
+    if (!create)
+        return MATCHER_NONE;
+
+    if (trie->size == trie->capacity)
+    {
+        if (trie->capacity >= MATCHER_OUTPUT / 2)
+            return MATCHER_NONE;
+        // `link` may point into the nodes so remember it as an offset.
+        size_t offset = (size_t)((char *)link - (char *)trie->nodes);
+        struct matcher_node * grown =
+            realloc(trie->nodes, 2 * (size_t)trie->capacity * sizeof(struct matcher_node));
+        if (grown == NULL)
+            return MATCHER_NONE;
+        trie->nodes = grown;
+        trie->capacity *= 2;
+        link = (uint32_t *)((char *)trie->nodes + offset);
+    }
+
+    uint32_t child = trie->size++;
+    trie->nodes[child].first_child = MATCHER_NONE;
+    trie->nodes[child].next_sibling = *link;
+    trie->nodes[child].pattern = MATCHER_NONE;
+    trie->nodes[child].label = label;
+    *link = child;
+    return child;
+}
+
+
+// Return the child of `state` in class `c`, or MATCHER_NONE.
+static inline uint32_t string_matcher_child(struct string_matcher const * matcher, uint32_t state,
+                                            unsigned char c)
+{
+    struct string_matcher_state const * s = matcher->states + state;
+    for (uint32_t i = s->first_child; i < s->first_child + s->child_count; ++i)
+        if (matcher->labels[i] == c)
+            return i;
+    return MATCHER_NONE;
+}
+
+
+// Return `state` with MATCHER_OUTPUT set if a pattern ends in it.
+static inline uint32_t string_matcher_flag(struct string_matcher const * matcher, uint32_t state)
+{
+    struct string_matcher_state const * s = matcher->states + state;
+    return (s->pattern != MATCHER_NONE || s->output != 0) ? state | MATCHER_OUTPUT : state;
+}
+
+
+// Return the state after reading a byte of class `c` in `state`, with
+// MATCHER_OUTPUT set if a pattern ends in it.
+static inline uint32_t string_matcher_step(struct string_matcher const * matcher, uint32_t state,
+                                           unsigned char c)
+{
+    while (state >= matcher->dense_count)
+    {
+        uint32_t child = string_matcher_child(matcher, state, c);
+        if (child != MATCHER_NONE)
+            return string_matcher_flag(matcher, child);
+        state = matcher->states[state].fail;
+    }
+    return matcher->dense[((size_t)state << matcher->row_shift) + c];
+}
+
+
+// Return the offset of the first byte of `text` at or after `i` that could
+// start a pattern. Only used when `matcher->skip` is set.
+static inline size_t string_matcher_skip(struct string_matcher const * matcher,
+                                         struct string const * text, size_t i)
+{
+    if (matcher->start_count == 1)
+    {
+        char const * found = memchr(text->data + i, matcher->start, text->size - i);
+        return (found != NULL) ? (size_t)(found - text->data) : text->size;
+    }
+    while (i < text->size && !matcher->starts[(unsigned char)text->data[i]])
+        ++i;
+    return i;
+}
+
+
+// Lay out the trie in breadth-first order and compute the failure links, outputs and dense rows.
+static bool string_matcher_compile(struct string_matcher * matcher,
+                                   struct matcher_trie const * trie)
+{
+    uint32_t const count = trie->size;
+    matcher->state_count = count;
+    matcher->states = malloc(count * sizeof(struct string_matcher_state));
+    matcher->labels = malloc(count);
+    uint32_t * order = malloc(count * sizeof(uint32_t));
+    if (matcher->states == NULL || matcher->labels == NULL || order == NULL)
+    {
+        free(order);
+        return false;
+    }
+
+    // `order` maps states to trie nodes. Children are appended as their
+    // parent is visited, in order of class.
+    order[0] = 0;
+    matcher->labels[0] = 0;
+    uint32_t appended = 1;
+    for (uint32_t state = 0; state < count; ++state)
+    {
+        struct matcher_node const * node = trie->nodes + order[state];
+        struct string_matcher_state * s = matcher->states + state;
+        s->first_child = appended;
+        s->pattern = node->pattern;
+        for (uint32_t child = node->first_child; child != MATCHER_NONE;
+             child = trie->nodes[child].next_sibling)
+        {
+            matcher->labels[appended] = trie->nodes[child].label;
+            order[appended++] = child;
+        }
+        s->child_count = appended - s->first_child;
+    }
+    free(order);
+
+    // A state's failure link is shallower than it, so visiting the states in
+    // breadth-first order means the links it depends on are already known.
+    matcher->states[0].fail = 0;
+    matcher->states[0].depth = 0;
+    matcher->states[0].output = 0;
+    for (uint32_t state = 0; state < count; ++state)
+    {
+        struct string_matcher_state const * s = matcher->states + state;
+        for (uint32_t child = s->first_child; child < s->first_child + s->child_count; ++child)
+        {
+            struct string_matcher_state * c = matcher->states + child;
+            c->depth = s->depth + 1;
+            c->fail = 0;
+            if (state != 0)
+            {
+                unsigned char label = matcher->labels[child];
+                uint32_t fail = s->fail;
+                uint32_t next = string_matcher_child(matcher, fail, label);
+                while (next == MATCHER_NONE && fail != 0)
+                {
+                    fail = matcher->states[fail].fail;
+                    next = string_matcher_child(matcher, fail, label);
+                }
+                c->fail = (next != MATCHER_NONE) ? next : 0;
+            }
+            struct string_matcher_state const * f = matcher->states + c->fail;
+            c->output = (f->pattern != MATCHER_NONE) ? c->fail : f->output;
+        }
+    }
+
+    // The dense states are a prefix of the breadth-first order. Rows are
+    // padded to a power of two so indexing them is a shift.
+    while (((size_t)1 << matcher->row_shift) < matcher->class_count)
+        ++matcher->row_shift;
+    uint32_t dense_count = 0;
+    while (dense_count < count && matcher->states[dense_count].depth <= MATCHER_DENSE_DEPTH &&
+           ((size_t)dense_count + 1) << matcher->row_shift <= MATCHER_MAX_DENSE)
+        ++dense_count;
+
+    matcher->dense = malloc(((size_t)dense_count << matcher->row_shift) * sizeof(uint32_t));
+    if (matcher->dense == NULL)
+        return false;
+
+    // The failure link of a dense state is a dense state visited before it,
+    // so its row can be copied for the classes without a child.
+    for (uint32_t state = 0; state < dense_count; ++state)
+    {
+        uint32_t * row = matcher->dense + ((size_t)state << matcher->row_shift);
+        uint32_t const * fail_row =
+            matcher->dense + ((size_t)matcher->states[state].fail << matcher->row_shift);
+        for (size_t c = 0; c < matcher->class_count; ++c)
+        {
+            uint32_t child = string_matcher_child(matcher, state, (unsigned char)c);
+            if (child != MATCHER_NONE)
+                row[c] = string_matcher_flag(matcher, child);
+            else
+                row[c] = (state == 0) ? 0 : fail_row[c];
+        }
+    }
+    matcher->dense_count = dense_count;
+
+    for (size_t b = 0; b < 256; ++b)
+    {
+        matcher->starts[b] = matcher->dense[matcher->classes[b]] != 0;
+        if (matcher->starts[b])
+        {
+            matcher->start = (unsigned char)b;
+            ++matcher->start_count;
+        }
+    }
+    matcher->skip = matcher->start_count <= MATCHER_SKIP_STARTS;
+    return true;
+}
+
+
+struct string_matcher * string_matcher_make(struct string const * patterns, size_t count)
+{
+    assert(patterns || count == 0);
+
+    struct string_matcher * matcher = calloc(1, sizeof(struct string_matcher));
+    if (matcher == NULL)
+        return NULL;
+
+    // Give each byte used by a pattern a class of its own, in byte order, and
+    // put every other byte in one extra class.
+    bool used[256] = {false};
+    for (size_t i = 0; i < count; ++i)
+        for (size_t j = 0; j < patterns[i].size; ++j)
+            used[(unsigned char)patterns[i].data[j]] = true;
+    size_t used_count = 0;
+    for (size_t b = 0; b < 256; ++b)
+        if (used[b])
+            matcher->classes[b] = (unsigned char)used_count++;
+    for (size_t b = 0; b < 256; ++b)
+        if (!used[b])
+            matcher->classes[b] = (unsigned char)used_count;
+    matcher->class_count = used_count + (used_count < 256);
+
+    struct matcher_trie trie = {malloc(64 * sizeof(struct matcher_node)), 1, 64};
+    bool ok = trie.nodes != NULL && count < MATCHER_NONE;
+    if (ok)
+    {
+        trie.nodes[0].first_child = MATCHER_NONE;
+        trie.nodes[0].next_sibling = MATCHER_NONE;
+        trie.nodes[0].pattern = MATCHER_NONE;
+        trie.nodes[0].label = 0;
+    }
+
+    for (size_t i = 0; ok && i < count; ++i)
+    {
+        uint32_t node = 0;
+        for (size_t j = 0; ok && j < patterns[i].size; ++j)
+        {
+            unsigned char c = matcher->classes[(unsigned char)patterns[i].data[j]];
+            node = matcher_trie_child(&trie, node, c, true);
+            ok = node != MATCHER_NONE;
+        }
+        if (ok && node != 0 && trie.nodes[node].pattern == MATCHER_NONE)
+            trie.nodes[node].pattern = (uint32_t)i;
+    }
+
+    ok = ok && string_matcher_compile(matcher, &trie);
+    free(trie.nodes);
+    if (!ok)
+    {
+        string_matcher_free(matcher);
+        return NULL;
+    }
+    return matcher;
+}
+
+
+void string_matcher_free(struct string_matcher * matcher)
+{
+    if (matcher == NULL)
+        return;
+
+    free(matcher->dense);
+    free(matcher->labels);
+    free(matcher->states);
+    free(matcher);
+}
+
+
+size_t string_matcher_find_all(struct string_match ** output,
+                               struct string_matcher const * matcher,
+                               struct string const * text)
+{
+    assert(output);
+    assert(matcher);
+    assert(text);
+
+    *output = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    uint32_t state = 0;
+    for (size_t i = 0; i < text->size; ++i)
+    {
+        // Bytes that don't start a pattern leave the root where it is.
+        if (matcher->skip && state == 0)
+        {
+            i = string_matcher_skip(matcher, text, i);
+            if (i == text->size)
+                break;
+        }
+
+        state = string_matcher_step(matcher, state, matcher->classes[(unsigned char)text->data[i]]);
+        if ((state & MATCHER_OUTPUT) == 0)
+            continue;
+        state &= ~MATCHER_OUTPUT;
+
+        struct string_matcher_state const * s = matcher->states + state;
+        uint32_t match = (s->pattern != MATCHER_NONE) ? state : s->output;
+        for (; match != 0; match = matcher->states[match].output)
+        {
+            if (count == capacity)
+            {
+                capacity = (capacity > 0) ? 2 * capacity : 16;
+                struct string_match * grown = realloc(*output, capacity * sizeof(**output));
+                if (grown == NULL)
+                {
+                    free(*output);
+                    *output = NULL;
+                    return 0;
+                }
+                *output = grown;
+            }
+
+            struct string_matcher_state const * m = matcher->states + match;
+            (*output)[count].offset = i + 1 - m->depth;
+            (*output)[count].pattern = m->pattern;
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+
+// Choose the matches to replace in `text` and return the size of the result.
+// If `result` isn't NULL the result is also written to it.
+//
+// After reading byte `i` in a state of depth `d` every match that ends later
+// starts at or after `i + 1 - d`. So the leftmost (then longest) match seen
+// so far is pending until it starts before that, and then no later match can
+// be preferred over it. Matches passed over for the pending match may start
+// after it ends, so if there are any the bytes after it are scanned again.
+static size_t string_matcher_replace(char * result, struct string_matcher const * matcher,
+                                     struct string const * text,
+                                     struct string const * replacements)
+{
+    size_t size = 0;
+    size_t copied = 0;
+    size_t pending_start = SIZE_MAX;
+    size_t pending_size = 0;
+    size_t pending_pattern = 0;
+    size_t passed_over_end = 0; // One past the last start of a match passed over.
+    uint32_t state = 0;
+    for (size_t i = 0;; ++i)
+    {
+        // With nothing pending, bytes that don't start a pattern leave the root where it is.
+        if (matcher->skip && state == 0 && pending_start == SIZE_MAX && i < text->size)
+            i = string_matcher_skip(matcher, text, i);
+
+        size_t earliest = i;
+        bool ends = false;
+        if (i < text->size)
+        {
+            unsigned char c = matcher->classes[(unsigned char)text->data[i]];
+            state = string_matcher_step(matcher, state, c);
+            ends = (state & MATCHER_OUTPUT) != 0;
+            state &= ~MATCHER_OUTPUT;
+            if (pending_start != SIZE_MAX)
+                earliest = i + 1 - matcher->states[state].depth;
+        }
+
+        if (pending_start < earliest)
+        {
+            struct string const * replacement = replacements + pending_pattern;
+            if (result != NULL)
+            {
+                memcpy(result + size, text->data + copied, pending_start - copied);
+                if (replacement->size > 0)
+                    memcpy(result + size + pending_start - copied, replacement->data,
+                           replacement->size);
+            }
+            size += pending_start - copied + replacement->size;
+            copied = pending_start + pending_size;
+            pending_start = SIZE_MAX;
+
+            if (passed_over_end > copied)
+            {
+                // Continue from the root at `copied`, reading it on the next iteration.
+                i = copied - 1;
+                state = 0;
+                passed_over_end = 0;
+                continue;
+            }
+            passed_over_end = 0;
+        }
+        if (i == text->size)
+            break;
+        if (!ends)
+            continue;
+
+        // Matches are visited from longest to shortest, so from leftmost to rightmost.
+        struct string_matcher_state const * s = matcher->states + state;
+        uint32_t match = (s->pattern != MATCHER_NONE) ? state : s->output;
+        for (; match != 0; match = matcher->states[match].output)
+        {
+            struct string_matcher_state const * m = matcher->states + match;
+            size_t start = i + 1 - m->depth;
+            if (start < copied)
+                continue;
+
+            size_t passed_over = start;
+            if (start < pending_start || (start == pending_start && m->depth > pending_size))
+            {
+                passed_over = pending_start;
+                pending_start = start;
+                pending_size = m->depth;
+                pending_pattern = m->pattern;
+            }
+            if (passed_over != SIZE_MAX && passed_over + 1 > passed_over_end)
+                passed_over_end = passed_over + 1;
+        }
+    }
+
+    if (result != NULL && text->size > copied)
+        memcpy(result + size, text->data + copied, text->size - copied);
+    return size + text->size - copied;
+}
+
+
+bool string_matcher_replace_all(struct string * output, struct string_matcher const * matcher,
+                                struct string const * text,
+                                struct string const * replacements)
+{
+    assert(output);
+    assert(matcher);
+    assert(text);
+    assert(replacements || matcher->state_count == 1);
+
+    size_t size = string_matcher_replace(NULL, matcher, text, replacements);
+    string_make(output, size);
+    if (output->size != size)
+        return false;
+
+    string_matcher_replace(output->data, matcher, text, replacements);
+    return true;
+}
+
+
+// A prefix matcher is a compressed trie. Its nodes are numbered in
+// breadth-first order, like the states of a string_matcher, so the children
+// of each node are consecutive and a node's children end where the next
+// node's begin. A sentinel node after the last gives the last its end.
+//
+// It's built from the prefixes sorted, where the prefixes below a node are
+// a contiguous range and, because they're sorted, the bytes they all share
+// are the bytes the first and last of the range share.
+struct string_prefix_node
+{
+    uint32_t label;       // The offset in `bytes` of the edge into the node, after its first byte.
+    uint32_t label_size;  // The size of the rest of the edge.
+    uint32_t first_child; // The first child; children are consecutive.
+    uint32_t prefix;      // The prefix that ends here or MATCHER_NONE.
+};
+
+
+struct string_prefix_matcher
+{
+    char * bytes;                      // The prefixes, each followed by a spare byte.
+    unsigned char * first_bytes;       // The first byte of the edge into each node.
+    struct string_prefix_node * nodes; // The nodes in breadth-first order, then a sentinel.
+};
+
+
+// The range of sorted prefixes below a node while the trie is built.
+struct prefix_range
+{
+    uint32_t begin;
+    uint32_t end;
+    uint32_t depth; // The size of the string the node represents.
+};
+
+
+// Return the index of the prefix whose copy starts at `offset` of the bytes.
+static uint32_t prefix_index(uint32_t const * offsets, size_t count, size_t offset)
+{
+    size_t low = 0;
+    size_t high = count;
+    while (high - low > 1)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (offsets[middle] <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+    return (uint32_t)low;
+}
+
+
+// Build the nodes of `matcher` from `sorted`, the views of its copied prefixes
+// in order, each of which starts at `offsets[i]` of the bytes for prefix `i`.
+static void string_prefix_matcher_build(struct string_prefix_matcher * matcher,
+                                        struct string const * sorted, uint32_t const * offsets,
+                                        struct prefix_range * ranges, size_t count)
+{
+    uint32_t node_count = 1;
+    ranges[0] = (struct prefix_range){0, (uint32_t)count, 0};
+    matcher->first_bytes[0] = 0;
+    matcher->nodes[0].label = 0;
+    matcher->nodes[0].label_size = 0;
+
+    for (uint32_t node = 0; node < node_count; ++node)
+    {
+        struct prefix_range const range = ranges[node];
+        struct string_prefix_node * n = matcher->nodes + node;
+        n->first_child = node_count;
+        n->prefix = MATCHER_NONE;
+
+        // Equal prefixes are in their original order, so the first one that
+        // ends here is the one reported.
+        uint32_t i = range.begin;
+        if (i < range.end && sorted[i].size == range.depth)
+            n->prefix = prefix_index(offsets, count, (size_t)(sorted[i].data - matcher->bytes));
+        while (i < range.end && sorted[i].size == range.depth)
+            ++i;
+
+        // Make a child for each run of prefixes with the same next byte, with
+        // an edge labelled with all the bytes the run shares.
+        while (i < range.end)
+        {
+            unsigned char c = (unsigned char)sorted[i].data[range.depth];
+            uint32_t end = i + 1;
+            while (end < range.end && (unsigned char)sorted[end].data[range.depth] == c)
+                ++end;
+
+            struct string const * first = sorted + i;
+            struct string const * last = sorted + end - 1;
+            size_t limit = (first->size < last->size) ? first->size : last->size;
+            size_t depth = range.depth + 1;
+            while (depth < limit && first->data[depth] == last->data[depth])
+                ++depth;
+
+            uint32_t child = node_count++;
+            matcher->first_bytes[child] = c;
+            matcher->nodes[child].label =
+                (uint32_t)(first->data + range.depth + 1 - matcher->bytes);
+            matcher->nodes[child].label_size = (uint32_t)(depth - range.depth - 1);
+            ranges[child] = (struct prefix_range){i, end, (uint32_t)depth};
+            i = end;
+        }
+    }
+    matcher->nodes[node_count].first_child = node_count;
+}
+
+
+struct string_prefix_matcher * string_prefix_matcher_make(struct string const * prefixes,
+                                                          size_t count)
+{
+    assert(prefixes || count == 0);
+
+    // Every node but the root ends a prefix or has at least two children, so
+    // there are fewer than two nodes per prefix, plus the root and sentinel.
+    size_t size = 0;
+    for (size_t i = 0; i < count; ++i)
+        size += prefixes[i].size + 1;
+    if (size >= MATCHER_NONE || 2 * count + 2 >= MATCHER_NONE)
+        return NULL;
+    size_t const node_capacity = 2 * count + 2;
+
+    struct string_prefix_matcher * matcher = calloc(1, sizeof(struct string_prefix_matcher));
+    uint32_t * offsets = malloc((count + 1) * sizeof(uint32_t));
+    struct string * sorted = malloc((count + 1) * sizeof(struct string));
+    struct prefix_range * ranges = malloc(node_capacity * sizeof(struct prefix_range));
+    bool ok = matcher != NULL && offsets != NULL && sorted != NULL && ranges != NULL;
+    if (ok)
+    {
+        matcher->bytes = malloc(size + 1);
+        matcher->first_bytes = malloc(node_capacity);
+        matcher->nodes = malloc(node_capacity * sizeof(struct string_prefix_node));
+        ok = matcher->bytes != NULL && matcher->first_bytes != NULL && matcher->nodes != NULL;
+    }
+
+    if (ok)
+    {
+        // The spare byte after each copy gives even empty prefixes an offset of
+        // their own, which is how a sorted view is traced back to its prefix.
+        size_t offset = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            offsets[i] = (uint32_t)offset;
+            if (prefixes[i].size > 0)
+                memcpy(matcher->bytes + offset, prefixes[i].data, prefixes[i].size);
+            sorted[i] = (struct string){matcher->bytes + offset, prefixes[i].size};
+            offset += prefixes[i].size + 1;
+        }
+        ok = string_sort(sorted, count, true);
+    }
+    if (ok)
+        string_prefix_matcher_build(matcher, sorted, offsets, ranges, count);
+
+    free(ranges);
+    free(sorted);
+    free(offsets);
+    if (!ok)
+    {
+        string_prefix_matcher_free(matcher);
+        return NULL;
+    }
+    return matcher;
+}
+
+
+void string_prefix_matcher_free(struct string_prefix_matcher * matcher)
+{
+    if (matcher == NULL)
+        return;
+
+    free(matcher->nodes);
+    free(matcher->first_bytes);
+    free(matcher->bytes);
+    free(matcher);
+}
+
+
+// Return the child of `node` whose edge `text` continues with at offset `i`,
+// or MATCHER_NONE.
+static inline uint32_t string_prefix_matcher_step(struct string_prefix_matcher const * matcher,
+                                                  uint32_t node, struct string const * text,
+                                                  size_t i)
+{
+    uint32_t first = matcher->nodes[node].first_child;
+    uint32_t count = matcher->nodes[node + 1].first_child - first;
+    unsigned char const * child = memchr(matcher->first_bytes + first, text->data[i], count);
+    if (child == NULL)
+        return MATCHER_NONE;
+
+    uint32_t next = (uint32_t)(child - matcher->first_bytes);
+    struct string_prefix_node const * n = matcher->nodes + next;
+    if (n->label_size > text->size - i - 1 ||
+        memcmp(matcher->bytes + n->label, text->data + i + 1, n->label_size) != 0)
+        return MATCHER_NONE;
+    return next;
+}
+
+
+size_t string_prefix_matcher_longest(struct string_prefix_matcher const * matcher,
+                                     struct string const * text)
+{
+    assert(matcher);
+    assert(text);
+
+    uint32_t node = 0;
+    uint32_t longest = matcher->nodes[0].prefix;
+    for (size_t i = 0; i < text->size;)
+    {
+        node = string_prefix_matcher_step(matcher, node, text, i);
+        if (node == MATCHER_NONE)
+            break;
+        i += 1 + matcher->nodes[node].label_size;
+        if (matcher->nodes[node].prefix != MATCHER_NONE)
+            longest = matcher->nodes[node].prefix;
+    }
+    return (longest != MATCHER_NONE) ? longest : STRING_NPOS;
+}
+
+
+size_t string_prefix_matcher_all(size_t * output, size_t capacity,
+                                 struct string_prefix_matcher const * matcher,
+                                 struct string const * text)
+{
+    assert(output || capacity == 0);
+    assert(matcher);
+    assert(text);
+
+    size_t count = 0;
+    uint32_t node = 0;
+    for (size_t i = 0;;)
+    {
+        uint32_t prefix = matcher->nodes[node].prefix;
+        if (prefix != MATCHER_NONE)
+        {
+            if (count < capacity)
+                output[count] = prefix;
+            ++count;
+        }
+        if (i == text->size)
+            break;
+
+        node = string_prefix_matcher_step(matcher, node, text, i);
+        if (node == MATCHER_NONE)
+            break;
+        i += 1 + matcher->nodes[node].label_size;
+    }
+    return count;
+}
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "util/string.h"
 #include "util/util.h"
 
 
@@ -11,12 +12,15 @@ bool parse_bool(char const * string, bool * result)
     assert(string != NULL);
     assert(result != NULL);
 
-    char const * false_values[] = {"false", "0", "off"};
-    char const * true_values[] = {"true", "1", "on"};
+    struct string const false_values[] = {string_literal("false"), string_literal("0"),
+                                           string_literal("off")};
+    struct string const true_values[] = {string_literal("true"), string_literal("1"),
+                                          string_literal("on")};
+    struct string const value = {(char *)string, strlen(string)};
 
     for (size_t i = 0; i < ARRAY_SIZE(false_values); ++i)
     {
-        if (strcmp(string, false_values[i]) == 0)
+        if (string_is_equal_ignore_case(&value, false_values + i))
         {
             *result = false;
             return true;
@@ -25,7 +29,7 @@ bool parse_bool(char const * string, bool * result)
 
     for (size_t i = 0; i < ARRAY_SIZE(true_values); ++i)
     {
-        if (strcmp(string, true_values[i]) == 0)
+        if (string_is_equal_ignore_case(&value, true_values + i))
         {
             *result = true;
             return true;
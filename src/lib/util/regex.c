@@ -0,0 +1,1387 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/regex.h"
+#include "util/string.h"
+
+
+// A pattern is parsed into a tree of nodes, and the tree is compiled twice
+// into a program for a Thompson NFA: forwards, behind a lazy `.*?` loop so
+// a match can start anywhere, and backwards. Neither program is run
+// directly. Each is the source of a DFA whose states are the lists of
+// instructions, or threads, that are alive after reading some text.
+//
+// The forward DFA keeps the threads of a state in order of priority, the
+// order a backtracking matcher would try them in, and drops the threads
+// after the first that matches. The loop is the last thread, so once there's
+// a match no new ones are started, and the last match seen is where the
+// leftmost match ends. The backward DFA keeps every thread and runs back
+// from there to find where the match starts.
+//
+// A backtracking matcher stops repeating a node once a repetition matches
+// nothing, and goes on with what follows there and then, before the other
+// ways the repetition could have matched. The repetitions of nodes that can
+// match nothing are marked in the program so the DFA can do the same:
+// following the instructions that don't read a byte tracks the outermost
+// such repetition started since the last byte, and each instruction is
+// followed once for each of those it's reached with.
+#define REGEX_NONE UINT32_MAX
+#define REGEX_NO_MATCH SIZE_MAX
+
+// Limits that keep patterns from using too much memory, time or stack.
+// REGEX_MAX_LEVELS limits the instructions times the repetitions of nodes
+// that can match nothing they're nested in.
+#define REGEX_MAX_DEPTH 256
+#define REGEX_MAX_REPEAT 1000
+#define REGEX_MAX_PROGRAM ((uint32_t)1 << 16)
+#define REGEX_MAX_LEVELS ((size_t)1 << 18)
+
+// Searching skips to the next occurrence of up to this many bytes that
+// every match starts with.
+#define REGEX_MAX_PREFIX 32
+
+// The transitions of each DFA take about this many bytes at most. When they
+// or the other limits are reached the cache is cleared.
+#define REGEX_CACHE_SIZE ((size_t)1 << 20)
+#define REGEX_MIN_STATES 64
+#define REGEX_MAX_STATES ((uint32_t)1 << 14)
+
+// A transition is the offset of the row of the next state, so scanning
+// doesn't need to multiply. This is set in it when the next state hasn't been
+// built yet, is a match, has no threads or is where searching can skip ahead
+// or stop, so scanning only has to look at the state in those cases.
+#define REGEX_SPECIAL ((uint32_t)1 << 31)
+#define REGEX_UNKNOWN UINT32_MAX
+
+// The states that every cache starts with: the start state, and the start
+// state at the start of the text, where `^` matches.
+#define REGEX_START_STATE 0
+#define REGEX_BEGIN_STATE 1
+
+// Returned by regex_parse_escape() for escapes of a set of bytes.
+#define REGEX_ESCAPE_SET 256
+
+
+struct regex_set
+{
+    uint64_t bits[4]; // Bit `b % 64` of word `b / 64` is set if byte `b` is in the set.
+};
+
+
+enum regex_node_type
+{
+    REGEX_NODE_SET,
+    REGEX_NODE_CONCAT,
+    REGEX_NODE_ALTERNATE,
+    REGEX_NODE_REPEAT,
+    REGEX_NODE_BEGIN,
+    REGEX_NODE_END,
+};
+
+
+struct regex_node
+{
+    uint32_t type;     // A regex_node_type.
+    uint32_t set;      // The set of a REGEX_NODE_SET.
+    uint32_t first;    // The first child, or the node that's repeated.
+    uint32_t last;     // The last child.
+    uint32_t next;     // The next sibling.
+    uint32_t previous; // The previous sibling.
+    uint32_t min;      // The fewest repetitions.
+    uint32_t max;      // The most repetitions, or REGEX_NONE for no limit.
+    uint32_t size;     // The number of instructions the node compiles to.
+    bool greedy;       // Whether more repetitions are preferred to fewer.
+    bool empty;        // Whether the node can match the empty string.
+};
+
+
+struct regex_parser
+{
+    unsigned char const * data;
+    size_t size;
+    size_t position;
+    unsigned depth;
+    struct regex_node * nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    struct regex_set * sets;
+    uint32_t set_count;
+    uint32_t set_capacity;
+};
+
+
+enum regex_op
+{
+    REGEX_BYTE,   // Read a byte of set `x` and go on to the next instruction.
+    REGEX_SPLIT,  // Go on to `x` and, with lower priority, to `y`.
+    REGEX_JUMP,   // Go on to `x`.
+    REGEX_ENTER,  // Start a repetition at level `x` and go on to the next instruction.
+    REGEX_EMPTY,  // Go on to `y` if the repetition at level `x` is empty, or else on.
+    REGEX_BEGIN,  // Go on to the next instruction at the start of the text.
+    REGEX_END,    // Go on to the next instruction at the end of the text.
+    REGEX_MATCH,  // Match.
+};
+
+
+struct regex_instruction
+{
+    uint32_t op; // A regex_op.
+    uint32_t x;
+    uint32_t y;
+};
+
+
+struct regex_program
+{
+    struct regex_instruction * instructions;
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t depth; // The number of levels of REGEX_ENTER.
+};
+
+
+struct regex_state
+{
+    uint64_t hash;     // The hash of the threads and `at_begin`.
+    uint32_t first;    // The offset of the threads in `threads` of the DFA.
+    uint32_t count;    // The number of threads.
+    bool at_begin;     // Whether this is the state at the start of the text.
+    bool match;        // Whether a match ends in this state.
+    bool match_at_end; // Whether a match ends in this state at the end of the text.
+};
+
+
+struct regex_dfa
+{
+    struct regex_program const * program;
+    bool longest;              // Whether to keep the threads after a match.
+    bool skip;                 // Whether to skip ahead to the prefix from the start state.
+    bool anchored;             // Whether no match can begin after the start of the text.
+    size_t class_count;        // The number of byte classes.
+    uint32_t * transitions;    // The row of the next state for each class of each state.
+    struct regex_state * states;
+    uint32_t state_count;
+    uint32_t state_capacity;
+    uint32_t * threads;        // The threads of every state.
+    size_t thread_count;
+    size_t thread_capacity;
+    uint32_t * table;          // A hash table of the states, for finding them by their threads.
+    size_t table_mask;
+    uint32_t * starts;         // The threads of the two start states.
+    uint32_t start_counts[2];
+    uint32_t * list;           // The threads of the state being built.
+    uint32_t list_size;
+    uint32_t * seen;           // The list each instruction at each level was last added to.
+    uint32_t generation;       // The number of the list being built.
+    uint32_t * stack;          // The instructions at each level still to follow.
+    uint32_t flushes;          // The number of times the cache has been cleared.
+};
+
+
+struct string_regex
+{
+    unsigned char classes[256];         // The class of each byte.
+    unsigned char representatives[256]; // A byte of each class.
+    size_t class_count;                 // The number of byte classes.
+    struct regex_set * sets;            // The sets of the REGEX_BYTE instructions.
+    struct string prefix;               // The bytes every match starts with.
+    char prefix_data[REGEX_MAX_PREFIX];
+    struct regex_program programs[2];   // The forward and backward programs.
+    struct regex_dfa forward;
+    struct regex_dfa backward;
+};
+
+
+static bool regex_set_has(struct regex_set const * set, unsigned char byte)
+{
+    return (set->bits[byte / 64] >> (byte % 64)) & 1;
+}
+
+
+static void regex_set_add_range(struct regex_set * set, unsigned low, unsigned high)
+{
+    for (unsigned byte = low; byte <= high; ++byte)
+        set->bits[byte / 64] |= (uint64_t)1 << (byte % 64);
+}
+
+
+// Add the bytes of the escape `\c` to `set`, where `c` is one of `dDsSwW`.
+static void regex_set_add_escape(struct regex_set * set, unsigned char c)
+{
+    struct regex_set bytes = {{0}};
+    if (c == 'd' || c == 'D' || c == 'w' || c == 'W')
+        regex_set_add_range(&bytes, '0', '9');
+    if (c == 'w' || c == 'W')
+    {
+        regex_set_add_range(&bytes, 'A', 'Z');
+        regex_set_add_range(&bytes, 'a', 'z');
+        regex_set_add_range(&bytes, '_', '_');
+    }
+    if (c == 's' || c == 'S')
+    {
+        regex_set_add_range(&bytes, '\t', '\r');
+        regex_set_add_range(&bytes, ' ', ' ');
+    }
+
+    bool const negate = c < 'a';
+    for (size_t i = 0; i < 4; ++i)
+        set->bits[i] |= negate ? ~bytes.bits[i] : bytes.bits[i];
+}
+
+
+// Return the only byte in `set`, or -1 if it has more or none.
+static int regex_set_single(struct regex_set const * set)
+{
+    int single = -1;
+    for (unsigned byte = 0; byte < 256; ++byte)
+    {
+        if (!regex_set_has(set, (unsigned char)byte))
+            continue;
+        if (single >= 0)
+            return -1;
+        single = (int)byte;
+    }
+    return single;
+}
+
+
+static uint32_t regex_add_set(struct regex_parser * parser, struct regex_set const * set)
+{
+    if (parser->set_count == parser->set_capacity)
+    {
+        uint32_t const capacity = (parser->set_capacity == 0) ? 16 : 2 * parser->set_capacity;
+        struct regex_set * sets = realloc(parser->sets, capacity * sizeof(*sets));
+        if (sets == NULL)
+            return REGEX_NONE;
+        parser->sets = sets;
+        parser->set_capacity = capacity;
+    }
+    parser->sets[parser->set_count] = *set;
+    return parser->set_count++;
+}
+
+
+static uint32_t regex_add_node(struct regex_parser * parser, enum regex_node_type type)
+{
+    if (parser->node_count == parser->node_capacity)
+    {
+        uint32_t const capacity = (parser->node_capacity == 0) ? 16 : 2 * parser->node_capacity;
+        struct regex_node * nodes = realloc(parser->nodes, capacity * sizeof(*nodes));
+        if (nodes == NULL)
+            return REGEX_NONE;
+        parser->nodes = nodes;
+        parser->node_capacity = capacity;
+    }
+    uint32_t const size = (type == REGEX_NODE_CONCAT || type == REGEX_NODE_ALTERNATE) ? 0 : 1;
+    bool const empty = type != REGEX_NODE_SET && type != REGEX_NODE_ALTERNATE;
+    parser->nodes[parser->node_count] = (struct regex_node){
+        type, 0, REGEX_NONE, REGEX_NONE, REGEX_NONE, REGEX_NONE, 1, 1, size, true, empty};
+    return parser->node_count++;
+}
+
+
+static uint32_t regex_add_set_node(struct regex_parser * parser, struct regex_set const * set)
+{
+    uint32_t const index = regex_add_set(parser, set);
+    uint32_t const node =
+        (index == REGEX_NONE) ? REGEX_NONE : regex_add_node(parser, REGEX_NODE_SET);
+    if (node != REGEX_NONE)
+        parser->nodes[node].set = index;
+    return node;
+}
+
+
+// Add `child` to the end of the children of `parent`, and return false if
+// that makes `parent` compile to more than REGEX_MAX_PROGRAM instructions.
+// Each alternative but the first adds a split and a jump.
+static bool regex_add_child(struct regex_parser * parser, uint32_t parent, uint32_t child)
+{
+    struct regex_node * nodes = parser->nodes;
+    nodes[child].previous = nodes[parent].last;
+    if (nodes[parent].last == REGEX_NONE)
+        nodes[parent].first = child;
+    else
+    {
+        nodes[nodes[parent].last].next = child;
+        nodes[parent].size += (nodes[parent].type == REGEX_NODE_ALTERNATE) ? 2 : 0;
+    }
+    nodes[parent].last = child;
+    nodes[parent].size += nodes[child].size;
+    if (nodes[parent].type == REGEX_NODE_ALTERNATE)
+        nodes[parent].empty |= nodes[child].empty;
+    else
+        nodes[parent].empty &= nodes[child].empty;
+    return nodes[parent].size <= REGEX_MAX_PROGRAM;
+}
+
+
+// Return the number of instructions a repetition of a node of `size`
+// instructions compiles to, counting the node as at least one so that
+// repetitions of empty nodes are limited too, as compiling and searching
+// them still takes time for each copy. If the node can match nothing,
+// `empty`, each copy starts with a REGEX_ENTER and each but the required
+// ones with a REGEX_EMPTY.
+static uint64_t regex_repeat_size(uint32_t size, bool empty, uint32_t min, uint32_t max)
+{
+    uint64_t const copy = ((size == 0) ? 1 : size) + empty;
+    if (max == REGEX_NONE)
+        return min * copy + ((min > 0) ? 1 : copy + 2) + empty;
+    return min * copy + (max - min) * (copy + 1 + empty);
+}
+
+
+static bool regex_peek(struct regex_parser const * parser, char c)
+{
+    return parser->position < parser->size && parser->data[parser->position] == (unsigned char)c;
+}
+
+
+static int regex_hex_digit(unsigned char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        return (c | 0x20) - 'a' + 10;
+    return -1;
+}
+
+
+// Parse the escape after a backslash. Return the byte it stands for,
+// REGEX_ESCAPE_SET if it stands for a set of bytes, which are added to
+// `set`, or -1 if it isn't valid.
+static int regex_parse_escape(struct regex_parser * parser, struct regex_set * set)
+{
+    if (parser->position == parser->size)
+        return -1;
+
+    unsigned char const c = parser->data[parser->position++];
+    switch (c)
+    {
+        case 'n':
+            return '\n';
+        case 'r':
+            return '\r';
+        case 't':
+            return '\t';
+        case 'f':
+            return '\f';
+        case 'v':
+            return '\v';
+        case 'd':
+        case 'D':
+        case 's':
+        case 'S':
+        case 'w':
+        case 'W':
+            regex_set_add_escape(set, c);
+            return REGEX_ESCAPE_SET;
+        case 'x':
+        {
+            if (parser->size - parser->position < 2)
+                return -1;
+            int const high = regex_hex_digit(parser->data[parser->position]);
+            int const low = regex_hex_digit(parser->data[parser->position + 1]);
+            parser->position += 2;
+            return (high < 0 || low < 0) ? -1 : high * 16 + low;
+        }
+        default:
+            // Other letters and digits are kept for escapes that may be added later.
+            if ((c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z'))
+                return -1;
+            return c;
+    }
+}
+
+
+// Parse a set of bytes after its `[`.
+static uint32_t regex_parse_set(struct regex_parser * parser)
+{
+    struct regex_set set = {{0}};
+    bool const negate = regex_peek(parser, '^');
+    parser->position += negate;
+
+    // A `]` straight after the `[` is a member of the set.
+    for (bool first = true;; first = false)
+    {
+        if (parser->position == parser->size)
+            return REGEX_NONE;
+        unsigned char const c = parser->data[parser->position++];
+        if (c == ']' && !first)
+            break;
+
+        int low = c;
+        if (c == '\\')
+        {
+            low = regex_parse_escape(parser, &set);
+            if (low < 0)
+                return REGEX_NONE;
+            if (low == REGEX_ESCAPE_SET)
+                continue;
+        }
+
+        // A `-` at the end of the set is a member of it.
+        int high = low;
+        if (regex_peek(parser, '-') && parser->position + 1 < parser->size &&
+            parser->data[parser->position + 1] != ']')
+        {
+            ++parser->position;
+            high = parser->data[parser->position++];
+            if (high == '\\')
+            {
+                struct regex_set escaped = {{0}};
+                high = regex_parse_escape(parser, &escaped);
+            }
+            if (high < low || high == REGEX_ESCAPE_SET)
+                return REGEX_NONE;
+        }
+        regex_set_add_range(&set, (unsigned)low, (unsigned)high);
+    }
+
+    if (negate)
+        for (size_t i = 0; i < 4; ++i)
+            set.bits[i] = ~set.bits[i];
+    return regex_add_set_node(parser, &set);
+}
+
+
+static uint32_t regex_parse_alternate(struct regex_parser * parser);
+
+
+static uint32_t regex_parse_atom(struct regex_parser * parser)
+{
+    struct regex_set set = {{0}};
+    unsigned char const c = parser->data[parser->position++];
+    switch (c)
+    {
+        case '(':
+        {
+            if (parser->depth == REGEX_MAX_DEPTH)
+                return REGEX_NONE;
+            if (regex_peek(parser, '?') && parser->position + 1 < parser->size &&
+                parser->data[parser->position + 1] == ':')
+                parser->position += 2;
+            ++parser->depth;
+            uint32_t const node = regex_parse_alternate(parser);
+            --parser->depth;
+            if (node == REGEX_NONE || !regex_peek(parser, ')'))
+                return REGEX_NONE;
+            ++parser->position;
+            return node;
+        }
+        case '[':
+            return regex_parse_set(parser);
+        case '^':
+            return regex_add_node(parser, REGEX_NODE_BEGIN);
+        case '$':
+            return regex_add_node(parser, REGEX_NODE_END);
+        case '*':
+        case '+':
+        case '?':
+            // There's nothing to repeat.
+            return REGEX_NONE;
+        case '.':
+            regex_set_add_range(&set, 0, 255);
+            set.bits['\n' / 64] &= ~((uint64_t)1 << ('\n' % 64));
+            return regex_add_set_node(parser, &set);
+        case '\\':
+        {
+            int const byte = regex_parse_escape(parser, &set);
+            if (byte < 0)
+                return REGEX_NONE;
+            if (byte != REGEX_ESCAPE_SET)
+                regex_set_add_range(&set, (unsigned)byte, (unsigned)byte);
+            return regex_add_set_node(parser, &set);
+        }
+        default:
+            regex_set_add_range(&set, c, c);
+            return regex_add_set_node(parser, &set);
+    }
+}
+
+
+// Parse a count in braces, `{m}`, `{m,}` or `{m,n}`, at the current position.
+// Return 1 if there's one, 0 if there isn't, in which case the brace is a
+// literal byte, and -1 if the count is too large or out of order.
+static int regex_parse_count(struct regex_parser * parser, uint32_t * min, uint32_t * max)
+{
+    size_t position = parser->position + 1;
+    uint32_t numbers[2] = {0, 0};
+    size_t digits[2] = {0, 0};
+    bool comma = false;
+    for (; position < parser->size; ++position)
+    {
+        unsigned char const c = parser->data[position];
+        if (c >= '0' && c <= '9')
+        {
+            if (numbers[comma] <= REGEX_MAX_REPEAT)
+                numbers[comma] = numbers[comma] * 10 + (uint32_t)(c - '0');
+            ++digits[comma];
+        }
+        else if (c == ',' && !comma)
+            comma = true;
+        else
+            break;
+    }
+    if (position == parser->size || parser->data[position] != '}' || digits[0] == 0)
+        return 0;
+
+    parser->position = position + 1;
+    *min = numbers[0];
+    *max = !comma ? numbers[0] : (digits[1] == 0) ? REGEX_NONE : numbers[1];
+    if (*min > REGEX_MAX_REPEAT || (*max != REGEX_NONE && (*max > REGEX_MAX_REPEAT || *max < *min)))
+        return -1;
+    return 1;
+}
+
+
+// Parse an atom and the count that follows it, if any.
+static uint32_t regex_parse_repeat(struct regex_parser * parser)
+{
+    uint32_t const atom = regex_parse_atom(parser);
+    if (atom == REGEX_NONE || parser->position == parser->size)
+        return atom;
+
+    uint32_t min = 0;
+    uint32_t max = REGEX_NONE;
+    unsigned char const c = parser->data[parser->position];
+    if (c == '+')
+        min = 1;
+    else if (c == '?')
+        max = 1;
+    if (c == '*' || c == '+' || c == '?')
+        ++parser->position;
+    else if (c != '{')
+        return atom;
+    else
+    {
+        int const count = regex_parse_count(parser, &min, &max);
+        if (count <= 0)
+            return (count == 0) ? atom : REGEX_NONE;
+    }
+
+    // Anchors can't be repeated and neither can a count.
+    uint32_t const type = parser->nodes[atom].type;
+    if (type == REGEX_NODE_BEGIN || type == REGEX_NODE_END)
+        return REGEX_NONE;
+    bool const greedy = !regex_peek(parser, '?');
+    parser->position += !greedy;
+    if (regex_peek(parser, '*') || regex_peek(parser, '+') || regex_peek(parser, '?'))
+        return REGEX_NONE;
+    if (regex_peek(parser, '{') && regex_parse_count(parser, &min, &max) != 0)
+        return REGEX_NONE;
+
+    bool const empty = parser->nodes[atom].empty;
+    uint64_t const size = regex_repeat_size(parser->nodes[atom].size, empty, min, max);
+    uint32_t const repeat =
+        (size > REGEX_MAX_PROGRAM) ? REGEX_NONE : regex_add_node(parser, REGEX_NODE_REPEAT);
+    if (repeat != REGEX_NONE)
+    {
+        parser->nodes[repeat].size = (uint32_t)size;
+        parser->nodes[repeat].first = atom;
+        parser->nodes[repeat].min = min;
+        parser->nodes[repeat].max = max;
+        parser->nodes[repeat].greedy = greedy;
+        parser->nodes[repeat].empty = min == 0 || empty;
+    }
+    return repeat;
+}
+
+
+static uint32_t regex_parse_concat(struct regex_parser * parser)
+{
+    uint32_t const concat = regex_add_node(parser, REGEX_NODE_CONCAT);
+    if (concat == REGEX_NONE)
+        return REGEX_NONE;
+    while (parser->position < parser->size && !regex_peek(parser, '|') && !regex_peek(parser, ')'))
+    {
+        uint32_t const node = regex_parse_repeat(parser);
+        if (node == REGEX_NONE || !regex_add_child(parser, concat, node))
+            return REGEX_NONE;
+    }
+    return concat;
+}
+
+
+static uint32_t regex_parse_alternate(struct regex_parser * parser)
+{
+    uint32_t const first = regex_parse_concat(parser);
+    if (first == REGEX_NONE || !regex_peek(parser, '|'))
+        return first;
+
+    uint32_t const alternate = regex_add_node(parser, REGEX_NODE_ALTERNATE);
+    if (alternate == REGEX_NONE)
+        return REGEX_NONE;
+    regex_add_child(parser, alternate, first);
+    while (regex_peek(parser, '|'))
+    {
+        ++parser->position;
+        uint32_t const node = regex_parse_concat(parser);
+        if (node == REGEX_NONE || !regex_add_child(parser, alternate, node))
+            return REGEX_NONE;
+    }
+    return alternate;
+}
+
+
+// Append the bytes that every match of `node` starts with to `prefix`, and
+// return true if that's all `node` ever matches, so what follows it can be
+// appended too.
+static bool regex_find_prefix(struct regex_parser const * parser, uint32_t node, char * prefix,
+                              size_t * size)
+{
+    struct regex_node const * n = parser->nodes + node;
+    if (n->type == REGEX_NODE_BEGIN)
+        return true;
+    if (n->type == REGEX_NODE_SET)
+    {
+        int const byte = regex_set_single(parser->sets + n->set);
+        if (byte < 0 || *size == REGEX_MAX_PREFIX)
+            return false;
+        prefix[(*size)++] = (char)byte;
+        return true;
+    }
+    if (n->type == REGEX_NODE_CONCAT)
+    {
+        for (uint32_t child = n->first; child != REGEX_NONE; child = parser->nodes[child].next)
+            if (!regex_find_prefix(parser, child, prefix, size))
+                return false;
+        return true;
+    }
+    if (n->type == REGEX_NODE_REPEAT)
+    {
+        for (uint32_t i = 0; i < n->min; ++i)
+            if (!regex_find_prefix(parser, n->first, prefix, size))
+                return false;
+        return n->max == n->min;
+    }
+    if (n->type == REGEX_NODE_ALTERNATE)
+    {
+        // Keep what the prefixes of all the alternatives start with.
+        size_t common = REGEX_MAX_PREFIX;
+        for (uint32_t child = n->first; child != REGEX_NONE; child = parser->nodes[child].next)
+        {
+            char alternative[REGEX_MAX_PREFIX];
+            size_t alternative_size = 0;
+            regex_find_prefix(parser, child, alternative, &alternative_size);
+            size_t same = 0;
+            while (same < alternative_size && same < common && same + *size < REGEX_MAX_PREFIX &&
+                   (child == n->first || alternative[same] == prefix[*size + same]))
+                ++same;
+            if (child == n->first)
+                memcpy(prefix + *size, alternative, same);
+            common = same;
+        }
+        *size += common;
+    }
+    return false;
+}
+
+
+static uint32_t regex_emit(struct regex_program * program, enum regex_op op, uint32_t x, uint32_t y)
+{
+    if (program->size == program->capacity)
+    {
+        if (program->capacity == REGEX_MAX_PROGRAM)
+            return REGEX_NONE;
+        uint32_t const capacity = (program->capacity == 0) ? 64 : 2 * program->capacity;
+        struct regex_instruction * instructions =
+            realloc(program->instructions, capacity * sizeof(*instructions));
+        if (instructions == NULL)
+            return REGEX_NONE;
+        program->instructions = instructions;
+        program->capacity = capacity;
+    }
+    program->instructions[program->size] = (struct regex_instruction){op, x, y};
+    return program->size++;
+}
+
+
+// Point the split at `split` to `more` and `fewer` in order of preference.
+static void regex_set_split(struct regex_program * program, uint32_t split, uint32_t more,
+                            uint32_t fewer, bool greedy)
+{
+    program->instructions[split].x = greedy ? more : fewer;
+    program->instructions[split].y = greedy ? fewer : more;
+}
+
+
+static bool regex_compile(struct regex_program * program, struct regex_node const * nodes,
+                          uint32_t node, bool backward, uint32_t level);
+
+
+// Each alternative but the last is preferred to the rest and jumps to the
+// end when it's matched. The jumps are chained through their targets until
+// the end is known.
+static bool regex_compile_alternate(struct regex_program * program,
+                                    struct regex_node const * nodes, uint32_t node, bool backward,
+                                    uint32_t level)
+{
+    uint32_t jumps = REGEX_NONE;
+    for (uint32_t child = nodes[node].first; child != REGEX_NONE; child = nodes[child].next)
+    {
+        bool const last = nodes[child].next == REGEX_NONE;
+        uint32_t const split = last ? REGEX_NONE : regex_emit(program, REGEX_SPLIT, 0, 0);
+        if ((!last && split == REGEX_NONE) ||
+            !regex_compile(program, nodes, child, backward, level))
+            return false;
+        if (last)
+            break;
+
+        jumps = regex_emit(program, REGEX_JUMP, jumps, 0);
+        if (jumps == REGEX_NONE)
+            return false;
+        regex_set_split(program, split, split + 1, program->size, true);
+    }
+
+    while (jumps != REGEX_NONE)
+    {
+        uint32_t const next = program->instructions[jumps].x;
+        program->instructions[jumps].x = program->size;
+        jumps = next;
+    }
+    return true;
+}
+
+
+// Append a copy of the node repeated by `repeat`, starting a repetition at
+// `level` if it can match nothing.
+static bool regex_compile_copy(struct regex_program * program, struct regex_node const * nodes,
+                               uint32_t repeat, bool backward, uint32_t level)
+{
+    uint32_t const node = nodes[repeat].first;
+    if (!nodes[node].empty)
+        return regex_compile(program, nodes, node, backward, level);
+    return regex_emit(program, REGEX_ENTER, level, 0) != REGEX_NONE &&
+           regex_compile(program, nodes, node, backward, level + 1);
+}
+
+
+// Repetitions are copies of the node: the ones that are required, then
+// either a loop or the optional ones, each of which skips the rest if it's
+// skipped. The splits of the optional ones are chained like the jumps of
+// alternatives.
+//
+// If the node can match nothing, its repetitions are at a new level, and
+// after each that may be the last there's a REGEX_EMPTY that skips the rest
+// if it matched nothing. Those are chained through their ends.
+static bool regex_compile_repeat(struct regex_program * program, struct regex_node const * nodes,
+                                 uint32_t node, bool backward, uint32_t level)
+{
+    struct regex_node const * n = nodes + node;
+    bool const empty = nodes[n->first].empty;
+    program->depth = (level + empty > program->depth) ? level + empty : program->depth;
+
+    uint32_t start = program->size;
+    for (uint32_t i = 0; i < n->min; ++i)
+    {
+        start = program->size;
+        if (!regex_compile_copy(program, nodes, node, backward, level))
+            return false;
+    }
+
+    if (n->max == REGEX_NONE && n->min > 0)
+    {
+        // Loop back to the last copy.
+        if (empty && regex_emit(program, REGEX_EMPTY, level, program->size + 2) == REGEX_NONE)
+            return false;
+        uint32_t const split = regex_emit(program, REGEX_SPLIT, 0, 0);
+        if (split == REGEX_NONE)
+            return false;
+        regex_set_split(program, split, start, split + 1, n->greedy);
+        return true;
+    }
+    if (n->max == REGEX_NONE)
+    {
+        uint32_t const split = regex_emit(program, REGEX_SPLIT, 0, 0);
+        if (split == REGEX_NONE || !regex_compile_copy(program, nodes, node, backward, level) ||
+            (empty && regex_emit(program, REGEX_EMPTY, level, program->size + 2) == REGEX_NONE) ||
+            regex_emit(program, REGEX_JUMP, split, 0) == REGEX_NONE)
+            return false;
+        regex_set_split(program, split, split + 1, program->size, n->greedy);
+        return true;
+    }
+
+    uint32_t splits = REGEX_NONE;
+    uint32_t empties = REGEX_NONE;
+    for (uint32_t i = n->min; i < n->max; ++i)
+    {
+        if (empty && i > 0)
+        {
+            empties = regex_emit(program, REGEX_EMPTY, level, empties);
+            if (empties == REGEX_NONE)
+                return false;
+        }
+        splits = regex_emit(program, REGEX_SPLIT, splits, 0);
+        if (splits == REGEX_NONE || !regex_compile_copy(program, nodes, node, backward, level))
+            return false;
+    }
+    while (splits != REGEX_NONE)
+    {
+        uint32_t const next = program->instructions[splits].x;
+        regex_set_split(program, splits, splits + 1, program->size, n->greedy);
+        splits = next;
+    }
+    while (empties != REGEX_NONE)
+    {
+        uint32_t const next = program->instructions[empties].y;
+        program->instructions[empties].y = program->size;
+        empties = next;
+    }
+    return true;
+}
+
+
+// Append the instructions that match `node`, or match it backwards if
+// `backward`, inside `level` repetitions of nodes that can match nothing.
+static bool regex_compile(struct regex_program * program, struct regex_node const * nodes,
+                          uint32_t node, bool backward, uint32_t level)
+{
+    struct regex_node const * n = nodes + node;
+    if (n->type == REGEX_NODE_SET)
+        return regex_emit(program, REGEX_BYTE, n->set, 0) != REGEX_NONE;
+    if (n->type == REGEX_NODE_BEGIN || n->type == REGEX_NODE_END)
+    {
+        // Backwards, the start of the text is where matching ends.
+        bool const begin = (n->type == REGEX_NODE_BEGIN) != backward;
+        return regex_emit(program, begin ? REGEX_BEGIN : REGEX_END, 0, 0) != REGEX_NONE;
+    }
+    if (n->type == REGEX_NODE_ALTERNATE)
+        return regex_compile_alternate(program, nodes, node, backward, level);
+    if (n->type == REGEX_NODE_REPEAT)
+        return regex_compile_repeat(program, nodes, node, backward, level);
+
+    uint32_t child = backward ? n->last : n->first;
+    for (; child != REGEX_NONE; child = backward ? nodes[child].previous : nodes[child].next)
+        if (!regex_compile(program, nodes, child, backward, level))
+            return false;
+    return true;
+}
+
+
+// Give the bytes that are in the same sets the same class.
+static void regex_make_classes(struct string_regex * regex, struct regex_set const * sets,
+                               uint32_t set_count)
+{
+    size_t class = 0;
+    for (unsigned byte = 0; byte < 256; ++byte)
+    {
+        bool differs = false;
+        for (uint32_t i = 0; i < set_count && byte > 0 && !differs; ++i)
+            differs = regex_set_has(sets + i, (unsigned char)byte) !=
+                      regex_set_has(sets + i, (unsigned char)(byte - 1));
+        if (differs)
+            regex->representatives[++class] = (unsigned char)byte;
+        regex->classes[byte] = (unsigned char)class;
+    }
+    regex->representatives[0] = 0;
+    regex->class_count = class + 1;
+}
+
+
+// Start a new list of threads.
+static void regex_dfa_new_list(struct regex_dfa * dfa)
+{
+    dfa->list_size = 0;
+    if (++dfa->generation == 0)
+    {
+        size_t const keys = (size_t)dfa->program->size * (dfa->program->depth + 1);
+        memset(dfa->seen, 0, keys * sizeof(*dfa->seen));
+        dfa->generation = 1;
+    }
+}
+
+
+// Add the threads that can be reached from instruction `pc` without
+// reading a byte to the list, in order of priority.
+//
+// What follows an instruction depends on the outermost repetition at a
+// level that's started on the way there, so each instruction is followed
+// once for each, as `pc * (depth + 1) + level`, where `depth` means none.
+// What follows a thread doesn't, so each is added once.
+static void regex_dfa_follow(struct regex_dfa * dfa, uint32_t pc, bool at_begin)
+{
+    struct regex_instruction const * instructions = dfa->program->instructions;
+    uint32_t const levels = dfa->program->depth + 1;
+    uint32_t * stack = dfa->stack;
+    size_t top = 0;
+    stack[top++] = pc * levels + levels - 1;
+    while (top > 0)
+    {
+        uint32_t key = stack[--top];
+        pc = key / levels;
+        uint32_t level = key % levels;
+        struct regex_instruction const * instruction = instructions + pc;
+        if (instruction->op == REGEX_BYTE || instruction->op == REGEX_END ||
+            instruction->op == REGEX_MATCH)
+            key = pc * levels;
+        if (dfa->seen[key] == dfa->generation)
+            continue;
+        dfa->seen[key] = dfa->generation;
+
+        if (instruction->op == REGEX_SPLIT)
+        {
+            stack[top++] = instruction->y * levels + level;
+            stack[top++] = instruction->x * levels + level;
+        }
+        else if (instruction->op == REGEX_JUMP)
+            stack[top++] = instruction->x * levels + level;
+        else if (instruction->op == REGEX_ENTER)
+        {
+            level = (instruction->x < level) ? instruction->x : level;
+            stack[top++] = (pc + 1) * levels + level;
+        }
+        else if (instruction->op == REGEX_EMPTY)
+            stack[top++] = ((level <= instruction->x) ? instruction->y : pc + 1) * levels + level;
+        else if (instruction->op == REGEX_BEGIN)
+        {
+            if (at_begin)
+                stack[top++] = (pc + 1) * levels + level;
+        }
+        else
+            dfa->list[dfa->list_size++] = pc;
+    }
+}
+
+
+static int regex_compare_threads(void const * a, void const * b)
+{
+    uint32_t const x = *(uint32_t const *)a;
+    uint32_t const y = *(uint32_t const *)b;
+    return (x > y) - (x < y);
+}
+
+
+// Drop the threads after the first match, or if every thread is kept, sort
+// them so lists that only differ in order are the same state.
+static void regex_dfa_finish_list(struct regex_dfa * dfa)
+{
+    if (dfa->longest)
+    {
+        qsort(dfa->list, dfa->list_size, sizeof(*dfa->list), regex_compare_threads);
+        return;
+    }
+    for (uint32_t i = 0; i < dfa->list_size; ++i)
+        if (dfa->program->instructions[dfa->list[i]].op == REGEX_MATCH)
+            dfa->list_size = i + 1;
+}
+
+
+// Return true if one of `threads` matches once the end of the text is reached.
+static bool regex_dfa_match_at_end(struct regex_dfa * dfa, uint32_t const * threads,
+                                   uint32_t count, bool at_begin)
+{
+    struct regex_instruction const * instructions = dfa->program->instructions;
+    regex_dfa_new_list(dfa);
+    uint32_t * stack = dfa->stack;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        size_t top = 0;
+        stack[top++] = threads[i];
+        while (top > 0)
+        {
+            uint32_t const pc = stack[--top];
+            if (dfa->seen[pc] == dfa->generation)
+                continue;
+            dfa->seen[pc] = dfa->generation;
+
+            struct regex_instruction const * instruction = instructions + pc;
+            if (instruction->op == REGEX_MATCH)
+                return true;
+            if (instruction->op == REGEX_SPLIT)
+            {
+                stack[top++] = instruction->y;
+                stack[top++] = instruction->x;
+            }
+            else if (instruction->op == REGEX_JUMP)
+                stack[top++] = instruction->x;
+            else if (instruction->op == REGEX_EMPTY)
+            {
+                // Whether a match is possible doesn't depend on where
+                // repetitions stop.
+                stack[top++] = instruction->y;
+                stack[top++] = pc + 1;
+            }
+            else if (instruction->op == REGEX_END || instruction->op == REGEX_ENTER ||
+                     (instruction->op == REGEX_BEGIN && at_begin))
+                stack[top++] = pc + 1;
+        }
+    }
+    return false;
+}
+
+
+static void regex_dfa_clear(struct regex_dfa * dfa);
+
+
+// Return the state with `threads`, adding it if it's new.
+static uint32_t regex_dfa_add(struct regex_dfa * dfa, uint32_t const * threads, uint32_t count,
+                              bool at_begin)
+{
+    uint64_t hash = 14695981039346656037u ^ at_begin;
+    for (uint32_t i = 0; i < count; ++i)
+        hash = (hash ^ threads[i]) * 1099511628211u;
+    hash ^= hash >> 32;
+
+    size_t slot = hash & dfa->table_mask;
+    for (; dfa->table[slot] != REGEX_NONE; slot = (slot + 1) & dfa->table_mask)
+    {
+        struct regex_state const * state = dfa->states + dfa->table[slot];
+        if (state->hash == hash && state->count == count && state->at_begin == at_begin &&
+            memcmp(dfa->threads + state->first, threads, count * sizeof(*threads)) == 0)
+            return dfa->table[slot];
+    }
+
+    if (dfa->state_count == dfa->state_capacity || dfa->thread_capacity - dfa->thread_count < count)
+    {
+        regex_dfa_clear(dfa);
+        return regex_dfa_add(dfa, threads, count, at_begin);
+    }
+
+    uint32_t const index = dfa->state_count++;
+    struct regex_state * state = dfa->states + index;
+    state->hash = hash;
+    state->first = (uint32_t)dfa->thread_count;
+    state->count = count;
+    state->at_begin = at_begin;
+    state->match = false;
+    for (uint32_t i = 0; i < count; ++i)
+        state->match |= dfa->program->instructions[threads[i]].op == REGEX_MATCH;
+    state->match_at_end = state->match || regex_dfa_match_at_end(dfa, threads, count, at_begin);
+    memcpy(dfa->threads + dfa->thread_count, threads, count * sizeof(*threads));
+    dfa->thread_count += count;
+
+    dfa->table[slot] = index;
+    uint32_t * row = dfa->transitions + index * dfa->class_count;
+    for (size_t c = 0; c < dfa->class_count; ++c)
+        row[c] = REGEX_UNKNOWN;
+    return index;
+}
+
+
+// Throw away every state but the start states.
+static void regex_dfa_clear(struct regex_dfa * dfa)
+{
+    memset(dfa->table, 0xFF, (dfa->table_mask + 1) * sizeof(*dfa->table));
+    dfa->state_count = 0;
+    dfa->thread_count = 0;
+    ++dfa->flushes;
+    regex_dfa_add(dfa, dfa->starts, dfa->start_counts[0], false);
+    regex_dfa_add(dfa, dfa->starts + dfa->program->size, dfa->start_counts[1], true);
+}
+
+
+// Return the transition from `state` on a byte of class `c` and remember it.
+static uint32_t regex_dfa_next(struct regex_dfa * dfa, struct string_regex const * regex,
+                               uint32_t state, size_t c)
+{
+    struct regex_instruction const * instructions = dfa->program->instructions;
+    struct regex_state const * from = dfa->states + state;
+    unsigned char const byte = regex->representatives[c];
+    regex_dfa_new_list(dfa);
+    for (uint32_t i = 0; i < from->count; ++i)
+    {
+        uint32_t const pc = dfa->threads[from->first + i];
+        struct regex_instruction const * instruction = instructions + pc;
+        if (instruction->op == REGEX_BYTE && regex_set_has(regex->sets + instruction->x, byte))
+            regex_dfa_follow(dfa, pc + 1, false);
+    }
+    regex_dfa_finish_list(dfa);
+
+    uint32_t const flushes = dfa->flushes;
+    uint32_t const index = regex_dfa_add(dfa, dfa->list, dfa->list_size, false);
+    struct regex_state const * to = dfa->states + index;
+    uint32_t next = index * (uint32_t)dfa->class_count;
+    if (to->match || to->count == 0 ||
+        (index == REGEX_START_STATE && (dfa->skip || dfa->anchored)))
+        next |= REGEX_SPECIAL;
+
+    // The state is gone if the cache was cleared to make room.
+    if (dfa->flushes == flushes)
+        dfa->transitions[state * dfa->class_count + c] = next;
+    return next;
+}
+
+
+static bool regex_dfa_init(struct regex_dfa * dfa, struct regex_program const * program,
+                           size_t class_count, bool longest, bool skip)
+{
+    size_t const size = program->size;
+    size_t states = REGEX_CACHE_SIZE / (class_count * sizeof(*dfa->transitions));
+    states = (states < REGEX_MIN_STATES) ? REGEX_MIN_STATES : states;
+    states = (states > REGEX_MAX_STATES) ? REGEX_MAX_STATES : states;
+    size_t table_size = 1;
+    while (table_size < 2 * states)
+        table_size *= 2;
+
+    dfa->program = program;
+    dfa->longest = longest;
+    dfa->skip = skip;
+    dfa->class_count = class_count;
+    dfa->state_capacity = (uint32_t)states;
+    // There's always room for the start states and one more after clearing.
+    dfa->thread_capacity = 16 * states + 3 * size;
+    dfa->table_mask = table_size - 1;
+    dfa->transitions = malloc(states * class_count * sizeof(*dfa->transitions));
+    dfa->states = malloc(states * sizeof(*dfa->states));
+    dfa->threads = malloc(dfa->thread_capacity * sizeof(*dfa->threads));
+    dfa->table = malloc(table_size * sizeof(*dfa->table));
+    dfa->starts = malloc(2 * size * sizeof(*dfa->starts));
+    size_t const keys = size * (program->depth + 1);
+    dfa->list = malloc(size * sizeof(*dfa->list));
+    dfa->seen = calloc(keys, sizeof(*dfa->seen));
+    dfa->stack = malloc((2 * keys + 1) * sizeof(*dfa->stack));
+    if (dfa->transitions == NULL || dfa->states == NULL || dfa->threads == NULL ||
+        dfa->table == NULL || dfa->starts == NULL || dfa->list == NULL || dfa->seen == NULL ||
+        dfa->stack == NULL)
+        return false;
+
+    for (size_t at_begin = 0; at_begin < 2; ++at_begin)
+    {
+        regex_dfa_new_list(dfa);
+        regex_dfa_follow(dfa, 0, at_begin);
+        regex_dfa_finish_list(dfa);
+        memcpy(dfa->starts + at_begin * size, dfa->list, dfa->list_size * sizeof(*dfa->list));
+        dfa->start_counts[at_begin] = dfa->list_size;
+    }
+
+    // If the loop in front of the forward program is all that's alive in the
+    // start state, every match begins at the start of the text.
+    dfa->anchored = !longest && dfa->start_counts[0] == 1;
+    regex_dfa_clear(dfa);
+    return true;
+}
+
+
+static void regex_dfa_free(struct regex_dfa * dfa)
+{
+    free(dfa->transitions);
+    free(dfa->states);
+    free(dfa->threads);
+    free(dfa->table);
+    free(dfa->starts);
+    free(dfa->list);
+    free(dfa->seen);
+    free(dfa->stack);
+}
+
+
+// Return the offset of the next occurrence of the prefix from `offset`, or
+// the size of `text` if there isn't one.
+static size_t regex_skip(struct string_regex const * regex, struct string const * text,
+                         size_t offset)
+{
+    struct string const rest = {text->data + offset, text->size - offset};
+    size_t found = STRING_NPOS;
+    if (regex->prefix.size == 1)
+    {
+        char const * byte = memchr(rest.data, regex->prefix.data[0], rest.size);
+        if (byte != NULL)
+            found = (size_t)(byte - rest.data);
+    }
+    else
+        found = string_find(&rest, &regex->prefix);
+    return (found == STRING_NPOS) ? text->size : offset + found;
+}
+
+
+// Return where the leftmost match in `text` ends, or REGEX_NO_MATCH if
+// there isn't one. If `earliest`, return where the first match found ends.
+static size_t regex_scan_forward(struct string_regex * regex, struct string const * text,
+                                 bool earliest)
+{
+    struct regex_dfa * dfa = &regex->forward;
+    uint32_t const * transitions = dfa->transitions;
+    unsigned char const * data = (unsigned char const *)text->data;
+    size_t const size = text->size;
+    size_t const class_count = dfa->class_count;
+
+    size_t end = REGEX_NO_MATCH;
+    uint32_t state = REGEX_BEGIN_STATE;
+    size_t i = 0;
+    for (;;)
+    {
+        struct regex_state const * current = dfa->states + state;
+        if (current->match)
+        {
+            end = i;
+            if (earliest)
+                return end;
+        }
+        if (current->count == 0)
+            return end;
+
+        // Only the loop is alive in the start state, so the next match can
+        // only start where the prefix does, or nowhere if it's anchored.
+        if (state == REGEX_START_STATE && dfa->anchored)
+            return end;
+        if (state == REGEX_START_STATE && dfa->skip)
+        {
+            i = regex_skip(regex, text, i);
+            if (i == size)
+                return end;
+        }
+
+        // Most bytes lead to an ordinary state that's already been built.
+        uint32_t row = state * (uint32_t)class_count;
+        uint32_t next = REGEX_UNKNOWN;
+        for (; i < size; ++i)
+        {
+            next = transitions[row + regex->classes[data[i]]];
+            if (next & REGEX_SPECIAL)
+                break;
+            row = next;
+        }
+        state = row / (uint32_t)class_count;
+        if (i == size)
+            break;
+
+        if (next == REGEX_UNKNOWN)
+            next = regex_dfa_next(dfa, regex, state, regex->classes[data[i]]);
+        state = (next & ~REGEX_SPECIAL) / (uint32_t)class_count;
+        ++i;
+    }
+
+    if (dfa->states[state].match_at_end)
+        end = size;
+    return end;
+}
+
+
+// Return where the match that ends at `end` starts: the smallest offset from
+// which the backward program matches up to `end`.
+static size_t regex_scan_backward(struct string_regex * regex, struct string const * text,
+                                  size_t end)
+{
+    struct regex_dfa * dfa = &regex->backward;
+    uint32_t const * transitions = dfa->transitions;
+    unsigned char const * data = (unsigned char const *)text->data;
+    size_t const class_count = dfa->class_count;
+
+    size_t start = REGEX_NO_MATCH;
+    uint32_t state = (end == text->size) ? REGEX_BEGIN_STATE : REGEX_START_STATE;
+    size_t i = end;
+    for (;;)
+    {
+        struct regex_state const * current = dfa->states + state;
+        if (current->match)
+            start = i;
+        if (current->count == 0)
+            return start;
+
+        uint32_t row = state * (uint32_t)class_count;
+        uint32_t next = REGEX_UNKNOWN;
+        for (; i > 0; --i)
+        {
+            next = transitions[row + regex->classes[data[i - 1]]];
+            if (next & REGEX_SPECIAL)
+                break;
+            row = next;
+        }
+        state = row / (uint32_t)class_count;
+        if (i == 0)
+            break;
+
+        if (next == REGEX_UNKNOWN)
+            next = regex_dfa_next(dfa, regex, state, regex->classes[data[i - 1]]);
+        state = (next & ~REGEX_SPECIAL) / (uint32_t)class_count;
+        --i;
+    }
+
+    if (dfa->states[state].match_at_end)
+        start = 0;
+    return start;
+}
+
+
+struct string_regex * string_regex_make(struct string const * pattern)
+{
+    assert(pattern);
+
+    struct regex_parser parser = {
+        (unsigned char const *)pattern->data, pattern->size, 0, 0, NULL, 0, 0, NULL, 0, 0};
+    struct string_regex * regex = calloc(1, sizeof(*regex));
+    uint32_t const root = (regex == NULL) ? REGEX_NONE : regex_parse_alternate(&parser);
+    bool valid = root != REGEX_NONE && parser.position == parser.size;
+
+    // The forward program starts with a loop that reads a byte and starts
+    // again, which is tried after the rest of the program.
+    struct regex_set any;
+    memset(&any, 0xFF, sizeof(any));
+    uint32_t const any_set = valid ? regex_add_set(&parser, &any) : REGEX_NONE;
+    struct regex_program * forward = valid ? regex->programs : NULL;
+    struct regex_program * backward = valid ? regex->programs + 1 : NULL;
+    valid = any_set != REGEX_NONE && regex_emit(forward, REGEX_SPLIT, 3, 1) != REGEX_NONE &&
+            regex_emit(forward, REGEX_BYTE, any_set, 0) != REGEX_NONE &&
+            regex_emit(forward, REGEX_JUMP, 0, 0) != REGEX_NONE &&
+            regex_compile(forward, parser.nodes, root, false, 0) &&
+            regex_emit(forward, REGEX_MATCH, 0, 0) != REGEX_NONE &&
+            regex_compile(backward, parser.nodes, root, true, 0) &&
+            regex_emit(backward, REGEX_MATCH, 0, 0) != REGEX_NONE &&
+            (size_t)forward->size * (forward->depth + 1) <= REGEX_MAX_LEVELS;
+
+    if (valid)
+    {
+        size_t prefix_size = 0;
+        regex_find_prefix(&parser, root, regex->prefix_data, &prefix_size);
+        regex->prefix = (struct string){regex->prefix_data, prefix_size};
+        regex->sets = parser.sets;
+        parser.sets = NULL;
+        regex_make_classes(regex, regex->sets, parser.set_count);
+        valid = regex_dfa_init(&regex->forward, forward, regex->class_count, false,
+                               prefix_size > 0) &&
+                regex_dfa_init(&regex->backward, backward, regex->class_count, true, false);
+    }
+
+    free(parser.nodes);
+    free(parser.sets);
+    if (!valid)
+    {
+        string_regex_free(regex);
+        return NULL;
+    }
+    return regex;
+}
+
+
+void string_regex_free(struct string_regex * regex)
+{
+    if (regex == NULL)
+        return;
+
+    regex_dfa_free(&regex->forward);
+    regex_dfa_free(&regex->backward);
+    free(regex->programs[0].instructions);
+    free(regex->programs[1].instructions);
+    free(regex->sets);
+    free(regex);
+}
+
+
+bool string_regex_is_match(struct string_regex * regex, struct string const * text)
+{
+    assert(regex);
+    assert(text);
+
+    return regex_scan_forward(regex, text, true) != REGEX_NO_MATCH;
+}
+
+
+bool string_regex_find(struct string * match, struct string_regex * regex,
+                       struct string const * text)
+{
+    assert(match);
+    assert(regex);
+    assert(text);
+
+    size_t const end = regex_scan_forward(regex, text, false);
+    if (end == REGEX_NO_MATCH)
+        return false;
+
+    size_t const start = regex_scan_backward(regex, text, end);
+    assert(start <= end);
+    *match = (struct string){text->data + start, end - start};
+    return true;
+}
@@ -0,0 +1,596 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/rope.h"
+#include "util/string.h"
+
+
+// Every node of the tree holds a piece of the string of at most
+// ROPE_LEAF_SIZE bytes, and the string is the in-order concatenation of the
+// pieces. Each node also stores the number of bytes in its subtree, which is
+// how positions are found, and a random priority that is at least that of
+// its children, which keeps the tree balanced with high probability.
+//
+// Insertions into a piece that stays within ROPE_LEAF_SIZE are made in
+// place, growing its buffer if need be. Other insertions split the tree at
+// the position, which splits at most one piece, and merge the new pieces in
+// between.
+//
+// Buffers are allocated to fit their pieces, and after each insertion that
+// splits a piece and each erasure the pieces around the edit are merged
+// wherever two neighbours fit in one, so no two neighbouring pieces do. That
+// keeps the pieces more than half of ROPE_LEAF_SIZE on average and the rope
+// little larger than the string, however it's edited.
+#define ROPE_LEAF_SIZE 4096
+
+
+struct rope_node
+{
+    struct rope_node * left;
+    struct rope_node * right;
+    size_t size;           // The number of bytes in this subtree.
+    uint32_t length;       // The number of bytes in `data`.
+    uint32_t capacity;     // The number of bytes `data` can hold.
+    uint32_t priority;     // At least the priority of each child.
+    char data[];
+};
+
+
+static inline size_t rope_node_size(struct rope_node const * node)
+{
+    return (node != NULL) ? node->size : 0;
+}
+
+
+static inline void rope_node_update(struct rope_node * node)
+{
+    node->size = rope_node_size(node->left) + node->length + rope_node_size(node->right);
+}
+
+
+// Return the next priority from an xorshift generator.
+static uint32_t rope_priority(struct rope * rope)
+{
+    rope->seed ^= rope->seed << 13;
+    rope->seed ^= rope->seed >> 7;
+    rope->seed ^= rope->seed << 17;
+    return (uint32_t)(rope->seed >> 32);
+}
+
+
+static struct rope_node * rope_node_make(struct rope * rope, size_t capacity)
+{
+    assert(capacity <= ROPE_LEAF_SIZE);
+
+    struct rope_node * node = malloc(sizeof(struct rope_node) + capacity);
+    if (node == NULL)
+        return NULL;
+
+    node->left = NULL;
+    node->right = NULL;
+    node->size = 0;
+    node->length = 0;
+    node->capacity = (uint32_t)capacity;
+    node->priority = rope_priority(rope);
+    return node;
+}
+
+
+// Make the buffer of the node at `*link` hold at least `length` bytes,
+// growing it by half again at a time so that appending a byte at a time is
+// amortized. Return false, without changing anything, if allocation fails.
+static bool rope_node_reserve(struct rope_node ** link, size_t length)
+{
+    assert(length <= ROPE_LEAF_SIZE);
+
+    struct rope_node * node = *link;
+    if (length <= node->capacity)
+        return true;
+
+    size_t capacity = node->capacity + node->capacity / 2;
+    if (capacity < length)
+        capacity = length;
+    if (capacity > ROPE_LEAF_SIZE)
+        capacity = ROPE_LEAF_SIZE;
+    node = realloc(node, sizeof(struct rope_node) + capacity);
+    if (node == NULL)
+        return false;
+
+    node->capacity = (uint32_t)capacity;
+    *link = node;
+    return true;
+}
+
+
+static void rope_node_free(struct rope_node * node)
+{
+    // Loop down the right spine so that only the left children recurse.
+    while (node != NULL)
+    {
+        rope_node_free(node->left);
+        struct rope_node * right = node->right;
+        free(node);
+        node = right;
+    }
+}
+
+
+// Concatenate the trees `left` and `right`.
+static struct rope_node * rope_node_merge(struct rope_node * left, struct rope_node * right)
+{
+    if (left == NULL)
+        return right;
+    if (right == NULL)
+        return left;
+
+    if (left->priority >= right->priority)
+    {
+        left->right = rope_node_merge(left->right, right);
+        rope_node_update(left);
+        return left;
+    }
+    right->left = rope_node_merge(left, right->left);
+    rope_node_update(right);
+    return right;
+}
+
+
+// Split `node` into the trees `left`, with the first `position` bytes, and
+// `right`, with the rest. If the split falls inside a piece, the end of the
+// piece is moved into `*spare`, which must have room for it and is then set
+// to NULL.
+static void rope_node_split(struct rope_node * node, size_t position, struct rope_node ** left,
+                            struct rope_node ** right, struct rope_node ** spare)
+{
+    if (node == NULL)
+    {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+
+    size_t left_size = rope_node_size(node->left);
+    if (position <= left_size)
+    {
+        rope_node_split(node->left, position, left, &node->left, spare);
+        rope_node_update(node);
+        *right = node;
+    }
+    else if (position >= left_size + node->length)
+    {
+        rope_node_split(node->right, position - left_size - node->length, &node->right, right,
+                        spare);
+        rope_node_update(node);
+        *left = node;
+    }
+    else
+    {
+        // The spare node takes the node's priority so both halves stay valid treaps.
+        size_t offset = position - left_size;
+        struct rope_node * end = *spare;
+        assert(end != NULL && end->capacity >= node->length - offset);
+        *spare = NULL;
+        end->length = (uint32_t)(node->length - offset);
+        memcpy(end->data, node->data + offset, end->length);
+        end->priority = node->priority;
+        end->left = NULL;
+        end->right = node->right;
+        rope_node_update(end);
+
+        node->length = (uint32_t)offset;
+        node->right = NULL;
+        rope_node_update(node);
+        *left = node;
+        *right = end;
+    }
+}
+
+
+// Return the node of the piece that holds byte `position` of the subtree at
+// `node`, and store the offset of the piece in `*start`.
+static struct rope_node * rope_node_find(struct rope_node * node, size_t position, size_t * start)
+{
+    assert(position < rope_node_size(node));
+
+    *start = 0;
+    for (;;)
+    {
+        size_t left_size = rope_node_size(node->left);
+        if (position < left_size)
+            node = node->left;
+        else if (position < left_size + node->length)
+        {
+            *start += left_size;
+            return node;
+        }
+        else
+        {
+            position -= left_size + node->length;
+            *start += left_size + node->length;
+            node = node->right;
+        }
+    }
+}
+
+
+// Unlink the nodes of the subtree at `node` and chain them in order through
+// their right children, followed by `tail`. Return the first.
+static struct rope_node * rope_node_list(struct rope_node * node, struct rope_node * tail)
+{
+    while (node != NULL)
+    {
+        struct rope_node * left = node->left;
+        node->left = NULL;
+        node->right = rope_node_list(node->right, tail);
+        tail = node;
+        node = left;
+    }
+    return tail;
+}
+
+
+// Return whether the buffer of `node` has so much room to spare that it's
+// worth shrinking.
+static inline bool rope_node_slack(struct rope_node const * node)
+{
+    return node->capacity - node->length > node->capacity / 4;
+}
+
+
+// Merge the neighbouring pieces that fit in one from the piece before the one
+// that holds byte `from - 1` to the piece after the one that holds byte `to`,
+// which covers every piece that an edit of `[from, to)` could have shrunk or
+// added together with their neighbours. Buffers with a lot of room to spare
+// are shrunk to fit. Nothing is merged if allocation fails, so this can't fail.
+static void rope_coalesce(struct rope * rope, size_t from, size_t to)
+{
+    size_t const size = rope_size(rope);
+    size_t begin = 0;
+    if (from > 0)
+        rope_node_find(rope->root, from - 1, &begin);
+    if (begin > 0)
+        rope_node_find(rope->root, begin - 1, &begin);
+    size_t end = to;
+    for (int i = 0; i < 2 && end < size; ++i)
+    {
+        struct rope_node const * node = rope_node_find(rope->root, end, &end);
+        end += node->length;
+    }
+
+    // Most edits leave nothing to merge or shrink, so look before splitting.
+    bool changes = false;
+    size_t previous = ROPE_LEAF_SIZE + 1;
+    for (size_t offset = begin; offset < end && !changes; offset += previous)
+    {
+        struct rope_node const * node = rope_node_find(rope->root, offset, &offset);
+        changes = previous + node->length <= ROPE_LEAF_SIZE || rope_node_slack(node);
+        previous = node->length;
+    }
+    if (!changes)
+        return;
+
+    // The splits are at the edges of pieces, so they don't need a spare node.
+    struct rope_node * spare = NULL;
+    struct rope_node * left;
+    struct rope_node * middle;
+    struct rope_node * right;
+    rope_node_split(rope->root, begin, &left, &middle, &spare);
+    rope_node_split(middle, end - begin, &middle, &right, &spare);
+
+    // Merge each piece into the one before it while they fit.
+    struct rope_node * list = rope_node_list(middle, NULL);
+    for (struct rope_node ** link = &list; *link != NULL; link = &(*link)->right)
+    {
+        struct rope_node * next;
+        while ((next = (*link)->right) != NULL &&
+               (*link)->length + next->length <= ROPE_LEAF_SIZE &&
+               rope_node_reserve(link, (*link)->length + next->length))
+        {
+            memcpy((*link)->data + (*link)->length, next->data, next->length);
+            (*link)->length += next->length;
+            (*link)->right = next->right;
+            free(next);
+        }
+
+        struct rope_node * node = *link;
+        if (rope_node_slack(node))
+        {
+            node = realloc(node, sizeof(struct rope_node) + node->length);
+            if (node != NULL)
+            {
+                node->capacity = node->length;
+                *link = node;
+            }
+        }
+    }
+
+    // Rebuild the treap with the pieces' own priorities.
+    middle = NULL;
+    while (list != NULL)
+    {
+        struct rope_node * node = list;
+        list = list->right;
+        node->right = NULL;
+        rope_node_update(node);
+        middle = rope_node_merge(middle, node);
+    }
+    rope->root = rope_node_merge(rope_node_merge(left, middle), right);
+}
+
+
+void rope_init(struct rope * rope)
+{
+    assert(rope);
+
+    rope->root = NULL;
+    rope->seed = 0x9E3779B97F4A7C15u;
+}
+
+
+void rope_free(struct rope * rope)
+{
+    assert(rope);
+
+    rope_node_free(rope->root);
+    rope->root = NULL;
+}
+
+
+size_t rope_size(struct rope const * rope)
+{
+    assert(rope);
+    return rope_node_size(rope->root);
+}
+
+
+// Insert `string` at `position` in the piece that contains it if it fits.
+// Return false, without changing anything, if it doesn't or if growing the
+// piece's buffer fails.
+static bool rope_insert_in_place(struct rope * rope, size_t position, struct string const * string)
+{
+    struct rope_node ** link = &rope->root;
+    size_t offset = position;
+    while (*link != NULL)
+    {
+        struct rope_node * node = *link;
+        size_t left_size = rope_node_size(node->left);
+        if (offset < left_size)
+            link = &node->left;
+        else if (offset <= left_size + node->length)
+            break;
+        else
+        {
+            offset -= left_size + node->length;
+            link = &node->right;
+        }
+    }
+    if (*link == NULL || (*link)->length + string->size > ROPE_LEAF_SIZE ||
+        !rope_node_reserve(link, (*link)->length + string->size))
+        return false;
+
+    // Walk the same path again to grow the subtree sizes.
+    struct rope_node * node = *link;
+    struct rope_node * parent = rope->root;
+    offset = position;
+    while (parent != node)
+    {
+        parent->size += string->size;
+        size_t left_size = rope_node_size(parent->left);
+        if (offset < left_size)
+            parent = parent->left;
+        else
+        {
+            offset -= left_size + parent->length;
+            parent = parent->right;
+        }
+    }
+
+    offset -= rope_node_size(node->left);
+    memmove(node->data + offset + string->size, node->data + offset, node->length - offset);
+    memcpy(node->data + offset, string->data, string->size);
+    node->length += (uint32_t)string->size;
+    node->size += string->size;
+    return true;
+}
+
+
+bool rope_insert(struct rope * rope, size_t position, struct string const * string)
+{
+    assert(rope);
+    assert(string);
+    assert(position <= rope_size(rope));
+
+    if (string->size == 0 || rope_insert_in_place(rope, position, string))
+        return true;
+
+    // Allocate every node first so that failing leaves the rope unchanged. The
+    // spare node takes the end of the piece the position splits, if any.
+    size_t tail = 0;
+    if (position < rope_size(rope))
+    {
+        size_t start;
+        struct rope_node const * node = rope_node_find(rope->root, position, &start);
+        tail = (start < position) ? start + node->length - position : 0;
+    }
+    size_t count = (string->size + ROPE_LEAF_SIZE - 1) / ROPE_LEAF_SIZE;
+    struct rope_node * spare = (tail > 0) ? rope_node_make(rope, tail) : NULL;
+    struct rope_node * middle = NULL;
+    bool ok = tail == 0 || spare != NULL;
+    for (size_t i = 0; ok && i < count; ++i)
+    {
+        size_t offset = i * ROPE_LEAF_SIZE;
+        size_t length = string->size - offset;
+        struct rope_node * node =
+            rope_node_make(rope, (length < ROPE_LEAF_SIZE) ? length : ROPE_LEAF_SIZE);
+        ok = node != NULL;
+        if (!ok)
+            break;
+
+        node->length = node->capacity;
+        memcpy(node->data, string->data + offset, node->length);
+        rope_node_update(node);
+        middle = rope_node_merge(middle, node);
+    }
+    if (!ok)
+    {
+        free(spare);
+        rope_node_free(middle);
+        return false;
+    }
+
+    struct rope_node * left;
+    struct rope_node * right;
+    rope_node_split(rope->root, position, &left, &right, &spare);
+    rope->root = rope_node_merge(rope_node_merge(left, middle), right);
+    free(spare);
+    rope_coalesce(rope, position, position + string->size);
+    return true;
+}
+
+
+// Erase `[from, to)` of the subtree at `node` and return the new subtree.
+static struct rope_node * rope_node_erase(struct rope_node * node, size_t from, size_t to)
+{
+    if (node == NULL || from >= to)
+        return node;
+    if (from == 0 && to >= node->size)
+    {
+        rope_node_free(node);
+        return NULL;
+    }
+
+    // Erase the overlap with this node's piece, then the overlap with each child.
+    size_t left_size = rope_node_size(node->left);
+    size_t right_start = left_size + node->length;
+    size_t begin = (from > left_size) ? from : left_size;
+    size_t end = (to < right_start) ? to : right_start;
+    if (begin < end)
+    {
+        memmove(node->data + begin - left_size, node->data + end - left_size, right_start - end);
+        node->length -= (uint32_t)(end - begin);
+    }
+    if (from < left_size)
+        node->left = rope_node_erase(node->left, from, (to < left_size) ? to : left_size);
+    if (to > right_start)
+        node->right = rope_node_erase(node->right, (from > right_start) ? from - right_start : 0,
+                                      to - right_start);
+
+    if (node->length == 0)
+    {
+        struct rope_node * merged = rope_node_merge(node->left, node->right);
+        free(node);
+        return merged;
+    }
+    rope_node_update(node);
+    return node;
+}
+
+
+void rope_erase(struct rope * rope, size_t from, size_t to)
+{
+    assert(rope);
+    assert(from <= to && to <= rope_size(rope));
+
+    if (from == to)
+        return;
+
+    rope->root = rope_node_erase(rope->root, from, to);
+    rope_coalesce(rope, from, from);
+}
+
+
+void rope_iter_init(struct rope_iter * iter, struct rope const * rope, size_t from, size_t to)
+{
+    assert(iter);
+    assert(rope);
+    assert(from <= to && to <= rope_size(rope));
+
+    iter->rope = rope;
+    iter->position = from;
+    iter->end = to;
+}
+
+
+bool rope_iter_next(struct rope_iter * iter, struct string * piece)
+{
+    assert(iter);
+    assert(piece);
+
+    if (iter->position >= iter->end)
+        return false;
+
+    struct rope_node const * node = iter->rope->root;
+    size_t offset = iter->position;
+    for (;;)
+    {
+        size_t left_size = rope_node_size(node->left);
+        if (offset < left_size)
+            node = node->left;
+        else if (offset < left_size + node->length)
+            break;
+        else
+        {
+            offset -= left_size + node->length;
+            node = node->right;
+        }
+    }
+
+    offset -= rope_node_size(node->left);
+    size_t length = node->length - offset;
+    if (length > iter->end - iter->position)
+        length = iter->end - iter->position;
+
+    piece->data = (char *)node->data + offset;
+    piece->size = length;
+    iter->position += length;
+    return true;
+}
+
+
+// Copy `[from, to)` of the subtree at `node` to `output` in one in-order walk.
+static void rope_node_copy(char * output, struct rope_node const * node, size_t from, size_t to)
+{
+    while (node != NULL && from < to)
+    {
+        size_t left_size = rope_node_size(node->left);
+        size_t right_start = left_size + node->length;
+        if (from < left_size)
+            rope_node_copy(output, node->left, from, (to < left_size) ? to : left_size);
+
+        size_t begin = (from > left_size) ? from : left_size;
+        size_t end = (to < right_start) ? to : right_start;
+        if (begin < end)
+            memcpy(output + begin - from, node->data + begin - left_size, end - begin);
+
+        if (to <= right_start)
+            return;
+        output += (from > right_start) ? 0 : right_start - from;
+        from = (from > right_start) ? from - right_start : 0;
+        to -= right_start;
+        node = node->right;
+    }
+}
+
+
+bool rope_copy_slice(struct string * result, struct rope const * rope, size_t from, size_t to)
+{
+    assert(result);
+    assert(rope);
+    assert(from <= to && to <= rope_size(rope));
+
+    string_make(result, to - from);
+    if (result->size != to - from)
+        return false;
+
+    rope_node_copy(result->data, rope->root, from, to);
+    return true;
+}
+
+
+bool rope_flatten(struct string * result, struct rope const * rope)
+{
+    return rope_copy_slice(result, rope, 0, rope_size(rope));
+}
@@ -1,10 +1,18 @@
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
+#include "util/arena.h"
+#include "util/cpu.h"
 #include "util/string.h"
 
+#ifdef CPU_X86_KERNELS
+#include <immintrin.h>
+#endif
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Construction and destruction
@@ -88,6 +96,39 @@ void string_free(struct string * string)
 }
 
 
+void string_make_arena(struct string * string, size_t size, struct arena * arena)
+{
+    assert(string);
+    assert(arena);
+
+    // Strings are byte arrays so don't waste any space on alignment padding.
+    string->data = (size > 0) ? (char *)arena_alloc_aligned(arena, size, 1) : NULL;
+    string->size = (string->data != NULL) ? size : 0;
+}
+
+
+void string_copy_arena(struct string * string, struct string const * to_copy,
+                       struct arena * arena)
+{
+    assert(string);
+    assert(to_copy);
+
+    string_make_arena(string, to_copy->size, arena);
+    if (string->size > 0)
+        memcpy(string->data, to_copy->data, string->size);
+}
+
+
+void string_copy_cstr_arena(struct string * string, char const * to_copy, struct arena * arena)
+{
+    assert(string);
+    assert(to_copy);
+
+    struct string const view = {(char *)to_copy, strlen(to_copy)};
+    string_copy_arena(string, &view, arena);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Comparison
 ////////////////////////////////////////////////////////////////////////////////
@@ -131,6 +172,103 @@ bool string_is_equal_cstr(struct string const * string, char const * other)
 }
 
 
+int string_compare(struct string const * string, struct string const * other)
+{
+    assert(string);
+    assert(other);
+
+    size_t size = (string->size < other->size) ? string->size : other->size;
+    int result = (size > 0) ? memcmp(string->data, other->data, size) : 0;
+    if (result != 0)
+        return result;
+    return (string->size > other->size) - (string->size < other->size);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Hashing
+////////////////////////////////////////////////////////////////////////////////
+
+
+// The hash reads the input in 16-byte blocks and combines each block into the
+// state with a folded multiply: the high and low halves of a 64x64 -> 128-bit
+// product XOR-ed together. This mixes every input bit into every output bit
+// and is the same construction used by hashes such as wyhash.
+#define STRING_HASH_P0 0xa0761d6478bd642full
+#define STRING_HASH_P1 0xe7037ed1a0b428dbull
+#define STRING_HASH_P2 0x8ebc6af09c88c6e3ull
+
+
+static inline uint64_t string_hash_mix(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 uint128_t;
+    uint128_t product = (uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    uint64_t hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    uint64_t lo = (cross << 32) | (uint32_t)lo_lo;
+    return lo ^ hi;
+#endif
+}
+
+
+static inline uint64_t string_hash_read64(char const * data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+
+// Read 1 to 8 bytes without reading past the end of `data`.
+static inline uint64_t string_hash_read_small(char const * data, size_t size)
+{
+    if (size >= 4)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, data, 4);
+        memcpy(&hi, data + size - 4, 4);
+        return ((uint64_t)hi << 32) | lo;
+    }
+    return ((uint64_t)(unsigned char)data[0] << 16) |
+           ((uint64_t)(unsigned char)data[size >> 1] << 8) | (unsigned char)data[size - 1];
+}
+
+
+uint64_t string_hash(struct string const * string, uint64_t seed)
+{
+    assert(string);
+
+    char const * data = string->data;
+    size_t size = string->size;
+    uint64_t state = seed ^ string_hash_mix(seed ^ STRING_HASH_P0, size ^ STRING_HASH_P1);
+
+    for (; size > 16; size -= 16, data += 16)
+        state = string_hash_mix(string_hash_read64(data) ^ STRING_HASH_P1,
+                                string_hash_read64(data + 8) ^ state);
+
+    // Read the final 1 to 16 bytes as two possibly-overlapping words.
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (size > 8)
+    {
+        a = string_hash_read64(data);
+        b = string_hash_read64(data + size - 8);
+    }
+    else if (size > 0)
+        a = string_hash_read_small(data, size);
+
+    state = string_hash_mix(a ^ STRING_HASH_P1, b ^ state);
+    return string_hash_mix(state ^ STRING_HASH_P2, string->size ^ STRING_HASH_P0);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Contains
 ////////////////////////////////////////////////////////////////////////////////
@@ -158,7 +296,12 @@ bool string_starts_with(struct string const * string, struct string const * pref
     if (prefix->size > string->size)
         return false;
 
-    return string_starts_with_cstr(string, prefix->data);
+    // The prefix isn't necessarily null-terminated so compare it by size.
+    for (size_t i = 0; i < prefix->size; ++i)
+        if (string->data[i] != prefix->data[i])
+            return false;
+
+    return true;
 }
 
 
@@ -191,146 +334,2443 @@ bool string_ends_with(struct string const * const string, struct string const *
 ////////////////////////////////////////////////////////////////////////////////
 
 
-size_t string_count_char(struct string const * string, char to_count)
-{
-    assert(string);
+// Each vectorized kernel is built from a function that compares a 64-byte
+// block against a character and returns a bit mask with bit `i` set when
+// byte `i` of the block matches. The kernels then count the set bits or walk
+// them with a bit-scan, which handles any number of matches per block without
+// branching per byte. Bytes left over after the last whole block are handled
+// by the scalar kernels, which are also the reference the tests compare to.
 
+
+static size_t string_count_char_scalar(char const * data, size_t size, char to_count)
+{
     size_t count = 0;
-    for (size_t i = 0; i < string->size; ++i)
-        count += string->data[i] == to_count;
+    for (size_t i = 0; i < size; ++i)
+        count += data[i] == to_count;
 
     return count;
 }
 
 
-////////////////////////////////////////////////////////////////////////////////
-// Joining
-////////////////////////////////////////////////////////////////////////////////
+// Store a view of every piece of `[data, data + size)` that is terminated by
+// \p pivot in \p output, where \p start is the offset of the first piece.
+// Return the number of pieces stored and update \p start to the offset of
+// the unterminated piece that follows the last pivot.
+static size_t string_split_view_scalar(struct string * output, char * data, size_t size,
+                                       size_t * start, size_t from, char pivot)
+{
+    size_t count = 0;
+    for (size_t i = from; i < size; ++i)
+    {
+        if (data[i] == pivot)
+        {
+            output[count].data = data + *start;
+            output[count].size = i - *start;
+            ++count;
+            *start = i + 1;
+        }
+    }
+    return count;
+}
 
 
-void string_join_array(struct string * result, struct string const * strings, size_t count)
+#ifdef CPU_X86_KERNELS
+
+
+static inline __attribute__((target("sse2"), always_inline)) uint64_t
+string_match_mask_sse2(char const * data, char c)
 {
-    assert(result);
-    assert(strings || count == 0);
+    __m128i const needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i block = _mm_loadu_si128((__m128i const *)(data + 16 * i));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)) << (16 * i);
+    }
+    return mask;
+}
 
-    size_t total_size = 0;
-    for (size_t i = 0; i < count; ++i)
-        total_size += strings[i].size;
 
-    string_make(result, total_size);
-    if (result->data == NULL)
-        return;
+static inline __attribute__((target("avx2"), always_inline)) uint64_t
+string_match_mask_avx2(char const * data, char c)
+{
+    __m256i const needle = _mm256_set1_epi8(c);
+    __m256i lo = _mm256_loadu_si256((__m256i const *)data);
+    __m256i hi = _mm256_loadu_si256((__m256i const *)(data + 32));
+    uint64_t lo_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle));
+    uint64_t hi_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle));
+    return lo_mask | (hi_mask << 32);
+}
 
-    for (size_t i = 0, k = 0; i < count; ++i)
-        for (size_t j = 0; j < strings[i].size; ++j, ++k)
-            result->data[k] = strings[i].data[j];
+
+static inline __attribute__((target("avx512f,avx512bw"), always_inline)) uint64_t
+string_match_mask_avx512(char const * data, char c)
+{
+    __m512i block = _mm512_loadu_si512((void const *)data);
+    return _mm512_cmpeq_epi8_mask(block, _mm512_set1_epi8(c));
 }
 
 
-////////////////////////////////////////////////////////////////////////////////
-// Slicing
-////////////////////////////////////////////////////////////////////////////////
+/// @cond Doxygen_Suppress
+#define STRING_SEARCH_KERNELS(isa, target_isa)                                                     \
+    static __attribute__((target(target_isa))) size_t string_count_char_##isa(                    \
+        char const * data, size_t size, char to_count)                                             \
+    {                                                                                              \
+        size_t count = 0;                                                                          \
+        size_t i = 0;                                                                              \
+        for (; i + 64 <= size; i += 64)                                                            \
+            count += __builtin_popcountll(string_match_mask_##isa(data + i, to_count));            \
+        return count + string_count_char_scalar(data + i, size - i, to_count);                     \
+    }                                                                                              \
+                                                                                                   \
+    static __attribute__((target(target_isa))) size_t string_split_view_##isa(                    \
+        struct string * output, char * data, size_t size, size_t * start, size_t from,             \
+        char pivot)                                                                                \
+    {                                                                                              \
+        size_t count = 0;                                                                          \
+        size_t i = from;                                                                           \
+        for (; i + 64 <= size; i += 64)                                                            \
+        {                                                                                          \
+            for (uint64_t mask = string_match_mask_##isa(data + i, pivot); mask != 0;              \
+                 mask &= mask - 1)                                                                 \
+            {                                                                                      \
+                size_t end = i + (size_t)__builtin_ctzll(mask);                                    \
+                output[count].data = data + *start;                                                \
+                output[count].size = end - *start;                                                 \
+                ++count;                                                                           \
+                *start = end + 1;                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+        return count + string_split_view_scalar(output + count, data, size, start, i, pivot);     \
+    }                                                                                              \
+                                                                                                   \
+    static __attribute__((target(target_isa))) uint64_t string_match_block_##isa(                \
+        char const * data, char c)                                                                 \
+    {                                                                                              \
+        return string_match_mask_##isa(data, c);                                                   \
+    }
+//! @endcond
 
 
-void string_copy_slice(struct string * string, struct string * to_slice, size_t from, size_t to)
+STRING_SEARCH_KERNELS(sse2, "sse2")
+STRING_SEARCH_KERNELS(avx2, "avx2,popcnt,bmi")
+STRING_SEARCH_KERNELS(avx512, "avx512f,avx512bw,popcnt,bmi")
+
+
+#endif // CPU_X86_KERNELS
+
+
+size_t string_count_char(struct string const * string, char to_count)
 {
     assert(string);
-    assert(to_slice);
-    assert(to_slice->size >= to);
-    assert(from <= to);
 
-    string_make(string, to - from);
-    for (size_t i = 0; i < string->size; ++i, ++from)
-        string->data[i] = to_slice->data[from];
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return string_count_char_avx512(string->data, string->size, to_count);
+        case CPU_ISA_AVX2:
+            return string_count_char_avx2(string->data, string->size, to_count);
+        case CPU_ISA_SSE2:
+            return string_count_char_sse2(string->data, string->size, to_count);
+#endif
+        default:
+            return string_count_char_scalar(string->data, string->size, to_count);
+    }
 }
 
 
-void string_view_slice(struct string * string, struct string * to_slice, size_t from, size_t to)
+// Return a bit mask of the bytes in the first `min(size, 64)` bytes of
+// \p data that are equal to \p c.
+static uint64_t string_match_mask(char const * data, size_t size, char c)
 {
-    assert(string);
-    assert(to_slice);
-    assert(to_slice->size >= to);
-    assert(from <= to);
+    if (size >= 64)
+    {
+        switch (cpu_isa_get())
+        {
+#ifdef CPU_X86_KERNELS
+            case CPU_ISA_AVX512:
+                return string_match_block_avx512(data, c);
+            case CPU_ISA_AVX2:
+                return string_match_block_avx2(data, c);
+            case CPU_ISA_SSE2:
+                return string_match_block_sse2(data, c);
+#endif
+            default:
+                size = 64;
+                break;
+        }
+    }
 
-    string->data = to_slice->data + from;
-    string->size = to - from;
+    uint64_t mask = 0;
+    for (size_t i = 0; i < size; ++i)
+        mask |= (uint64_t)(data[i] == c) << i;
+    return mask;
 }
 
 
-size_t string_copy_split(struct string ** output, struct string const * to_split, char pivot)
+// Return true if the `needle_size` bytes at `data` match `needle`, given that
+// the first and last bytes are already known to match.
+static inline bool string_find_verify(char const * data, char const * needle, size_t needle_size)
 {
-    assert(output);
-    assert(to_split);
+    return needle_size <= 2 || memcmp(data + 1, needle + 1, needle_size - 2) == 0;
+}
 
-    const size_t n_pivots = string_count_char(to_split, pivot);
-    const size_t output_size = n_pivots + 1;
 
-    // Only allocate once. Compute the total number of bytes to store n_pivot
-    // string structures and the corresponding characters in the strings.
-    size_t n_bytes = to_split->size + output_size * sizeof(struct string) - n_pivots;
-    *output = (struct string*)malloc(n_bytes);
-    if (*output == NULL)
-        return 0;
+// Search the candidate positions `[from, end)` of `data` for `needle` one at a time.
+static size_t string_find_scalar(char const * data, size_t from, size_t end, char const * needle,
+                                 size_t needle_size)
+{
+    char const first = needle[0];
+    char const last = needle[needle_size - 1];
+    for (size_t i = from; i < end; ++i)
+        if (data[i] == first && data[i + needle_size - 1] == last &&
+            string_find_verify(data + i, needle, needle_size))
+            return i;
+    return STRING_NPOS;
+}
 
-    // Store the string structs in first followed by the split strings.
-    struct string * string_data = *output;
-    char * char_data = (char*)(string_data + output_size);
 
-    // Loop through the original string and each time a character to split about
-    // is found initialize a string object and copy in the characters.
-    size_t last_boundary = 0;
-    size_t j = 0;
-    size_t k = 0;
-    for (size_t i = 0; i < to_split->size; ++i)
+// Like string_find_scalar() but searches the positions from `end - 1` down to `0`.
+static size_t string_rfind_scalar(char const * data, size_t end, char const * needle,
+                                  size_t needle_size)
+{
+    char const first = needle[0];
+    char const last = needle[needle_size - 1];
+    for (size_t i = end; i-- > 0;)
+        if (data[i] == first && data[i + needle_size - 1] == last &&
+            string_find_verify(data + i, needle, needle_size))
+            return i;
+    return STRING_NPOS;
+}
+
+
+#ifdef CPU_X86_KERNELS
+
+
+// The vectorized searches AND the match mask of the needle's first byte at
+// each position with the match mask of its last byte at the same position,
+// which discards almost every position without looking at it individually.
+
+
+/// @cond Doxygen_Suppress
+#define STRING_FIND_KERNELS(isa, target_isa)                                                       \
+    static __attribute__((target(target_isa))) size_t string_find_##isa(                          \
+        char const * data, size_t end, char const * needle, size_t needle_size)                    \
+    {                                                                                              \
+        char const first = needle[0];                                                              \
+        char const last = needle[needle_size - 1];                                                 \
+        size_t i = 0;                                                                              \
+        for (; i + 64 <= end; i += 64)                                                             \
+        {                                                                                          \
+            uint64_t mask = string_match_mask_##isa(data + i, first) &                             \
+                            string_match_mask_##isa(data + i + needle_size - 1, last);             \
+            for (; mask != 0; mask &= mask - 1)                                                    \
+            {                                                                                      \
+                size_t candidate = i + (size_t)__builtin_ctzll(mask);                              \
+                if (string_find_verify(data + candidate, needle, needle_size))                     \
+                    return candidate;                                                              \
+            }                                                                                      \
+        }                                                                                          \
+        return string_find_scalar(data, i, end, needle, needle_size);                              \
+    }                                                                                              \
+                                                                                                   \
+    static __attribute__((target(target_isa))) size_t string_rfind_##isa(                         \
+        char const * data, size_t end, char const * needle, size_t needle_size)                    \
+    {                                                                                              \
+        char const first = needle[0];                                                              \
+        char const last = needle[needle_size - 1];                                                 \
+        for (; end >= 64; end -= 64)                                                               \
+        {                                                                                          \
+            size_t i = end - 64;                                                                   \
+            uint64_t mask = string_match_mask_##isa(data + i, first) &                             \
+                            string_match_mask_##isa(data + i + needle_size - 1, last);             \
+            while (mask != 0)                                                                      \
+            {                                                                                      \
+                size_t bit = 63 - (size_t)__builtin_clzll(mask);                                   \
+                if (string_find_verify(data + i + bit, needle, needle_size))                       \
+                    return i + bit;                                                                \
+                mask &= ~((uint64_t)1 << bit);                                                     \
+            }                                                                                      \
+        }                                                                                          \
+        return string_rfind_scalar(data, end, needle, needle_size);                                \
+    }
+//! @endcond
+
+
+STRING_FIND_KERNELS(sse2, "sse2")
+STRING_FIND_KERNELS(avx2, "avx2,bmi,lzcnt")
+STRING_FIND_KERNELS(avx512, "avx512f,avx512bw,bmi,lzcnt")
+
+
+#endif // CPU_X86_KERNELS
+
+
+// Search for needles of up to this many bytes with the vectorized kernels.
+#define STRING_FIND_SHORT_NEEDLE 32
+
+
+// The Two-Way algorithm of Crochemore and Perrin splits the needle at a
+// critical factorization `needle = u v`, matches `v` left to right and then
+// `u` right to left, and shifts by the period of the needle when it is
+// periodic, remembering how much of the needle is already known to match.
+// This gives a worst-case linear search with constant extra memory. As in
+// glibc, windows are first checked against a table of shifts indexed by their
+// last byte, which skips most of a haystack that the needle rarely matches.
+//
+// To share the code between forward, reverse and case-insensitive searches
+// the bytes are read through a `string_twoway_text`, which can index its
+// bytes back to front and convert them to lower case.
+struct string_twoway_text
+{
+    char const * data;
+    size_t size;
+    bool reverse;
+    bool ignore_case;
+};
+
+
+// Return `c` in lower case if it's an ASCII letter.
+static inline char string_to_lower_char(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c | 0x20) : c;
+}
+
+
+static inline char string_twoway_at(struct string_twoway_text const * text, size_t i)
+{
+    char c = text->reverse ? text->data[text->size - 1 - i] : text->data[i];
+    return text->ignore_case ? string_to_lower_char(c) : c;
+}
+
+
+// Compute the maximal suffix of `needle` under the byte order, or the
+// reversed byte order if `invert` is set. Return its start minus one and
+// store its period in `period`.
+static ptrdiff_t string_twoway_maximal_suffix(struct string_twoway_text const * needle,
+                                              bool invert, ptrdiff_t * period)
+{
+    ptrdiff_t const m = (ptrdiff_t)needle->size;
+    ptrdiff_t ms = -1;
+    ptrdiff_t j = 0;
+    ptrdiff_t k = 1;
+    *period = 1;
+    while (j + k < m)
     {
-        if (to_split->data[i] != pivot)
-            char_data[k++] = to_split->data[i];
+        unsigned char a = (unsigned char)string_twoway_at(needle, (size_t)(j + k));
+        unsigned char b = (unsigned char)string_twoway_at(needle, (size_t)(ms + k));
+        if (invert ? (a > b) : (a < b))
+        {
+            j += k;
+            k = 1;
+            *period = j - ms;
+        }
+        else if (a == b)
+        {
+            if (k != *period)
+                ++k;
+            else
+            {
+                j += *period;
+                k = 1;
+            }
+        }
         else
         {
-            string_data[j].data = char_data + last_boundary;
-            string_data[j].size = k - last_boundary;
-            ++j;
-            last_boundary = i;
+            ms = j;
+            j = ms + 1;
+            k = *period = 1;
         }
     }
+    return ms;
+}
 
-    string_data[j].data = char_data + last_boundary;
-    string_data[j].size = k - last_boundary;
 
-    return output_size;
+// Return the position of the first occurrence of `needle` in `haystack`, or
+// STRING_NPOS. Positions are relative to the direction the texts are read in.
+static size_t string_twoway(struct string_twoway_text const * haystack,
+                            struct string_twoway_text const * needle)
+{
+    size_t const m = needle->size;
+    size_t const n = haystack->size;
+
+    // The right half `v` of the critical factorization starts at `suffix`.
+    ptrdiff_t p, q;
+    ptrdiff_t i = string_twoway_maximal_suffix(needle, false, &p);
+    ptrdiff_t j = string_twoway_maximal_suffix(needle, true, &q);
+    size_t const suffix = (size_t)((i > j) ? i : j) + 1;
+    size_t period = (size_t)((i > j) ? p : q);
+
+    // The needle is periodic if `u` repeats after `period` bytes. Otherwise no
+    // two matches overlap by more than this conservative shift.
+    bool periodic = period + suffix <= m;
+    for (size_t k = 0; periodic && k < suffix; ++k)
+        periodic = string_twoway_at(needle, k) == string_twoway_at(needle, k + period);
+    if (!periodic)
+        period = ((suffix > m - suffix) ? suffix : m - suffix) + 1;
+
+    // How far to shift a window ending in each byte to align it with the last
+    // occurrence of that byte in the needle.
+    size_t shifts[256];
+    for (size_t c = 0; c < 256; ++c)
+        shifts[c] = m;
+    for (size_t k = 0; k < m; ++k)
+        shifts[(unsigned char)string_twoway_at(needle, k)] = m - 1 - k;
+
+    // The number of bytes at the start of the window known to match, which is
+    // only non-zero after shifting a periodic needle by its period.
+    size_t memory = 0;
+    for (size_t position = 0; position <= n - m;)
+    {
+        size_t shift = shifts[(unsigned char)string_twoway_at(haystack, position + m - 1)];
+        if (shift > 0)
+        {
+            // The bytes that were known to match can't match after a short shift.
+            if (memory > 0 && shift < period)
+                shift = m - period;
+            memory = 0;
+            position += shift;
+            continue;
+        }
+
+        // The last bytes match, so compare the rest of `v`.
+        size_t k = (suffix > memory) ? suffix : memory;
+        while (k < m - 1 &&
+               string_twoway_at(needle, k) == string_twoway_at(haystack, position + k))
+            ++k;
+        if (k < m - 1)
+        {
+            position += k - suffix + 1;
+            memory = 0;
+            continue;
+        }
+
+        // Then compare `u` from right to left, down to the bytes known to match.
+        k = suffix;
+        while (k > memory &&
+               string_twoway_at(needle, k - 1) == string_twoway_at(haystack, position + k - 1))
+            --k;
+        if (k <= memory)
+            return position;
+
+        position += period;
+        memory = periodic ? m - period : 0;
+    }
+
+    return STRING_NPOS;
 }
 
 
-size_t string_view_split(struct string ** output, struct string const * to_split, char pivot)
+size_t string_find(struct string const * haystack, struct string const * needle)
 {
-    assert(output);
-    assert(to_split);
-
-    size_t number_of_pivots = string_count_char(to_split, pivot);
-    size_t output_size = 1 + number_of_pivots;
+    assert(haystack);
+    assert(needle);
 
-    *output = malloc(sizeof(struct string) * output_size);
-    if (*output == NULL)
+    if (needle->size == 0)
         return 0;
+    if (needle->size > haystack->size)
+        return STRING_NPOS;
+
+    if (needle->size > STRING_FIND_SHORT_NEEDLE)
+    {
+        struct string_twoway_text const h = {haystack->data, haystack->size, false, false};
+        struct string_twoway_text const n = {needle->data, needle->size, false, false};
+        return string_twoway(&h, &n);
+    }
+
+    // The number of positions the needle could start at.
+    size_t const end = haystack->size - needle->size + 1;
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return string_find_avx512(haystack->data, end, needle->data, needle->size);
+        case CPU_ISA_AVX2:
+            return string_find_avx2(haystack->data, end, needle->data, needle->size);
+        case CPU_ISA_SSE2:
+            return string_find_sse2(haystack->data, end, needle->data, needle->size);
+#endif
+        default:
+            return string_find_scalar(haystack->data, 0, end, needle->data, needle->size);
+    }
+}
+
+
+size_t string_rfind(struct string const * haystack, struct string const * needle)
+{
+    assert(haystack);
+    assert(needle);
+
+    if (needle->size == 0)
+        return haystack->size;
+    if (needle->size > haystack->size)
+        return STRING_NPOS;
+
+    if (needle->size > STRING_FIND_SHORT_NEEDLE)
+    {
+        // The first match in the reversed texts is the last match in the originals.
+        struct string_twoway_text const h = {haystack->data, haystack->size, true, false};
+        struct string_twoway_text const n = {needle->data, needle->size, true, false};
+        size_t position = string_twoway(&h, &n);
+        return (position == STRING_NPOS) ? STRING_NPOS
+                                         : haystack->size - position - needle->size;
+    }
+
+    size_t const end = haystack->size - needle->size + 1;
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return string_rfind_avx512(haystack->data, end, needle->data, needle->size);
+        case CPU_ISA_AVX2:
+            return string_rfind_avx2(haystack->data, end, needle->data, needle->size);
+        case CPU_ISA_SSE2:
+            return string_rfind_sse2(haystack->data, end, needle->data, needle->size);
+#endif
+        default:
+            return string_rfind_scalar(haystack->data, end, needle->data, needle->size);
+    }
+}
+
+
+size_t string_find_all(size_t ** output, struct string const * haystack,
+                       struct string const * needle)
+{
+    assert(output);
+    assert(haystack);
+    assert(needle);
 
-    struct string * out_strings = *output;
+    *output = NULL;
+    if (needle->size == 0)
+        return 0;
 
-    size_t last_boundary = 0;
-    size_t j = 0;
-    for (size_t i = 0; j < number_of_pivots; ++i)
+    size_t count = 0;
+    size_t capacity = 0;
+    struct string rest = *haystack;
+    for (;;)
     {
-        if (to_split->data[i] == pivot)
+        size_t position = string_find(&rest, needle);
+        if (position == STRING_NPOS)
+            break;
+
+        if (count == capacity)
         {
-            out_strings[j].data = to_split->data + last_boundary;
-            out_strings[j].size = i - last_boundary;
-            ++j;
-            last_boundary = i + 1;
-            continue;
+            capacity = (capacity > 0) ? 2 * capacity : 16;
+            size_t * grown = realloc(*output, capacity * sizeof(size_t));
+            if (grown == NULL)
+            {
+                free(*output);
+                *output = NULL;
+                return 0;
+            }
+            *output = grown;
         }
+
+        size_t offset = (size_t)(rest.data - haystack->data) + position;
+        (*output)[count++] = offset;
+        rest.data = haystack->data + offset + needle->size;
+        rest.size = haystack->size - offset - needle->size;
     }
 
-    out_strings[j].data = to_split->data + last_boundary;
-    out_strings[j].size = to_split->size - last_boundary;
+    return count;
+}
 
-    return output_size;
+
+// Store a view of every piece of `[data, data + size)` that is terminated by
+// \p pivot in \p output, using the kernel for the selected instruction set.
+// The arguments are the same as for string_split_view_scalar().
+static size_t string_split_view_range(struct string * output, char * data, size_t size,
+                                      size_t * start, size_t from, char pivot)
+{
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return string_split_view_avx512(output, data, size, start, from, pivot);
+        case CPU_ISA_AVX2:
+            return string_split_view_avx2(output, data, size, start, from, pivot);
+        case CPU_ISA_SSE2:
+            return string_split_view_sse2(output, data, size, start, from, pivot);
+#endif
+        default:
+            return string_split_view_scalar(output, data, size, start, from, pivot);
+    }
+}
+
+
+// Store a view of every piece of \p to_split that is terminated by \p pivot in
+// \p output followed by a view of the final piece.
+static void string_split_view_into(struct string * output, struct string const * to_split,
+                                   char pivot)
+{
+    size_t start = 0;
+    size_t count = string_split_view_range(output, to_split->data, to_split->size, &start, 0,
+                                           pivot);
+    output[count].data = to_split->data + start;
+    output[count].size = to_split->size - start;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Joining
+////////////////////////////////////////////////////////////////////////////////
+
+
+void string_join_array(struct string * result, struct string const * strings, size_t count)
+{
+    assert(result);
+    assert(strings || count == 0);
+
+    size_t total_size = 0;
+    for (size_t i = 0; i < count; ++i)
+        total_size += strings[i].size;
+
+    string_make(result, total_size);
+    if (result->data == NULL)
+        return;
+
+    char * out = result->data;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (strings[i].size > 0)
+            memcpy(out, strings[i].data, strings[i].size);
+        out += strings[i].size;
+    }
+}
+
+
+void string_join_array_arena(struct string * result, struct string const * strings, size_t count,
+                             struct arena * arena)
+{
+    assert(result);
+    assert(strings || count == 0);
+
+    size_t total_size = 0;
+    for (size_t i = 0; i < count; ++i)
+        total_size += strings[i].size;
+
+    string_make_arena(result, total_size, arena);
+    if (result->data == NULL)
+        return;
+
+    char * out = result->data;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (strings[i].size > 0)
+            memcpy(out, strings[i].data, strings[i].size);
+        out += strings[i].size;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Building
+////////////////////////////////////////////////////////////////////////////////
+
+
+// The capacity of a builder's first allocation.
+#define STRING_BUILDER_MIN_CAPACITY 64
+
+
+void string_builder_init(struct string_builder * builder)
+{
+    assert(builder);
+
+    builder->data = NULL;
+    builder->size = 0;
+    builder->capacity = 0;
+}
+
+
+void string_builder_free(struct string_builder * builder)
+{
+    assert(builder);
+
+    free(builder->data);
+    string_builder_init(builder);
+}
+
+
+void string_builder_clear(struct string_builder * builder)
+{
+    assert(builder);
+
+    builder->size = 0;
+}
+
+
+// Grow the capacity of `builder` to at least `capacity` bytes, and at least
+// double it so that a sequence of appends only allocates logarithmically often.
+static bool string_builder_grow(struct string_builder * builder, size_t capacity)
+{
+    size_t grown = (builder->capacity > SIZE_MAX / 2) ? SIZE_MAX : 2 * builder->capacity;
+    if (grown < capacity)
+        grown = capacity;
+    if (grown < STRING_BUILDER_MIN_CAPACITY)
+        grown = STRING_BUILDER_MIN_CAPACITY;
+
+    char * data = realloc(builder->data, grown);
+    if (data == NULL)
+        return false;
+
+    builder->data = data;
+    builder->capacity = grown;
+    return true;
+}
+
+
+bool string_builder_reserve(struct string_builder * builder, size_t additional)
+{
+    assert(builder);
+
+    if (additional <= builder->capacity - builder->size)
+        return true;
+    if (additional > SIZE_MAX - builder->size)
+        return false;
+    return string_builder_grow(builder, builder->size + additional);
+}
+
+
+bool string_builder_shrink(struct string_builder * builder)
+{
+    assert(builder);
+
+    if (builder->size == builder->capacity)
+        return true;
+    if (builder->size == 0)
+    {
+        string_builder_free(builder);
+        return true;
+    }
+
+    char * data = realloc(builder->data, builder->size);
+    if (data == NULL)
+        return false;
+
+    builder->data = data;
+    builder->capacity = builder->size;
+    return true;
+}
+
+
+// Append `size` bytes from `data` to `builder`.
+static inline bool string_builder_append_bytes(struct string_builder * builder, char const * data,
+                                               size_t size)
+{
+    if (size > builder->capacity - builder->size && !string_builder_reserve(builder, size))
+        return false;
+
+    if (size > 0)
+        memcpy(builder->data + builder->size, data, size);
+    builder->size += size;
+    return true;
+}
+
+
+bool string_builder_append(struct string_builder * builder, struct string const * string)
+{
+    assert(builder);
+    assert(string);
+
+    return string_builder_append_bytes(builder, string->data, string->size);
+}
+
+
+bool string_builder_append_cstr(struct string_builder * builder, char const * string)
+{
+    assert(builder);
+    assert(string);
+
+    return string_builder_append_bytes(builder, string, strlen(string));
+}
+
+
+bool string_builder_append_char(struct string_builder * builder, char c)
+{
+    assert(builder);
+
+    if (builder->size == builder->capacity && !string_builder_reserve(builder, 1))
+        return false;
+
+    builder->data[builder->size++] = c;
+    return true;
+}
+
+
+// The number of characters needed for the decimal representation of any int64_t or uint64_t.
+#define STRING_BUILDER_INT_DIGITS 20
+
+
+// Write the decimal digits of `value` backwards, ending just before `end`,
+// and return a pointer to the first digit.
+static char * string_builder_digits(char * end, uint64_t value)
+{
+    do
+    {
+        *--end = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    return end;
+}
+
+
+bool string_builder_append_uint(struct string_builder * builder, uint64_t value)
+{
+    assert(builder);
+
+    char buffer[STRING_BUILDER_INT_DIGITS];
+    char * end = buffer + sizeof(buffer);
+    char * start = string_builder_digits(end, value);
+    return string_builder_append_bytes(builder, start, (size_t)(end - start));
+}
+
+
+bool string_builder_append_int(struct string_builder * builder, int64_t value)
+{
+    assert(builder);
+
+    // Negate in unsigned arithmetic so that INT64_MIN doesn't overflow.
+    char buffer[STRING_BUILDER_INT_DIGITS];
+    char * end = buffer + sizeof(buffer);
+    char * start = string_builder_digits(end, (value < 0) ? 0 - (uint64_t)value : (uint64_t)value);
+    if (value < 0)
+        *--start = '-';
+    return string_builder_append_bytes(builder, start, (size_t)(end - start));
+}
+
+
+void string_builder_finish(struct string_builder * builder, struct string * result)
+{
+    assert(builder);
+    assert(result);
+
+    result->data = builder->data;
+    result->size = builder->size;
+    if (result->size == 0)
+    {
+        // An empty string doesn't own memory so free any the builder has.
+        free(builder->data);
+        result->data = NULL;
+    }
+    string_builder_init(builder);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Slicing
+////////////////////////////////////////////////////////////////////////////////
+
+
+void string_copy_slice(struct string * string, struct string * to_slice, size_t from, size_t to)
+{
+    assert(string);
+    assert(to_slice);
+    assert(to_slice->size >= to);
+    assert(from <= to);
+
+    string_make(string, to - from);
+    for (size_t i = 0; i < string->size; ++i, ++from)
+        string->data[i] = to_slice->data[from];
+}
+
+
+void string_copy_slice_arena(struct string * string, struct string const * to_slice, size_t from,
+                             size_t to, struct arena * arena)
+{
+    assert(string);
+    assert(to_slice);
+    assert(to_slice->size >= to);
+    assert(from <= to);
+
+    struct string const view = {to_slice->data + from, to - from};
+    string_copy_arena(string, &view, arena);
+}
+
+
+void string_view_slice(struct string * string, struct string * to_slice, size_t from, size_t to)
+{
+    assert(string);
+    assert(to_slice);
+    assert(to_slice->size >= to);
+    assert(from <= to);
+
+    string->data = to_slice->data + from;
+    string->size = to - from;
+}
+
+
+// Split \p to_split about \p pivot into \p memory, which must have space for
+// `output_size` string structures followed by the characters of the pieces.
+static void string_copy_split_into(void * memory, size_t output_size,
+                                   struct string const * to_split, char pivot)
+{
+    // Store the string structs in first followed by the split strings.
+    struct string * string_data = memory;
+    char * char_data = (char*)(string_data + output_size);
+
+    // Find the pieces as views of the original string and then copy each
+    // piece into the character data, re-pointing the view at the copy.
+    string_split_view_into(string_data, to_split, pivot);
+    for (size_t i = 0; i < output_size; ++i)
+    {
+        if (string_data[i].size > 0)
+            memcpy(char_data, string_data[i].data, string_data[i].size);
+        string_data[i].data = char_data;
+        char_data += string_data[i].size;
+    }
+}
+
+
+size_t string_copy_split(struct string ** output, struct string const * to_split, char pivot)
+{
+    assert(output);
+    assert(to_split);
+
+    const size_t n_pivots = string_count_char(to_split, pivot);
+    const size_t output_size = n_pivots + 1;
+
+    // Only allocate once. Compute the total number of bytes to store n_pivot
+    // string structures and the corresponding characters in the strings.
+    size_t n_bytes = to_split->size + output_size * sizeof(struct string) - n_pivots;
+    *output = (struct string*)malloc(n_bytes);
+    if (*output == NULL)
+        return 0;
+
+    string_copy_split_into(*output, output_size, to_split, pivot);
+    return output_size;
+}
+
+
+size_t string_copy_split_arena(struct string ** output, struct string const * to_split,
+                               char pivot, struct arena * arena)
+{
+    assert(output);
+    assert(to_split);
+
+    const size_t n_pivots = string_count_char(to_split, pivot);
+    const size_t output_size = n_pivots + 1;
+
+    size_t n_bytes = to_split->size + output_size * sizeof(struct string) - n_pivots;
+    *output = arena_alloc_aligned(arena, n_bytes, _Alignof(struct string));
+    if (*output == NULL)
+        return 0;
+
+    string_copy_split_into(*output, output_size, to_split, pivot);
+    return output_size;
+}
+
+
+size_t string_view_split(struct string ** output, struct string const * to_split, char pivot)
+{
+    assert(output);
+    assert(to_split);
+
+    size_t number_of_pivots = string_count_char(to_split, pivot);
+    size_t output_size = 1 + number_of_pivots;
+
+    *output = malloc(sizeof(struct string) * output_size);
+    if (*output == NULL)
+        return 0;
+
+    string_split_view_into(*output, to_split, pivot);
+    return output_size;
+}
+
+
+// Give each thread of string_view_split_parallel() at least this many bytes.
+#define STRING_SPLIT_PARALLEL_MIN_CHUNK ((size_t)1 << 20)
+
+
+// The part of a parallel split done by one thread.
+struct string_split_chunk
+{
+    struct string const * to_split;
+    struct string * output; // Where the first piece of the chunk is stored.
+    size_t begin;           // The offset of the chunk, which is 0 or just after a pivot.
+    size_t end;             // The offset of the end of the chunk.
+    size_t count;           // The number of pivots in the chunk.
+    size_t start;           // The offset of the piece after the last pivot in the chunk.
+    char pivot;
+    bool started;           // `true` if `thread` is running this chunk.
+    thrd_t thread;
+};
+
+
+static int string_split_chunk_count(void * chunk_pointer)
+{
+    struct string_split_chunk * chunk = chunk_pointer;
+    struct string const piece = {chunk->to_split->data + chunk->begin, chunk->end - chunk->begin};
+    chunk->count = string_count_char(&piece, chunk->pivot);
+    return 0;
+}
+
+
+static int string_split_chunk_fill(void * chunk_pointer)
+{
+    struct string_split_chunk * chunk = chunk_pointer;
+    chunk->start = chunk->begin;
+    string_split_view_range(chunk->output, chunk->to_split->data, chunk->end, &chunk->start,
+                            chunk->begin, chunk->pivot);
+    return 0;
+}
+
+
+// Run `function` on every chunk: the first on the calling thread and each of
+// the others on a new thread, or on the calling thread if one can't be started.
+static void string_split_chunks_run(struct string_split_chunk * chunks, size_t count,
+                                    thrd_start_t function)
+{
+    for (size_t i = 1; i < count; ++i)
+        chunks[i].started = thrd_create(&chunks[i].thread, function, chunks + i) == thrd_success;
+
+    function(chunks);
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (chunks[i].started)
+            thrd_join(chunks[i].thread, NULL);
+        else
+            function(chunks + i);
+    }
+}
+
+
+size_t string_view_split_parallel(struct string ** output, struct string const * to_split,
+                                  char pivot, size_t thread_count)
+{
+    assert(output);
+    assert(to_split);
+    assert(thread_count > 0);
+
+    size_t const max_chunks = to_split->size / STRING_SPLIT_PARALLEL_MIN_CHUNK;
+    size_t const chunk_count = (thread_count < max_chunks) ? thread_count : max_chunks;
+    if (chunk_count <= 1)
+        return string_view_split(output, to_split, pivot);
+
+    *output = NULL;
+    struct string_split_chunk * chunks = malloc(sizeof(*chunks) * chunk_count);
+    if (chunks == NULL)
+        return 0;
+
+    // Cut the input into chunks of about the same size, moving each cut to
+    // just after the next pivot. Searching from the previous cut when it's
+    // further on scans each byte at most once, even if there are few pivots.
+    size_t begin = 0;
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        size_t end = to_split->size;
+        if (i + 1 < chunk_count)
+        {
+            size_t cut = to_split->size / chunk_count * (i + 1);
+            cut = (cut > begin) ? cut : begin;
+            char const * found = memchr(to_split->data + cut, pivot, to_split->size - cut);
+            end = (found != NULL) ? (size_t)(found - to_split->data) + 1 : to_split->size;
+        }
+        chunks[i] = (struct string_split_chunk){
+            .to_split = to_split, .begin = begin, .end = end, .pivot = pivot};
+        begin = end;
+    }
+
+    // Count the pivots in each chunk to find where its pieces go in the output.
+    string_split_chunks_run(chunks, chunk_count, string_split_chunk_count);
+    size_t output_size = 1;
+    for (size_t i = 0; i < chunk_count; ++i)
+        output_size += chunks[i].count;
+
+    *output = malloc(sizeof(struct string) * output_size);
+    if (*output == NULL)
+    {
+        free(chunks);
+        return 0;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        chunks[i].output = *output + offset;
+        offset += chunks[i].count;
+    }
+    string_split_chunks_run(chunks, chunk_count, string_split_chunk_fill);
+
+    // The final piece follows the last pivot in the last chunk that has one.
+    size_t start = 0;
+    for (size_t i = 0; i < chunk_count; ++i)
+        if (chunks[i].count > 0)
+            start = chunks[i].start;
+    (*output)[output_size - 1].data = to_split->data + start;
+    (*output)[output_size - 1].size = to_split->size - start;
+
+    free(chunks);
+    return output_size;
+}
+
+
+void string_split_iter_init(struct string_split_iter * iter, struct string const * to_split,
+                            char pivot)
+{
+    assert(iter);
+    assert(to_split);
+
+    iter->to_split = *to_split;
+    iter->start = 0;
+    iter->block = 0;
+    iter->mask = string_match_mask(to_split->data, to_split->size, pivot);
+    iter->pivot = pivot;
+    iter->done = false;
+}
+
+
+bool string_split_iter_next(struct string_split_iter * iter, struct string * piece)
+{
+    assert(iter);
+    assert(piece);
+
+    if (iter->done)
+        return false;
+
+    // Move to the next block containing a pivot, or finish with the final
+    // piece if there are no pivots left.
+    while (iter->mask == 0)
+    {
+        iter->block += 64;
+        if (iter->block >= iter->to_split.size)
+        {
+            piece->data = iter->to_split.data + iter->start;
+            piece->size = iter->to_split.size - iter->start;
+            iter->done = true;
+            return true;
+        }
+        iter->mask = string_match_mask(iter->to_split.data + iter->block,
+                                       iter->to_split.size - iter->block, iter->pivot);
+    }
+
+    size_t end = iter->block + (size_t)__builtin_ctzll(iter->mask);
+    iter->mask &= iter->mask - 1;
+
+    piece->data = iter->to_split.data + iter->start;
+    piece->size = end - iter->start;
+    iter->start = end + 1;
+    return true;
+}
+
+
+// Store the offset of every pivot in `[data, data + size)` followed by
+// `size` in `ends`, which must have room for them all as `type`, and store
+// views of `count` pieces from piece `first` of an index in `output`.
+/// @cond Doxygen_Suppress
+#define STRING_SPLIT_INDEX_FILL(type)                                                              \
+    static void string_split_index_fill_##type(type * ends, char const * data, size_t size,        \
+                                               char pivot)                                         \
+    {                                                                                              \
+        size_t count = 0;                                                                          \
+        for (size_t block = 0; block < size; block += 64)                                          \
+        {                                                                                          \
+            for (uint64_t mask = string_match_mask(data + block, size - block, pivot); mask != 0;  \
+                 mask &= mask - 1)                                                                 \
+                ends[count++] = (type)(block + (size_t)__builtin_ctzll(mask));                     \
+        }                                                                                          \
+        ends[count] = (type)size;                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    static void string_split_index_range_##type(struct string * output, char * data,             \
+                                                type const * ends, size_t first, size_t count)     \
+    {                                                                                              \
+        size_t start = (first > 0) ? (size_t)ends[first - 1] + 1 : 0;                              \
+        for (size_t i = 0; i < count; ++i)                                                         \
+        {                                                                                          \
+            size_t end = ends[first + i];                                                          \
+            output[i].data = data + start;                                                         \
+            output[i].size = end - start;                                                          \
+            start = end + 1;                                                                       \
+        }                                                                                          \
+    }
+//! @endcond
+
+
+STRING_SPLIT_INDEX_FILL(uint16_t)
+STRING_SPLIT_INDEX_FILL(uint32_t)
+STRING_SPLIT_INDEX_FILL(uint64_t)
+
+
+bool string_split_index_make(struct string_split_index * index, struct string const * to_split,
+                             char pivot)
+{
+    assert(index);
+    assert(to_split);
+
+    index->data = to_split->data;
+    index->count = string_count_char(to_split, pivot) + 1;
+    index->offset_size = (to_split->size <= UINT16_MAX)   ? sizeof(uint16_t)
+                         : (to_split->size <= UINT32_MAX) ? sizeof(uint32_t)
+                                                          : sizeof(uint64_t);
+    index->ends = malloc(index->count * index->offset_size);
+    if (index->ends == NULL)
+    {
+        index->count = 0;
+        return false;
+    }
+
+    if (index->offset_size == sizeof(uint16_t))
+        string_split_index_fill_uint16_t(index->ends, to_split->data, to_split->size, pivot);
+    else if (index->offset_size == sizeof(uint32_t))
+        string_split_index_fill_uint32_t(index->ends, to_split->data, to_split->size, pivot);
+    else
+        string_split_index_fill_uint64_t(index->ends, to_split->data, to_split->size, pivot);
+    return true;
+}
+
+
+void string_split_index_free(struct string_split_index * index)
+{
+    assert(index);
+
+    free(index->ends);
+    index->ends = NULL;
+    index->count = 0;
+}
+
+
+// Return the offset of the end of piece `i` of `index`.
+static size_t string_split_index_end(struct string_split_index const * index, size_t i)
+{
+    if (index->offset_size == sizeof(uint16_t))
+        return ((uint16_t const *)index->ends)[i];
+    if (index->offset_size == sizeof(uint32_t))
+        return ((uint32_t const *)index->ends)[i];
+    return (size_t)((uint64_t const *)index->ends)[i];
+}
+
+
+void string_split_index_get(struct string * piece, struct string_split_index const * index,
+                            size_t i)
+{
+    assert(piece);
+    assert(index);
+    assert(i < index->count);
+
+    size_t start = (i > 0) ? string_split_index_end(index, i - 1) + 1 : 0;
+    piece->data = index->data + start;
+    piece->size = string_split_index_end(index, i) - start;
+}
+
+
+size_t string_split_index_get_range(struct string * output,
+                                    struct string_split_index const * index, size_t first,
+                                    size_t count)
+{
+    assert(output || count == 0);
+    assert(index);
+
+    if (first >= index->count)
+        return 0;
+    if (count > index->count - first)
+        count = index->count - first;
+
+    if (index->offset_size == sizeof(uint16_t))
+        string_split_index_range_uint16_t(output, index->data, index->ends, first, count);
+    else if (index->offset_size == sizeof(uint32_t))
+        string_split_index_range_uint32_t(output, index->data, index->ends, first, count);
+    else
+        string_split_index_range_uint64_t(output, index->data, index->ends, first, count);
+    return count;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Character sets
+////////////////////////////////////////////////////////////////////////////////
+
+
+void string_char_set_init(struct string_char_set * set, struct string const * chars)
+{
+    assert(set);
+    assert(chars);
+
+    memset(set, 0, sizeof(*set));
+    for (size_t i = 0; i < chars->size; ++i)
+    {
+        unsigned char c = (unsigned char)chars->data[i];
+        set->contains[c] = true;
+        if (c < 128)
+            set->low[c & 0x0f] |= (unsigned char)(1u << (c >> 4));
+        else
+        {
+            set->low_high[c & 0x0f] |= (unsigned char)(1u << ((c >> 4) - 8));
+            set->has_high = true;
+        }
+    }
+}
+
+
+void string_char_set_init_cstr(struct string_char_set * set, char const * chars)
+{
+    assert(chars);
+
+    struct string const view = {(char *)chars, strlen(chars)};
+    string_char_set_init(set, &view);
+}
+
+
+static size_t string_count_any_scalar(char const * data, size_t size,
+                                      struct string_char_set const * set)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i)
+        count += set->contains[(unsigned char)data[i]];
+    return count;
+}
+
+
+// Like string_split_view_scalar() but splits about any character in `set`
+// and, if `collapse` is set, doesn't store empty pieces.
+static size_t string_split_any_scalar(struct string * output, char * data, size_t size,
+                                      size_t * start, size_t from,
+                                      struct string_char_set const * set, bool collapse)
+{
+    size_t count = 0;
+    for (size_t i = from; i < size; ++i)
+    {
+        if (set->contains[(unsigned char)data[i]])
+        {
+            if (!collapse || i > *start)
+            {
+                output[count].data = data + *start;
+                output[count].size = i - *start;
+                ++count;
+            }
+            *start = i + 1;
+        }
+    }
+    return count;
+}
+
+
+#ifdef CPU_X86_KERNELS
+
+
+// Classify the 32 bytes in `block`: bytes in the set become non-zero.
+static inline __attribute__((target("avx2"), always_inline)) __m256i
+string_classify_avx2(__m256i block, __m256i low, __m256i low_high, bool has_high)
+{
+    // Bit h of high_bits[h] is set for the high nibbles 0 to 7, and bit h - 8
+    // of high_bits_high[h] for the high nibbles 8 to 15.
+    __m256i const high_bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0,
+                                               0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0,
+                                               0, 0);
+    __m256i const high_bits_high = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8,
+        16, 32, 64, -128);
+    __m256i const nibble = _mm256_set1_epi8(0x0f);
+
+    __m256i lo = _mm256_and_si256(block, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+    __m256i hits =
+        _mm256_and_si256(_mm256_shuffle_epi8(low, lo), _mm256_shuffle_epi8(high_bits, hi));
+    if (has_high)
+        hits = _mm256_or_si256(hits, _mm256_and_si256(_mm256_shuffle_epi8(low_high, lo),
+                                                      _mm256_shuffle_epi8(high_bits_high, hi)));
+    return hits;
+}
+
+
+static inline __attribute__((target("avx2"), always_inline)) uint64_t
+string_set_mask_avx2(char const * data, struct string_char_set const * set)
+{
+    __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)set->low));
+    __m256i low_high =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)set->low_high));
+    __m256i const zero = _mm256_setzero_si256();
+
+    __m256i lo = string_classify_avx2(_mm256_loadu_si256((__m256i const *)data), low, low_high,
+                                      set->has_high);
+    __m256i hi = string_classify_avx2(_mm256_loadu_si256((__m256i const *)(data + 32)), low,
+                                      low_high, set->has_high);
+    uint64_t lo_mask = (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, zero));
+    uint64_t hi_mask = (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, zero));
+    return lo_mask | (hi_mask << 32);
+}
+
+
+static inline __attribute__((target("avx512f,avx512bw"), always_inline)) uint64_t
+string_set_mask_avx512(char const * data, struct string_char_set const * set)
+{
+    __m512i const high_bits = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0));
+    __m512i const high_bits_high = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128));
+    __m512i const nibble = _mm512_set1_epi8(0x0f);
+    __m512i low = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i const *)set->low));
+
+    __m512i block = _mm512_loadu_si512((void const *)data);
+    __m512i lo = _mm512_and_si512(block, nibble);
+    __m512i hi = _mm512_and_si512(_mm512_srli_epi16(block, 4), nibble);
+    __m512i hits =
+        _mm512_and_si512(_mm512_shuffle_epi8(low, lo), _mm512_shuffle_epi8(high_bits, hi));
+    if (set->has_high)
+    {
+        __m512i low_high = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i const *)set->low_high));
+        hits = _mm512_or_si512(hits, _mm512_and_si512(_mm512_shuffle_epi8(low_high, lo),
+                                                      _mm512_shuffle_epi8(high_bits_high, hi)));
+    }
+    return _mm512_test_epi8_mask(hits, hits);
+}
+
+
+/// @cond Doxygen_Suppress
+#define STRING_SET_KERNELS(isa, target_isa)                                                        \
+    static __attribute__((target(target_isa))) size_t string_count_any_##isa(                     \
+        char const * data, size_t size, struct string_char_set const * set)                        \
+    {                                                                                              \
+        size_t count = 0;                                                                          \
+        size_t i = 0;                                                                              \
+        for (; i + 64 <= size; i += 64)                                                            \
+            count += __builtin_popcountll(string_set_mask_##isa(data + i, set));                   \
+        return count + string_count_any_scalar(data + i, size - i, set);                           \
+    }                                                                                              \
+                                                                                                   \
+    static __attribute__((target(target_isa))) size_t string_split_any_##isa(                     \
+        struct string * output, char * data, size_t size, size_t * start, size_t from,             \
+        struct string_char_set const * set, bool collapse)                                         \
+    {                                                                                              \
+        size_t count = 0;                                                                          \
+        size_t i = from;                                                                           \
+        for (; i + 64 <= size; i += 64)                                                            \
+        {                                                                                          \
+            for (uint64_t mask = string_set_mask_##isa(data + i, set); mask != 0;                  \
+                 mask &= mask - 1)                                                                 \
+            {                                                                                      \
+                size_t end = i + (size_t)__builtin_ctzll(mask);                                    \
+                if (!collapse || end > *start)                                                     \
+                {                                                                                  \
+                    output[count].data = data + *start;                                            \
+                    output[count].size = end - *start;                                             \
+                    ++count;                                                                       \
+                }                                                                                  \
+                *start = end + 1;                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+        return count + string_split_any_scalar(output + count, data, size, start, i, set,          \
+                                               collapse);                                          \
+    }
+//! @endcond
+
+
+STRING_SET_KERNELS(avx2, "avx2,popcnt,bmi")
+STRING_SET_KERNELS(avx512, "avx512f,avx512bw,popcnt,bmi")
+
+
+#endif // CPU_X86_KERNELS
+
+
+size_t string_count_any(struct string const * string, struct string_char_set const * set)
+{
+    assert(string);
+    assert(set);
+
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return string_count_any_avx512(string->data, string->size, set);
+        case CPU_ISA_AVX2:
+            return string_count_any_avx2(string->data, string->size, set);
+#endif
+        default:
+            return string_count_any_scalar(string->data, string->size, set);
+    }
+}
+
+
+size_t string_view_split_any(struct string ** output, struct string const * to_split,
+                             struct string_char_set const * delimiters, bool collapse)
+{
+    assert(output);
+    assert(to_split);
+    assert(delimiters);
+
+    // Collapsing can only reduce the number of pieces so allocate for the worst case.
+    size_t output_size = 1 + string_count_any(to_split, delimiters);
+    *output = malloc(sizeof(struct string) * output_size);
+    if (*output == NULL)
+        return 0;
+
+    size_t start = 0;
+    size_t count = 0;
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            count = string_split_any_avx512(*output, to_split->data, to_split->size, &start, 0,
+                                            delimiters, collapse);
+            break;
+        case CPU_ISA_AVX2:
+            count = string_split_any_avx2(*output, to_split->data, to_split->size, &start, 0,
+                                          delimiters, collapse);
+            break;
+#endif
+        default:
+            count = string_split_any_scalar(*output, to_split->data, to_split->size, &start, 0,
+                                            delimiters, collapse);
+            break;
+    }
+
+    if (!collapse || start < to_split->size)
+    {
+        (*output)[count].data = to_split->data + start;
+        (*output)[count].size = to_split->size - start;
+        ++count;
+    }
+    return count;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Case
+////////////////////////////////////////////////////////////////////////////////
+
+
+// A byte is a letter of the case starting at `first`, either 'A' or 'a', if
+// `byte - first` is below 26 as an unsigned byte. The kernels only have
+// signed byte comparisons before AVX-512, so they add `0x80 - first`
+// instead, which moves the letters to the 26 smallest signed values, and
+// compare with a single `<`. Flipping bit 0x20 of a letter changes its case.
+
+
+// Flip the case of every byte of `[input, input + size)` that's a letter of
+// the case starting at `first` and store the result in `output`, which may
+// be the same as `input`.
+static void string_flip_case_scalar(char * output, char const * input, size_t size, char first)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        bool letter = (unsigned char)(input[i] - first) < 26;
+        output[i] = (char)(input[i] ^ (letter ? 0x20 : 0));
+    }
+}
+
+
+static bool string_is_equal_ignore_case_scalar(char const * data, char const * other, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        if (string_to_lower_char(data[i]) != string_to_lower_char(other[i]))
+            return false;
+    return true;
+}
+
+
+// Search the candidate positions `[from, end)` of `data` for `needle`, whose
+// letters are all lower case, ignoring case.
+static size_t string_find_ignore_case_scalar(char const * data, size_t from, size_t end,
+                                             char const * needle, size_t needle_size)
+{
+    char const first = needle[0];
+    char const last = needle[needle_size - 1];
+    for (size_t i = from; i < end; ++i)
+        if (string_to_lower_char(data[i]) == first &&
+            string_to_lower_char(data[i + needle_size - 1]) == last &&
+            string_is_equal_ignore_case_scalar(data + i, needle, needle_size))
+            return i;
+    return STRING_NPOS;
+}
+
+
+#ifdef CPU_X86_KERNELS
+
+
+// Each helper works on a 64-byte block, like the search helpers above. The
+// letter masks of `string_letters_` are all ones in bytes that are letters of
+// the case starting at `first`.
+
+
+static inline __attribute__((target("sse2"), always_inline)) __m128i
+string_letters_sse2(__m128i block, char first)
+{
+    __m128i shifted = _mm_add_epi8(block, _mm_set1_epi8((char)(0x80 - first)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(0x80 + 26)));
+}
+
+
+static inline __attribute__((target("sse2"), always_inline)) void
+string_flip_case_block_sse2(char * output, char const * input, char first)
+{
+    __m128i const flip = _mm_set1_epi8(0x20);
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i block = _mm_loadu_si128((__m128i const *)(input + 16 * i));
+        __m128i letters = string_letters_sse2(block, first);
+        block = _mm_xor_si128(block, _mm_and_si128(letters, flip));
+        _mm_storeu_si128((__m128i *)(output + 16 * i), block);
+    }
+}
+
+
+// Return a mask of the bytes of the blocks at `data` and `other` that are
+// equal ignoring case: either they're the same, or they only differ in bit
+// 0x20 and are letters.
+static inline __attribute__((target("sse2"), always_inline)) uint64_t
+string_equal_ignore_case_mask_sse2(char const * data, char const * other)
+{
+    __m128i const flip = _mm_set1_epi8(0x20);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i a = _mm_loadu_si128((__m128i const *)(data + 16 * i));
+        __m128i b = _mm_loadu_si128((__m128i const *)(other + 16 * i));
+        __m128i difference = _mm_xor_si128(a, b);
+        __m128i same = _mm_cmpeq_epi8(difference, _mm_setzero_si128());
+        __m128i folded = _mm_and_si128(_mm_cmpeq_epi8(difference, flip),
+                                       string_letters_sse2(_mm_or_si128(a, flip), 'a'));
+        uint16_t equal = (uint16_t)_mm_movemask_epi8(_mm_or_si128(same, folded));
+        mask |= (uint64_t)equal << (16 * i);
+    }
+    return mask;
+}
+
+
+// Return a mask of the bytes of the block at `data` that are equal to `c`
+// once `case_bit` is set in them. `case_bit` is 0x20 if `c` is a lower case
+// letter, which then matches both cases, and 0 otherwise.
+static inline __attribute__((target("sse2"), always_inline)) uint64_t
+string_match_mask_ignore_case_sse2(char const * data, char c, char case_bit)
+{
+    __m128i const needle = _mm_set1_epi8(c);
+    __m128i const bit = _mm_set1_epi8(case_bit);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i block = _mm_or_si128(_mm_loadu_si128((__m128i const *)(data + 16 * i)), bit);
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)) << (16 * i);
+    }
+    return mask;
+}
+
+
+static inline __attribute__((target("avx2"), always_inline)) __m256i
+string_letters_avx2(__m256i block, char first)
+{
+    __m256i shifted = _mm256_add_epi8(block, _mm256_set1_epi8((char)(0x80 - first)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 26)), shifted);
+}
+
+
+static inline __attribute__((target("avx2"), always_inline)) void
+string_flip_case_block_avx2(char * output, char const * input, char first)
+{
+    __m256i const flip = _mm256_set1_epi8(0x20);
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256i block = _mm256_loadu_si256((__m256i const *)(input + 32 * i));
+        __m256i letters = string_letters_avx2(block, first);
+        block = _mm256_xor_si256(block, _mm256_and_si256(letters, flip));
+        _mm256_storeu_si256((__m256i *)(output + 32 * i), block);
+    }
+}
+
+
+static inline __attribute__((target("avx2"), always_inline)) uint64_t
+string_equal_ignore_case_mask_avx2(char const * data, char const * other)
+{
+    __m256i const flip = _mm256_set1_epi8(0x20);
+    uint64_t mask = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256i a = _mm256_loadu_si256((__m256i const *)(data + 32 * i));
+        __m256i b = _mm256_loadu_si256((__m256i const *)(other + 32 * i));
+        __m256i difference = _mm256_xor_si256(a, b);
+        __m256i same = _mm256_cmpeq_epi8(difference, _mm256_setzero_si256());
+        __m256i folded = _mm256_and_si256(_mm256_cmpeq_epi8(difference, flip),
+                                          string_letters_avx2(_mm256_or_si256(a, flip), 'a'));
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(same, folded));
+        mask |= (uint64_t)equal << (32 * i);
+    }
+    return mask;
+}
+
+
+static inline __attribute__((target("avx2"), always_inline)) uint64_t
+string_match_mask_ignore_case_avx2(char const * data, char c, char case_bit)
+{
+    __m256i const needle = _mm256_set1_epi8(c);
+    __m256i const bit = _mm256_set1_epi8(case_bit);
+    __m256i lo = _mm256_or_si256(_mm256_loadu_si256((__m256i const *)data), bit);
+    __m256i hi = _mm256_or_si256(_mm256_loadu_si256((__m256i const *)(data + 32)), bit);
+    uint64_t lo_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle));
+    uint64_t hi_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle));
+    return lo_mask | (hi_mask << 32);
+}
+
+
+// AVX-512 has unsigned byte comparisons into mask registers, so the letters
+// are found with a subtraction and a single unsigned `<`.
+static inline __attribute__((target("avx512f,avx512bw"), always_inline)) __mmask64
+string_letters_avx512(__m512i block, char first)
+{
+    __m512i shifted = _mm512_sub_epi8(block, _mm512_set1_epi8(first));
+    return _mm512_cmplt_epu8_mask(shifted, _mm512_set1_epi8(26));
+}
+
+
+static inline __attribute__((target("avx512f,avx512bw"), always_inline)) void
+string_flip_case_block_avx512(char * output, char const * input, char first)
+{
+    __m512i block = _mm512_loadu_si512((void const *)input);
+    __mmask64 letters = string_letters_avx512(block, first);
+    block = _mm512_mask_blend_epi8(letters, block, _mm512_xor_si512(block, _mm512_set1_epi8(0x20)));
+    _mm512_storeu_si512((void *)output, block);
+}
+
+
+static inline __attribute__((target("avx512f,avx512bw"), always_inline)) uint64_t
+string_equal_ignore_case_mask_avx512(char const * data, char const * other)
+{
+    __m512i const flip = _mm512_set1_epi8(0x20);
+    __m512i a = _mm512_loadu_si512((void const *)data);
+    __m512i b = _mm512_loadu_si512((void const *)other);
+    __m512i difference = _mm512_xor_si512(a, b);
+    __mmask64 same = _mm512_cmpeq_epi8_mask(difference, _mm512_setzero_si512());
+    __mmask64 folded = _mm512_cmpeq_epi8_mask(difference, flip) &
+                       string_letters_avx512(_mm512_or_si512(a, flip), 'a');
+    return same | folded;
+}
+
+
+static inline __attribute__((target("avx512f,avx512bw"), always_inline)) uint64_t
+string_match_mask_ignore_case_avx512(char const * data, char c, char case_bit)
+{
+    __m512i block = _mm512_or_si512(_mm512_loadu_si512((void const *)data),
+                                    _mm512_set1_epi8(case_bit));
+    return _mm512_cmpeq_epi8_mask(block, _mm512_set1_epi8(c));
+}
+
+
+/// @cond Doxygen_Suppress
+#define STRING_CASE_KERNELS(isa, target_isa)                                                       \
+    static __attribute__((target(target_isa))) void string_flip_case_##isa(                       \
+        char * output, char const * input, size_t size, char first)                                \
+    {                                                                                              \
+        size_t i = 0;                                                                              \
+        for (; i + 64 <= size; i += 64)                                                            \
+            string_flip_case_block_##isa(output + i, input + i, first);                            \
+        string_flip_case_scalar(output + i, input + i, size - i, first);                           \
+    }                                                                                              \
+                                                                                                   \
+    static __attribute__((target(target_isa))) bool string_is_equal_ignore_case_##isa(             \
+        char const * data, char const * other, size_t size)                                        \
+    {                                                                                              \
+        size_t i = 0;                                                                              \
+        for (; i + 64 <= size; i += 64)                                                            \
+            if (string_equal_ignore_case_mask_##isa(data + i, other + i) != UINT64_MAX)            \
+                return false;                                                                      \
+        return string_is_equal_ignore_case_scalar(data + i, other + i, size - i);                  \
+    }                                                                                              \
+                                                                                                   \
+    static __attribute__((target(target_isa))) size_t string_find_ignore_case_##isa(              \
+        char const * data, size_t end, char const * needle, size_t needle_size)                    \
+    {                                                                                              \
+        char const first = needle[0];                                                              \
+        char const last = needle[needle_size - 1];                                                 \
+        char const first_bit = (first >= 'a' && first <= 'z') ? 0x20 : 0;                          \
+        char const last_bit = (last >= 'a' && last <= 'z') ? 0x20 : 0;                             \
+        size_t i = 0;                                                                              \
+        for (; i + 64 <= end; i += 64)                                                             \
+        {                                                                                          \
+            uint64_t mask =                                                                        \
+                string_match_mask_ignore_case_##isa(data + i, first, first_bit) &                  \
+                string_match_mask_ignore_case_##isa(data + i + needle_size - 1, last, last_bit);   \
+            for (; mask != 0; mask &= mask - 1)                                                    \
+            {                                                                                      \
+                size_t candidate = i + (size_t)__builtin_ctzll(mask);                              \
+                if (string_is_equal_ignore_case_scalar(data + candidate, needle, needle_size))     \
+                    return candidate;                                                              \
+            }                                                                                      \
+        }                                                                                          \
+        return string_find_ignore_case_scalar(data, i, end, needle, needle_size);                  \
+    }
+//! @endcond
+
+
+STRING_CASE_KERNELS(sse2, "sse2")
+STRING_CASE_KERNELS(avx2, "avx2,bmi")
+STRING_CASE_KERNELS(avx512, "avx512f,avx512bw,bmi")
+
+
+#endif // CPU_X86_KERNELS
+
+
+static void string_flip_case(char * output, char const * input, size_t size, char first)
+{
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            string_flip_case_avx512(output, input, size, first);
+            break;
+        case CPU_ISA_AVX2:
+            string_flip_case_avx2(output, input, size, first);
+            break;
+        case CPU_ISA_SSE2:
+            string_flip_case_sse2(output, input, size, first);
+            break;
+#endif
+        default:
+            string_flip_case_scalar(output, input, size, first);
+            break;
+    }
+}
+
+
+void string_to_lower(struct string * string)
+{
+    assert(string);
+
+    string_flip_case(string->data, string->data, string->size, 'A');
+}
+
+
+void string_to_upper(struct string * string)
+{
+    assert(string);
+
+    string_flip_case(string->data, string->data, string->size, 'a');
+}
+
+
+void string_copy_lower(struct string * string, struct string const * to_copy)
+{
+    assert(string);
+    assert(to_copy);
+
+    string_make(string, to_copy->size);
+    string_flip_case(string->data, to_copy->data, string->size, 'A');
+}
+
+
+void string_copy_upper(struct string * string, struct string const * to_copy)
+{
+    assert(string);
+    assert(to_copy);
+
+    string_make(string, to_copy->size);
+    string_flip_case(string->data, to_copy->data, string->size, 'a');
+}
+
+
+// Return true if the `size` bytes at `data` and `other` are equal ignoring case.
+static bool string_is_equal_ignore_case_bytes(char const * data, char const * other, size_t size)
+{
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return string_is_equal_ignore_case_avx512(data, other, size);
+        case CPU_ISA_AVX2:
+            return string_is_equal_ignore_case_avx2(data, other, size);
+        case CPU_ISA_SSE2:
+            return string_is_equal_ignore_case_sse2(data, other, size);
+#endif
+        default:
+            return string_is_equal_ignore_case_scalar(data, other, size);
+    }
+}
+
+
+bool string_is_equal_ignore_case(struct string const * string, struct string const * other)
+{
+    assert(string);
+    assert(other);
+
+    return string->size == other->size &&
+           string_is_equal_ignore_case_bytes(string->data, other->data, string->size);
+}
+
+
+bool string_starts_with_ignore_case(struct string const * string, struct string const * prefix)
+{
+    assert(string);
+    assert(prefix);
+
+    return prefix->size <= string->size &&
+           string_is_equal_ignore_case_bytes(string->data, prefix->data, prefix->size);
+}
+
+
+size_t string_find_ignore_case(struct string const * haystack, struct string const * needle)
+{
+    assert(haystack);
+    assert(needle);
+
+    if (needle->size == 0)
+        return 0;
+    if (needle->size > haystack->size)
+        return STRING_NPOS;
+
+    if (needle->size > STRING_FIND_SHORT_NEEDLE)
+    {
+        struct string_twoway_text const h = {haystack->data, haystack->size, false, true};
+        struct string_twoway_text const n = {needle->data, needle->size, false, true};
+        return string_twoway(&h, &n);
+    }
+
+    // The kernels compare against the needle in lower case.
+    char lower[STRING_FIND_SHORT_NEEDLE];
+    string_flip_case_scalar(lower, needle->data, needle->size, 'A');
+
+    size_t const end = haystack->size - needle->size + 1;
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return string_find_ignore_case_avx512(haystack->data, end, lower, needle->size);
+        case CPU_ISA_AVX2:
+            return string_find_ignore_case_avx2(haystack->data, end, lower, needle->size);
+        case CPU_ISA_SSE2:
+            return string_find_ignore_case_sse2(haystack->data, end, lower, needle->size);
+#endif
+        default:
+            return string_find_ignore_case_scalar(haystack->data, 0, end, lower, needle->size);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorting
+////////////////////////////////////////////////////////////////////////////////
+
+
+// Ranges of fewer strings than this are sorted by comparison rather than by
+// another radix pass, which would spend more on its 257 counters than on the
+// strings.
+#define STRING_SORT_SMALL 64
+
+// Multikey quicksort hands ranges of fewer strings than this to insertion sort.
+#define STRING_SORT_INSERTION 12
+
+// Each thread of string_sort_parallel() is given at least this many strings.
+#define STRING_SORT_PARALLEL_MIN_COUNT ((size_t)1 << 16)
+
+// One bucket for the strings that end before the byte, then one per byte value.
+#define STRING_SORT_BUCKETS 257
+
+
+// A range of strings that still needs a radix pass.
+struct string_sort_job
+{
+    size_t begin;
+    size_t count;
+    size_t depth; // The number of leading bytes the strings of the range share.
+};
+
+
+// The state of a sort on one thread.
+struct string_sort
+{
+    struct string * strings;
+    struct string * buffer;        // Where stable passes distribute strings, or NULL.
+    uint16_t * keys;               // The bucket of each string in the current pass.
+    struct string_sort_job * jobs; // Room for a job per STRING_SORT_SMALL strings.
+    size_t job_count;
+    bool stable;
+};
+
+
+// Return the bucket of `string` in a pass at `depth`.
+static inline uint16_t string_sort_key(struct string const * string, size_t depth)
+{
+    return (depth < string->size) ? (uint16_t)((unsigned char)string->data[depth] + 1) : 0;
+}
+
+
+// Compare `string` and `other`, which share their first `depth` bytes.
+static inline int string_compare_from(struct string const * string, struct string const * other,
+                                      size_t depth)
+{
+    struct string const rest = {string->data + depth, string->size - depth};
+    struct string const other_rest = {other->data + depth, other->size - depth};
+    return string_compare(&rest, &other_rest);
+}
+
+
+static void string_sort_insertion(struct string * strings, size_t count, size_t depth)
+{
+    for (size_t i = 1; i < count; ++i)
+    {
+        struct string const value = strings[i];
+        size_t j = i;
+        for (; j > 0 && string_compare_from(strings + j - 1, &value, depth) > 0; --j)
+            strings[j] = strings[j - 1];
+        strings[j] = value;
+    }
+}
+
+
+static inline void string_sort_swap(struct string * strings, size_t i, size_t j)
+{
+    struct string const swap = strings[i];
+    strings[i] = strings[j];
+    strings[j] = swap;
+}
+
+
+// Sort strings that share their first `depth` bytes by multikey quicksort:
+// partition them three ways about the median of three of their bytes at
+// `depth`, sort the smaller and larger parts at the same depth, and the
+// equal part from the next byte.
+static void string_sort_multikey(struct string * strings, size_t count, size_t depth)
+{
+    while (count >= STRING_SORT_INSERTION)
+    {
+        uint16_t a = string_sort_key(strings, depth);
+        uint16_t b = string_sort_key(strings + count / 2, depth);
+        uint16_t c = string_sort_key(strings + count - 1, depth);
+        uint16_t pivot = (a < b) ? ((b < c) ? b : (a < c) ? c : a)
+                                 : ((a < c) ? a : (b < c) ? c : b);
+
+        size_t less = 0;
+        size_t greater = count;
+        for (size_t i = 0; i < greater;)
+        {
+            uint16_t key = string_sort_key(strings + i, depth);
+            if (key < pivot)
+                string_sort_swap(strings, less++, i++);
+            else if (key > pivot)
+                string_sort_swap(strings, i, --greater);
+            else
+                ++i;
+        }
+
+        string_sort_multikey(strings, less, depth);
+        string_sort_multikey(strings + greater, count - greater, depth);
+        if (pivot == 0)
+            return;
+        strings += less;
+        count = greater - less;
+        ++depth;
+    }
+    string_sort_insertion(strings, count, depth);
+}
+
+
+// Return how many leading bytes `[strings, strings + count)` share, given
+// they share at least `depth`.
+static size_t string_sort_common_prefix(struct string const * strings, size_t count, size_t depth)
+{
+    size_t common = strings[0].size;
+    for (size_t i = 1; i < count && common > depth; ++i)
+    {
+        size_t limit = (strings[i].size < common) ? strings[i].size : common;
+        size_t j = depth;
+        while (j < limit && strings[i].data[j] == strings[0].data[j])
+            ++j;
+        common = j;
+    }
+    return common;
+}
+
+
+// Sort the range of `job` by its byte at the job's depth, sorting the small
+// buckets straight away and pushing the others as jobs.
+static void string_sort_pass(struct string_sort * sort, struct string_sort_job job)
+{
+    struct string * strings = sort->strings + job.begin;
+    uint16_t * keys = sort->keys + job.begin;
+    size_t counts[STRING_SORT_BUCKETS];
+    while (true)
+    {
+        memset(counts, 0, sizeof(counts));
+        for (size_t i = 0; i < job.count; ++i)
+        {
+            keys[i] = string_sort_key(strings + i, job.depth);
+            ++counts[keys[i]];
+        }
+        if (counts[keys[0]] < job.count)
+            break;
+
+        // Every string is in one bucket, so skip the rest of their common
+        // prefix rather than making a pass per byte of it.
+        if (keys[0] == 0)
+            return;
+        job.depth = string_sort_common_prefix(strings, job.count, job.depth + 1);
+    }
+
+    size_t next[STRING_SORT_BUCKETS];
+    size_t offset = 0;
+    for (size_t b = 0; b < STRING_SORT_BUCKETS; ++b)
+    {
+        next[b] = offset;
+        offset += counts[b];
+    }
+
+    if (sort->stable)
+    {
+        struct string * buffer = sort->buffer + job.begin;
+        for (size_t i = 0; i < job.count; ++i)
+            buffer[next[keys[i]]++] = strings[i];
+        memcpy(strings, buffer, job.count * sizeof(*strings));
+    }
+    else
+    {
+        // Permute the strings in place by following cycles: take the first
+        // misplaced string of each bucket and swap it into the next free slot
+        // of its own bucket until a string of this bucket comes back.
+        size_t end = 0;
+        for (size_t b = 0; b < STRING_SORT_BUCKETS; ++b)
+        {
+            end += counts[b];
+            while (next[b] < end)
+            {
+                struct string value = strings[next[b]];
+                uint16_t key = keys[next[b]];
+                while (key != b)
+                {
+                    size_t const slot = next[key]++;
+                    struct string const swap = strings[slot];
+                    uint16_t const swap_key = keys[slot];
+                    strings[slot] = value;
+                    keys[slot] = key;
+                    value = swap;
+                    key = swap_key;
+                }
+                strings[next[b]++] = value;
+            }
+        }
+    }
+
+    // The strings of bucket 0 all end here, so they're already in order.
+    offset = counts[0];
+    for (size_t b = 1; b < STRING_SORT_BUCKETS; ++b)
+    {
+        if (counts[b] >= STRING_SORT_SMALL)
+            sort->jobs[sort->job_count++] =
+                (struct string_sort_job){job.begin + offset, counts[b], job.depth + 1};
+        else if (sort->stable)
+            string_sort_insertion(strings + offset, counts[b], job.depth + 1);
+        else
+            string_sort_multikey(strings + offset, counts[b], job.depth + 1);
+        offset += counts[b];
+    }
+}
+
+
+// Sort `[begin, begin + count)` of the strings, which share their first `depth` bytes.
+static void string_sort_range(struct string_sort * sort, size_t begin, size_t count, size_t depth)
+{
+    if (count < STRING_SORT_SMALL)
+    {
+        if (sort->stable)
+            string_sort_insertion(sort->strings + begin, count, depth);
+        else
+            string_sort_multikey(sort->strings + begin, count, depth);
+        return;
+    }
+
+    sort->jobs[sort->job_count++] = (struct string_sort_job){begin, count, depth};
+    while (sort->job_count > 0)
+    {
+        --sort->job_count;
+        string_sort_pass(sort, sort->jobs[sort->job_count]);
+    }
+}
+
+
+bool string_sort(struct string * strings, size_t count, bool stable)
+{
+    assert(strings || count == 0);
+
+    struct string_sort sort = {strings, NULL, NULL, NULL, 0, stable};
+    if (count < STRING_SORT_SMALL)
+    {
+        string_sort_range(&sort, 0, count, 0);
+        return true;
+    }
+
+    sort.keys = malloc(count * sizeof(*sort.keys));
+    sort.jobs = malloc((count / STRING_SORT_SMALL) * sizeof(*sort.jobs));
+    sort.buffer = stable ? malloc(count * sizeof(*sort.buffer)) : NULL;
+    bool const allocated = sort.keys != NULL && sort.jobs != NULL && (!stable || sort.buffer);
+    if (allocated)
+        string_sort_range(&sort, 0, count, 0);
+
+    free(sort.buffer);
+    free(sort.jobs);
+    free(sort.keys);
+    return allocated;
+}
+
+
+// The part of a parallel sort done by one thread: first a slice of the
+// strings to count and distribute, then a run of buckets to sort.
+struct string_sort_part
+{
+    struct string_sort sort;
+    size_t begin;                       // The slice of the strings.
+    size_t end;
+    size_t next[STRING_SORT_BUCKETS];   // The slice's count of each bucket, then where its
+                                        // next string of each bucket is distributed to.
+    size_t first_bucket;                // The run of buckets.
+    size_t last_bucket;
+    size_t const * bucket_offsets;      // Where each bucket starts, and where the last ends.
+    bool started;                       // `true` if `thread` is running this part.
+    thrd_t thread;
+};
+
+
+static int string_sort_part_count(void * part_pointer)
+{
+    struct string_sort_part * part = part_pointer;
+    for (size_t i = part->begin; i < part->end; ++i)
+    {
+        part->sort.keys[i] = string_sort_key(part->sort.strings + i, 0);
+        ++part->next[part->sort.keys[i]];
+    }
+    return 0;
+}
+
+
+static int string_sort_part_distribute(void * part_pointer)
+{
+    struct string_sort_part * part = part_pointer;
+    for (size_t i = part->begin; i < part->end; ++i)
+        part->sort.buffer[part->next[part->sort.keys[i]]++] = part->sort.strings[i];
+    return 0;
+}
+
+
+static int string_sort_part_sort(void * part_pointer)
+{
+    struct string_sort_part * part = part_pointer;
+    size_t const * offsets = part->bucket_offsets;
+    size_t const begin = offsets[part->first_bucket];
+    size_t const end = offsets[part->last_bucket];
+    memcpy(part->sort.strings + begin, part->sort.buffer + begin,
+           (end - begin) * sizeof(*part->sort.strings));
+
+    for (size_t b = (part->first_bucket > 0) ? part->first_bucket : 1; b < part->last_bucket; ++b)
+        string_sort_range(&part->sort, offsets[b], offsets[b + 1] - offsets[b], 1);
+    return 0;
+}
+
+
+// Run `function` on every part: the first on the calling thread and each of
+// the others on a new thread, or on the calling thread if one can't be started.
+static void string_sort_parts_run(struct string_sort_part * parts, size_t count,
+                                  thrd_start_t function)
+{
+    for (size_t i = 1; i < count; ++i)
+        parts[i].started = thrd_create(&parts[i].thread, function, parts + i) == thrd_success;
+
+    function(parts);
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (parts[i].started)
+            thrd_join(parts[i].thread, NULL);
+        else
+            function(parts + i);
+    }
+}
+
+
+bool string_sort_parallel(struct string * strings, size_t count, bool stable,
+                          size_t thread_count)
+{
+    assert(strings || count == 0);
+    assert(thread_count >= 1);
+
+    size_t part_count = count / STRING_SORT_PARALLEL_MIN_COUNT;
+    if (part_count > thread_count)
+        part_count = thread_count;
+    if (part_count < 2)
+        return string_sort(strings, count, stable);
+
+    // Every part distributes through the buffer, so it's needed even when
+    // the later passes aren't stable. A part's jobs cover at most the
+    // strings of its buckets, so the parts share one job stack between them.
+    struct string_sort_part * parts = calloc(part_count, sizeof(*parts));
+    uint16_t * keys = malloc(count * sizeof(*keys));
+    struct string * buffer = malloc(count * sizeof(*buffer));
+    struct string_sort_job * jobs =
+        malloc((count / STRING_SORT_SMALL + part_count) * sizeof(*jobs));
+    if (parts == NULL || keys == NULL || buffer == NULL || jobs == NULL)
+    {
+        free(jobs);
+        free(buffer);
+        free(keys);
+        free(parts);
+        return false;
+    }
+
+    for (size_t i = 0; i < part_count; ++i)
+    {
+        parts[i].sort = (struct string_sort){strings, buffer, keys, NULL, 0, stable};
+        parts[i].begin = count * i / part_count;
+        parts[i].end = count * (i + 1) / part_count;
+    }
+    string_sort_parts_run(parts, part_count, string_sort_part_count);
+
+    // Lay the buckets out in order, with each part's strings in a bucket
+    // after those of the parts before it.
+    size_t offsets[STRING_SORT_BUCKETS + 1];
+    size_t offset = 0;
+    for (size_t b = 0; b < STRING_SORT_BUCKETS; ++b)
+    {
+        offsets[b] = offset;
+        for (size_t i = 0; i < part_count; ++i)
+        {
+            size_t const bucket_count = parts[i].next[b];
+            parts[i].next[b] = offset;
+            offset += bucket_count;
+        }
+    }
+    offsets[STRING_SORT_BUCKETS] = count;
+    string_sort_parts_run(parts, part_count, string_sort_part_distribute);
+
+    // Deal out runs of buckets, ending each run with the first bucket that
+    // starts past its share of the strings. A bucket is never split, so a
+    // large one can leave the parts after it with fewer strings, or none.
+    size_t bucket = 0;
+    size_t job_offset = 0;
+    for (size_t i = 0; i < part_count; ++i)
+    {
+        size_t const target = count * (i + 1) / part_count;
+        parts[i].first_bucket = bucket;
+        while (bucket < STRING_SORT_BUCKETS && offsets[bucket] < target)
+            ++bucket;
+        parts[i].last_bucket = bucket;
+        parts[i].bucket_offsets = offsets;
+        parts[i].sort.jobs = jobs + job_offset;
+        job_offset += (offsets[bucket] - offsets[parts[i].first_bucket]) / STRING_SORT_SMALL + 1;
+    }
+    string_sort_parts_run(parts, part_count, string_sort_part_sort);
+
+    free(jobs);
+    free(buffer);
+    free(keys);
+    free(parts);
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Small strings
+////////////////////////////////////////////////////////////////////////////////
+
+
+void sso_string_make(struct sso_string * string, size_t size)
+{
+    assert(string);
+
+    if (size <= SSO_STRING_CAPACITY)
+    {
+        string->string.data = string->buffer;
+        string->string.size = size;
+        return;
+    }
+
+    string_make(&string->string, size);
+    if (string->string.data == NULL)
+        string->string.data = string->buffer;
+}
+
+
+void sso_string_copy(struct sso_string * string, struct string const * to_copy)
+{
+    assert(string);
+    assert(to_copy);
+
+    sso_string_make(string, to_copy->size);
+    if (string->string.size > 0)
+        memcpy(string->string.data, to_copy->data, string->string.size);
+}
+
+
+void sso_string_copy_cstr(struct sso_string * string, char const * to_copy)
+{
+    assert(string);
+    assert(to_copy);
+
+    struct string const view = {(char *)to_copy, strlen(to_copy)};
+    sso_string_copy(string, &view);
+}
+
+
+void sso_string_copy_slice(struct sso_string * string, struct string const * to_slice,
+                           size_t from, size_t to)
+{
+    assert(string);
+    assert(to_slice);
+    assert(to_slice->size >= to);
+    assert(from <= to);
+
+    struct string const view = {to_slice->data + from, to - from};
+    sso_string_copy(string, &view);
+}
+
+
+void sso_string_join_array(struct sso_string * result, struct string const * strings,
+                           size_t count)
+{
+    assert(result);
+    assert(strings || count == 0);
+
+    size_t total_size = 0;
+    for (size_t i = 0; i < count; ++i)
+        total_size += strings[i].size;
+
+    sso_string_make(result, total_size);
+    if (result->string.size != total_size)
+        return;
+
+    char * out = result->string.data;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (strings[i].size > 0)
+            memcpy(out, strings[i].data, strings[i].size);
+        out += strings[i].size;
+    }
+}
+
+
+void sso_string_move(struct sso_string * string, struct sso_string * to_move)
+{
+    assert(string);
+    assert(to_move);
+
+    if (string == to_move)
+        return;
+
+    sso_string_free(string);
+    if (sso_string_is_inline(to_move))
+        sso_string_copy(string, &to_move->string);
+    else
+        string->string = to_move->string;
+
+    to_move->string.data = to_move->buffer;
+    to_move->string.size = 0;
+}
+
+
+void sso_string_free(struct sso_string * string)
+{
+    assert(string);
+
+    if (!sso_string_is_inline(string))
+        free(string->string.data);
+
+    string->string.data = string->buffer;
+    string->string.size = 0;
+}
+
+
+bool sso_string_is_inline(struct sso_string const * string)
+{
+    assert(string);
+
+    return string->string.data == string->buffer;
+}
+
+
+bool sso_string_is_equal(struct sso_string const * string, struct sso_string const * other)
+{
+    assert(string);
+    assert(other);
+
+    return string_is_equal(&string->string, &other->string);
 }
@@ -0,0 +1,462 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/string.h"
+#include "util/utf8.h"
+
+#ifdef CPU_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Scalar decoding
+////////////////////////////////////////////////////////////////////////////////
+
+
+// Return the size of the valid sequence at the start of `data`, which has
+// `size` bytes, or 0 if it isn't valid. See table 3-7 of the Unicode standard.
+static inline size_t utf8_sequence_size(unsigned char const * data, size_t size)
+{
+    unsigned char const lead = data[0];
+    if (lead < 0x80)
+        return 1;
+
+    size_t length;
+    unsigned char min = 0x80;
+    unsigned char max = 0xBF;
+    if (lead < 0xC2)
+        return 0;
+    else if (lead < 0xE0)
+        length = 2;
+    else if (lead < 0xF0)
+    {
+        length = 3;
+        min = (lead == 0xE0) ? 0xA0 : min; // Overlong.
+        max = (lead == 0xED) ? 0x9F : max; // Surrogates.
+    }
+    else if (lead < 0xF5)
+    {
+        length = 4;
+        min = (lead == 0xF0) ? 0x90 : min; // Overlong.
+        max = (lead == 0xF4) ? 0x8F : max; // Above U+10FFFF.
+    }
+    else
+        return 0;
+
+    if (length > size || data[1] < min || data[1] > max)
+        return 0;
+    for (size_t i = 2; i < length; ++i)
+        if ((data[i] & 0xC0) != 0x80)
+            return 0;
+    return length;
+}
+
+
+static bool utf8_is_valid_scalar(char const * data, size_t size)
+{
+    unsigned char const * bytes = (unsigned char const *)data;
+    size_t i = 0;
+    while (i < size)
+    {
+        // Skip ASCII a word at a time.
+        if (i + 8 <= size)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i, sizeof(word));
+            if ((word & 0x8080808080808080u) == 0)
+            {
+                i += 8;
+                continue;
+            }
+        }
+
+        size_t length = utf8_sequence_size(bytes + i, size - i);
+        if (length == 0)
+            return false;
+        i += length;
+    }
+    return true;
+}
+
+
+static inline bool utf8_is_continuation(char c)
+{
+    return ((unsigned char)c & 0xC0) == 0x80;
+}
+
+
+static size_t utf8_count_codepoints_scalar(char const * data, size_t size)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i)
+        count += !utf8_is_continuation(data[i]);
+    return count;
+}
+
+
+#ifdef CPU_X86_KERNELS
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Vector kernels
+////////////////////////////////////////////////////////////////////////////////
+
+
+static __attribute__((target("sse2"))) bool utf8_is_valid_sse2(char const * data, size_t size)
+{
+    unsigned char const * bytes = (unsigned char const *)data;
+    size_t i = 0;
+    while (i < size)
+    {
+        if (i + 16 <= size &&
+            _mm_movemask_epi8(_mm_loadu_si128((__m128i const *)(bytes + i))) == 0)
+        {
+            i += 16;
+            continue;
+        }
+
+        size_t length = utf8_sequence_size(bytes + i, size - i);
+        if (length == 0)
+            return false;
+        i += length;
+    }
+    return true;
+}
+
+
+// The errors that the pair of bytes (byte 1, byte 2) can show. Each table is
+// indexed by one nibble of the pair and an error is present if its bit is set
+// in all three, following Keiser and Lemire, "Validating UTF-8 In Less Than
+// One Instruction Per Byte" (2021).
+#define UTF8_TOO_SHORT (1 << 0)      // 11______ 0_______ or 11______ 11______
+#define UTF8_TOO_LONG (1 << 1)       // 0_______ 10______
+#define UTF8_OVERLONG_3 (1 << 2)     // 11100000 100_____
+#define UTF8_TOO_LARGE (1 << 3)      // 11110100 1001____ and above
+#define UTF8_SURROGATE (1 << 4)      // 11101101 101_____
+#define UTF8_OVERLONG_2 (1 << 5)     // 1100000_ 10______
+#define UTF8_TOO_LARGE_1000 (1 << 6) // 11110101 1000____ and above
+#define UTF8_OVERLONG_4 (1 << 6)     // 11110000 1000____
+#define UTF8_TWO_CONTS (1 << 7)      // 10______ 10______
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+
+static unsigned char const utf8_byte_1_high[16] = {
+    // 0_______: ASCII.
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG,
+    // 10______: continuation.
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    // 1100____, 1101____: two byte lead.
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2, UTF8_TOO_SHORT,
+    // 1110____: three byte lead.
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    // 1111____: four byte lead.
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4};
+
+
+static unsigned char const utf8_byte_1_low[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4, // ____0000
+    UTF8_CARRY | UTF8_OVERLONG_2,                                     // ____0001
+    UTF8_CARRY,                                                       // ____0010
+    UTF8_CARRY,                                                       // ____0011
+    UTF8_CARRY | UTF8_TOO_LARGE,                                      // ____0100
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____0101
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____0110
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____0111
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____1000
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____1001
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____1010
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____1011
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____1100
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE, // ____1101
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____1110
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                // ____1111
+};
+
+
+static unsigned char const utf8_byte_2_high[16] = {
+    // ________ 0_______: ASCII.
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    // ________ 1000____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 |
+        UTF8_OVERLONG_4,
+    // ________ 1001____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+    // ________ 101_____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    // ________ 11______: lead.
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT};
+
+
+// Subtracting the last 32 or 64 of these from a block with saturation
+// leaves a non-zero byte where one of its last three bytes starts a sequence
+// that's too long to end inside the block.
+static unsigned char const utf8_max_value[64] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+
+
+/// @cond Doxygen_Suppress
+// The bytes of `input` shifted along by `n`, with the last `n` bytes of `previous` first.
+#define UTF8_PREV_AVX2(input, previous, n)                                                         \
+    _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - (n))
+
+#define UTF8_PREV_AVX512(input, previous, n)                                                       \
+    _mm512_alignr_epi8(input,                                                                      \
+                       _mm512_permutex2var_epi32(input,                                            \
+                                                 _mm512_setr_epi32(28, 29, 30, 31, 0, 1, 2, 3, 4,  \
+                                                                   5, 6, 7, 8, 9, 10, 11),         \
+                                                 previous),                                        \
+                       16 - (n))
+//! @endcond
+
+
+// Return the errors in the 32 bytes of `input`, where `previous` is the block before it.
+static inline __attribute__((target("avx2"), always_inline)) __m256i
+utf8_block_errors_avx2(__m256i input, __m256i previous)
+{
+    __m256i const nibble = _mm256_set1_epi8(0x0F);
+    __m256i const byte_1_high =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)utf8_byte_1_high));
+    __m256i const byte_1_low =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)utf8_byte_1_low));
+    __m256i const byte_2_high =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const *)utf8_byte_2_high));
+
+    __m256i prev1 = UTF8_PREV_AVX2(input, previous, 1);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+            _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+        _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+    // A byte two after a three or four byte lead, or three after a four byte
+    // lead, must be a continuation; these are the only valid TWO_CONTS.
+    __m256i third = _mm256_subs_epu8(UTF8_PREV_AVX2(input, previous, 2),
+                                     _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(UTF8_PREV_AVX2(input, previous, 3),
+                                      _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must_continue =
+        _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must_continue, special);
+}
+
+
+static __attribute__((target("avx2"))) bool utf8_is_valid_avx2(char const * data, size_t size)
+{
+    __m256i const max_value = _mm256_loadu_si256((__m256i const *)(utf8_max_value + 32));
+    __m256i errors = _mm256_setzero_si256();
+    __m256i previous = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+
+    // The tail is padded with zeros, which are ASCII, so a truncated final
+    // sequence shows up as TOO_SHORT.
+    for (size_t i = 0; i < size; i += 32)
+    {
+        __m256i input;
+        if (i + 32 <= size)
+            input = _mm256_loadu_si256((__m256i const *)(data + i));
+        else
+        {
+            char tail[32] = {0};
+            memcpy(tail, data + i, size - i);
+            input = _mm256_loadu_si256((__m256i const *)tail);
+        }
+
+        if (_mm256_movemask_epi8(input) == 0)
+        {
+            errors = _mm256_or_si256(errors, incomplete);
+            incomplete = _mm256_setzero_si256();
+        }
+        else
+        {
+            errors = _mm256_or_si256(errors, utf8_block_errors_avx2(input, previous));
+            incomplete = _mm256_subs_epu8(input, max_value);
+        }
+        previous = input;
+    }
+
+    errors = _mm256_or_si256(errors, incomplete);
+    return _mm256_testz_si256(errors, errors);
+}
+
+
+static inline __attribute__((target("avx512f,avx512bw"), always_inline)) __m512i
+utf8_block_errors_avx512(__m512i input, __m512i previous)
+{
+    __m512i const nibble = _mm512_set1_epi8(0x0F);
+    __m512i const byte_1_high =
+        _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i const *)utf8_byte_1_high));
+    __m512i const byte_1_low =
+        _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i const *)utf8_byte_1_low));
+    __m512i const byte_2_high =
+        _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i const *)utf8_byte_2_high));
+
+    __m512i prev1 = UTF8_PREV_AVX512(input, previous, 1);
+    __m512i special = _mm512_and_si512(
+        _mm512_and_si512(
+            _mm512_shuffle_epi8(byte_1_high, _mm512_and_si512(_mm512_srli_epi16(prev1, 4), nibble)),
+            _mm512_shuffle_epi8(byte_1_low, _mm512_and_si512(prev1, nibble))),
+        _mm512_shuffle_epi8(byte_2_high, _mm512_and_si512(_mm512_srli_epi16(input, 4), nibble)));
+
+    __m512i third = _mm512_subs_epu8(UTF8_PREV_AVX512(input, previous, 2),
+                                     _mm512_set1_epi8((char)(0xE0 - 0x80)));
+    __m512i fourth = _mm512_subs_epu8(UTF8_PREV_AVX512(input, previous, 3),
+                                      _mm512_set1_epi8((char)(0xF0 - 0x80)));
+    __m512i must_continue =
+        _mm512_and_si512(_mm512_or_si512(third, fourth), _mm512_set1_epi8((char)0x80));
+    return _mm512_xor_si512(must_continue, special);
+}
+
+
+static __attribute__((target("avx512f,avx512bw"))) bool utf8_is_valid_avx512(char const * data,
+                                                                              size_t size)
+{
+    __m512i const max_value = _mm512_loadu_si512((void const *)utf8_max_value);
+    __m512i errors = _mm512_setzero_si512();
+    __m512i previous = _mm512_setzero_si512();
+    __m512i incomplete = _mm512_setzero_si512();
+
+    for (size_t i = 0; i < size; i += 64)
+    {
+        // Masked loads read zeros past the end without touching the memory.
+        __mmask64 mask = (i + 64 <= size) ? ~(__mmask64)0 : ((__mmask64)1 << (size - i)) - 1;
+        __m512i input = _mm512_maskz_loadu_epi8(mask, data + i);
+
+        if (_mm512_movepi8_mask(input) == 0)
+        {
+            errors = _mm512_or_si512(errors, incomplete);
+            incomplete = _mm512_setzero_si512();
+        }
+        else
+        {
+            errors = _mm512_or_si512(errors, utf8_block_errors_avx512(input, previous));
+            incomplete = _mm512_subs_epu8(input, max_value);
+        }
+        previous = input;
+    }
+
+    errors = _mm512_or_si512(errors, incomplete);
+    return _mm512_test_epi8_mask(errors, errors) == 0;
+}
+
+
+// Continuation bytes are the signed bytes below -64.
+static __attribute__((target("sse2"))) size_t utf8_count_codepoints_sse2(char const * data,
+                                                                         size_t size)
+{
+    __m128i const limit = _mm_set1_epi8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i input = _mm_loadu_si128((__m128i const *)(data + i));
+        count +=
+            (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpgt_epi8(input, limit)));
+    }
+    return count + utf8_count_codepoints_scalar(data + i, size - i);
+}
+
+
+static __attribute__((target("avx2"))) size_t utf8_count_codepoints_avx2(char const * data,
+                                                                         size_t size)
+{
+    __m256i const limit = _mm256_set1_epi8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i input = _mm256_loadu_si256((__m256i const *)(data + i));
+        count += (size_t)__builtin_popcount(
+            (unsigned)_mm256_movemask_epi8(_mm256_cmpgt_epi8(input, limit)));
+    }
+    return count + utf8_count_codepoints_scalar(data + i, size - i);
+}
+
+
+static __attribute__((target("avx512f,avx512bw"))) size_t
+utf8_count_codepoints_avx512(char const * data, size_t size)
+{
+    __m512i const limit = _mm512_set1_epi8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m512i input = _mm512_loadu_si512((void const *)(data + i));
+        count += (size_t)__builtin_popcountll(_mm512_cmpgt_epi8_mask(input, limit));
+    }
+    return count + utf8_count_codepoints_scalar(data + i, size - i);
+}
+
+
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Public functions
+////////////////////////////////////////////////////////////////////////////////
+
+
+bool utf8_is_valid(struct string const * string)
+{
+    assert(string);
+
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return utf8_is_valid_avx512(string->data, string->size);
+        case CPU_ISA_AVX2:
+            return utf8_is_valid_avx2(string->data, string->size);
+        case CPU_ISA_SSE2:
+            return utf8_is_valid_sse2(string->data, string->size);
+#endif
+        default:
+            return utf8_is_valid_scalar(string->data, string->size);
+    }
+}
+
+
+size_t utf8_count_codepoints(struct string const * string)
+{
+    assert(string);
+
+    switch (cpu_isa_get())
+    {
+#ifdef CPU_X86_KERNELS
+        case CPU_ISA_AVX512:
+            return utf8_count_codepoints_avx512(string->data, string->size);
+        case CPU_ISA_AVX2:
+            return utf8_count_codepoints_avx2(string->data, string->size);
+        case CPU_ISA_SSE2:
+            return utf8_count_codepoints_sse2(string->data, string->size);
+#endif
+        default:
+            return utf8_count_codepoints_scalar(string->data, string->size);
+    }
+}
+
+
+void utf8_view_truncate(struct string * result, struct string const * string, size_t max_size)
+{
+    assert(result);
+    assert(string);
+
+    // Back up over at most three continuation bytes to the start of the code point.
+    size_t size = (max_size < string->size) ? max_size : string->size;
+    if (size < string->size)
+        for (size_t i = 0; i < 3 && size > 0 && utf8_is_continuation(string->data[size]); ++i)
+            --size;
+
+    result->data = string->data;
+    result->size = size;
+}
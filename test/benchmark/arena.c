@@ -0,0 +1,173 @@
+// getrusage is a POSIX function so it isn't declared in strict C mode.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "util/arena.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// Use the same variables for all benchmarks so that the memory locations
+// for the variables are the same for each benchmark.
+static struct arena arena;
+static struct string input;
+static struct string output;
+static struct string batch[100];
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Single allocations
+////////////////////////////////////////////////////////////////////////////////
+
+
+static void bench_string_copy_malloc_func()
+{
+    string_copy(&output, &input);
+    CHECK(output.size == input.size);
+    string_free(&output);
+}
+
+
+static void bench_string_copy_arena_func()
+{
+    string_copy_arena(&output, &input, &arena);
+    CHECK(output.size == input.size);
+    arena_reset(&arena);
+}
+
+
+static void bench_string_copy()
+{
+    benchmark_init(__func__);
+
+    input = string_literal("abc");
+    BENCH_WITH_NAME(bench_string_copy_malloc_func, "malloc 3 bytes");
+    BENCH_WITH_NAME(bench_string_copy_arena_func, "arena 3 bytes");
+
+    input = string_literal("0123456789abcdef0123456789abcdef0123456789abcdef");
+    BENCH_WITH_NAME(bench_string_copy_malloc_func, "malloc 48 bytes");
+    BENCH_WITH_NAME(bench_string_copy_arena_func, "arena 48 bytes");
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Batches of allocations
+////////////////////////////////////////////////////////////////////////////////
+
+
+static void bench_string_copy_batch_malloc_func()
+{
+    for (size_t i = 0; i < ARRAY_SIZE(batch); ++i)
+        string_copy_slice(batch + i, &input, i % 8, input.size);
+    for (size_t i = 0; i < ARRAY_SIZE(batch); ++i)
+        string_free(batch + i);
+}
+
+
+static void bench_string_copy_batch_arena_func()
+{
+    for (size_t i = 0; i < ARRAY_SIZE(batch); ++i)
+        string_copy_slice_arena(batch + i, &input, i % 8, input.size, &arena);
+    arena_reset(&arena);
+}
+
+
+static void bench_string_copy_batch()
+{
+    benchmark_init(__func__);
+
+    input = string_literal("0123456789abcdef0123456789abcdef");
+    BENCH_WITH_NAME(bench_string_copy_batch_malloc_func, "malloc 100 slices");
+    BENCH_WITH_NAME(bench_string_copy_batch_arena_func, "arena 100 slices");
+}
+
+
+static void bench_string_join_malloc_func()
+{
+    string_join_array(&output, batch, 10);
+    CHECK(output.size == 10 * input.size);
+    string_free(&output);
+}
+
+
+static void bench_string_join_arena_func()
+{
+    string_join_array_arena(&output, batch, 10, &arena);
+    CHECK(output.size == 10 * input.size);
+    arena_reset(&arena);
+}
+
+
+static void bench_string_join()
+{
+    benchmark_init(__func__);
+
+    input = string_literal("key=value;");
+    for (size_t i = 0; i < 10; ++i)
+        batch[i] = input;
+    BENCH_WITH_NAME(bench_string_join_malloc_func, "malloc join 10");
+    BENCH_WITH_NAME(bench_string_join_arena_func, "arena join 10");
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory use
+////////////////////////////////////////////////////////////////////////////////
+
+
+// Return the peak resident set size of the process in KiB, or 0 if unknown.
+static long peak_rss_kib()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+
+// Simulate many requests that each make thousands of short-lived strings and
+// check that resetting the arena keeps the peak memory use flat.
+static void bench_arena_reset_rss()
+{
+    printf("\n %s\n", __func__);
+
+    input = string_literal("0123456789abcdef0123456789abcdef0123456789abcdef");
+    struct string copy;
+    long rss_before = peak_rss_kib();
+    for (size_t request = 0; request < 10000; ++request)
+    {
+        for (size_t i = 0; i < 1000; ++i)
+            string_copy_slice_arena(&copy, &input, i % 32, input.size, &arena);
+
+        if (request == 0)
+            printf(" peak RSS after 1 request:      %ld KiB (+%ld KiB)\n", peak_rss_kib(),
+                   peak_rss_kib() - rss_before);
+        arena_reset(&arena);
+    }
+    printf(" peak RSS after 10000 requests: %ld KiB (+%ld KiB)\n", peak_rss_kib(),
+           peak_rss_kib() - rss_before);
+    printf(" arena capacity:                %zu KiB\n", arena_capacity(&arena) >> 10);
+}
+
+
+int main()
+{
+    arena_init(&arena, 0);
+
+    bench_string_copy();
+    bench_string_copy_batch();
+    bench_string_join();
+    bench_arena_reset_rss();
+
+    arena_free(&arena);
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/compress.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// Each input is about 16 MiB of short strings: URLs, and keys made of a few
+// fields separated by colons. The compressor is trained on the first 1,000.
+#define INPUT_SIZE ((size_t)16 << 20)
+#define SAMPLE_COUNT 1000
+
+
+static struct string * strings;
+static size_t string_count;
+static size_t raw_size;
+static struct string_compressor * compressor;
+static char * encoded;
+static size_t * encoded_offsets;
+static size_t encoded_size;
+static char * decoded;
+static unsigned seed = 12345;
+
+
+static unsigned next_random()
+{
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+
+// Fill the input with `kind` 0, URLs, or 1, keys.
+static void make_input(char * data, int kind)
+{
+    static char const * const hosts[] = {"www.example.com", "shop.example.co.uk", "api.service.io",
+                                         "static.cdn-host.net", "news.example.org"};
+    static char const * const words[] = {"users", "items", "orders", "search", "images", "blog",
+                                         "posts", "session", "cart", "profile", "settings"};
+
+    string_count = 0;
+    raw_size = 0;
+    while (raw_size + 128 < INPUT_SIZE)
+    {
+        char * next = data + raw_size;
+        int size;
+        if (kind == 0)
+            size = snprintf(next, 128, "https://%s/%s/%u/%s?id=%u", hosts[next_random() % 5],
+                            words[next_random() % 11], next_random() % 10000,
+                            words[next_random() % 11], next_random());
+        else
+            size = snprintf(next, 128, "%s:%u:%s:%04u", words[next_random() % 11],
+                            next_random() % 100000, words[next_random() % 11],
+                            next_random() % 2000);
+        strings[string_count++] = (struct string){next, (size_t)size};
+        raw_size += (size_t)size;
+    }
+}
+
+
+static void bench_string_compressor_encode_func()
+{
+    size_t size = 0;
+    for (size_t i = 0; i < string_count; ++i)
+        size += string_compressor_encode(encoded + size, compressor, strings + i);
+    CHECK(size == encoded_size);
+}
+
+
+static void bench_string_compressor_decode_func()
+{
+    size_t size = 0;
+    for (size_t i = 0; i < string_count; ++i)
+    {
+        struct string const view = {encoded + encoded_offsets[i],
+                                    encoded_offsets[i + 1] - encoded_offsets[i]};
+        size += string_compressor_decode(decoded + size, INPUT_SIZE - size, compressor, &view);
+    }
+    CHECK(size == raw_size);
+}
+
+
+static void bench_memcpy_func()
+{
+    // The baseline copies the raw strings one at a time.
+    size_t size = 0;
+    for (size_t i = 0; i < string_count; ++i)
+    {
+        memcpy(decoded + size, strings[i].data, strings[i].size);
+        size += strings[i].size;
+    }
+    CHECK(size == raw_size);
+}
+
+
+static void bench_string_compressor()
+{
+    benchmark_init(__func__);
+
+    char * data = malloc(INPUT_SIZE);
+    strings = malloc(INPUT_SIZE / 16 * sizeof(*strings));
+    encoded_offsets = malloc((INPUT_SIZE / 16 + 1) * sizeof(*encoded_offsets));
+    encoded = malloc(2 * INPUT_SIZE);
+    decoded = malloc(INPUT_SIZE);
+    CHECK(data != NULL && strings != NULL && encoded_offsets != NULL && encoded != NULL &&
+          decoded != NULL);
+
+    char const * const names[] = {"urls", "keys"};
+    char name[64];
+    for (int kind = 0; kind < 2; ++kind)
+    {
+        make_input(data, kind);
+        compressor = string_compressor_train(strings, SAMPLE_COUNT);
+        CHECK(compressor != NULL);
+
+        encoded_size = 0;
+        for (size_t i = 0; i < string_count; ++i)
+        {
+            encoded_offsets[i] = encoded_size;
+            encoded_size +=
+                string_compressor_encode(encoded + encoded_size, compressor, strings + i);
+        }
+        encoded_offsets[string_count] = encoded_size;
+        printf(" %s: %zu strings, %zu symbols, compressed to %.1f%% of %zu bytes\n", names[kind],
+               string_count, string_compressor_symbol_count(compressor),
+               100.0 * (double)encoded_size / (double)raw_size, raw_size);
+
+        snprintf(name, sizeof(name), "encode %s", names[kind]);
+        BENCH_THROUGHPUT(bench_string_compressor_encode_func, name, raw_size);
+        snprintf(name, sizeof(name), "decode %s", names[kind]);
+        BENCH_THROUGHPUT(bench_string_compressor_decode_func, name, raw_size);
+        snprintf(name, sizeof(name), "memcpy %s", names[kind]);
+        BENCH_THROUGHPUT(bench_memcpy_func, name, raw_size);
+        string_compressor_free(compressor);
+    }
+
+    free(decoded);
+    free(encoded);
+    free(encoded_offsets);
+    free(strings);
+    free(data);
+}
+
+
+int main()
+{
+    bench_string_compressor();
+    return 0;
+}
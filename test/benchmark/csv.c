@@ -0,0 +1,170 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/csv.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// Each input is 4 MiB of records: narrow ones of short numeric fields, and
+// wide ones of longer text fields, a third of them quoted and some of those
+// with escaped quotes and newlines.
+#define INPUT_SIZE ((size_t)4 << 20)
+#define CHUNK_SIZE ((size_t)64 << 10)
+
+
+static struct string input;
+static size_t expected_count;
+
+
+// Fill the input with records, quoting about one field in `quote_one_in`,
+// or none if it's 0, and with fields of up to `max_size` bytes.
+static void make_input(size_t max_size, unsigned quote_one_in)
+{
+    string_make(&input, INPUT_SIZE);
+    CHECK(input.data != NULL);
+
+    unsigned seed = 12345;
+    size_t i = 0;
+    size_t column = 0;
+    char field[256];
+    while (true)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t size = 1 + (seed >> 8) % max_size;
+        bool const quoted = quote_one_in != 0 && (seed >> 4) % quote_one_in == 0;
+        size_t f = 0;
+        if (quoted)
+            field[f++] = '"';
+        for (size_t j = 0; j < size; ++j)
+        {
+            seed = seed * 1103515245u + 12345u;
+            unsigned random = seed >> 8;
+            if (quoted && random % 64 == 0)
+                field[f++] = '"', field[f++] = '"';
+            else if (quoted && random % 64 == 1)
+                field[f++] = (random & 256) ? ',' : '\n';
+            else if (max_size < 16)
+                field[f++] = (char)('0' + random % 10);
+            else
+                field[f++] = (random % 6 == 0) ? ' ' : (char)('a' + random % 26);
+        }
+        if (quoted)
+            field[f++] = '"';
+        field[f++] = (++column % 8 == 0) ? '\n' : ',';
+
+        if (i + f > input.size)
+            break;
+        memcpy(input.data + i, field, f);
+        i += f;
+    }
+    memset(input.data + i, '\n', input.size - i);
+}
+
+
+// A byte at a time state machine, as a baseline.
+static size_t naive_count(struct string const * string)
+{
+    size_t count = 0;
+    bool inside = false;
+    for (size_t i = 0; i < string->size; ++i)
+    {
+        char c = string->data[i];
+        if (c == '"')
+            inside = !inside;
+        else if (!inside && (c == ',' || c == '\n'))
+            ++count;
+    }
+    return count;
+}
+
+
+static void bench_naive_func()
+{
+    CHECK(naive_count(&input) == expected_count);
+}
+
+
+static void bench_csv_reader_func()
+{
+    struct csv_reader reader;
+    csv_reader_init(&reader, ',');
+    csv_reader_feed(&reader, &input, true);
+
+    size_t count = 0;
+    struct string field;
+    while (csv_reader_next(&reader, &field) != CSV_RC_END)
+        ++count;
+    CHECK(count == expected_count);
+    csv_reader_free(&reader);
+}
+
+
+static void bench_csv_reader_chunks_func()
+{
+    struct csv_reader reader;
+    csv_reader_init(&reader, ',');
+    struct string chunk = {input.data, 0};
+    csv_reader_feed(&reader, &chunk, false);
+
+    size_t count = 0;
+    struct string field;
+    enum csv_rc rc;
+    while ((rc = csv_reader_next(&reader, &field)) != CSV_RC_END)
+    {
+        if (rc != CSV_RC_NEED_INPUT)
+        {
+            ++count;
+            continue;
+        }
+        chunk.data += chunk.size;
+        chunk.size = CHUNK_SIZE;
+        csv_reader_feed(&reader, &chunk, chunk.data + chunk.size == input.data + input.size);
+    }
+    CHECK(count == expected_count);
+    csv_reader_free(&reader);
+}
+
+
+static void bench_csv_reader()
+{
+    benchmark_init(__func__);
+
+    struct
+    {
+        char const * name;
+        size_t max_size;
+        unsigned quote_one_in;
+    } const inputs[] = {
+        {"narrow", 8, 0},
+        {"wide", 80, 3},
+    };
+
+    char name[64];
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i)
+    {
+        make_input(inputs[i].max_size, inputs[i].quote_one_in);
+        expected_count = naive_count(&input);
+        snprintf(name, sizeof(name), "naive %s", inputs[i].name);
+        BENCH_THROUGHPUT(bench_naive_func, name, INPUT_SIZE);
+        for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        {
+            snprintf(name, sizeof(name), "whole %s %s", inputs[i].name, cpu_isa_to_string(isa));
+            BENCH_THROUGHPUT(bench_csv_reader_func, name, INPUT_SIZE);
+            snprintf(name, sizeof(name), "chunks %s %s", inputs[i].name, cpu_isa_to_string(isa));
+            BENCH_THROUGHPUT(bench_csv_reader_chunks_func, name, INPUT_SIZE);
+        }
+        cpu_isa_set(cpu_isa_supported());
+        string_free(&input);
+    }
+}
+
+
+int main()
+{
+    bench_csv_reader();
+    return 0;
+}
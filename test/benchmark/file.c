@@ -0,0 +1,348 @@
+// Needed for getline, pipe, open and close, which the readers use.
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "util/file.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// The file is 64 MiB of lines of 1 to 80 characters. Each file_map
+// benchmark either maps the file, with different hints, or reads it into a
+// buffer with fread, and then either stops at the first line or splits the
+// whole file. Each file_reader benchmark reads every line from the file or
+// from a pipe that another thread writes the same lines to, compared with
+// getline. The write benchmarks write the first 10^3 to 10^6 lines, with a
+// newline after each but the last, with file_write_strings(), by joining
+// them and writing the result, and with fwrite.
+#define FILE_PATH "benchmark_file.tmp"
+#define WRITE_PATH "benchmark_file_write.tmp"
+#define FILE_SIZE ((size_t)64 << 20)
+
+
+static struct string buffer;
+static unsigned flags;
+static size_t capacity;
+static size_t expected_lines;
+static struct string * lines;
+static struct string * pieces;
+static size_t line_count;
+static size_t written_size;
+static int write_fd;
+
+
+static void write_file()
+{
+    string_make(&buffer, FILE_SIZE);
+    CHECK(buffer.data != NULL);
+
+    unsigned seed = 12345;
+    for (size_t i = 0; i < buffer.size;)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t size = 1 + (seed >> 16) % 80;
+        for (size_t j = 0; j < size && i < buffer.size; ++j)
+            buffer.data[i++] = (char)('a' + j % 26);
+        if (i < buffer.size)
+            buffer.data[i++] = '\n';
+    }
+
+    FILE * file = fopen(FILE_PATH, "wb");
+    CHECK(file != NULL);
+    CHECK(fwrite(buffer.data, 1, buffer.size, file) == buffer.size);
+    CHECK(fclose(file) == 0);
+
+    expected_lines = string_count_char(&buffer, '\n') + 1;
+}
+
+
+// Read the whole file into a heap buffer.
+static void read_file(struct string * contents)
+{
+    FILE * file = fopen(FILE_PATH, "rb");
+    CHECK(file != NULL);
+    string_make(contents, FILE_SIZE);
+    CHECK(contents->data != NULL);
+    CHECK(fread(contents->data, 1, contents->size, file) == contents->size);
+    CHECK(fclose(file) == 0);
+}
+
+
+static size_t count_lines(struct string const * contents, bool first_only)
+{
+    struct string_split_iter iter;
+    struct string line;
+    size_t count = 0;
+    string_split_iter_init(&iter, contents, '\n');
+    while (string_split_iter_next(&iter, &line))
+    {
+        ++count;
+        if (first_only)
+            break;
+    }
+    return count;
+}
+
+
+static void bench_file_map_first_func()
+{
+    struct string contents;
+    CHECK(file_map(&contents, FILE_PATH, flags));
+    CHECK(count_lines(&contents, true) == 1);
+    file_unmap(&contents);
+}
+
+
+static void bench_file_map_split_func()
+{
+    struct string contents;
+    CHECK(file_map(&contents, FILE_PATH, flags));
+    CHECK(count_lines(&contents, false) == expected_lines);
+    file_unmap(&contents);
+}
+
+
+static void bench_fread_first_func()
+{
+    struct string contents;
+    read_file(&contents);
+    CHECK(count_lines(&contents, true) == 1);
+    string_free(&contents);
+}
+
+
+static void bench_fread_split_func()
+{
+    struct string contents;
+    read_file(&contents);
+    CHECK(count_lines(&contents, false) == expected_lines);
+    string_free(&contents);
+}
+
+
+// Write the whole buffer to the pipe `fd` and close it.
+static int write_pipe(void * fd)
+{
+    for (size_t i = 0; i < buffer.size;)
+    {
+        ssize_t count = write(*(int *)fd, buffer.data + i, buffer.size - i);
+        CHECK(count > 0);
+        i += (size_t)count;
+    }
+    CHECK(close(*(int *)fd) == 0);
+    return 0;
+}
+
+
+// Open a pipe and start a thread writing the buffer to it. Read from `fds[0]`.
+static void open_pipe(int fds[2], thrd_t * writer)
+{
+    CHECK(pipe(fds) == 0);
+    CHECK(thrd_create(writer, write_pipe, fds + 1) == thrd_success);
+}
+
+
+static size_t count_records(int fd)
+{
+    struct file_reader reader;
+    CHECK(file_reader_init(&reader, fd, '\n', capacity));
+    struct string record;
+    size_t count = 0;
+    while (file_reader_next(&reader, &record) == FILE_READER_RC_OK)
+        ++count;
+    file_reader_free(&reader);
+    return count;
+}
+
+
+static size_t count_getline(FILE * file)
+{
+    char * line = NULL;
+    size_t line_capacity = 0;
+    size_t count = 0;
+    while (getline(&line, &line_capacity, file) >= 0)
+        ++count;
+    free(line);
+    return count;
+}
+
+
+static void bench_file_reader_file_func()
+{
+    int fd = open(FILE_PATH, O_RDONLY);
+    CHECK(fd >= 0);
+    CHECK(count_records(fd) == expected_lines);
+    CHECK(close(fd) == 0);
+}
+
+
+static void bench_getline_file_func()
+{
+    FILE * file = fopen(FILE_PATH, "rb");
+    CHECK(file != NULL);
+    CHECK(count_getline(file) == expected_lines);
+    CHECK(fclose(file) == 0);
+}
+
+
+static void bench_file_reader_pipe_func()
+{
+    int fds[2];
+    thrd_t writer;
+    open_pipe(fds, &writer);
+    CHECK(count_records(fds[0]) == expected_lines);
+    CHECK(thrd_join(writer, NULL) == thrd_success);
+    CHECK(close(fds[0]) == 0);
+}
+
+
+static void bench_getline_pipe_func()
+{
+    int fds[2];
+    thrd_t writer;
+    open_pipe(fds, &writer);
+    FILE * file = fdopen(fds[0], "rb");
+    CHECK(file != NULL);
+    CHECK(count_getline(file) == expected_lines);
+    CHECK(thrd_join(writer, NULL) == thrd_success);
+    CHECK(fclose(file) == 0);
+}
+
+
+static void bench_file_write_strings_func()
+{
+    CHECK(lseek(write_fd, 0, SEEK_SET) == 0);
+    CHECK(file_write_strings(write_fd, lines, line_count, &string_literal("\n")));
+}
+
+
+static void bench_join_write_func()
+{
+    // The pieces are the lines with a newline between each two.
+    struct string joined;
+    string_join_array(&joined, pieces, 2 * line_count - 1);
+    CHECK(joined.size == written_size);
+    CHECK(lseek(write_fd, 0, SEEK_SET) == 0);
+    for (size_t i = 0; i < joined.size;)
+    {
+        ssize_t count = write(write_fd, joined.data + i, joined.size - i);
+        CHECK(count > 0);
+        i += (size_t)count;
+    }
+    string_free(&joined);
+}
+
+
+static void bench_fwrite_func()
+{
+    CHECK(lseek(write_fd, 0, SEEK_SET) == 0);
+    FILE * file = fdopen(dup(write_fd), "wb");
+    CHECK(file != NULL);
+    for (size_t i = 0; i < line_count; ++i)
+    {
+        if (i > 0)
+            CHECK(fputc('\n', file) == '\n');
+        CHECK(fwrite(lines[i].data, 1, lines[i].size, file) == lines[i].size);
+    }
+    CHECK(fclose(file) == 0);
+}
+
+
+static void bench_file_write()
+{
+    benchmark_init(__func__);
+
+    size_t const total_count = string_view_split(&lines, &buffer, '\n');
+    pieces = malloc(2 * total_count * sizeof(*pieces));
+    CHECK(pieces != NULL);
+    for (size_t i = 0; i < total_count; ++i)
+    {
+        pieces[2 * i] = lines[i];
+        pieces[2 * i + 1] = string_literal("\n");
+    }
+    write_fd = open(WRITE_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    CHECK(write_fd >= 0);
+
+    char name[64];
+    for (line_count = 1000; line_count <= 1000000; line_count *= 10)
+    {
+        CHECK(line_count <= total_count);
+        written_size = line_count - 1;
+        for (size_t i = 0; i < line_count; ++i)
+            written_size += lines[i].size;
+
+        snprintf(name, sizeof(name), "writev %zu", line_count);
+        BENCH_THROUGHPUT(bench_file_write_strings_func, name, written_size);
+        snprintf(name, sizeof(name), "join write %zu", line_count);
+        BENCH_THROUGHPUT(bench_join_write_func, name, written_size);
+        snprintf(name, sizeof(name), "fwrite %zu", line_count);
+        BENCH_THROUGHPUT(bench_fwrite_func, name, written_size);
+    }
+
+    CHECK(close(write_fd) == 0);
+    CHECK(remove(WRITE_PATH) == 0);
+    free(pieces);
+    free(lines);
+}
+
+
+static void bench_file()
+{
+    benchmark_init(__func__);
+    write_file();
+
+    // The throughput is the size of the file divided by the time taken, even
+    // for the benchmarks that stop at the first line.
+    struct
+    {
+        char const * name;
+        unsigned flags;
+    } const variants[] = {
+        {"map", 0},
+        {"map sequential", FILE_MAP_SEQUENTIAL},
+        {"map willneed", FILE_MAP_WILLNEED | FILE_MAP_SEQUENTIAL},
+        {"map populate", FILE_MAP_POPULATE},
+    };
+
+    char name[64];
+    for (size_t i = 0; i < sizeof(variants) / sizeof(*variants); ++i)
+    {
+        flags = variants[i].flags;
+        snprintf(name, sizeof(name), "%s first", variants[i].name);
+        BENCH_THROUGHPUT(bench_file_map_first_func, name, FILE_SIZE);
+        snprintf(name, sizeof(name), "%s split", variants[i].name);
+        BENCH_THROUGHPUT(bench_file_map_split_func, name, FILE_SIZE);
+    }
+    BENCH_THROUGHPUT(bench_fread_first_func, "fread first", FILE_SIZE);
+    BENCH_THROUGHPUT(bench_fread_split_func, "fread split", FILE_SIZE);
+
+    size_t const capacities[] = {(size_t)4 << 10, (size_t)64 << 10, (size_t)1 << 20};
+    for (size_t i = 0; i < sizeof(capacities) / sizeof(*capacities); ++i)
+    {
+        capacity = capacities[i];
+        snprintf(name, sizeof(name), "reader %zu KiB file", capacity >> 10);
+        BENCH_THROUGHPUT(bench_file_reader_file_func, name, FILE_SIZE);
+        snprintf(name, sizeof(name), "reader %zu KiB pipe", capacity >> 10);
+        BENCH_THROUGHPUT(bench_file_reader_pipe_func, name, FILE_SIZE);
+    }
+    BENCH_THROUGHPUT(bench_getline_file_func, "getline file", FILE_SIZE);
+    BENCH_THROUGHPUT(bench_getline_pipe_func, "getline pipe", FILE_SIZE);
+
+    CHECK(remove(FILE_PATH) == 0);
+}
+
+
+int main()
+{
+    bench_file();
+    bench_file_write();
+    string_free(&buffer);
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/fuzzy.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// The pair benchmarks compare about 1 MiB of strings of one size, each with
+// a copy that has about one edit in ten, by filling in the whole table of
+// distances, with string_edit_distance() and with
+// string_edit_distance_within() for a limit of 3. The search benchmarks look
+// for misspelled names in a dictionary of 100,000 names of 4 to 19 letters.
+#define PAIRS_SIZE ((size_t)1 << 20)
+#define NAME_COUNT 100000
+#define QUERY_COUNT 16
+
+
+static struct string * firsts;
+static struct string * seconds;
+static size_t pair_count;
+static size_t expected_sum;
+static size_t expected_within;
+static struct string * names;
+static size_t names_size;
+static struct string * queries;
+static size_t query;
+static size_t * row;
+static unsigned seed = 12345;
+
+
+static unsigned next_random()
+{
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+
+// Fill `output` with a copy of `input` with about one edit in ten.
+static size_t make_edited(char * output, struct string const * input)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < input->size; ++i)
+    {
+        unsigned const random = next_random() % 30;
+        char const c = (char)('a' + next_random() % 26);
+        if (random == 0)
+            output[size++] = c;
+        else if (random == 1)
+        {
+            output[size++] = c;
+            output[size++] = input->data[i];
+        }
+        else if (random != 2)
+            output[size++] = input->data[i];
+    }
+    return size;
+}
+
+
+// The distance by filling in the table of distances between prefixes a row at a time.
+static size_t naive_distance(struct string const * a, struct string const * b)
+{
+    for (size_t j = 0; j <= b->size; ++j)
+        row[j] = j;
+    for (size_t i = 1; i <= a->size; ++i)
+    {
+        size_t diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= b->size; ++j)
+        {
+            size_t const above = row[j];
+            size_t best = diagonal + (a->data[i - 1] != b->data[j - 1]);
+            best = (above + 1 < best) ? above + 1 : best;
+            best = (row[j - 1] + 1 < best) ? row[j - 1] + 1 : best;
+            row[j] = best;
+            diagonal = above;
+        }
+    }
+    return row[b->size];
+}
+
+
+static void bench_naive_distance_func()
+{
+    size_t sum = 0;
+    for (size_t i = 0; i < pair_count; ++i)
+        sum += naive_distance(firsts + i, seconds + i);
+    CHECK(sum == expected_sum);
+}
+
+
+static void bench_string_edit_distance_func()
+{
+    size_t sum = 0;
+    for (size_t i = 0; i < pair_count; ++i)
+        sum += string_edit_distance(firsts + i, seconds + i);
+    CHECK(sum == expected_sum);
+}
+
+
+static void bench_string_edit_distance_within_func()
+{
+    size_t count = 0;
+    for (size_t i = 0; i < pair_count; ++i)
+        count += string_edit_distance_within(firsts + i, seconds + i, 3);
+    CHECK(count == expected_within);
+}
+
+
+static void bench_string_edit_distance()
+{
+    benchmark_init(__func__);
+
+    char * data = malloc(3 * PAIRS_SIZE);
+    firsts = malloc(PAIRS_SIZE * sizeof(*firsts));
+    seconds = malloc(PAIRS_SIZE * sizeof(*seconds));
+    row = malloc((2 * PAIRS_SIZE + 1) * sizeof(*row));
+    CHECK(data != NULL && firsts != NULL && seconds != NULL && row != NULL);
+    for (size_t i = 0; i < PAIRS_SIZE; ++i)
+        data[i] = (char)('a' + next_random() % 26);
+
+    // The whole table is too slow to fill in for long strings.
+    size_t const sizes[] = {8, 16, 64, 256, 1024};
+    char name[64];
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s)
+    {
+        pair_count = PAIRS_SIZE / sizes[s];
+        char * second = data + PAIRS_SIZE;
+        for (size_t i = 0; i < pair_count; ++i)
+        {
+            firsts[i] = (struct string){data + i * sizes[s], sizes[s]};
+            seconds[i] = (struct string){second, make_edited(second, firsts + i)};
+            second += seconds[i].size;
+        }
+
+        expected_sum = 0;
+        expected_within = 0;
+        for (size_t i = 0; i < pair_count; ++i)
+        {
+            size_t const distance = string_edit_distance(firsts + i, seconds + i);
+            expected_sum += distance;
+            expected_within += distance <= 3;
+        }
+
+        if (sizes[s] <= 64)
+        {
+            snprintf(name, sizeof(name), "naive %zu", sizes[s]);
+            BENCH_THROUGHPUT(bench_naive_distance_func, name, PAIRS_SIZE);
+        }
+        snprintf(name, sizeof(name), "distance %zu", sizes[s]);
+        BENCH_THROUGHPUT(bench_string_edit_distance_func, name, PAIRS_SIZE);
+        snprintf(name, sizeof(name), "within 3 %zu", sizes[s]);
+        BENCH_THROUGHPUT(bench_string_edit_distance_within_func, name, PAIRS_SIZE);
+    }
+
+    free(row);
+    free(seconds);
+    free(firsts);
+    free(data);
+}
+
+
+static void bench_naive_closest_func()
+{
+    // The baseline finds the closest name by computing every distance.
+    size_t best = 0;
+    size_t best_distance = SIZE_MAX;
+    for (size_t i = 0; i < NAME_COUNT; ++i)
+    {
+        size_t const distance = naive_distance(queries + query, names + i);
+        if (distance < best_distance)
+            best = i, best_distance = distance;
+    }
+    CHECK(best_distance <= 2);
+    CHECK(string_is_equal(names + best, names + query * 1000) || best_distance < 2);
+    query = (query + 1) % QUERY_COUNT;
+}
+
+
+static void bench_string_find_closest_func()
+{
+    struct string_candidate closest;
+    CHECK(string_find_closest(&closest, 1, queries + query, names, NAME_COUNT, 2) == 1);
+    CHECK(closest.distance <= 2);
+    CHECK(closest.index == query * 1000 || closest.distance < 2);
+    query = (query + 1) % QUERY_COUNT;
+}
+
+
+static void bench_string_find_closest()
+{
+    benchmark_init(__func__);
+
+    char (*data)[20] = malloc(NAME_COUNT * sizeof(*data));
+    char (*query_data)[20] = malloc(QUERY_COUNT * sizeof(*query_data));
+    names = malloc(NAME_COUNT * sizeof(*names));
+    queries = malloc(QUERY_COUNT * sizeof(*queries));
+    row = malloc(sizeof(*data) * sizeof(*row));
+    CHECK(data != NULL && query_data != NULL && names != NULL && queries != NULL && row != NULL);
+
+    names_size = 0;
+    for (size_t i = 0; i < NAME_COUNT; ++i)
+    {
+        size_t const size = 4 + next_random() % 16;
+        for (size_t j = 0; j < size; ++j)
+            data[i][j] = (char)('a' + next_random() % 26);
+        names[i] = (struct string){data[i], size};
+        names_size += size;
+    }
+
+    // Each query is a name with two bytes swapped, which is two edits.
+    for (size_t i = 0; i < QUERY_COUNT; ++i)
+    {
+        struct string const * from = names + i * 1000;
+        memcpy(query_data[i], from->data, from->size);
+        char const swap = query_data[i][1];
+        query_data[i][1] = query_data[i][2];
+        query_data[i][2] = swap;
+        queries[i] = (struct string){query_data[i], from->size};
+    }
+
+    query = 0;
+    BENCH_THROUGHPUT(bench_naive_closest_func, "naive closest", names_size);
+    query = 0;
+    BENCH_THROUGHPUT(bench_string_find_closest_func, "find closest", names_size);
+
+    free(row);
+    free(queries);
+    free(names);
+    free(query_data);
+    free(data);
+}
+
+
+int main()
+{
+    bench_string_edit_distance();
+    bench_string_find_closest();
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+
+#include "util/intern.h"
+#include "util/log.h"
+#include "util/string.h"
+#include "util/timespec.h"
+
+#include "test/benchmark.h"
+
+
+// Use the same variables for all benchmarks so that the memory locations
+// for the variables are the same for each benchmark.
+static struct intern_table * table;
+static struct string key;
+static struct string key_atom;
+static struct string level_atoms[DEBUG + 1];
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Single-threaded comparisons
+////////////////////////////////////////////////////////////////////////////////
+
+
+static void bench_string_to_log_level_func()
+{
+    CHECK(string_to_log_level("Debug") == DEBUG);
+}
+
+
+static void bench_intern_lookup_func()
+{
+    struct string atom;
+    CHECK(intern_lookup(table, &key, &atom));
+}
+
+
+static void bench_intern_is_same_func()
+{
+    // Once a key is interned finding its level is a pointer comparison per level.
+    int level = 0;
+    while (level <= DEBUG && !string_is_same(&key_atom, level_atoms + level))
+        ++level;
+    CHECK(level == DEBUG);
+}
+
+
+static void bench_intern_compare()
+{
+    benchmark_init(__func__);
+
+    for (int level = 0; level <= DEBUG; ++level)
+    {
+        struct string name;
+        string_view_cstr(&name, (char *)log_level_to_string(level));
+        CHECK(intern_string(table, &name, level_atoms + level));
+    }
+    key = string_literal("Debug");
+    CHECK(intern_string(table, &key, &key_atom));
+
+    BENCH_WITH_NAME(bench_string_to_log_level_func, "strcmp scan");
+    BENCH_WITH_NAME(bench_intern_lookup_func, "intern_lookup");
+    BENCH_WITH_NAME(bench_intern_is_same_func, "atom is_same scan");
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Multi-threaded throughput
+////////////////////////////////////////////////////////////////////////////////
+
+
+#define KEYS 1024
+#define OPERATIONS_PER_THREAD 1000000
+
+
+static char key_data[KEYS][32];
+static struct string keys[KEYS];
+
+
+// Look up every key in turn; they have all been interned so every lookup hits.
+static int bench_hit_thread(void * arg)
+{
+    UNUSED(arg);
+    struct string atom;
+    for (size_t i = 0; i < OPERATIONS_PER_THREAD; ++i)
+        if (!intern_string(table, keys + (i % KEYS), &atom))
+            return 1;
+    return 0;
+}
+
+
+// Intern keys no other thread uses so that every call misses and inserts.
+static int bench_miss_thread(void * arg)
+{
+    size_t id = (size_t)arg;
+    char buffer[48];
+    struct string atom;
+    for (size_t i = 0; i < OPERATIONS_PER_THREAD / 10; ++i)
+    {
+        int size = snprintf(buffer, sizeof(buffer), "thread-%zu-key-%zu", id, i);
+        if (!intern_string(table, &(struct string){buffer, (size_t)size}, &atom))
+            return 1;
+    }
+    return 0;
+}
+
+
+// Run `function` on `n_threads` threads and return the total operations per second.
+static double run_threads(thrd_start_t function, size_t n_threads, size_t operations)
+{
+    thrd_t threads[16];
+    CHECK(n_threads <= ARRAY_SIZE(threads));
+
+    struct timespec start, stop, duration;
+    timespec_get(&start, TIME_UTC);
+    for (size_t i = 0; i < n_threads; ++i)
+        CHECK(thrd_create(threads + i, function, (void *)i) == thrd_success);
+    for (size_t i = 0; i < n_threads; ++i)
+    {
+        int rc = 1;
+        CHECK(thrd_join(threads[i], &rc) == thrd_success);
+        CHECK(rc == 0);
+    }
+    timespec_get(&stop, TIME_UTC);
+    timespec_duration(&duration, &start, &stop);
+
+    return (double)(n_threads * operations) / timespec_to_double_s(&duration);
+}
+
+
+static void bench_intern_threads()
+{
+    printf("\n %s\n", __func__);
+    puts("---------+----------------+-----------------\n"
+         " threads | hit (Mops/s)   | miss (Mops/s)   \n"
+         "---------+----------------+-----------------");
+
+    size_t const thread_counts[] = {1, 4, 16};
+    for (size_t t = 0; t < ARRAY_SIZE(thread_counts); ++t)
+    {
+        // Use a fresh table for each thread count so the misses really miss.
+        intern_table_free(table);
+        table = intern_table_make();
+        CHECK(table != NULL);
+        for (size_t i = 0; i < KEYS; ++i)
+            CHECK(intern_string(table, keys + i, &key_atom));
+
+        size_t n = thread_counts[t];
+        double hit = run_threads(bench_hit_thread, n, OPERATIONS_PER_THREAD);
+        double miss = run_threads(bench_miss_thread, n, OPERATIONS_PER_THREAD / 10);
+        printf(" %7zu | %14.2f | %15.2f\n", n, hit / 1e6, miss / 1e6);
+    }
+}
+
+
+int main()
+{
+    table = intern_table_make();
+    CHECK(table != NULL);
+
+    for (size_t i = 0; i < KEYS; ++i)
+    {
+        int size = snprintf(key_data[i], sizeof(key_data[i]), "field_key_%zu", i);
+        keys[i] = (struct string){key_data[i], (size_t)size};
+    }
+
+    bench_intern_compare();
+    bench_intern_threads();
+
+    intern_table_free(table);
+    return 0;
+}
@@ -0,0 +1,394 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/json.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// Each input is an array of about 4 MiB of values shaped like those of the
+// usual test documents: tweets, which are mostly strings, some of them with
+// escapes; compact records of the events of a ticketing site, which are
+// mostly integers and short keys; and indented arrays of coordinates, which
+// are all floating point numbers.
+#define INPUT_SIZE ((size_t)4 << 20)
+#define CHUNK_SIZE ((size_t)64 << 10)
+#define BATCH_SIZE 256
+
+
+static struct string input;
+static size_t expected_count;
+static unsigned seed = 12345;
+
+
+static unsigned next_random()
+{
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+
+static void append_words(struct string_builder * builder, size_t count)
+{
+    static char const * const words[] = {
+        "the", "release", "is", "out", "today", "\\\"finally\\\"", "caf\\u00e9", "with",
+        "#json", "@parser", "https:\\/\\/example.com\\/p", "and", "more", "\\n", "fast",
+    };
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i > 0)
+            CHECK(string_builder_append_char(builder, ' '));
+        CHECK(string_builder_append_cstr(builder, words[next_random() % 15]));
+    }
+}
+
+
+static void append_tweet(struct string_builder * builder)
+{
+    CHECK(string_builder_append_cstr(builder, "{\"id\":"));
+    CHECK(string_builder_append_uint(builder, 505874924095815681u + next_random()));
+    CHECK(string_builder_append_cstr(builder, ",\"text\":\""));
+    append_words(builder, 4 + next_random() % 16);
+    CHECK(string_builder_append_cstr(builder, "\",\"user\":{\"name\":\""));
+    append_words(builder, 2);
+    CHECK(string_builder_append_cstr(builder, "\",\"followers_count\":"));
+    CHECK(string_builder_append_uint(builder, next_random()));
+    CHECK(string_builder_append_cstr(builder, ",\"verified\":"));
+    CHECK(string_builder_append_cstr(builder, next_random() % 8 ? "false" : "true"));
+    CHECK(string_builder_append_cstr(builder, "},\"entities\":{\"hashtags\":[],\"urls\":[\""));
+    append_words(builder, 1);
+    CHECK(string_builder_append_cstr(
+        builder, "\"]},\"in_reply_to_status_id\":null,\"retweet_count\":"));
+    CHECK(string_builder_append_uint(builder, next_random() % 1000));
+    CHECK(string_builder_append_cstr(builder, ",\"lang\":\"en\"}"));
+}
+
+
+static void append_event(struct string_builder * builder)
+{
+    CHECK(string_builder_append_cstr(builder, "{\"id\":"));
+    CHECK(string_builder_append_uint(builder, 138586341 + next_random()));
+    CHECK(string_builder_append_cstr(builder, ",\"logo\":null,\"name\":\"Concert\",\"prices\":["));
+    size_t const count = 1 + next_random() % 6;
+    for (size_t i = 0; i < count; ++i)
+    {
+        CHECK(string_builder_append_cstr(builder, i > 0 ? ",{\"amount\":" : "{\"amount\":"));
+        CHECK(string_builder_append_uint(builder, 1000 * (next_random() % 100)));
+        CHECK(string_builder_append_cstr(builder, ",\"audienceSubCategoryId\":337100890,"
+                                                  "\"seatCategoryId\":"));
+        CHECK(string_builder_append_uint(builder, 338937295 + next_random()));
+        CHECK(string_builder_append_char(builder, '}'));
+    }
+    CHECK(string_builder_append_cstr(builder, "],\"subTopicIds\":[337184269,337184283],"
+                                              "\"topicIds\":[324846099,107888604]}"));
+}
+
+
+static void append_coordinates(struct string_builder * builder)
+{
+    CHECK(string_builder_append_cstr(builder, "[\n"));
+    size_t const count = 8 + next_random() % 32;
+    for (size_t i = 0; i < count; ++i)
+    {
+        char point[64];
+        snprintf(point, sizeof(point), "%s    [-%u.%09u%05u,%u.%09u%05u]", i > 0 ? ",\n" : "",
+                 next_random() % 180, next_random() % 1000000000, next_random() % 100000,
+                 next_random() % 90, next_random() % 1000000000, next_random() % 100000);
+        CHECK(string_builder_append_cstr(builder, point));
+    }
+    CHECK(string_builder_append_cstr(builder, "\n  ]"));
+}
+
+
+static void make_input(void (*append_value)(struct string_builder *))
+{
+    struct string_builder builder;
+    string_builder_init(&builder);
+    CHECK(string_builder_append_char(&builder, '['));
+    while (builder.size < INPUT_SIZE)
+    {
+        if (builder.size > 1)
+            CHECK(string_builder_append_cstr(&builder, ",\n  "));
+        append_value(&builder);
+    }
+    CHECK(string_builder_append_cstr(&builder, "\n]\n"));
+    string_builder_finish(&builder, &input);
+}
+
+
+// A recursive descent parser that reads a byte at a time, as a baseline. It
+// counts the same tokens as the reader returns and checks the same grammar.
+struct baseline
+{
+    char const * data;
+    char const * end;
+    size_t count;
+};
+
+
+static void baseline_skip_spaces(struct baseline * parser)
+{
+    while (parser->data < parser->end && (*parser->data == ' ' || *parser->data == '\t' ||
+                                           *parser->data == '\n' || *parser->data == '\r'))
+        ++parser->data;
+}
+
+
+static bool baseline_digits(struct baseline * parser)
+{
+    char const * start = parser->data;
+    while (parser->data < parser->end && *parser->data >= '0' && *parser->data <= '9')
+        ++parser->data;
+    return parser->data > start;
+}
+
+
+static bool baseline_string(struct baseline * parser)
+{
+    ++parser->data;
+    while (parser->data < parser->end)
+    {
+        char const c = *parser->data++;
+        if (c == '"')
+        {
+            ++parser->count;
+            return true;
+        }
+        if (c == '\\')
+            ++parser->data;
+    }
+    return false;
+}
+
+
+static bool baseline_number(struct baseline * parser)
+{
+    if (*parser->data == '-')
+        ++parser->data;
+    if (parser->data < parser->end && *parser->data == '0')
+        ++parser->data;
+    else if (!baseline_digits(parser))
+        return false;
+    if (parser->data < parser->end && *parser->data == '.')
+    {
+        ++parser->data;
+        if (!baseline_digits(parser))
+            return false;
+    }
+    if (parser->data < parser->end && (*parser->data == 'e' || *parser->data == 'E'))
+    {
+        ++parser->data;
+        if (parser->data < parser->end && (*parser->data == '+' || *parser->data == '-'))
+            ++parser->data;
+        if (!baseline_digits(parser))
+            return false;
+    }
+    ++parser->count;
+    return true;
+}
+
+
+static bool baseline_literal(struct baseline * parser, char const * literal)
+{
+    size_t const size = strlen(literal);
+    if ((size_t)(parser->end - parser->data) < size || memcmp(parser->data, literal, size) != 0)
+        return false;
+    parser->data += size;
+    ++parser->count;
+    return true;
+}
+
+
+static bool baseline_value(struct baseline * parser);
+
+
+// Parse the members of an object or the values of an array up to `close`.
+static bool baseline_container(struct baseline * parser, char close)
+{
+    ++parser->data;
+    ++parser->count;
+    baseline_skip_spaces(parser);
+    if (parser->data < parser->end && *parser->data == close)
+    {
+        ++parser->data;
+        ++parser->count;
+        return true;
+    }
+
+    while (true)
+    {
+        if (close == '}')
+        {
+            if (parser->data == parser->end || *parser->data != '"' || !baseline_string(parser))
+                return false;
+            baseline_skip_spaces(parser);
+            if (parser->data == parser->end || *parser->data++ != ':')
+                return false;
+        }
+        if (!baseline_value(parser))
+            return false;
+        baseline_skip_spaces(parser);
+        if (parser->data == parser->end)
+            return false;
+        char const c = *parser->data++;
+        if (c == close)
+        {
+            ++parser->count;
+            return true;
+        }
+        if (c != ',')
+            return false;
+        baseline_skip_spaces(parser);
+    }
+}
+
+
+static bool baseline_value(struct baseline * parser)
+{
+    baseline_skip_spaces(parser);
+    if (parser->data == parser->end)
+        return false;
+    switch (*parser->data)
+    {
+        case '{':
+            return baseline_container(parser, '}');
+        case '[':
+            return baseline_container(parser, ']');
+        case '"':
+            return baseline_string(parser);
+        case 't':
+            return baseline_literal(parser, "true");
+        case 'f':
+            return baseline_literal(parser, "false");
+        case 'n':
+            return baseline_literal(parser, "null");
+        default:
+            return baseline_number(parser);
+    }
+}
+
+
+static size_t baseline_count(struct string const * string)
+{
+    struct baseline parser = {string->data, string->data + string->size, 0};
+    CHECK(baseline_value(&parser));
+    baseline_skip_spaces(&parser);
+    CHECK(parser.data == parser.end);
+    return parser.count;
+}
+
+
+static void bench_baseline_func()
+{
+    CHECK(baseline_count(&input) == expected_count);
+}
+
+
+static void bench_json_reader_func()
+{
+    struct json_reader reader;
+    json_reader_init(&reader);
+    json_reader_feed(&reader, &input, true);
+
+    size_t count = 0;
+    struct json_token token;
+    enum json_rc rc;
+    while ((rc = json_reader_next(&reader, &token)) == JSON_RC_TOKEN)
+        ++count;
+    CHECK(rc == JSON_RC_END);
+    CHECK(count == expected_count);
+    json_reader_free(&reader);
+}
+
+
+static void bench_json_reader_batch_func()
+{
+    struct json_reader reader;
+    json_reader_init(&reader);
+    json_reader_feed(&reader, &input, true);
+
+    size_t count = 0;
+    struct json_token tokens[BATCH_SIZE];
+    size_t stored;
+    enum json_rc rc;
+    while ((rc = json_reader_next_batch(&reader, tokens, BATCH_SIZE, &stored)) == JSON_RC_TOKEN)
+        count += stored;
+    CHECK(rc == JSON_RC_END);
+    CHECK(count + stored == expected_count);
+    json_reader_free(&reader);
+}
+
+
+static void bench_json_reader_chunks_func()
+{
+    struct json_reader reader;
+    json_reader_init(&reader);
+    struct string chunk = {input.data, 0};
+    json_reader_feed(&reader, &chunk, false);
+
+    size_t count = 0;
+    struct json_token token;
+    enum json_rc rc;
+    while ((rc = json_reader_next(&reader, &token)) != JSON_RC_END)
+    {
+        if (rc == JSON_RC_TOKEN)
+        {
+            ++count;
+            continue;
+        }
+        CHECK(rc == JSON_RC_NEED_INPUT);
+        chunk.data += chunk.size;
+        size_t const left = (size_t)(input.data + input.size - chunk.data);
+        chunk.size = (left < CHUNK_SIZE) ? left : CHUNK_SIZE;
+        json_reader_feed(&reader, &chunk, chunk.size == left);
+    }
+    CHECK(count == expected_count);
+    json_reader_free(&reader);
+}
+
+
+static void bench_json_reader()
+{
+    benchmark_init(__func__);
+
+    struct
+    {
+        char const * name;
+        void (*append_value)(struct string_builder *);
+    } const inputs[] = {
+        {"twitter", append_tweet},
+        {"citm", append_event},
+        {"canada", append_coordinates},
+    };
+
+    char name[64];
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i)
+    {
+        make_input(inputs[i].append_value);
+        expected_count = baseline_count(&input);
+        printf(" %s: %zu tokens in %zu bytes\n", inputs[i].name, expected_count, input.size);
+        snprintf(name, sizeof(name), "baseline %s", inputs[i].name);
+        BENCH_THROUGHPUT(bench_baseline_func, name, input.size);
+        for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        {
+            snprintf(name, sizeof(name), "whole %s %s", inputs[i].name, cpu_isa_to_string(isa));
+            BENCH_THROUGHPUT(bench_json_reader_func, name, input.size);
+            snprintf(name, sizeof(name), "batch %s %s", inputs[i].name, cpu_isa_to_string(isa));
+            BENCH_THROUGHPUT(bench_json_reader_batch_func, name, input.size);
+            snprintf(name, sizeof(name), "chunks %s %s", inputs[i].name, cpu_isa_to_string(isa));
+            BENCH_THROUGHPUT(bench_json_reader_chunks_func, name, input.size);
+        }
+        cpu_isa_set(cpu_isa_supported());
+        string_free(&input);
+    }
+}
+
+
+int main()
+{
+    bench_json_reader();
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Needed for hsearch, which the hash map is compared against.
+#define _GNU_SOURCE
+
+#include <search.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/map.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// The keys are "k0", "k1", ... stored one after another with a '\0' after
+// each so they can also be used as C strings. Every call looks up LOOKUPS
+// random keys, all of which are present.
+#define MAX_KEYS 10000000
+#define LOOKUPS 8
+
+// A linear scan of more keys than this is too slow to measure.
+#define MAX_LINEAR_KEYS 100
+
+
+static char * key_data;
+static struct string * keys;
+static size_t key_count;
+static struct string_map map;
+static unsigned seed = 12345;
+
+
+// Copy LOOKUPS random keys to `queries`.
+static void random_queries(struct string * queries)
+{
+    for (size_t i = 0; i < LOOKUPS; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        queries[i] = keys[(((size_t)seed << 16) ^ (seed >> 16)) % key_count];
+    }
+}
+
+
+static void bench_string_map_find_func()
+{
+    struct string queries[LOOKUPS];
+    random_queries(queries);
+    for (size_t i = 0; i < LOOKUPS; ++i)
+        CHECK(string_map_find(&map, queries + i) != NULL);
+}
+
+
+static void bench_string_map_find_batch_func()
+{
+    struct string queries[LOOKUPS];
+    struct string_map_entry * found[LOOKUPS];
+    random_queries(queries);
+    CHECK(string_map_find_batch(found, &map, queries, LOOKUPS) == LOOKUPS);
+}
+
+
+static void bench_hsearch_func()
+{
+    struct string queries[LOOKUPS];
+    random_queries(queries);
+    for (size_t i = 0; i < LOOKUPS; ++i)
+        CHECK(hsearch((ENTRY){.key = queries[i].data}, FIND) != NULL);
+}
+
+
+static void bench_linear_scan_func()
+{
+    // The same strcmp scan as parse_enum().
+    struct string queries[LOOKUPS];
+    random_queries(queries);
+    for (size_t i = 0; i < LOOKUPS; ++i)
+    {
+        size_t k = 0;
+        while (k < key_count && strcmp(keys[k].data, queries[i].data) != 0)
+            ++k;
+        CHECK(k < key_count);
+    }
+}
+
+
+static void bench_string_map()
+{
+    benchmark_init(__func__);
+
+    key_data = malloc((size_t)MAX_KEYS * 10);
+    keys = malloc(MAX_KEYS * sizeof(*keys));
+    CHECK(key_data != NULL && keys != NULL);
+    char * next = key_data;
+    for (size_t i = 0; i < MAX_KEYS; ++i)
+    {
+        keys[i].data = next;
+        keys[i].size = (size_t)sprintf(next, "k%zu", i);
+        next += keys[i].size + 1;
+    }
+
+    char name[64];
+    for (key_count = 10; key_count <= MAX_KEYS; key_count *= 10)
+    {
+        string_map_init(&map);
+        CHECK(string_map_reserve(&map, key_count));
+        CHECK(hcreate(2 * key_count) != 0);
+        for (size_t i = 0; i < key_count; ++i)
+        {
+            CHECK(string_map_insert(&map, keys + i, keys + i));
+            CHECK(hsearch((ENTRY){.key = keys[i].data, .data = keys + i}, ENTER) != NULL);
+        }
+
+        snprintf(name, sizeof(name), "map find %zu", key_count);
+        BENCH_WITH_NAME(bench_string_map_find_func, name);
+        snprintf(name, sizeof(name), "map find_batch %zu", key_count);
+        BENCH_WITH_NAME(bench_string_map_find_batch_func, name);
+        snprintf(name, sizeof(name), "hsearch %zu", key_count);
+        BENCH_WITH_NAME(bench_hsearch_func, name);
+        if (key_count <= MAX_LINEAR_KEYS)
+        {
+            snprintf(name, sizeof(name), "linear scan %zu", key_count);
+            BENCH_WITH_NAME(bench_linear_scan_func, name);
+        }
+
+        hdestroy();
+        string_map_free(&map);
+    }
+
+    free(keys);
+    free(key_data);
+}
+
+
+int main()
+{
+    bench_string_map();
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/matcher.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// The text is 1 MiB of random lower case words separated by spaces, about
+// one in a hundred of which is one of the patterns. The patterns are random
+// words of 4 to 12 letters.
+#define TEXT_SIZE ((size_t)1 << 20)
+#define MAX_PATTERNS 10000
+
+
+static struct string text;
+static struct string patterns[MAX_PATTERNS];
+static struct string replacements[MAX_PATTERNS];
+static size_t pattern_count;
+static struct string_matcher * matcher;
+static size_t expected;
+static unsigned seed = 12345;
+
+
+static unsigned next_random()
+{
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+
+static void random_word(struct string * word)
+{
+    string_make(word, 4 + next_random() % 9);
+    CHECK(word->data != NULL);
+    for (size_t i = 0; i < word->size; ++i)
+        word->data[i] = (char)('a' + next_random() % 26);
+}
+
+
+// Make the patterns and write a new text that contains some of them.
+static void inputs_init(size_t count)
+{
+    for (size_t i = 0; i < pattern_count; ++i)
+        string_free(patterns + i);
+    pattern_count = count;
+    for (size_t i = 0; i < pattern_count; ++i)
+    {
+        random_word(patterns + i);
+        replacements[i] = string_literal("<keyword>");
+    }
+
+    size_t i = 0;
+    while (i < text.size)
+    {
+        struct string word;
+        bool keyword = next_random() % 100 == 0;
+        if (keyword)
+            word = patterns[next_random() % pattern_count];
+        else
+            random_word(&word);
+        size_t size = (word.size < text.size - i) ? word.size : text.size - i;
+        memcpy(text.data + i, word.data, size);
+        if (!keyword)
+            string_free(&word);
+        i += size;
+        if (i < text.size)
+            text.data[i++] = ' ';
+    }
+}
+
+
+static void bench_string_matcher_find_all_func()
+{
+    struct string_match * matches;
+    CHECK(string_matcher_find_all(&matches, matcher, &text) == expected);
+    free(matches);
+}
+
+
+static void bench_string_find_all_func()
+{
+    // The baseline scans the text once per pattern.
+    size_t count = 0;
+    for (size_t i = 0; i < pattern_count; ++i)
+    {
+        size_t * offsets;
+        count += string_find_all(&offsets, &text, patterns + i);
+        free(offsets);
+    }
+    CHECK(count == expected);
+}
+
+
+static void bench_string_matcher_replace_all_func()
+{
+    struct string output;
+    CHECK(string_matcher_replace_all(&output, matcher, &text, replacements));
+    string_free(&output);
+}
+
+
+static void bench_string_matcher()
+{
+    benchmark_init(__func__);
+
+    string_make(&text, TEXT_SIZE);
+    CHECK(text.data != NULL);
+
+    char name[64];
+    for (size_t count = 1; count <= MAX_PATTERNS; count *= 10)
+    {
+        inputs_init(count);
+        matcher = string_matcher_make(patterns, pattern_count);
+        CHECK(matcher != NULL);
+
+        struct string_match * matches;
+        expected = string_matcher_find_all(&matches, matcher, &text);
+        free(matches);
+
+        snprintf(name, sizeof(name), "find_all %zu patterns", count);
+        BENCH_THROUGHPUT(bench_string_matcher_find_all_func, name, text.size);
+
+        // Scanning once per pattern becomes too slow to measure beyond this.
+        if (count <= 1000)
+        {
+            snprintf(name, sizeof(name), "per-pattern %zu patterns", count);
+            BENCH_THROUGHPUT(bench_string_find_all_func, name, text.size);
+        }
+
+        snprintf(name, sizeof(name), "replace_all %zu patterns", count);
+        BENCH_THROUGHPUT(bench_string_matcher_replace_all_func, name, text.size);
+
+        string_matcher_free(matcher);
+    }
+
+    for (size_t i = 0; i < pattern_count; ++i)
+        string_free(patterns + i);
+    string_free(&text);
+}
+
+
+// The routing benchmark routes 64 Ki paths to the longest of 10 to 100,000
+// prefixes. The prefixes are paths of 1 to 4 segments drawn from 64 words,
+// so many of them share their first segments, and about half the paths
+// start with one of them.
+#define ROUTE_COUNT ((size_t)1 << 16)
+#define MAX_PREFIXES 100000
+
+
+static struct string * prefixes;
+static size_t prefix_count;
+static struct string routes[ROUTE_COUNT];
+static size_t loop_route_count;
+static struct string_prefix_matcher * router;
+static size_t routed;
+static size_t loop_routed;
+
+
+static void random_path(char * data, size_t * size, size_t segments)
+{
+    static char const * const words[] = {
+        "api", "v1", "v2", "users", "items", "orders", "static", "images", "css", "js", "admin",
+        "login", "logout", "search", "cart", "checkout", "blog", "posts", "tags", "archive",
+        "feed", "rss", "help", "docs", "about", "contact", "jobs", "press", "legal", "terms",
+        "privacy", "status", "health", "metrics", "debug", "assets", "fonts", "video", "audio",
+        "upload", "files", "share", "groups", "events", "maps", "news", "sports", "weather",
+        "shop", "deals", "brands", "reviews", "wiki", "forum", "topics", "threads", "inbox",
+        "sent", "drafts", "spam", "trash", "notes", "tasks", "home"};
+    for (size_t s = 0; s < segments; ++s)
+    {
+        char const * word = words[next_random() % 64];
+        data[(*size)++] = '/';
+        memcpy(data + *size, word, strlen(word));
+        *size += strlen(word);
+    }
+}
+
+
+static void bench_string_prefix_matcher_longest_func()
+{
+    size_t count = 0;
+    for (size_t i = 0; i < ROUTE_COUNT; ++i)
+        count += string_prefix_matcher_longest(router, routes + i) != STRING_NPOS;
+    CHECK(count == routed);
+}
+
+
+static void bench_string_starts_with_func()
+{
+    // The baseline tests every prefix in turn and keeps the longest.
+    size_t count = 0;
+    for (size_t i = 0; i < loop_route_count; ++i)
+    {
+        size_t longest = STRING_NPOS;
+        for (size_t p = 0; p < prefix_count; ++p)
+            if (string_starts_with(routes + i, prefixes + p) &&
+                (longest == STRING_NPOS || prefixes[p].size > prefixes[longest].size))
+                longest = p;
+        count += longest != STRING_NPOS;
+    }
+    CHECK(count == loop_routed);
+}
+
+
+static void bench_string_prefix_matcher()
+{
+    benchmark_init(__func__);
+
+    char * prefix_data = malloc(MAX_PREFIXES * 48);
+    char * route_data = malloc(ROUTE_COUNT * 80);
+    prefixes = malloc(MAX_PREFIXES * sizeof(*prefixes));
+    CHECK(prefix_data != NULL && route_data != NULL && prefixes != NULL);
+
+    char name[64];
+    for (prefix_count = 10; prefix_count <= MAX_PREFIXES; prefix_count *= 100)
+    {
+        for (size_t p = 0; p < prefix_count; ++p)
+        {
+            size_t size = 0;
+            random_path(prefix_data + 48 * p, &size, 1 + next_random() % 4);
+            prefixes[p] = (struct string){prefix_data + 48 * p, size};
+        }
+
+        size_t bytes = 0;
+        for (size_t i = 0; i < ROUTE_COUNT; ++i)
+        {
+            char * data = route_data + 80 * i;
+            size_t size = 0;
+            if (next_random() % 2 == 0)
+            {
+                struct string const * prefix = prefixes + next_random() % prefix_count;
+                memcpy(data, prefix->data, prefix->size);
+                size = prefix->size;
+            }
+            random_path(data, &size, 1 + next_random() % 3);
+            routes[i] = (struct string){data, size};
+            bytes += size;
+        }
+
+        router = string_prefix_matcher_make(prefixes, prefix_count);
+        CHECK(router != NULL);
+
+        routed = 0;
+        for (size_t i = 0; i < ROUTE_COUNT; ++i)
+            routed += string_prefix_matcher_longest(router, routes + i) != STRING_NPOS;
+        snprintf(name, sizeof(name), "trie %zu prefixes", prefix_count);
+        BENCH_THROUGHPUT(bench_string_prefix_matcher_longest_func, name, bytes);
+
+        // Testing every prefix costs a hundred times more per byte with each
+        // step, so beyond 1,000 prefixes only as many routes are tested as
+        // keep the number of tests per call the same, and only a few calls
+        // are measured. The throughput is per byte of those routes, so it's
+        // still comparable.
+        loop_route_count = ROUTE_COUNT;
+        if (prefix_count > 1000)
+            loop_route_count = ROUTE_COUNT * 1000 / prefix_count;
+        size_t loop_bytes = 0;
+        loop_routed = 0;
+        for (size_t i = 0; i < loop_route_count; ++i)
+        {
+            loop_bytes += routes[i].size;
+            loop_routed += string_prefix_matcher_longest(router, routes + i) != STRING_NPOS;
+        }
+        snprintf(name, sizeof(name), "loop %zu prefixes", prefix_count);
+        if (prefix_count <= 1000)
+            BENCH_THROUGHPUT(bench_string_starts_with_func, name, loop_bytes);
+        else
+            BENCH_THROUGHPUT_CALLS(bench_string_starts_with_func, name, loop_bytes, 5);
+
+        string_prefix_matcher_free(router);
+    }
+
+    free(prefixes);
+    free(route_data);
+    free(prefix_data);
+}
+
+
+int main()
+{
+    bench_string_matcher();
+    bench_string_prefix_matcher();
+    return 0;
+}
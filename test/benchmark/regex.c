@@ -0,0 +1,138 @@
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/regex.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// The input is about 16 MiB of log lines. Each pattern is matched against
+// every line, with string_regex_is_match() and with POSIX regexec(), which
+// is given the bounds of the line with REG_STARTEND so it needn't be copied.
+#define INPUT_SIZE ((size_t)16 << 20)
+
+
+static struct string * lines;
+static size_t line_count;
+static size_t input_size;
+static struct string_regex * regex;
+static regex_t posix;
+static size_t expected_count;
+static unsigned seed = 12345;
+
+
+static unsigned next_random()
+{
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+
+static void make_input(char * data)
+{
+    static char const * const levels[] = {"INFO ", "INFO ", "INFO ", "DEBUG", "WARN ", "ERROR"};
+    static char const * const methods[] = {"GET", "GET", "POST", "PUT", "DELETE"};
+    static char const * const paths[] = {"users", "orders", "items", "search", "health"};
+    static char const * const users[] = {"alice", "bob", "carol", "dave", "erin", "mallory"};
+    static unsigned const statuses[] = {200, 200, 200, 201, 304, 404, 500, 503};
+
+    line_count = 0;
+    input_size = 0;
+    while (input_size + 256 < INPUT_SIZE)
+    {
+        char * line = data + input_size;
+        int const size = snprintf(
+            line, 256,
+            "2024-%02u-%02uT%02u:%02u:%02u.%03uZ %s [worker-%u] %s /api/%s/%u %u took %ums "
+            "user=%s",
+            1 + next_random() % 12, 1 + next_random() % 28, next_random() % 24,
+            next_random() % 60, next_random() % 60, next_random() % 1000,
+            levels[next_random() % 6], next_random() % 16, methods[next_random() % 5],
+            paths[next_random() % 5], next_random() % 100000, statuses[next_random() % 8],
+            (next_random() % 100 == 0) ? 1000 + next_random() % 9000 : next_random() % 500,
+            users[next_random() % 6]);
+        lines[line_count++] = (struct string){line, (size_t)size};
+        line[size] = '\n';
+        input_size += (size_t)size + 1;
+    }
+}
+
+
+static void bench_string_regex_is_match_func()
+{
+    size_t count = 0;
+    for (size_t i = 0; i < line_count; ++i)
+        count += string_regex_is_match(regex, lines + i);
+    CHECK(count == expected_count);
+}
+
+
+static void bench_regexec_func()
+{
+    size_t count = 0;
+    for (size_t i = 0; i < line_count; ++i)
+    {
+        regmatch_t bounds = {0, (regoff_t)lines[i].size};
+        count += regexec(&posix, lines[i].data, 1, &bounds, REG_STARTEND) == 0;
+    }
+    CHECK(count == expected_count);
+}
+
+
+static void bench_string_regex()
+{
+    benchmark_init(__func__);
+
+    char * data = malloc(INPUT_SIZE);
+    lines = malloc(INPUT_SIZE / 64 * sizeof(*lines));
+    CHECK(data != NULL && lines != NULL);
+    make_input(data);
+
+    // A literal, a literal prefix, alternatives with a common prefix, a
+    // pattern without one, an anchored pattern and a pattern that only
+    // rarely matches.
+    char const * const patterns[] = {
+        "ERROR",
+        "took [0-9]+ms",
+        "(POST|PUT) /api/[a-z]+/[0-9]+ 5[0-9][0-9]",
+        "[a-z]+/[0-9]+ 50[0-9]",
+        "^[0-9]{4}-[0-9]{2}-[0-9]{2}T[^ ]+ (WARN|ERROR)",
+        "took [0-9]{4,}ms user=(alice|bob)$",
+    };
+    char const * const names[] = {"literal", "prefix", "alternatives", "no prefix", "anchored",
+                                 "rare"};
+    char name[64];
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(*patterns); ++p)
+    {
+        struct string pattern;
+        string_view_cstr(&pattern, (char *)patterns[p]);
+        regex = string_regex_make(&pattern);
+        CHECK(regex != NULL);
+        CHECK(regcomp(&posix, patterns[p], REG_EXTENDED | REG_NOSUB) == 0);
+
+        expected_count = 0;
+        for (size_t i = 0; i < line_count; ++i)
+            expected_count += string_regex_is_match(regex, lines + i);
+        printf(" %s: %zu of %zu lines match\n", names[p], expected_count, line_count);
+
+        snprintf(name, sizeof(name), "regex %s", names[p]);
+        BENCH_THROUGHPUT(bench_string_regex_is_match_func, name, input_size);
+        snprintf(name, sizeof(name), "regexec %s", names[p]);
+        BENCH_THROUGHPUT(bench_regexec_func, name, input_size);
+        regfree(&posix);
+        string_regex_free(regex);
+    }
+
+    free(lines);
+    free(data);
+}
+
+
+int main()
+{
+    bench_string_regex();
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/rope.h"
+#include "util/string.h"
+
+#include "test/benchmark.h"
+
+
+// Each edit inserts a short string at a random position and erases as many
+// bytes at another, so the size of the text stays the same. The flat
+// baseline makes the same edits to one contiguous buffer with memmove.
+#define EDIT_SIZE 16
+#define CHUNK_SIZE ((size_t)1 << 20)
+
+
+static struct rope rope;
+static struct string flat;
+static size_t text_size;
+static unsigned seed = 12345;
+
+
+static size_t next_position(size_t size)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (((size_t)seed << 16) ^ (seed >> 16)) % (size + 1);
+}
+
+
+static void bench_rope_edit_func()
+{
+    CHECK(rope_insert(&rope, next_position(text_size), &string_literal("0123456789abcdef")));
+    size_t from = next_position(text_size);
+    rope_erase(&rope, from, from + EDIT_SIZE);
+}
+
+
+static void bench_flat_edit_func()
+{
+    size_t position = next_position(text_size);
+    memmove(flat.data + position + EDIT_SIZE, flat.data + position, text_size - position);
+    memcpy(flat.data + position, "0123456789abcdef", EDIT_SIZE);
+    size_t from = next_position(text_size);
+    memmove(flat.data + from, flat.data + from + EDIT_SIZE, text_size - from);
+}
+
+
+static void bench_rope_flatten_func()
+{
+    struct string result;
+    CHECK(rope_flatten(&result, &rope));
+    string_free(&result);
+}
+
+
+static void bench_rope()
+{
+    benchmark_init(__func__);
+
+    struct string chunk;
+    string_make(&chunk, CHUNK_SIZE);
+    CHECK(chunk.data != NULL);
+    memset(chunk.data, 'x', chunk.size);
+
+    char name[64];
+    size_t const sizes[] = {(size_t)1 << 20, (size_t)100 << 20, (size_t)1 << 30};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); ++s)
+    {
+        // Build the rope a chunk at a time so there's only ever one copy of the text.
+        text_size = sizes[s];
+        rope_init(&rope);
+        for (size_t size = 0; size < text_size; size += CHUNK_SIZE)
+            CHECK(rope_insert(&rope, size, &chunk));
+        text_size -= EDIT_SIZE;
+        rope_erase(&rope, text_size, text_size + EDIT_SIZE);
+
+        snprintf(name, sizeof(name), "rope edit %zu MiB", sizes[s] >> 20);
+        BENCH_WITH_NAME(bench_rope_edit_func, name);
+        snprintf(name, sizeof(name), "rope flatten %zu MiB", sizes[s] >> 20);
+        BENCH_THROUGHPUT(bench_rope_flatten_func, name, text_size);
+        rope_free(&rope);
+
+        // Each flat edit moves half the text on average for each of two memmoves.
+        string_make(&flat, text_size + EDIT_SIZE);
+        CHECK(flat.data != NULL);
+        memset(flat.data, 'x', flat.size);
+        snprintf(name, sizeof(name), "flat edit %zu MiB", sizes[s] >> 20);
+        BENCH_THROUGHPUT(bench_flat_edit_func, name, text_size);
+        string_free(&flat);
+    }
+
+    string_free(&chunk);
+}
+
+
+int main()
+{
+    bench_rope();
+    return 0;
+}
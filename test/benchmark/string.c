@@ -1,6 +1,16 @@
+// Needed for memmem and strncasecmp, which the searches and comparisons are
+// compared against.
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
+#include "util/cpu.h"
 #include "util/string.h"
+#include "util/util.h"
 
 #include "test/benchmark.h"
 
@@ -60,6 +70,159 @@ static void bench_string_view_slice()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Small strings
+////////////////////////////////////////////////////////////////////////////////
+
+
+static struct sso_string sso_output;
+
+
+static void bench_string_copy_func()
+{
+    string_copy(&slice_output, &slice_input);
+    CHECK(slice_output.size == slice_input.size);
+    string_free(&slice_output);
+}
+
+
+static void bench_sso_string_copy_func()
+{
+    sso_string_copy(&sso_output, &slice_input);
+    CHECK(sso_output.string.size == slice_input.size);
+    sso_string_free(&sso_output);
+}
+
+
+static void bench_sso_string_copy_slice_func()
+{
+    sso_string_copy_slice(&sso_output, &slice_input, slice_from, slice_to);
+    CHECK(sso_output.string.size == (slice_to - slice_from));
+    sso_string_free(&sso_output);
+}
+
+
+static void bench_sso_string()
+{
+    benchmark_init(__func__);
+
+    slice_input = string_literal("Info");
+    BENCH_WITH_NAME(bench_string_copy_func, "string_copy 4");
+    BENCH_WITH_NAME(bench_sso_string_copy_func, "sso_string_copy 4");
+
+    slice_input = string_literal("content-type-options");
+    BENCH_WITH_NAME(bench_string_copy_func, "string_copy 20");
+    BENCH_WITH_NAME(bench_sso_string_copy_func, "sso_string_copy 20");
+
+    slice_input = string_literal("0123456789abcdef0123456789abcdef");
+    BENCH_WITH_NAME(bench_string_copy_func, "string_copy 32");
+    BENCH_WITH_NAME(bench_sso_string_copy_func, "sso_string_copy 32");
+
+    slice_input = string_literal("0123456789");
+    slice_from = 1;
+    slice_to = 8;
+    BENCH_WITH_NAME(bench_string_copy_slice_func, "string_copy_slice 7");
+    BENCH_WITH_NAME(bench_sso_string_copy_slice_func, "sso_string_copy_slice 7");
+
+    // Report how many of a typical set of keys still need a heap allocation.
+    char const * keys[] = {
+        "Info", "Warning", "--log-level", "LOG_LEVEL", "true", "content-type",
+        "x-request-id", "accept-encoding", "user_id", "timestamp", "ENV_RC_INVALID_VALUE",
+        "a-rather-long-header-field-name", "PARSE_UINT32", "0", "https://example.com/index.html",
+    };
+    size_t allocations = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(keys); ++i)
+    {
+        sso_string_copy_cstr(&sso_output, keys[i]);
+        allocations += !sso_string_is_inline(&sso_output);
+        sso_string_free(&sso_output);
+    }
+    printf(" heap allocations for %zu typical keys: string_copy %zu, sso_string_copy %zu\n",
+           ARRAY_SIZE(keys), ARRAY_SIZE(keys), allocations);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Building
+////////////////////////////////////////////////////////////////////////////////
+
+
+// Each benchmark builds a string from build_count copies of a short piece.
+static struct string build_piece = {"piece-12", 8};
+static struct string * build_pieces;
+static size_t build_count;
+
+
+static void bench_string_builder_func()
+{
+    struct string_builder builder;
+    string_builder_init(&builder);
+    for (size_t i = 0; i < build_count; ++i)
+        CHECK(string_builder_append(&builder, &build_piece));
+
+    struct string result;
+    string_builder_finish(&builder, &result);
+    CHECK(result.size == build_count * build_piece.size);
+    string_free(&result);
+}
+
+
+static void bench_string_join_repeated_func()
+{
+    // Appending with string_join copies everything built so far on every append.
+    struct string result = {NULL, 0};
+    for (size_t i = 0; i < build_count; ++i)
+    {
+        struct string joined;
+        string_join(&joined, result, build_piece);
+        string_free(&result);
+        result = joined;
+    }
+    CHECK(result.size == build_count * build_piece.size);
+    string_free(&result);
+}
+
+
+static void bench_string_join_array_func()
+{
+    // string_join_array is only an option when all the pieces are known up front.
+    struct string result;
+    string_join_array(&result, build_pieces, build_count);
+    CHECK(result.size == build_count * build_piece.size);
+    string_free(&result);
+}
+
+
+static void bench_string_builder()
+{
+    benchmark_init(__func__);
+
+    build_pieces = malloc(1000000 * sizeof(struct string));
+    CHECK(build_pieces != NULL);
+    for (size_t i = 0; i < 1000000; ++i)
+        build_pieces[i] = build_piece;
+
+    char name[64];
+    for (build_count = 1000; build_count <= 1000000; build_count *= 10)
+    {
+        size_t bytes = build_count * build_piece.size;
+        snprintf(name, sizeof(name), "builder %zu pieces", build_count);
+        BENCH_THROUGHPUT(bench_string_builder_func, name, bytes);
+        snprintf(name, sizeof(name), "join_array %zu pieces", build_count);
+        BENCH_THROUGHPUT(bench_string_join_array_func, name, bytes);
+
+        // Repeated joins take quadratic time, so stop before they get too slow.
+        if (build_count <= 1000)
+        {
+            snprintf(name, sizeof(name), "join repeated %zu pieces", build_count);
+            BENCH_THROUGHPUT(bench_string_join_repeated_func, name, bytes);
+        }
+    }
+
+    free(build_pieces);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // Splitting
 ////////////////////////////////////////////////////////////////////////////////
@@ -163,12 +326,618 @@ static void bench_string_view_split()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Large inputs
+////////////////////////////////////////////////////////////////////////////////
+
+
+// The large-input benchmarks use sizes from 1 KiB to 64 MiB in steps of 4x.
+#define LARGE_INPUT_MIN_SIZE ((size_t)1 << 10)
+#define LARGE_INPUT_MAX_SIZE ((size_t)64 << 20)
+
+
+static struct string large_input;
+static struct string large_buffer;
+static char large_pivot = '\n';
+static size_t large_expected;
+
+
+// Fill large_buffer with lines of printable characters between 0 and 126 bytes long.
+static void large_buffer_init()
+{
+    string_make(&large_buffer, LARGE_INPUT_MAX_SIZE);
+    CHECK(large_buffer.data != NULL);
+
+    unsigned seed = 12345;
+    size_t line_end = 0;
+    for (size_t i = 0; i < large_buffer.size; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        if (i == line_end)
+        {
+            large_buffer.data[i] = '\n';
+            line_end = i + 1 + (seed >> 16) % 127;
+        }
+        else
+            large_buffer.data[i] = (char)(' ' + 1 + (seed >> 16) % 94);
+    }
+}
+
+
+// Format the name of a large-input benchmark in a static buffer.
+static char const * large_name(enum cpu_isa isa, size_t size)
+{
+    static char name[32];
+    if (size >= ((size_t)1 << 20))
+        snprintf(name, sizeof(name), "%s %zuMiB", cpu_isa_to_string(isa), size >> 20);
+    else
+        snprintf(name, sizeof(name), "%s %zuKiB", cpu_isa_to_string(isa), size >> 10);
+    return name;
+}
+
+
+static void bench_string_count_char_func()
+{
+    CHECK(string_count_char(&large_input, large_pivot) == large_expected);
+}
+
+
+static void bench_string_count_char()
+{
+    benchmark_init(__func__);
+
+    for (size_t size = LARGE_INPUT_MIN_SIZE; size <= LARGE_INPUT_MAX_SIZE; size *= 4)
+    {
+        string_view_slice(&large_input, &large_buffer, 0, size);
+        for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        {
+            large_expected = string_count_char(&large_input, large_pivot);
+            BENCH_THROUGHPUT(bench_string_count_char_func, large_name(isa, size), size);
+        }
+        cpu_isa_set(cpu_isa_supported());
+    }
+}
+
+
+static void bench_string_view_split_large_func()
+{
+    size_t out_size = string_view_split(&split_output, &large_input, large_pivot);
+    CHECK(out_size == large_expected);
+    free(split_output);
+}
+
+
+static void bench_string_view_split_large()
+{
+    benchmark_init(__func__);
+
+    for (size_t size = LARGE_INPUT_MIN_SIZE; size <= LARGE_INPUT_MAX_SIZE; size *= 4)
+    {
+        string_view_slice(&large_input, &large_buffer, 0, size);
+        for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        {
+            large_expected = string_count_char(&large_input, large_pivot) + 1;
+            BENCH_THROUGHPUT(bench_string_view_split_large_func, large_name(isa, size), size);
+        }
+        cpu_isa_set(cpu_isa_supported());
+    }
+}
+
+
+static struct string_char_set large_delimiters;
+
+
+static void bench_string_view_split_any_func()
+{
+    size_t out_size = string_view_split_any(&split_output, &large_input, &large_delimiters, false);
+    CHECK(out_size == large_expected);
+    free(split_output);
+}
+
+
+static void bench_string_view_split_any()
+{
+    benchmark_init(__func__);
+
+    // Split about whitespace and common field separators. The benchmark input
+    // has no tabs or carriage returns but does contain the other delimiters.
+    string_char_set_init_cstr(&large_delimiters, " \t\r\n,;|");
+    for (size_t size = (size_t)1 << 20; size <= LARGE_INPUT_MAX_SIZE; size *= 64)
+    {
+        string_view_slice(&large_input, &large_buffer, 0, size);
+        for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        {
+            large_expected = string_count_any(&large_input, &large_delimiters) + 1;
+            BENCH_THROUGHPUT(bench_string_view_split_any_func, large_name(isa, size), size);
+        }
+        cpu_isa_set(cpu_isa_supported());
+    }
+}
+
+
+// Count every piece of large_input, or only the first large_expected pieces when
+// large_early_exit is set, to model a consumer that stops early.
+static bool large_early_exit;
+
+
+static void bench_string_split_iter_func()
+{
+    struct string_split_iter iter;
+    struct string piece;
+    size_t count = 0;
+    string_split_iter_init(&iter, &large_input, large_pivot);
+    while (string_split_iter_next(&iter, &piece))
+        if (++count == large_expected && large_early_exit)
+            break;
+    CHECK(count == large_expected);
+}
+
+
+static void bench_string_view_split_first_func()
+{
+    size_t out_size = string_view_split(&split_output, &large_input, large_pivot);
+    CHECK(out_size >= large_expected);
+    free(split_output);
+}
+
+
+static void bench_string_copy_split_large_func()
+{
+    size_t out_size = string_copy_split(&split_output, &large_input, large_pivot);
+    CHECK(out_size >= large_expected);
+    free(split_output);
+}
+
+
+static void bench_string_split_iter()
+{
+    benchmark_init(__func__);
+
+    size_t size = (size_t)1 << 20;
+    string_view_slice(&large_input, &large_buffer, 0, size);
+
+    large_early_exit = false;
+    large_expected = string_count_char(&large_input, large_pivot) + 1;
+    BENCH_THROUGHPUT(bench_string_split_iter_func, "iter all", size);
+    BENCH_THROUGHPUT(bench_string_view_split_first_func, "view_split all", size);
+    BENCH_THROUGHPUT(bench_string_copy_split_large_func, "copy_split all", size);
+
+    // Only the first few pieces are needed, but the allocating split functions
+    // still have to scan and store the whole input before returning.
+    large_early_exit = true;
+    large_expected = 10;
+    BENCH_THROUGHPUT(bench_string_split_iter_func, "iter first 10", size);
+    BENCH_THROUGHPUT(bench_string_view_split_first_func, "view_split first 10", size);
+    BENCH_THROUGHPUT(bench_string_copy_split_large_func, "copy_split first 10", size);
+}
+
+
+// The index benchmarks split fields of 0 to 15 digits separated by commas,
+// so there's a piece for every 8.5 bytes of input on average.
+static struct string index_fields;
+static struct string * index_views;
+static struct string_split_index split_index;
+static size_t index_sum;
+
+
+static void bench_string_view_split_make_func()
+{
+    size_t out_size = string_view_split(&split_output, &large_input, ',');
+    CHECK(out_size == large_expected);
+    free(split_output);
+}
+
+
+static void bench_string_split_index_make_func()
+{
+    struct string_split_index index;
+    CHECK(string_split_index_make(&index, &large_input, ','));
+    CHECK(index.count == large_expected);
+    string_split_index_free(&index);
+}
+
+
+static void bench_string_view_split_read_func()
+{
+    size_t sum = 0;
+    for (size_t i = 0; i < large_expected; ++i)
+        sum += index_views[i].size + (size_t)(index_views[i].data - large_input.data);
+    CHECK(sum == index_sum);
+}
+
+
+static void bench_string_split_index_read_func()
+{
+    size_t sum = 0;
+    struct string piece;
+    for (size_t i = 0; i < split_index.count; ++i)
+    {
+        string_split_index_get(&piece, &split_index, i);
+        sum += piece.size + (size_t)(piece.data - large_input.data);
+    }
+    CHECK(sum == index_sum);
+}
+
+
+static void bench_string_split_index_range_func()
+{
+    size_t sum = 0;
+    struct string pieces[256];
+    size_t count;
+    for (size_t i = 0; i < split_index.count; i += count)
+    {
+        count = string_split_index_get_range(pieces, &split_index, i, ARRAY_SIZE(pieces));
+        for (size_t j = 0; j < count; ++j)
+            sum += pieces[j].size + (size_t)(pieces[j].data - large_input.data);
+    }
+    CHECK(sum == index_sum);
+}
+
+
+static void bench_string_split_index()
+{
+    benchmark_init(__func__);
+
+    string_make(&index_fields, LARGE_INPUT_MAX_SIZE);
+    CHECK(index_fields.data != NULL);
+    unsigned seed = 12345;
+    for (size_t i = 0; i < index_fields.size;)
+    {
+        seed = seed * 1103515245u + 12345u;
+        for (size_t size = (seed >> 16) % 16; size > 0 && i < index_fields.size; --size)
+            index_fields.data[i++] = (char)('0' + size % 10);
+        if (i < index_fields.size)
+            index_fields.data[i++] = ',';
+    }
+
+    // Making the index and the views both scan the input once, but the views
+    // write 16 bytes per piece. Reading every piece in order streams through
+    // the offsets or the views, so the smaller the index the fewer cache
+    // lines, and cache misses once it no longer fits, each piece costs. The
+    // index is read a piece at a time and in batches of 256.
+    char name[64];
+    for (size_t size = (size_t)32 << 10; size <= LARGE_INPUT_MAX_SIZE; size *= 32)
+    {
+        string_view_slice(&large_input, &index_fields, 0, size);
+        large_expected = string_count_char(&large_input, ',') + 1;
+        CHECK(string_view_split(&index_views, &large_input, ',') == large_expected);
+        CHECK(string_split_index_make(&split_index, &large_input, ','));
+
+        index_sum = 0;
+        for (size_t i = 0; i < large_expected; ++i)
+            index_sum += index_views[i].size + (size_t)(index_views[i].data - large_input.data);
+        printf(" %zu KiB, %zu pieces: views %zu bytes per piece (%zu KiB), index %zu (%zu KiB)\n",
+               size >> 10, large_expected, sizeof(struct string),
+               large_expected * sizeof(struct string) >> 10, split_index.offset_size,
+               large_expected * split_index.offset_size >> 10);
+
+        snprintf(name, sizeof(name), "view_split %zuKiB", size >> 10);
+        BENCH_THROUGHPUT(bench_string_view_split_make_func, name, size);
+        snprintf(name, sizeof(name), "index %zuKiB", size >> 10);
+        BENCH_THROUGHPUT(bench_string_split_index_make_func, name, size);
+        snprintf(name, sizeof(name), "read views %zuKiB", size >> 10);
+        BENCH_THROUGHPUT(bench_string_view_split_read_func, name, size);
+        snprintf(name, sizeof(name), "read get %zuKiB", size >> 10);
+        BENCH_THROUGHPUT(bench_string_split_index_read_func, name, size);
+        snprintf(name, sizeof(name), "read range %zuKiB", size >> 10);
+        BENCH_THROUGHPUT(bench_string_split_index_range_func, name, size);
+
+        string_split_index_free(&split_index);
+        free(index_views);
+    }
+    string_free(&index_fields);
+}
+
+
+static size_t parallel_threads;
+
+
+static void bench_string_view_split_parallel_func()
+{
+    size_t out_size = string_view_split_parallel(&split_output, &large_input, large_pivot,
+                                                 parallel_threads);
+    CHECK(out_size == large_expected);
+    free(split_output);
+}
+
+
+static void bench_string_view_split_parallel()
+{
+    benchmark_init(__func__);
+
+    // How the split scales from one thread, which is string_view_split(), to
+    // 32. The throughput can't scale past the number of cores.
+    size_t size = LARGE_INPUT_MAX_SIZE;
+    string_view_slice(&large_input, &large_buffer, 0, size);
+    large_expected = string_count_char(&large_input, large_pivot) + 1;
+
+    char name[64];
+    for (parallel_threads = 1; parallel_threads <= 32; parallel_threads *= 2)
+    {
+        snprintf(name, sizeof(name), "%zuMiB threads=%zu", size >> 20, parallel_threads);
+        BENCH_THROUGHPUT(bench_string_view_split_parallel_func, name, size);
+    }
+}
+
+
+static struct string find_needle;
+
+
+static void bench_string_find_func()
+{
+    CHECK(string_find(&large_input, &find_needle) == large_expected);
+}
+
+
+static void bench_memmem_func()
+{
+    char const * found =
+        memmem(large_input.data, large_input.size, find_needle.data, find_needle.size);
+    CHECK((size_t)(found - large_input.data) == large_expected);
+}
+
+
+static void bench_string_find()
+{
+    benchmark_init(__func__);
+
+    // The needles are the last bytes of the input, so the longer ones are only
+    // found after scanning all of it and the throughput is of the bytes scanned.
+    char name[64];
+    for (size_t size = (size_t)1 << 20; size <= LARGE_INPUT_MAX_SIZE; size *= 64)
+    {
+        string_view_slice(&large_input, &large_buffer, 0, size);
+        for (size_t needle_size = 1; needle_size <= 64; needle_size *= 2)
+        {
+            string_view_slice(&find_needle, &large_input, size - needle_size, size);
+            large_expected = string_find(&large_input, &find_needle);
+            size_t scanned = large_expected + needle_size;
+
+            snprintf(name, sizeof(name), "%s n=%zu", large_name(cpu_isa_get(), size),
+                     needle_size);
+            BENCH_THROUGHPUT(bench_string_find_func, name, scanned);
+
+            cpu_isa_set(CPU_ISA_SCALAR);
+            snprintf(name, sizeof(name), "%s n=%zu", large_name(CPU_ISA_SCALAR, size),
+                     needle_size);
+            BENCH_THROUGHPUT(bench_string_find_func, name, scanned);
+            cpu_isa_set(cpu_isa_supported());
+
+            snprintf(name, sizeof(name), "memmem %zuMiB n=%zu", size >> 20, needle_size);
+            BENCH_THROUGHPUT(bench_memmem_func, name, scanned);
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Case
+////////////////////////////////////////////////////////////////////////////////
+
+
+// The case benchmarks use the start of large_buffer, from 8 bytes to 1 MiB,
+// in lower case and compare it with the same bytes in upper case.
+static size_t const case_sizes[] = {8, 64, (size_t)1 << 10, (size_t)16 << 10, (size_t)1 << 20};
+static struct string case_input;
+static struct string case_upper;
+
+
+static void bench_string_to_lower_func()
+{
+    string_to_lower(&case_input);
+}
+
+
+static void bench_tolower_func()
+{
+    for (size_t i = 0; i < case_input.size; ++i)
+        case_input.data[i] = (char)tolower((unsigned char)case_input.data[i]);
+}
+
+
+static void bench_string_is_equal_ignore_case_func()
+{
+    CHECK(string_is_equal_ignore_case(&case_input, &case_upper));
+}
+
+
+static void bench_strncasecmp_func()
+{
+    CHECK(strncasecmp(case_input.data, case_upper.data, case_input.size) == 0);
+}
+
+
+static void bench_string_find_ignore_case_func()
+{
+    CHECK(string_find_ignore_case(&case_input, &find_needle) == large_expected);
+}
+
+
+// Format the name of a case benchmark in a static buffer.
+static char const * case_name(char const * prefix, char const * isa, size_t size)
+{
+    static char name[64];
+    if (size >= ((size_t)1 << 20))
+        snprintf(name, sizeof(name), "%s %s %zuMiB", prefix, isa, size >> 20);
+    else if (size >= ((size_t)1 << 10))
+        snprintf(name, sizeof(name), "%s %s %zuKiB", prefix, isa, size >> 10);
+    else
+        snprintf(name, sizeof(name), "%s %s %zuB", prefix, isa, size);
+    return name;
+}
+
+
+static void bench_string_case()
+{
+    benchmark_init(__func__);
+
+    // The inputs are views of a lower case and an upper case copy of large_buffer.
+    size_t const max_size = case_sizes[ARRAY_SIZE(case_sizes) - 1];
+    struct string source;
+    struct string lower;
+    struct string upper;
+    string_view_slice(&source, &large_buffer, 0, max_size);
+    string_copy_lower(&lower, &source);
+    string_copy_upper(&upper, &source);
+    CHECK(lower.data != NULL && upper.data != NULL);
+
+    for (size_t s = 0; s < ARRAY_SIZE(case_sizes); ++s)
+    {
+        size_t const size = case_sizes[s];
+        string_view_slice(&case_input, &lower, 0, size);
+        string_view_slice(&case_upper, &upper, 0, size);
+
+        // The needle is the last 8 bytes in upper case, so most of the input is scanned.
+        string_view_slice(&find_needle, &upper, size - 8, size);
+        large_expected = string_find_ignore_case(&case_input, &find_needle);
+        size_t const scanned = large_expected + 8;
+
+        for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        {
+            char const * isa_name = cpu_isa_to_string(isa);
+            BENCH_THROUGHPUT(bench_string_to_lower_func, case_name("lower", isa_name, size), size);
+            BENCH_THROUGHPUT(bench_string_is_equal_ignore_case_func,
+                             case_name("equal", isa_name, size), size);
+            BENCH_THROUGHPUT(bench_string_find_ignore_case_func,
+                             case_name("find", isa_name, size), scanned);
+        }
+        cpu_isa_set(cpu_isa_supported());
+
+        BENCH_THROUGHPUT(bench_tolower_func, case_name("lower", "tolower", size), size);
+        BENCH_THROUGHPUT(bench_strncasecmp_func, case_name("equal", "strncasecmp", size), size);
+    }
+
+    string_free(&lower);
+    string_free(&upper);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorting
+////////////////////////////////////////////////////////////////////////////////
+
+
+// The sorting benchmarks sort 256Ki strings of three kinds: random words,
+// URLs that share a long prefix, and strings that are already sorted. Every
+// call sorts a fresh copy of the unsorted views.
+#define SORT_COUNT ((size_t)1 << 18)
+
+static struct string * sort_input;
+static struct string * sort_output;
+static size_t sort_threads;
+
+
+static int string_compare_qsort(void const * lhs, void const * rhs)
+{
+    return string_compare(lhs, rhs);
+}
+
+
+static void bench_qsort_func()
+{
+    memcpy(sort_output, sort_input, SORT_COUNT * sizeof(*sort_output));
+    qsort(sort_output, SORT_COUNT, sizeof(*sort_output), string_compare_qsort);
+}
+
+
+static void bench_string_sort_func()
+{
+    memcpy(sort_output, sort_input, SORT_COUNT * sizeof(*sort_output));
+    CHECK(string_sort(sort_output, SORT_COUNT, false));
+}
+
+
+static void bench_string_sort_stable_func()
+{
+    memcpy(sort_output, sort_input, SORT_COUNT * sizeof(*sort_output));
+    CHECK(string_sort(sort_output, SORT_COUNT, true));
+}
+
+
+static void bench_string_sort_parallel_func()
+{
+    memcpy(sort_output, sort_input, SORT_COUNT * sizeof(*sort_output));
+    CHECK(string_sort_parallel(sort_output, SORT_COUNT, false, sort_threads));
+}
+
+
+static void bench_string_sort()
+{
+    benchmark_init(__func__);
+
+    char * pool = malloc(SORT_COUNT * 64);
+    sort_input = malloc(SORT_COUNT * sizeof(*sort_input));
+    sort_output = malloc(SORT_COUNT * sizeof(*sort_output));
+    CHECK(pool != NULL && sort_input != NULL && sort_output != NULL);
+
+    char const * const names[] = {"random", "prefix", "sorted"};
+    char name[64];
+    for (int kind = 0; kind < 3; ++kind)
+    {
+        unsigned seed = 12345;
+        size_t bytes = 0;
+        char * next = pool;
+        for (size_t i = 0; i < SORT_COUNT; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            size_t size = 0;
+            if (kind == 0 || kind == 1)
+            {
+                if (kind == 1)
+                    size = (size_t)snprintf(next, 64, "https://example.com/api/v2/items/");
+                size_t end = size + 4 + (seed >> 16) % 12;
+                for (; size < end; ++size)
+                {
+                    seed = seed * 1103515245u + 12345u;
+                    next[size] = (char)('a' + (seed >> 16) % 26);
+                }
+            }
+            else
+                size = (size_t)snprintf(next, 64, "key-%010zu", i);
+            sort_input[i] = (struct string){next, size};
+            next += size;
+            bytes += size;
+        }
+
+        snprintf(name, sizeof(name), "%s qsort", names[kind]);
+        BENCH_THROUGHPUT(bench_qsort_func, name, bytes);
+        snprintf(name, sizeof(name), "%s radix", names[kind]);
+        BENCH_THROUGHPUT(bench_string_sort_func, name, bytes);
+        snprintf(name, sizeof(name), "%s radix stable", names[kind]);
+        BENCH_THROUGHPUT(bench_string_sort_stable_func, name, bytes);
+        for (sort_threads = 2; sort_threads <= 8; sort_threads *= 2)
+        {
+            snprintf(name, sizeof(name), "%s threads=%zu", names[kind], sort_threads);
+            BENCH_THROUGHPUT(bench_string_sort_parallel_func, name, bytes);
+        }
+    }
+
+    free(sort_output);
+    free(sort_input);
+    free(pool);
+}
+
+
 int main()
 {
     bench_string_copy_slice();
     bench_string_view_slice();
+    bench_sso_string();
+    bench_string_builder();
 
     bench_string_copy_split();
     bench_string_view_split();
+
+    large_buffer_init();
+    bench_string_count_char();
+    bench_string_view_split_large();
+    bench_string_split_iter();
+    bench_string_split_index();
+    bench_string_view_split_parallel();
+    bench_string_view_split_any();
+    bench_string_find();
+    bench_string_case();
+    string_free(&large_buffer);
+
+    bench_string_sort();
     return 0;
 }
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/string.h"
+#include "util/utf8.h"
+
+#include "test/benchmark.h"
+
+
+// Each input is 1 MiB of valid UTF-8: plain ASCII, English text with about
+// one accented letter or symbol in 16 characters, and CJK text, where almost
+// every character is three bytes.
+#define INPUT_SIZE ((size_t)1 << 20)
+
+
+static struct string input;
+static size_t expected_count;
+
+
+// Fill `buffer` with code points from `alphabet`, picking a multi-byte one
+// about once in `one_in` characters, or never if `one_in` is 0.
+static void make_input(struct string * buffer, char const * const * alphabet, size_t alphabet_size,
+                       unsigned one_in)
+{
+    string_make(buffer, INPUT_SIZE);
+    CHECK(buffer->data != NULL);
+
+    unsigned seed = 12345;
+    size_t i = 0;
+    while (true)
+    {
+        seed = seed * 1103515245u + 12345u;
+        unsigned random = seed >> 8;
+        char const * next;
+        char letter[2] = {(char)('a' + random % 26), '\0'};
+        if (one_in != 0 && random % one_in == 0)
+            next = alphabet[(random >> 8) % alphabet_size];
+        else
+            next = (random % 6 == 0) ? " " : letter;
+
+        size_t size = strlen(next);
+        if (i + size > buffer->size)
+            break;
+        memcpy(buffer->data + i, next, size);
+        i += size;
+    }
+    memset(buffer->data + i, ' ', buffer->size - i);
+}
+
+
+static void bench_utf8_is_valid_func()
+{
+    CHECK(utf8_is_valid(&input));
+}
+
+
+static void bench_utf8_count_codepoints_func()
+{
+    CHECK(utf8_count_codepoints(&input) == expected_count);
+}
+
+
+static void bench_utf8()
+{
+    benchmark_init(__func__);
+
+    static char const * const latin[] = {"\xC3\xA9", "\xC3\xBC", "\xC3\xB1", "\xE2\x82\xAC",
+                                         "\xE2\x80\x94", "\xF0\x9F\x98\x80"};
+    static char const * const cjk[] = {"\xE4\xBD\xA0", "\xE5\xA5\xBD", "\xE4\xB8\x96",
+                                       "\xE7\x95\x8C", "\xE6\x97\xA5", "\xE6\x9C\xAC"};
+    struct
+    {
+        char const * name;
+        char const * const * alphabet;
+        unsigned one_in;
+    } const inputs[] = {
+        {"ascii", latin, 0},
+        {"latin", latin, 16},
+        {"cjk", cjk, 1},
+    };
+
+    char name[64];
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i)
+    {
+        make_input(&input, inputs[i].alphabet, 6, inputs[i].one_in);
+        for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        {
+            expected_count = utf8_count_codepoints(&input);
+            snprintf(name, sizeof(name), "valid %s %s", inputs[i].name, cpu_isa_to_string(isa));
+            BENCH_THROUGHPUT(bench_utf8_is_valid_func, name, INPUT_SIZE);
+            snprintf(name, sizeof(name), "count %s %s", inputs[i].name, cpu_isa_to_string(isa));
+            BENCH_THROUGHPUT(bench_utf8_count_codepoints_func, name, INPUT_SIZE);
+        }
+        cpu_isa_set(cpu_isa_supported());
+        string_free(&input);
+    }
+}
+
+
+int main()
+{
+    bench_utf8();
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "util/arena.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+static void test_arena_alloc()
+{
+    struct arena arena;
+    arena_init(&arena, 64);
+    CHECK(arena_capacity(&arena) == 0);
+
+    char * one = arena_alloc(&arena, 10);
+    char * two = arena_alloc(&arena, 10);
+    CHECK(one != NULL && two != NULL);
+    CHECK(two >= one + 10);
+    CHECK((uintptr_t)one % ARENA_DEFAULT_ALIGNMENT == 0);
+    CHECK((uintptr_t)two % ARENA_DEFAULT_ALIGNMENT == 0);
+    memset(one, 'a', 10);
+    memset(two, 'b', 10);
+    CHECK(one[9] == 'a');
+
+    // Allocations bigger than the chunk size get their own chunk.
+    char * big = arena_alloc(&arena, 1000);
+    CHECK(big != NULL);
+    memset(big, 'c', 1000);
+    CHECK(arena_capacity(&arena) >= 1064);
+    CHECK(one[0] == 'a' && two[0] == 'b');
+
+    arena_free(&arena);
+    CHECK(arena_capacity(&arena) == 0);
+}
+
+
+static void test_arena_alloc_aligned()
+{
+    struct arena arena;
+    arena_init(&arena, 256);
+
+    size_t const alignments[] = {1, 2, 4, 8, 16, 64, 128, 4096};
+    for (size_t i = 0; i < ARRAY_SIZE(alignments); ++i)
+    {
+        arena_alloc_aligned(&arena, 1, 1);
+        char * p = arena_alloc_aligned(&arena, 3, alignments[i]);
+        CHECK(p != NULL);
+        CHECK((uintptr_t)p % alignments[i] == 0);
+    }
+
+    arena_free(&arena);
+}
+
+
+static void test_arena_rollback()
+{
+    struct arena arena;
+    arena_init(&arena, 64);
+
+    char * before = arena_alloc(&arena, 8);
+    struct arena_mark mark = arena_mark(&arena);
+    char * first = arena_alloc(&arena, 8);
+    for (int i = 0; i < 100; ++i)
+        CHECK(arena_alloc(&arena, 48) != NULL);
+    size_t capacity = arena_capacity(&arena);
+
+    // Rolling back should hand out the same memory again without growing.
+    arena_rollback(&arena, mark);
+    CHECK(arena_alloc(&arena, 8) == first);
+    for (int i = 0; i < 100; ++i)
+        CHECK(arena_alloc(&arena, 48) != NULL);
+    CHECK(arena_capacity(&arena) == capacity);
+
+    // Resetting should start again from the first chunk.
+    arena_reset(&arena);
+    CHECK(arena_alloc(&arena, 8) == before);
+    CHECK(arena_capacity(&arena) == capacity);
+
+    // A mark made before anything was allocated rolls back to the start.
+    arena_free(&arena);
+    arena_init(&arena, 64);
+    mark = arena_mark(&arena);
+    before = arena_alloc(&arena, 8);
+    arena_rollback(&arena, mark);
+    CHECK(arena_alloc(&arena, 8) == before);
+    arena_free(&arena);
+}
+
+
+int main()
+{
+    test_arena_alloc();
+    test_arena_alloc_aligned();
+    test_arena_rollback();
+    success("All tests passed :-)");
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 
 #include "util/cli.h"
 #include "util/util.h"
@@ -34,9 +35,35 @@ static void test_cli_parse()
 }
 
 
+static void test_cli_suggest()
+{
+    bool verbose = false;
+    bool version = false;
+    char * output = NULL;
+    struct cli_arg args[] = {
+        {"input", NULL, PARSE_STRING, &output, sizeof(output), "a positional argument"},
+        {"--verbose", "-v", PARSE_FLAG, &verbose, sizeof(verbose), "verbose"},
+        {"--version", NULL, PARSE_FLAG, &version, sizeof(version), "version"},
+        {"--output", "-o", PARSE_STRING, &output, sizeof(output), "output"},
+    };
+    struct cli cli = {"test", NULL, args, ARRAY_SIZE(args)};
+
+    CHECK(strcmp(cli_suggest(&cli, "--verbos"), "--verbose") == 0);
+    CHECK(strcmp(cli_suggest(&cli, "--verison"), "--version") == 0);
+    CHECK(strcmp(cli_suggest(&cli, "-output"), "--output") == 0);
+    CHECK(strcmp(cli_suggest(&cli, "--outptu"), "--output") == 0);
+
+    // Positional arguments aren't suggested, and short typos are too ambiguous.
+    CHECK(cli_suggest(&cli, "inptu") == NULL);
+    CHECK(cli_suggest(&cli, "-x") == NULL);
+    CHECK(cli_suggest(&cli, "--something-else") == NULL);
+}
+
+
 int main()
 {
     test_cli_parse();
+    test_cli_suggest();
     success("All tests passed :-)");
     return 0;
 }
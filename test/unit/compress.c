@@ -0,0 +1,186 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/compress.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+// Encode `string`, check it decodes back to itself and return the encoded size.
+static size_t check_round_trip(struct string_compressor const * compressor,
+                               struct string const * string)
+{
+    char encoded[512];
+    char decoded[256];
+    CHECK(2 * string->size <= sizeof(encoded));
+    size_t size = string_compressor_encode(encoded, compressor, string);
+    CHECK(size <= 2 * string->size);
+
+    struct string const view = {encoded, size};
+    CHECK(string_compressor_decoded_size(compressor, &view) == string->size);
+    CHECK(string_compressor_decode(decoded, sizeof(decoded), compressor, &view) == string->size);
+    CHECK(string_is_equal(&(struct string){decoded, string->size}, string));
+    CHECK(string_compressor_is_equal(compressor, &view, string));
+
+    // Decoding into a short buffer stores what fits and reports the whole size.
+    for (size_t capacity = 0; capacity < string->size && capacity < 20; ++capacity)
+    {
+        memset(decoded, '#', sizeof(decoded));
+        CHECK(string_compressor_decode(decoded, capacity, compressor, &view) == string->size);
+        CHECK(memcmp(decoded, string->data, capacity) == 0);
+        CHECK(decoded[capacity] == '#');
+    }
+    return size;
+}
+
+
+static void test_string_compressor()
+{
+    // Without a sample there are no symbols and every byte is escaped.
+    struct string_compressor * compressor = string_compressor_train(NULL, 0);
+    CHECK(compressor != NULL);
+    CHECK(string_compressor_symbol_count(compressor) == 0);
+    CHECK(check_round_trip(compressor, &string_literal("abc")) == 6);
+    CHECK(check_round_trip(compressor, &string_literal("")) == 0);
+    string_compressor_free(compressor);
+
+    // URLs share a lot of substrings, so they should compress well.
+    enum { url_count = 2000 };
+    char (*data)[96] = malloc(url_count * sizeof(*data));
+    struct string * urls = malloc(url_count * sizeof(*urls));
+    CHECK(data != NULL && urls != NULL);
+    char const * const hosts[] = {"www.example.com", "api.example.org", "cdn.static.net"};
+    char const * const paths[] = {"users", "items", "orders", "search", "images"};
+    unsigned seed = 1;
+    for (size_t i = 0; i < url_count; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        int size = snprintf(data[i], sizeof(data[i]), "https://%s/%s/%u?page=%u",
+                            hosts[(seed >> 16) % 3], paths[(seed >> 8) % 5], seed % 100000,
+                            (seed >> 20) % 10);
+        urls[i] = (struct string){data[i], (size_t)size};
+    }
+
+    compressor = string_compressor_train(urls, 500);
+    CHECK(compressor != NULL);
+    CHECK(string_compressor_symbol_count(compressor) > 100);
+    size_t raw_size = 0;
+    size_t encoded_size = 0;
+    for (size_t i = 0; i < url_count; ++i)
+    {
+        raw_size += urls[i].size;
+        encoded_size += check_round_trip(compressor, urls + i);
+    }
+    CHECK(encoded_size * 2 < raw_size);
+
+    // Strings unlike the sample still round trip, including zero bytes and
+    // every byte value.
+    char bytes[256];
+    for (size_t i = 0; i < sizeof(bytes); ++i)
+        bytes[i] = (char)(i * 7);
+    check_round_trip(compressor, &(struct string){bytes, sizeof(bytes) / 2});
+    check_round_trip(compressor, &(struct string){bytes + 128, sizeof(bytes) / 2});
+    check_round_trip(compressor, &string_literal("http\0s://"));
+    check_round_trip(compressor, &string_literal("h"));
+
+    // Encodings are equal exactly when the strings are, and comparing with a
+    // plain string stops at the first difference.
+    char encoded[2][256];
+    struct string one = string_literal("https://www.example.com/users/1?page=2");
+    struct string two = string_literal("https://www.example.com/users/1?page=3");
+    struct string views[2] = {{encoded[0], string_compressor_encode(encoded[0], compressor, &one)},
+                              {encoded[1], string_compressor_encode(encoded[1], compressor, &two)}};
+    CHECK(!string_is_equal(views + 0, views + 1));
+    CHECK(!string_compressor_is_equal(compressor, views + 0, &two));
+    CHECK(!string_compressor_is_equal(compressor, views + 0, &string_literal("https://www")));
+    CHECK(!string_compressor_is_equal(compressor, views + 0, &string_literal("")));
+    views[1].size = string_compressor_encode(encoded[1], compressor, &one);
+    CHECK(string_is_equal(views + 0, views + 1));
+    struct string longer = string_literal("https://www.example.com/users/1?page=2x");
+    CHECK(!string_compressor_is_equal(compressor, views + 0, &longer));
+
+    string_compressor_free(compressor);
+    free(urls);
+    free(data);
+}
+
+
+static void test_string_compressor_collisions()
+{
+    // Symbols that start with the same 3 bytes hash to the same slot, but
+    // each is still in the table and encodes its string with one code.
+    char const * const words[] = {"https", "http:", "httpd", "http/"};
+    struct string sample[400];
+    for (size_t i = 0; i < ARRAY_SIZE(sample); ++i)
+        string_view_cstr(sample + i, (char *)words[i % ARRAY_SIZE(words)]);
+
+    struct string_compressor * compressor = string_compressor_train(sample, ARRAY_SIZE(sample));
+    CHECK(compressor != NULL);
+    for (size_t i = 0; i < ARRAY_SIZE(words); ++i)
+        CHECK(check_round_trip(compressor, sample + i) == 1);
+    string_compressor_free(compressor);
+}
+
+
+static void test_string_compressor_random()
+{
+    // Tables trained on random strings over a few letters, checked against
+    // random strings that mostly use the same letters. The first two strings
+    // are equal.
+    unsigned seed = 1;
+    char data[200][40];
+    struct string strings[200];
+    for (size_t round = 0; round < 20; ++round)
+    {
+        size_t letters = 2 + round % 5;
+        for (size_t i = 0; i < ARRAY_SIZE(strings); ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            size_t size = (seed >> 16) % sizeof(data[i]);
+            for (size_t j = 0; j < size; ++j)
+            {
+                seed = seed * 1103515245u + 12345u;
+                unsigned random = seed >> 16;
+                data[i][j] = (random % 50 == 0) ? (char)(random >> 6)
+                                                : (char)('a' + random % letters);
+            }
+            strings[i] = (struct string){data[i], size};
+        }
+        memcpy(data[1], data[0], strings[0].size);
+        strings[1].size = strings[0].size;
+
+        struct string_compressor * compressor =
+            string_compressor_train(strings, ARRAY_SIZE(strings) / 2);
+        CHECK(compressor != NULL);
+        char encoded[2][80];
+        struct string previous = {encoded[1], 0};
+        for (size_t i = 0; i < ARRAY_SIZE(strings); ++i)
+        {
+            check_round_trip(compressor, strings + i);
+            struct string view = {encoded[i % 2], 0};
+            view.size = string_compressor_encode(view.data, compressor, strings + i);
+            if (i > 0)
+            {
+                bool const equal = string_is_equal(strings + i, strings + i - 1);
+                CHECK(string_is_equal(&view, &previous) == equal);
+                CHECK(string_compressor_is_equal(compressor, &previous, strings + i) == equal);
+            }
+            previous = view;
+        }
+        string_compressor_free(compressor);
+    }
+}
+
+
+int main()
+{
+    test_string_compressor();
+    test_string_compressor_collisions();
+    test_string_compressor_random();
+    success("All tests passed :-)");
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Needed for setenv and unsetenv.
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+static void test_cpu_init()
+{
+    // The first call selects the instruction set named by the environment.
+    CHECK(setenv("CPU_ISA", "Scalar", 1) == 0);
+    CHECK(cpu_isa_get() == CPU_ISA_SCALAR);
+
+    enum cpu_isa supported = cpu_isa_supported();
+    if (supported >= CPU_ISA_SSE2)
+    {
+        CHECK(setenv("CPU_ISA", "SSE2", 1) == 0);
+        cpu_init();
+        CHECK(cpu_isa_get() == CPU_ISA_SSE2);
+    }
+
+    // Instruction sets the processor doesn't support fall back to the best it does.
+    if (supported < CPU_ISA_AVX512)
+    {
+        CHECK(setenv("CPU_ISA", "AVX512", 1) == 0);
+        cpu_init();
+        CHECK(cpu_isa_get() == supported);
+    }
+
+    CHECK(unsetenv("CPU_ISA") == 0);
+    cpu_init();
+    CHECK(cpu_isa_get() == supported);
+}
+
+
+static void test_cpu_isa_set()
+{
+    enum cpu_isa supported = cpu_isa_supported();
+    CHECK(cpu_isa_get() == supported);
+
+    // The scalar kernels are always available.
+    CHECK(cpu_isa_set(CPU_ISA_SCALAR) == true);
+    CHECK(cpu_isa_get() == CPU_ISA_SCALAR);
+
+    // Instruction sets the processor doesn't support should be rejected.
+    if (supported < CPU_ISA_AVX512)
+    {
+        CHECK(cpu_isa_set(supported + 1) == false);
+        CHECK(cpu_isa_get() == CPU_ISA_SCALAR);
+    }
+
+    CHECK(cpu_isa_set(supported) == true);
+    CHECK(cpu_isa_get() == supported);
+}
+
+
+static void test_cpu_isa_to_string()
+{
+    CHECK(strcmp(cpu_isa_to_string(CPU_ISA_SCALAR), "Scalar") == 0);
+    CHECK(strcmp(cpu_isa_to_string(CPU_ISA_SSE2), "SSE2") == 0);
+    CHECK(strcmp(cpu_isa_to_string(CPU_ISA_AVX2), "AVX2") == 0);
+    CHECK(strcmp(cpu_isa_to_string(CPU_ISA_AVX512), "AVX512") == 0);
+}
+
+
+int main()
+{
+    test_cpu_init();
+    test_cpu_isa_set();
+    test_cpu_isa_to_string();
+    success("All tests passed :-)");
+    return 0;
+}
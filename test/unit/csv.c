@@ -0,0 +1,215 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/csv.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+// A field and the code it's returned with.
+struct expected_field
+{
+    char const * value;
+    enum csv_rc rc;
+};
+
+
+// Check that tokenizing `input` whole, and in chunks of every size up to
+// `max_chunk`, gives `expected`.
+static void check_fields(char const * input, char delimiter, struct expected_field const * expected,
+                         size_t expected_count, size_t max_chunk)
+{
+    size_t const size = strlen(input);
+    for (size_t chunk_size = 0; chunk_size <= max_chunk; ++chunk_size)
+    {
+        struct csv_reader reader;
+        csv_reader_init(&reader, delimiter);
+        size_t offset = (chunk_size == 0) ? size : 0;
+        struct string chunk = {(char *)input, (chunk_size == 0) ? size : 0};
+        csv_reader_feed(&reader, &chunk, chunk_size == 0);
+
+        size_t count = 0;
+        struct string field;
+        enum csv_rc rc;
+        while ((rc = csv_reader_next(&reader, &field)) != CSV_RC_END)
+        {
+            if (rc == CSV_RC_NEED_INPUT)
+            {
+                size_t next = (offset + chunk_size < size) ? chunk_size : size - offset;
+                chunk = (struct string){(char *)input + offset, next};
+                offset += next;
+                csv_reader_feed(&reader, &chunk, offset == size);
+                continue;
+            }
+            CHECK(count < expected_count);
+            CHECK(rc == expected[count].rc);
+            CHECK(string_is_equal_cstr(&field, expected[count].value));
+            ++count;
+        }
+        CHECK(count == expected_count);
+        csv_reader_free(&reader);
+    }
+}
+
+
+static void test_csv_reader()
+{
+    // Plain fields, with and without a final newline.
+    struct expected_field const plain[] = {
+        {"a", CSV_RC_FIELD}, {"b", CSV_RC_FIELD}, {"c", CSV_RC_RECORD},
+        {"1", CSV_RC_FIELD}, {"", CSV_RC_FIELD},  {"3", CSV_RC_RECORD},
+    };
+    check_fields("a,b,c\n1,,3\n", ',', plain, ARRAY_SIZE(plain), 12);
+    check_fields("a,b,c\n1,,3", ',', plain, ARRAY_SIZE(plain), 11);
+    check_fields("a,b,c\r\n1,,3\r\n", ',', plain, ARRAY_SIZE(plain), 14);
+
+    // Quoted fields can contain delimiters, newlines and escaped quotes.
+    struct expected_field const quoted[] = {
+        {"a,b", CSV_RC_FIELD},
+        {"line 1\nline 2", CSV_RC_FIELD},
+        {"say \"hi\"", CSV_RC_RECORD},
+        {"", CSV_RC_FIELD},
+        {"\"", CSV_RC_FIELD},
+        {"x", CSV_RC_RECORD},
+    };
+    check_fields("\"a,b\",\"line 1\nline 2\",\"say \"\"hi\"\"\"\r\n\"\",\"\"\"\",x", ',', quoted,
+                 ARRAY_SIZE(quoted), 45);
+
+    // Empty input has no records, and an empty line is a record with one empty field.
+    check_fields("", ',', NULL, 0, 2);
+    struct expected_field const empty_lines[] = {
+        {"", CSV_RC_RECORD}, {"", CSV_RC_RECORD}, {"", CSV_RC_FIELD}, {"", CSV_RC_RECORD}};
+    check_fields("\n\n,", ',', empty_lines, ARRAY_SIZE(empty_lines), 4);
+
+    // Tabs separate the fields of TSV, and commas are then ordinary bytes.
+    struct expected_field const tsv[] = {{"a,b", CSV_RC_FIELD}, {"c", CSV_RC_RECORD}};
+    check_fields("a,b\tc\n", '\t', tsv, ARRAY_SIZE(tsv), 7);
+
+    // Quotes that don't surround a whole field are kept.
+    struct expected_field const partial[] = {
+        {"ab\"c,d\"", CSV_RC_FIELD}, {"\"e\"f", CSV_RC_RECORD}};
+    check_fields("ab\"c,d\",\"e\"f", ',', partial, ARRAY_SIZE(partial), 13);
+}
+
+
+// Append `value` to `builder` as a CSV field, quoting it if it needs quotes.
+static void append_field(struct string_builder * builder, struct string const * value)
+{
+    bool quote = false;
+    for (size_t i = 0; i < value->size; ++i)
+        quote = quote || value->data[i] == ',' || value->data[i] == '\n' ||
+                value->data[i] == '"' || value->data[i] == '\r';
+    if (!quote)
+    {
+        CHECK(string_builder_append(builder, value));
+        return;
+    }
+
+    CHECK(string_builder_append_char(builder, '"'));
+    for (size_t i = 0; i < value->size; ++i)
+    {
+        if (value->data[i] == '"')
+            CHECK(string_builder_append_char(builder, '"'));
+        CHECK(string_builder_append_char(builder, value->data[i]));
+    }
+    CHECK(string_builder_append_char(builder, '"'));
+}
+
+
+static void test_csv_reader_random()
+{
+    // Encode random fields as CSV, with many quotes and long quoted sections
+    // so that quote state is carried across blocks, and check that they're
+    // tokenized back into the same fields with every instruction set and
+    // with chunks of several sizes.
+    enum { field_count = 3000 };
+    char (*values)[200] = malloc(field_count * sizeof(*values));
+    struct string * fields = malloc(field_count * sizeof(*fields));
+    bool * record_ends = malloc(field_count * sizeof(*record_ends));
+    CHECK(values != NULL && fields != NULL && record_ends != NULL);
+
+    struct string_builder builder;
+    string_builder_init(&builder);
+    unsigned seed = 1;
+    for (size_t i = 0; i < field_count; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t size = (seed >> 16) % ((seed >> 12) % 8 == 0 ? 200 : 12);
+        for (size_t j = 0; j < size; ++j)
+        {
+            seed = seed * 1103515245u + 12345u;
+            values[i][j] = "abcdefgh,\n\"\r xyz"[(seed >> 16) % 17];
+        }
+        // An empty line at the end of the input isn't a record, so the last
+        // field is never empty.
+        if (i == field_count - 1 && size == 0)
+            values[i][size++] = 'z';
+        fields[i] = (struct string){values[i], size};
+        record_ends[i] = (seed >> 8) % 5 == 0 || i == field_count - 1;
+
+        append_field(&builder, fields + i);
+        if (!record_ends[i])
+            CHECK(string_builder_append_char(&builder, ','));
+        else if (i < field_count - 1)
+        {
+            struct string const newline = (seed >> 4) % 2 ? string_literal("\r\n")
+                                                          : string_literal("\n");
+            CHECK(string_builder_append(&builder, &newline));
+        }
+    }
+    struct string input = {builder.data, builder.size};
+
+    size_t const chunk_sizes[] = {0, 1, 7, 63, 64, 65, 1000};
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        for (size_t c = 0; c < ARRAY_SIZE(chunk_sizes); ++c)
+        {
+            struct csv_reader reader;
+            csv_reader_init(&reader, ',');
+            size_t chunk_size = (chunk_sizes[c] == 0) ? input.size : chunk_sizes[c];
+            size_t offset = 0;
+
+            size_t count = 0;
+            struct string field;
+            enum csv_rc rc = CSV_RC_NEED_INPUT;
+            while (rc != CSV_RC_END)
+            {
+                rc = csv_reader_next(&reader, &field);
+                if (rc == CSV_RC_NEED_INPUT)
+                {
+                    size_t next = (offset + chunk_size < input.size) ? chunk_size
+                                                                     : input.size - offset;
+                    struct string chunk = {input.data + offset, next};
+                    offset += next;
+                    csv_reader_feed(&reader, &chunk, offset == input.size);
+                }
+                else if (rc != CSV_RC_END)
+                {
+                    CHECK(count < field_count);
+                    CHECK(rc == (record_ends[count] ? CSV_RC_RECORD : CSV_RC_FIELD));
+                    CHECK(string_is_equal(&field, fields + count));
+                    ++count;
+                }
+            }
+            CHECK(count == field_count);
+            csv_reader_free(&reader);
+        }
+    cpu_isa_set(cpu_isa_supported());
+
+    string_builder_free(&builder);
+    free(record_ends);
+    free(fields);
+    free(values);
+}
+
+
+int main()
+{
+    test_csv_reader();
+    test_csv_reader_random();
+    success("All tests passed :-)");
+    return 0;
+}
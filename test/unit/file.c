@@ -0,0 +1,233 @@
+// Needed for pipe, open and close, which feed the record reader and take
+// the written strings.
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util/file.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+#define TEST_PATH "unit_test_file.tmp"
+
+
+// Overwrite the file at TEST_PATH with \p contents.
+static void write_test_file(struct string const * contents)
+{
+    FILE * file = fopen(TEST_PATH, "wb");
+    CHECK(file != NULL);
+    CHECK(fwrite(contents->data, 1, contents->size, file) == contents->size);
+    CHECK(fclose(file) == 0);
+}
+
+
+static void test_file_map()
+{
+    struct string expected = string_literal("first line\nsecond line\n\nlast line");
+    write_test_file(&expected);
+
+    unsigned const flag_sets[] = {0, FILE_MAP_SEQUENTIAL, FILE_MAP_WILLNEED | FILE_MAP_HUGEPAGE,
+                                  FILE_MAP_POPULATE | FILE_MAP_SEQUENTIAL};
+    for (size_t i = 0; i < ARRAY_SIZE(flag_sets); ++i)
+    {
+        struct string contents;
+        CHECK(file_map(&contents, TEST_PATH, flag_sets[i]));
+        CHECK(string_is_equal(&contents, &expected));
+
+        // Splitting views the mapped file without copying it.
+        struct string * lines;
+        CHECK(string_view_split(&lines, &contents, '\n') == 4);
+        CHECK(string_is_equal_cstr(lines + 1, "second line"));
+        CHECK(lines[1].data == contents.data + 11);
+        CHECK(lines[2].size == 0);
+        CHECK(string_is_equal_cstr(lines + 3, "last line"));
+        free(lines);
+
+        struct string slice;
+        string_view_slice(&slice, &contents, 6, 10);
+        CHECK(string_is_equal_cstr(&slice, "line"));
+
+        file_unmap(&contents);
+        CHECK(contents.data == NULL && contents.size == 0);
+    }
+
+    // An empty file gives an empty view.
+    write_test_file(&string_literal(""));
+    struct string contents;
+    CHECK(file_map(&contents, TEST_PATH, FILE_MAP_POPULATE));
+    CHECK(contents.data == NULL && contents.size == 0);
+    file_unmap(&contents);
+
+    CHECK(remove(TEST_PATH) == 0);
+    CHECK(!file_map(&contents, TEST_PATH, 0));
+    CHECK(errno == ENOENT);
+    CHECK(contents.data == NULL && contents.size == 0);
+}
+
+
+static void test_file_reader_pipe()
+{
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    char const input[] = "ab\ncdefgh\n\nijklmnopqrs\ntuv";
+    CHECK(write(fds[1], input, sizeof(input) - 1) == (ssize_t)(sizeof(input) - 1));
+    CHECK(close(fds[1]) == 0);
+
+    // An 8 byte buffer makes records straddle reads and one record too long.
+    struct file_reader reader;
+    CHECK(file_reader_init(&reader, fds[0], '\n', 8));
+    struct string record;
+    CHECK(file_reader_next(&reader, &record) == FILE_READER_RC_OK);
+    CHECK(string_is_equal_cstr(&record, "ab"));
+    CHECK(file_reader_next(&reader, &record) == FILE_READER_RC_OK);
+    CHECK(string_is_equal_cstr(&record, "cdefgh"));
+    CHECK(file_reader_next(&reader, &record) == FILE_READER_RC_OK);
+    CHECK(record.size == 0);
+    CHECK(file_reader_next(&reader, &record) == FILE_READER_RC_TOO_LONG);
+    CHECK(string_is_equal_cstr(&record, "ijklmnop"));
+    CHECK(file_reader_next(&reader, &record) == FILE_READER_RC_OK);
+    CHECK(string_is_equal_cstr(&record, "tuv"));
+    CHECK(file_reader_next(&reader, &record) == FILE_READER_RC_END);
+    CHECK(file_reader_next(&reader, &record) == FILE_READER_RC_END);
+    file_reader_free(&reader);
+    CHECK(close(fds[0]) == 0);
+
+    // Reading a closed descriptor fails.
+    CHECK(file_reader_init(&reader, fds[0], '\n', 0));
+    CHECK(file_reader_next(&reader, &record) == FILE_READER_RC_ERROR);
+    CHECK(errno == EBADF);
+    file_reader_free(&reader);
+}
+
+
+static void test_file_reader_file()
+{
+    // Lines of 0 to 99 bytes, ending with a delimiter so there's no final record.
+    struct string expected;
+    string_make(&expected, 100000);
+    CHECK(expected.data != NULL);
+    unsigned seed = 1;
+    for (size_t i = 0; i < expected.size;)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t size = (seed >> 16) % 100;
+        for (size_t j = 0; j < size && i < expected.size - 1; ++j)
+            expected.data[i++] = (char)('a' + j % 26);
+        expected.data[i++] = '\n';
+    }
+    expected.data[expected.size - 1] = '\n';
+    write_test_file(&expected);
+
+    struct string * lines;
+    size_t line_count = string_view_split(&lines, &expected, '\n') - 1;
+
+    size_t const capacities[] = {100, 101, 4096, 0};
+    for (size_t c = 0; c < ARRAY_SIZE(capacities); ++c)
+    {
+        int fd = open(TEST_PATH, O_RDONLY);
+        CHECK(fd >= 0);
+        struct file_reader reader;
+        CHECK(file_reader_init(&reader, fd, '\n', capacities[c]));
+
+        struct string record;
+        size_t count = 0;
+        while (file_reader_next(&reader, &record) == FILE_READER_RC_OK)
+        {
+            CHECK(count < line_count);
+            CHECK(string_is_equal(&record, lines + count));
+            ++count;
+        }
+        CHECK(count == line_count);
+        file_reader_free(&reader);
+        CHECK(close(fd) == 0);
+    }
+
+    free(lines);
+    string_free(&expected);
+    CHECK(remove(TEST_PATH) == 0);
+}
+
+
+static void test_file_write_strings()
+{
+    // Pieces of 0 to 299 bytes, so there are many more than fit in one
+    // batch, and runs of small ones between large ones.
+    enum { piece_count = 5000 };
+    struct string * pieces = malloc(piece_count * sizeof(*pieces));
+    char * data = malloc(piece_count * 300);
+    CHECK(pieces != NULL && data != NULL);
+    unsigned seed = 1;
+    for (size_t i = 0; i < piece_count; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t size = (seed >> 16) % ((seed & 1) ? 300 : 20);
+        pieces[i] = (struct string){data + 300 * i, size};
+        for (size_t j = 0; j < size; ++j)
+            pieces[i].data[j] = (char)('a' + (i + j) % 26);
+    }
+
+    char long_separator[200];
+    memset(long_separator, '-', sizeof(long_separator));
+    struct string const separators[] = {string_literal(""), string_literal("\n"),
+                                        string_literal(", "),
+                                        {long_separator, sizeof(long_separator)}};
+    size_t const counts[] = {0, 1, 2, 1000, piece_count};
+    for (size_t s = 0; s <= ARRAY_SIZE(separators); ++s)
+    {
+        struct string const * separator = (s < ARRAY_SIZE(separators)) ? separators + s : NULL;
+        for (size_t c = 0; c < ARRAY_SIZE(counts); ++c)
+        {
+            int fd = open(TEST_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            CHECK(fd >= 0);
+            CHECK(file_write_strings(fd, pieces, counts[c], separator));
+            CHECK(close(fd) == 0);
+
+            // The file has the pieces and separators joined.
+            struct string contents;
+            CHECK(file_map(&contents, TEST_PATH, 0));
+            size_t offset = 0;
+            for (size_t i = 0; i < counts[c]; ++i)
+            {
+                if (i > 0 && separator != NULL)
+                {
+                    CHECK(offset + separator->size <= contents.size);
+                    CHECK(memcmp(contents.data + offset, separator->data, separator->size) == 0);
+                    offset += separator->size;
+                }
+                CHECK(offset + pieces[i].size <= contents.size);
+                CHECK(memcmp(contents.data + offset, pieces[i].data, pieces[i].size) == 0);
+                offset += pieces[i].size;
+            }
+            CHECK(offset == contents.size);
+            file_unmap(&contents);
+        }
+    }
+    CHECK(remove(TEST_PATH) == 0);
+
+    // Writing to a closed descriptor fails, but writing nothing doesn't write.
+    CHECK(!file_write_strings(-1, pieces, 10, NULL));
+    CHECK(errno == EBADF);
+    CHECK(file_write_strings(-1, pieces, 0, NULL));
+
+    free(data);
+    free(pieces);
+}
+
+
+int main()
+{
+    test_file_map();
+    test_file_reader_pipe();
+    test_file_reader_file();
+    test_file_write_strings();
+    success("All tests passed :-)");
+    return 0;
+}
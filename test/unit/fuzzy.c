@@ -0,0 +1,185 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/fuzzy.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+// The distance by filling in the table of distances between prefixes a row at a time.
+static size_t naive_distance(struct string const * a, struct string const * b)
+{
+    size_t * row = malloc((b->size + 1) * sizeof(*row));
+    CHECK(row != NULL);
+    for (size_t j = 0; j <= b->size; ++j)
+        row[j] = j;
+    for (size_t i = 1; i <= a->size; ++i)
+    {
+        size_t diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= b->size; ++j)
+        {
+            size_t const above = row[j];
+            size_t best = diagonal + (a->data[i - 1] != b->data[j - 1]);
+            best = (above + 1 < best) ? above + 1 : best;
+            best = (row[j - 1] + 1 < best) ? row[j - 1] + 1 : best;
+            row[j] = best;
+            diagonal = above;
+        }
+    }
+    size_t const distance = row[b->size];
+    free(row);
+    return distance;
+}
+
+
+// Check the distance both ways round and the limits either side of it.
+static void check_distance(struct string const * a, struct string const * b, size_t expected)
+{
+    CHECK(string_edit_distance(a, b) == expected);
+    CHECK(string_edit_distance(b, a) == expected);
+    CHECK(string_edit_distance_within(a, b, expected));
+    CHECK(string_edit_distance_within(b, a, expected + 1));
+    if (expected > 0)
+    {
+        CHECK(!string_edit_distance_within(a, b, expected - 1));
+        CHECK(!string_edit_distance_within(b, a, expected * 3 / 4));
+        CHECK(!string_edit_distance_within(a, b, expected / 2));
+        CHECK(!string_edit_distance_within(b, a, 0));
+    }
+}
+
+
+static void test_string_edit_distance()
+{
+    struct
+    {
+        char const * a;
+        char const * b;
+        size_t distance;
+    } const cases[] = {
+        {"", "", 0},
+        {"", "abc", 3},
+        {"kitten", "sitting", 3},
+        {"flaw", "lawn", 2},
+        {"--verbose", "--verbos", 1},
+        {"abc", "abc", 0},
+        {"abc", "cba", 2},
+        {"intention", "execution", 5},
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(cases); ++i)
+    {
+        struct string a;
+        struct string b;
+        string_view_cstr(&a, (char *)cases[i].a);
+        string_view_cstr(&b, (char *)cases[i].b);
+        check_distance(&a, &b, cases[i].distance);
+    }
+}
+
+
+static void test_string_edit_distance_random()
+{
+    // Strings over a few letters either side of the 64 byte block size, and
+    // edited copies of them, so distances range from none to most bytes.
+    char a[300];
+    char b[300];
+    unsigned seed = 1;
+    for (size_t round = 0; round < 3000; ++round)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t const max_size = (round % 3 == 0) ? 70 : (round % 3 == 1) ? 140 : sizeof(a);
+        size_t a_size = (seed >> 16) % max_size;
+        size_t const letters = 2 + round % 4;
+        for (size_t i = 0; i < a_size; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            a[i] = (char)('a' + (seed >> 16) % letters);
+        }
+
+        size_t b_size = 0;
+        bool const edit = round % 2 == 0;
+        for (size_t i = 0; i < a_size || (!edit && b_size < a_size / 2); ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            unsigned const random = (seed >> 16) % 16;
+            char const c = (char)('a' + (seed >> 8) % letters);
+            if (b_size == sizeof(b))
+                break;
+            if (!edit || i >= a_size)
+                b[b_size++] = c;
+            else if (random == 0)
+                b[b_size++] = c;
+            else if (random == 1 && b_size + 1 < sizeof(b))
+            {
+                b[b_size++] = c;
+                b[b_size++] = a[i];
+            }
+            else if (random != 2)
+                b[b_size++] = a[i];
+        }
+
+        struct string const sa = {a, a_size};
+        struct string const sb = {b, b_size};
+        check_distance(&sa, &sb, naive_distance(&sa, &sb));
+    }
+}
+
+
+static void test_string_find_closest()
+{
+    struct string const names[] = {
+        string_literal("--verbose"), string_literal("--version"), string_literal("--output"),
+        string_literal("--quiet"),   string_literal("--help"),    string_literal("--verbose"),
+        string_literal("-v"),        string_literal("--input"),
+    };
+
+    struct string_candidate closest[4];
+    CHECK(string_find_closest(closest, 4, &string_literal("--verison"), names,
+                              ARRAY_SIZE(names), 4) == 3);
+    CHECK(closest[0].index == 1 && closest[0].distance == 2);
+    CHECK(closest[1].index == 0 && closest[1].distance == 4);
+    CHECK(closest[2].index == 5 && closest[2].distance == 4);
+
+    // Only the closest are kept, and equally close ones in order.
+    CHECK(string_find_closest(closest, 1, &string_literal("--verbos"), names, ARRAY_SIZE(names),
+                              2) == 1);
+    CHECK(closest[0].index == 0 && closest[0].distance == 1);
+    CHECK(string_find_closest(closest, 2, &string_literal("--outptu"), names, ARRAY_SIZE(names),
+                              2) == 1);
+    CHECK(closest[0].index == 2 && closest[0].distance == 2);
+    CHECK(string_find_closest(closest, 4, &string_literal("--nothing-like"), names,
+                              ARRAY_SIZE(names), 2) == 0);
+    CHECK(string_find_closest(closest, 0, &string_literal("--help"), names, ARRAY_SIZE(names),
+                              2) == 0);
+    CHECK(string_find_closest(closest, 4, &string_literal("--help"), names, 0, 2) == 0);
+
+    // A long query against long candidates, one of them an edited copy.
+    char data[3][200];
+    for (size_t i = 0; i < sizeof(data[0]); ++i)
+    {
+        data[0][i] = (char)('a' + i % 7);
+        data[1][i] = (char)('a' + i % 5);
+        data[2][i] = (char)('a' + i % 7);
+    }
+    data[2][50] = 'z';
+    data[2][150] = 'z';
+    struct string const query = {data[0], sizeof(data[0])};
+    struct string const longs[] = {{data[1], sizeof(data[1])}, {data[2], sizeof(data[2])}};
+    CHECK(string_find_closest(closest, 4, &query, longs, ARRAY_SIZE(longs), 10) == 1);
+    CHECK(closest[0].index == 1 && closest[0].distance == 2);
+}
+
+
+int main()
+{
+    test_string_edit_distance();
+    test_string_edit_distance_random();
+    test_string_find_closest();
+    success("All tests passed :-)");
+    return 0;
+}
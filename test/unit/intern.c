@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+
+#include "util/intern.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+static void test_intern_string()
+{
+    struct intern_table * table = intern_table_make();
+    CHECK(table != NULL);
+    CHECK(intern_table_size(table) == 0);
+
+    char one_data[] = "Warning";
+    char two_data[] = "Warning";
+    struct string one = {one_data, 7};
+    struct string two = {two_data, 7};
+    struct string one_atom, two_atom, other_atom;
+
+    CHECK(intern_string(table, &one, &one_atom));
+    CHECK(intern_string(table, &two, &two_atom));
+    CHECK(intern_string(table, &string_literal("Info"), &other_atom));
+
+    // Equal strings share one atom, which is a copy of the contents.
+    CHECK(string_is_same(&one_atom, &two_atom));
+    CHECK(!string_is_same(&one_atom, &other_atom));
+    CHECK(one_atom.data != one.data);
+    CHECK(string_is_equal(&one_atom, &one));
+    CHECK(strcmp(one_atom.data, "Warning") == 0);
+    CHECK(intern_table_size(table) == 2);
+
+    // Empty strings are atoms too.
+    struct string empty_atom;
+    CHECK(intern_string(table, &(struct string){NULL, 0}, &empty_atom));
+    CHECK(empty_atom.size == 0);
+    CHECK(intern_table_size(table) == 3);
+
+    intern_table_free(table);
+}
+
+
+static void test_intern_lookup()
+{
+    struct intern_table * table = intern_table_make();
+    struct string atom, found;
+
+    CHECK(intern_lookup(table, &string_literal("Debug"), &found) == false);
+    CHECK(intern_string(table, &string_literal("Debug"), &atom));
+    CHECK(intern_lookup(table, &string_literal("Debug"), &found) == true);
+    CHECK(string_is_same(&atom, &found));
+
+    // Atoms must survive the table growing.
+    char buffer[32];
+    for (int i = 0; i < 10000; ++i)
+    {
+        int size = snprintf(buffer, sizeof(buffer), "key-%i", i);
+        CHECK(intern_string(table, &(struct string){buffer, (size_t)size}, &found));
+    }
+    CHECK(intern_table_size(table) == 10001);
+    CHECK(intern_lookup(table, &string_literal("Debug"), &found));
+    CHECK(string_is_same(&atom, &found));
+    CHECK(intern_lookup(table, &string_literal("key-9999"), &found));
+    CHECK(string_is_equal_cstr(&found, "key-9999"));
+
+    intern_table_free(table);
+}
+
+
+// Each thread interns the same keys so that they race to insert them.
+static struct intern_table * shared_table;
+static struct string shared_atoms[4][1000];
+
+
+static int intern_thread(void * arg)
+{
+    size_t id = (size_t)arg;
+    char buffer[32];
+    for (int i = 0; i < 1000; ++i)
+    {
+        int size = snprintf(buffer, sizeof(buffer), "shared-%i", i);
+        if (!intern_string(shared_table, &(struct string){buffer, (size_t)size},
+                           &shared_atoms[id][i]))
+            return 1;
+    }
+    return 0;
+}
+
+
+static void test_intern_threads()
+{
+    shared_table = intern_table_make();
+    thrd_t threads[4];
+    for (size_t i = 0; i < ARRAY_SIZE(threads); ++i)
+        CHECK(thrd_create(threads + i, intern_thread, (void *)i) == thrd_success);
+    for (size_t i = 0; i < ARRAY_SIZE(threads); ++i)
+    {
+        int rc = 1;
+        CHECK(thrd_join(threads[i], &rc) == thrd_success);
+        CHECK(rc == 0);
+    }
+
+    CHECK(intern_table_size(shared_table) == 1000);
+    for (size_t i = 1; i < ARRAY_SIZE(threads); ++i)
+        for (size_t j = 0; j < 1000; ++j)
+            CHECK(string_is_same(&shared_atoms[0][j], &shared_atoms[i][j]));
+
+    intern_table_free(shared_table);
+}
+
+
+int main()
+{
+    test_intern_string();
+    test_intern_lookup();
+    test_intern_threads();
+    success("All tests passed :-)");
+    return 0;
+}
@@ -0,0 +1,425 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/json.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+// A token and its text.
+struct expected_token
+{
+    enum json_token_type type;
+    char const * text;
+};
+
+
+// Tokenize `input` whole, and in chunks of every size up to `max_chunk`,
+// one token at a time and in batches of several sizes, and check that it
+// gives `expected` and then `last`. For ::JSON_RC_INVALID, the offset of the
+// problem must be `invalid_offset`.
+static void check_tokens(char const * input, struct expected_token const * expected,
+                         size_t expected_count, size_t max_chunk, enum json_rc last,
+                         size_t invalid_offset)
+{
+    // A batch size of 0 means one token at a time with json_reader_next().
+    size_t const batch_sizes[] = {0, 1, 3, 16};
+    size_t const size = strlen(input);
+    for (size_t b = 0; b < ARRAY_SIZE(batch_sizes); ++b)
+        for (size_t chunk_size = 0; chunk_size <= max_chunk; ++chunk_size)
+        {
+            struct json_reader reader;
+            json_reader_init(&reader);
+            size_t offset = (chunk_size == 0) ? size : 0;
+            struct string chunk = {(char *)input, (chunk_size == 0) ? size : 0};
+            json_reader_feed(&reader, &chunk, chunk_size == 0);
+
+            size_t count = 0;
+            struct json_token tokens[16];
+            size_t stored;
+            enum json_rc rc;
+            for (;;)
+            {
+                if (batch_sizes[b] == 0)
+                {
+                    rc = json_reader_next(&reader, tokens);
+                    stored = (rc == JSON_RC_TOKEN);
+                }
+                else
+                    rc = json_reader_next_batch(&reader, tokens, batch_sizes[b], &stored);
+
+                // Every token of a batch stays valid until the next call.
+                for (size_t i = 0; i < stored; ++i)
+                {
+                    CHECK(count < expected_count);
+                    CHECK(tokens[i].type == expected[count].type);
+                    CHECK(string_is_equal_cstr(&tokens[i].text, expected[count].text));
+                    ++count;
+                }
+                if (rc == last)
+                    break;
+                if (rc == JSON_RC_NEED_INPUT)
+                {
+                    size_t next = (offset + chunk_size < size) ? chunk_size : size - offset;
+                    chunk = (struct string){(char *)input + offset, next};
+                    offset += next;
+                    json_reader_feed(&reader, &chunk, offset == size);
+                    continue;
+                }
+                CHECK(rc == JSON_RC_TOKEN);
+            }
+            CHECK(count == expected_count);
+            if (last == JSON_RC_INVALID)
+                CHECK(reader.offset == invalid_offset);
+            json_reader_free(&reader);
+        }
+}
+
+
+static void test_json_reader()
+{
+    struct expected_token const document[] = {
+        {JSON_TOKEN_OBJECT_START, "{"},
+        {JSON_TOKEN_KEY, "name"},
+        {JSON_TOKEN_STRING, "say \\\"hi\\\" \\\\"},
+        {JSON_TOKEN_KEY, "values"},
+        {JSON_TOKEN_ARRAY_START, "["},
+        {JSON_TOKEN_NUMBER, "0"},
+        {JSON_TOKEN_NUMBER, "-12.5e+3"},
+        {JSON_TOKEN_TRUE, "true"},
+        {JSON_TOKEN_FALSE, "false"},
+        {JSON_TOKEN_NULL, "null"},
+        {JSON_TOKEN_ARRAY_START, "["},
+        {JSON_TOKEN_ARRAY_END, "]"},
+        {JSON_TOKEN_OBJECT_START, "{"},
+        {JSON_TOKEN_OBJECT_END, "}"},
+        {JSON_TOKEN_STRING, ""},
+        {JSON_TOKEN_ARRAY_END, "]"},
+        {JSON_TOKEN_KEY, "{[,:]}"},
+        {JSON_TOKEN_NUMBER, "1E2"},
+        {JSON_TOKEN_OBJECT_END, "}"},
+    };
+    check_tokens("{\"name\": \"say \\\"hi\\\" \\\\\",\n \"values\" : [0,-12.5e+3,true ,false,\r\n"
+                 "\tnull,[],{},\"\"], \"{[,:]}\":1E2}",
+                 document, ARRAY_SIZE(document), 90, JSON_RC_END, 0);
+
+    // Values may follow one another, as in JSON Lines.
+    struct expected_token const lines[] = {
+        {JSON_TOKEN_NUMBER, "1"},     {JSON_TOKEN_OBJECT_START, "{"}, {JSON_TOKEN_KEY, "a"},
+        {JSON_TOKEN_NULL, "null"},    {JSON_TOKEN_OBJECT_END, "}"},   {JSON_TOKEN_STRING, "x"},
+        {JSON_TOKEN_NUMBER, "2"},
+    };
+    check_tokens(" 1\n{\"a\":null}\n\"x\"\n2 ", lines, ARRAY_SIZE(lines), 24, JSON_RC_END, 0);
+
+    // Input of only whitespace has no values.
+    check_tokens("", NULL, 0, 1, JSON_RC_END, 0);
+    check_tokens(" \r\n\t ", NULL, 0, 5, JSON_RC_END, 0);
+}
+
+
+static void test_json_reader_invalid()
+{
+    struct
+    {
+        char const * input;
+        size_t offset;
+    } const cases[] = {
+        {"[", 1},           {"]", 0},           {"{\"a\"}", 4},     {"{\"a\":}", 5},
+        {"[1,]", 3},        {"{,}", 1},         {"[1 2]", 3},       {"tru", 0},
+        {"nul ", 0},        {"truex", 0},       {"\"abc", 4},       {"{\"a\":1,}", 7},
+        {"[}", 1},          {"{]", 1},          {":", 0},           {"{1:2}", 1},
+        {"[\"a\":1]", 4},   {"[1]]", 3},        {"\\\"", 0},        {"[\"a\\\"]", 6},
+        {"{\"a\" 1}", 5},   {"[+1]", 1},        {"[.5]", 1},        {"[1,,2]", 3},
+        {"[\xc3\xa9]", 1},  {"{\"a\":1\"b\":2}", 6},
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(cases); ++i)
+    {
+        // The tokens before the problem are returned, so skip them.
+        struct json_reader reader;
+        json_reader_init(&reader);
+        struct string input;
+        string_view_cstr(&input, (char *)cases[i].input);
+        json_reader_feed(&reader, &input, true);
+        struct json_token token;
+        enum json_rc rc;
+        while ((rc = json_reader_next(&reader, &token)) == JSON_RC_TOKEN)
+            ;
+        CHECK(rc == JSON_RC_INVALID);
+        CHECK(reader.offset == cases[i].offset);
+        json_reader_free(&reader);
+    }
+
+    // Containers can be nested up to the limit.
+    char * deep = malloc(2 * JSON_MAX_DEPTH + 2);
+    CHECK(deep != NULL);
+    memset(deep, '[', JSON_MAX_DEPTH);
+    memset(deep + JSON_MAX_DEPTH, ']', JSON_MAX_DEPTH);
+    deep[2 * JSON_MAX_DEPTH] = '\0';
+    struct json_reader reader;
+    json_reader_init(&reader);
+    struct string input = {deep, 2 * JSON_MAX_DEPTH};
+    json_reader_feed(&reader, &input, true);
+    struct json_token token;
+    size_t count = 0;
+    while (json_reader_next(&reader, &token) == JSON_RC_TOKEN)
+        ++count;
+    CHECK(count == 2 * JSON_MAX_DEPTH);
+    json_reader_free(&reader);
+
+    memmove(deep + 1, deep, 2 * JSON_MAX_DEPTH + 1);
+    json_reader_init(&reader);
+    input.size += 1;
+    json_reader_feed(&reader, &input, true);
+    while (json_reader_next(&reader, &token) == JSON_RC_TOKEN)
+        ;
+    CHECK(reader.offset == JSON_MAX_DEPTH);
+    json_reader_free(&reader);
+    free(deep);
+}
+
+
+// Append `value` to `builder` as a JSON string, escaping what must be
+// escaped and some of what needn't be.
+static void append_string(struct string_builder * builder, struct string const * value,
+                          unsigned * seed)
+{
+    CHECK(string_builder_append_char(builder, '"'));
+    for (size_t i = 0; i < value->size; ++i)
+    {
+        char const c = value->data[i];
+        *seed = *seed * 1103515245u + 12345u;
+        if (c == '"' || c == '\\')
+        {
+            CHECK(string_builder_append_char(builder, '\\'));
+            CHECK(string_builder_append_char(builder, c));
+        }
+        else if (c == '\n')
+            CHECK(string_builder_append_cstr(builder, "\\n"));
+        else if ((*seed >> 16) % 8 == 0)
+        {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04X", (unsigned)c);
+            CHECK(string_builder_append_cstr(builder, escape));
+        }
+        else
+            CHECK(string_builder_append_char(builder, c));
+    }
+    CHECK(string_builder_append_char(builder, '"'));
+}
+
+
+static void test_json_reader_random()
+{
+    // Encode random strings with many quotes and backslashes, some of them
+    // long so that the string and escape states are carried across blocks,
+    // together with numbers, and check that they're tokenized and decoded
+    // back with every instruction set, with chunks of several sizes and one
+    // token at a time or in batches.
+    enum { value_count = 3000 };
+    char (*values)[200] = malloc(value_count * sizeof(*values));
+    struct string * strings = malloc(value_count * sizeof(*strings));
+    char * decoded = malloc(8 * 200);
+    CHECK(values != NULL && strings != NULL && decoded != NULL);
+
+    struct string_builder builder;
+    string_builder_init(&builder);
+    CHECK(string_builder_append_char(&builder, '['));
+    unsigned seed = 1;
+    for (size_t i = 0; i < value_count; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t size = (seed >> 16) % ((seed >> 12) % 8 == 0 ? 200 : 12);
+        for (size_t j = 0; j < size; ++j)
+        {
+            seed = seed * 1103515245u + 12345u;
+            values[i][j] = "abcd\"\\\\\\\n {}[],:x1"[(seed >> 16) % 18];
+        }
+        strings[i] = (struct string){values[i], size};
+
+        if (i > 0)
+            CHECK(string_builder_append_cstr(&builder, (seed >> 4) % 2 ? ",\n" : ","));
+        if ((seed >> 8) % 3 == 0)
+        {
+            // An object whose key is the string and whose value is its index.
+            CHECK(string_builder_append_char(&builder, '{'));
+            append_string(&builder, strings + i, &seed);
+            CHECK(string_builder_append_char(&builder, ':'));
+            CHECK(string_builder_append_uint(&builder, i));
+            CHECK(string_builder_append_char(&builder, '}'));
+        }
+        else
+        {
+            append_string(&builder, strings + i, &seed);
+        }
+    }
+    CHECK(string_builder_append_char(&builder, ']'));
+    struct string input = {builder.data, builder.size};
+
+    size_t const chunk_sizes[] = {0, 1, 7, 63, 64, 65, 1000};
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        for (size_t c = 0; c < ARRAY_SIZE(chunk_sizes); ++c)
+        {
+            struct json_reader reader;
+            json_reader_init(&reader);
+            size_t chunk_size = (chunk_sizes[c] == 0) ? input.size : chunk_sizes[c];
+            size_t offset = 0;
+
+            size_t count = 0;
+            size_t other_count = 0;
+            struct json_token tokens[8];
+            size_t stored = 0;
+            enum json_rc rc = JSON_RC_NEED_INPUT;
+            while (rc != JSON_RC_END)
+            {
+                if (c % 2 == 0)
+                {
+                    rc = json_reader_next(&reader, tokens);
+                    stored = (rc == JSON_RC_TOKEN);
+                }
+                else
+                    rc = json_reader_next_batch(&reader, tokens, ARRAY_SIZE(tokens), &stored);
+                CHECK(rc != JSON_RC_INVALID && rc != JSON_RC_ERROR);
+
+                for (size_t i = 0; i < stored; ++i)
+                {
+                    struct json_token const * token = tokens + i;
+                    if (token->type == JSON_TOKEN_KEY || token->type == JSON_TOKEN_STRING)
+                    {
+                        CHECK(count < value_count);
+                        size_t size = json_string_decode(decoded, &token->text);
+                        CHECK(size == strings[count].size);
+                        CHECK(memcmp(decoded, strings[count].data, size) == 0);
+                        ++count;
+                    }
+                    else if (token->type == JSON_TOKEN_NUMBER)
+                    {
+                        int64_t number;
+                        CHECK(json_number_to_int64(&number, &token->text));
+                        CHECK(number == (int64_t)count - 1);
+                    }
+                    else
+                    {
+                        ++other_count;
+                    }
+                }
+                if (rc == JSON_RC_NEED_INPUT)
+                {
+                    size_t next = (offset + chunk_size < input.size) ? chunk_size
+                                                                     : input.size - offset;
+                    struct string chunk = {input.data + offset, next};
+                    offset += next;
+                    json_reader_feed(&reader, &chunk, offset == input.size);
+                }
+            }
+            CHECK(count == value_count);
+            CHECK(other_count >= 2);
+            json_reader_free(&reader);
+        }
+    cpu_isa_set(cpu_isa_supported());
+
+    string_builder_free(&builder);
+    free(decoded);
+    free(strings);
+    free(values);
+}
+
+
+static void test_json_string_decode()
+{
+    struct
+    {
+        char const * input;
+        char const * output;
+    } const cases[] = {
+        {"plain", "plain"},
+        {"\\\"\\\\\\/\\b\\f\\n\\r\\t", "\"\\/\b\f\n\r\t"},
+        {"\\u0041\\u00e9\\u20AC", "A\xc3\xa9\xe2\x82\xac"},
+        {"\\uD83D\\uDE00!", "\xf0\x9f\x98\x80!"},
+        {"caf\xc3\xa9", "caf\xc3\xa9"},
+        {"", ""},
+    };
+    char output[32];
+    for (size_t i = 0; i < ARRAY_SIZE(cases); ++i)
+    {
+        struct string input;
+        string_view_cstr(&input, (char *)cases[i].input);
+        size_t size = json_string_decode(output, &input);
+        CHECK(size == strlen(cases[i].output));
+        CHECK(memcmp(output, cases[i].output, size) == 0);
+    }
+
+    char const * const invalid[] = {
+        "\\", "a\\x", "\\u12", "\\u12G4", "\\uD83D", "\\uD83D\\n", "\\uD83D\\u0041", "\\uDE00",
+        "a\nb", "\t",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(invalid); ++i)
+    {
+        struct string input;
+        string_view_cstr(&input, (char *)invalid[i]);
+        CHECK(json_string_decode(output, &input) == SIZE_MAX);
+    }
+}
+
+
+static void test_json_number()
+{
+    int64_t integer;
+    CHECK(json_number_to_int64(&integer, &string_literal("0")) && integer == 0);
+    CHECK(json_number_to_int64(&integer, &string_literal("-42")) && integer == -42);
+    CHECK(json_number_to_int64(&integer, &string_literal("9223372036854775807")) &&
+          integer == INT64_MAX);
+    CHECK(json_number_to_int64(&integer, &string_literal("-9223372036854775808")) &&
+          integer == INT64_MIN);
+    CHECK(!json_number_to_int64(&integer, &string_literal("9223372036854775808")));
+    CHECK(!json_number_to_int64(&integer, &string_literal("-9223372036854775809")));
+    CHECK(!json_number_to_int64(&integer, &string_literal("1.0")));
+    CHECK(!json_number_to_int64(&integer, &string_literal("1e3")));
+    CHECK(!json_number_to_int64(&integer, &string_literal("01")));
+    CHECK(!json_number_to_int64(&integer, &string_literal("-")));
+
+    double number;
+    CHECK(json_number_to_double(&number, &string_literal("0")) && number == 0.0);
+    CHECK(json_number_to_double(&number, &string_literal("-12.5e+3")) && number == -12500.0);
+    CHECK(json_number_to_double(&number, &string_literal("0.1")) && number == 0.1);
+    CHECK(!json_number_to_double(&number, &string_literal("inf")));
+    CHECK(!json_number_to_double(&number, &string_literal("0x10")));
+
+    // The reader only checks the first byte of a number, and the rest of it
+    // when it's converted.
+    char const * const invalid[] = {"01", "1.", "-", "1e", "1x", "-.5", "1e+", "1.5.2"};
+    for (size_t i = 0; i < ARRAY_SIZE(invalid); ++i)
+    {
+        struct string text;
+        string_view_cstr(&text, (char *)invalid[i]);
+        struct expected_token const expected = {JSON_TOKEN_NUMBER, invalid[i]};
+        check_tokens(invalid[i], &expected, 1, 3, JSON_RC_END, 0);
+        CHECK(!json_number_to_int64(&integer, &text));
+        CHECK(!json_number_to_double(&number, &text));
+    }
+
+    // The token needn't be null-terminated, and may be longer than a short buffer.
+    CHECK(json_number_to_double(&number, &(struct string){"25", 1}) && number == 2.0);
+    char digits[101];
+    memset(digits, '0', sizeof(digits));
+    digits[0] = '1';
+    CHECK(json_number_to_double(&number, &(struct string){digits, sizeof(digits)}) &&
+          number == 1e100);
+}
+
+
+int main()
+{
+    test_json_reader();
+    test_json_reader_invalid();
+    test_json_reader_random();
+    test_json_string_decode();
+    test_json_number();
+    success("All tests passed :-)");
+    return 0;
+}
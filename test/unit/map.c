@@ -0,0 +1,172 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/map.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+static void test_string_map_basic()
+{
+    struct string_map map;
+    string_map_init(&map);
+    CHECK(string_map_size(&map) == 0);
+    CHECK(string_map_find(&map, &string_literal("a")) == NULL);
+    CHECK(!string_map_erase(&map, &string_literal("a")));
+
+    int one = 1, two = 2, three = 3;
+    CHECK(string_map_insert(&map, &string_literal("one"), &one));
+    CHECK(string_map_insert(&map, &string_literal("two"), &two));
+    CHECK(string_map_insert(&map, &string_literal(""), &three));
+    CHECK(string_map_size(&map) == 3);
+
+    struct string_map_entry * entry = string_map_find(&map, &string_literal("two"));
+    CHECK(entry != NULL && entry->value == &two);
+    CHECK(string_is_equal_cstr(&entry->key, "two"));
+    CHECK(string_map_find(&map, &string_literal("")) != NULL);
+    CHECK(string_map_find(&map, &string_literal("tw")) == NULL);
+    CHECK(string_map_find(&map, &string_literal("two ")) == NULL);
+
+    // Inserting an existing key replaces its value.
+    CHECK(string_map_insert(&map, &string_literal("one"), &three));
+    CHECK(string_map_size(&map) == 3);
+    CHECK(string_map_find(&map, &string_literal("one"))->value == &three);
+
+    CHECK(string_map_erase(&map, &string_literal("one")));
+    CHECK(!string_map_erase(&map, &string_literal("one")));
+    CHECK(string_map_find(&map, &string_literal("one")) == NULL);
+    CHECK(string_map_size(&map) == 2);
+
+    size_t position = 0;
+    size_t count = 0;
+    while ((entry = string_map_next(&map, &position)) != NULL)
+    {
+        CHECK(entry->value == &two || entry->value == &three);
+        ++count;
+    }
+    CHECK(count == 2);
+
+    string_map_free(&map);
+    CHECK(string_map_size(&map) == 0);
+    CHECK(string_map_find(&map, &string_literal("two")) == NULL);
+}
+
+
+static void test_string_map_random()
+{
+    // Insert and erase many keys, so the map grows and reuses deleted slots,
+    // checking it against an array of which keys should be present.
+    enum { key_count = 5000 };
+    char (*names)[16] = malloc(key_count * sizeof(*names));
+    struct string * keys = malloc(key_count * sizeof(*keys));
+    bool * present = malloc(key_count * sizeof(*present));
+    struct string_map_entry ** found = malloc(key_count * sizeof(*found));
+    CHECK(names != NULL && keys != NULL && present != NULL && found != NULL);
+    for (size_t i = 0; i < key_count; ++i)
+    {
+        keys[i].data = names[i];
+        keys[i].size = (size_t)snprintf(names[i], sizeof(names[i]), "key-%zu", i);
+    }
+
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+    {
+        struct string_map map;
+        string_map_init(&map);
+        memset(present, 0, key_count * sizeof(*present));
+        size_t size = 0;
+
+        unsigned seed = 1;
+        for (size_t round = 0; round < 50000; ++round)
+        {
+            seed = seed * 1103515245u + 12345u;
+            size_t i = (seed >> 8) % key_count;
+            if ((seed >> 4) % 3 != 0)
+            {
+                CHECK(string_map_insert(&map, keys + i, (void *)(uintptr_t)(i + 1)));
+                size += !present[i];
+                present[i] = true;
+            }
+            else
+            {
+                CHECK(string_map_erase(&map, keys + i) == present[i]);
+                size -= present[i];
+                present[i] = false;
+            }
+            CHECK(string_map_size(&map) == size);
+        }
+
+        // Look every key up one at a time and all at once.
+        size_t expected = 0;
+        for (size_t i = 0; i < key_count; ++i)
+        {
+            struct string_map_entry * entry = string_map_find(&map, keys + i);
+            CHECK((entry != NULL) == present[i]);
+            CHECK(entry == NULL || entry->value == (void *)(uintptr_t)(i + 1));
+            expected += present[i];
+        }
+        CHECK(string_map_find_batch(found, &map, keys, key_count) == expected);
+        for (size_t i = 0; i < key_count; ++i)
+            CHECK(found[i] == string_map_find(&map, keys + i));
+
+        // Iteration visits every entry exactly once.
+        size_t position = 0;
+        size_t visited = 0;
+        struct string_map_entry * entry;
+        while ((entry = string_map_next(&map, &position)) != NULL)
+        {
+            size_t i = (size_t)(uintptr_t)entry->value - 1;
+            CHECK(present[i]);
+            present[i] = false;
+            ++visited;
+        }
+        CHECK(visited == size);
+        string_map_free(&map);
+    }
+    cpu_isa_set(cpu_isa_supported());
+
+    free(found);
+    free(present);
+    free(keys);
+    free(names);
+}
+
+
+static void test_string_map_reserve()
+{
+    struct string_map map;
+    string_map_init(&map);
+    CHECK(string_map_reserve(&map, 1000));
+    CHECK(map.capacity >= 1000);
+
+    // Inserting up to the reserved size doesn't move the entries.
+    struct string_map_entry * entries = map.entries;
+    char names[1000][8];
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        struct string key = {names[i], (size_t)snprintf(names[i], sizeof(names[i]), "%zu", i)};
+        CHECK(string_map_insert(&map, &key, NULL));
+    }
+    CHECK(map.entries == entries);
+    CHECK(string_map_size(&map) == 1000);
+
+    struct string_map_entry * found[3];
+    struct string keys[] = {string_literal("0"), string_literal("1000"), string_literal("999")};
+    CHECK(string_map_find_batch(found, &map, keys, ARRAY_SIZE(keys)) == 2);
+    CHECK(found[0] != NULL && found[1] == NULL && found[2] != NULL);
+    string_map_free(&map);
+}
+
+
+int main()
+{
+    test_string_map_basic();
+    test_string_map_random();
+    test_string_map_reserve();
+    success("All tests passed :-)");
+    return 0;
+}
@@ -0,0 +1,282 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/matcher.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+static void test_string_matcher_find_all()
+{
+    struct string patterns[] = {string_literal("he"), string_literal("she"), string_literal("his"),
+                                string_literal("hers")};
+    struct string_matcher * matcher = string_matcher_make(patterns, ARRAY_SIZE(patterns));
+    CHECK(matcher != NULL);
+
+    // Overlapping matches are ordered by where they end, longest first.
+    struct string_match * matches;
+    struct string text = string_literal("ushers his");
+    CHECK(string_matcher_find_all(&matches, matcher, &text) == 4);
+    CHECK(matches[0].offset == 1 && matches[0].pattern == 1);
+    CHECK(matches[1].offset == 2 && matches[1].pattern == 0);
+    CHECK(matches[2].offset == 2 && matches[2].pattern == 3);
+    CHECK(matches[3].offset == 7 && matches[3].pattern == 2);
+    free(matches);
+
+    CHECK(string_matcher_find_all(&matches, matcher, &string_literal("xyz")) == 0);
+    CHECK(matches == NULL);
+    CHECK(string_matcher_find_all(&matches, matcher, &(struct string){NULL, 0}) == 0);
+    string_matcher_free(matcher);
+
+    // Empty patterns never match and duplicates are reported once.
+    struct string odd[] = {string_literal(""), string_literal("a"), string_literal("a")};
+    matcher = string_matcher_make(odd, ARRAY_SIZE(odd));
+    CHECK(string_matcher_find_all(&matches, matcher, &string_literal("aba")) == 2);
+    CHECK(matches[0].offset == 0 && matches[0].pattern == 1);
+    CHECK(matches[1].offset == 2 && matches[1].pattern == 1);
+    free(matches);
+    string_matcher_free(matcher);
+
+    matcher = string_matcher_make(NULL, 0);
+    CHECK(matcher != NULL);
+    CHECK(string_matcher_find_all(&matches, matcher, &string_literal("aba")) == 0);
+    string_matcher_free(matcher);
+}
+
+
+// Fill \p buffer with pseudo-random characters from the first \p letters of the alphabet.
+static void fill_pseudo_random(char * buffer, size_t size, size_t letters, unsigned * seed)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        *seed = *seed * 1103515245u + 12345u;
+        buffer[i] = (char)('a' + (*seed >> 16) % letters);
+    }
+}
+
+
+// Return the index of the longest pattern that matches \p text at \p offset,
+// preferring the first of equal patterns, or `SIZE_MAX` if none match.
+static size_t longest_match_at(struct string const * patterns, size_t count,
+                               struct string const * text, size_t offset)
+{
+    size_t best = SIZE_MAX;
+    for (size_t p = 0; p < count; ++p)
+        if (patterns[p].size > 0 && patterns[p].size <= text->size - offset &&
+            memcmp(text->data + offset, patterns[p].data, patterns[p].size) == 0 &&
+            (best == SIZE_MAX || patterns[p].size > patterns[best].size))
+            best = p;
+    return best;
+}
+
+
+static void test_string_matcher_random()
+{
+    // Few letters and many patterns give long failure paths, lots of
+    // overlapping matches and states both with and without dense rows.
+    unsigned seed = 1;
+    char pattern_data[64][12];
+    struct string patterns[64];
+    struct string replacements[64];
+    char text_data[500];
+    for (size_t round = 0; round < 50; ++round)
+    {
+        size_t count = 1 + round % ARRAY_SIZE(patterns);
+        size_t letters = 2 + round % 3;
+        for (size_t p = 0; p < count; ++p)
+        {
+            size_t size = 1 + p % sizeof(pattern_data[p]);
+            fill_pseudo_random(pattern_data[p], size, letters, &seed);
+            patterns[p] = (struct string){pattern_data[p], size};
+            replacements[p] = (struct string){pattern_data[p], p % 3};
+        }
+        fill_pseudo_random(text_data, sizeof(text_data), letters, &seed);
+        struct string text = {text_data, sizeof(text_data)};
+
+        struct string_matcher * matcher = string_matcher_make(patterns, count);
+        CHECK(matcher != NULL);
+
+        // Every match should be found, in order of end then length.
+        struct string_match * matches;
+        size_t match_count = string_matcher_find_all(&matches, matcher, &text);
+        size_t expected_count = 0;
+        for (size_t end = 1; end <= text.size; ++end)
+            for (size_t size = end; size > 0; --size)
+            {
+                size_t found = SIZE_MAX;
+                for (size_t p = 0; p < count && found == SIZE_MAX; ++p)
+                    if (patterns[p].size == size &&
+                        memcmp(text.data + end - size, patterns[p].data, size) == 0)
+                        found = p;
+                if (found == SIZE_MAX)
+                    continue;
+                CHECK(expected_count < match_count);
+                CHECK(matches[expected_count].offset == end - size);
+                CHECK(matches[expected_count].pattern == found);
+                ++expected_count;
+            }
+        CHECK(match_count == expected_count);
+        free(matches);
+
+        // Replacing should pick leftmost then longest matches.
+        char expected_data[sizeof(text_data) * 2];
+        size_t expected_size = 0;
+        for (size_t i = 0; i < text.size;)
+        {
+            size_t p = longest_match_at(patterns, count, &text, i);
+            if (p == SIZE_MAX)
+            {
+                expected_data[expected_size++] = text.data[i++];
+                continue;
+            }
+            memcpy(expected_data + expected_size, replacements[p].data, replacements[p].size);
+            expected_size += replacements[p].size;
+            i += patterns[p].size;
+        }
+
+        struct string replaced;
+        CHECK(string_matcher_replace_all(&replaced, matcher, &text, replacements));
+        CHECK(string_is_equal(&replaced, &(struct string){expected_data, expected_size}));
+        string_free(&replaced);
+        string_matcher_free(matcher);
+    }
+}
+
+
+static void test_string_matcher_replace_all()
+{
+    struct string patterns[] = {string_literal("bc"), string_literal("abcd"),
+                                string_literal("cat")};
+    struct string replacements[] = {string_literal("X"), string_literal("<abcd>"),
+                                    string_literal("dog")};
+    struct string_matcher * matcher = string_matcher_make(patterns, ARRAY_SIZE(patterns));
+    CHECK(matcher != NULL);
+
+    // "abcd" starts further left than "bc" so it wins even though it ends later.
+    struct string replaced;
+    CHECK(string_matcher_replace_all(&replaced, matcher, &string_literal("abcd abc cat."),
+                                     replacements));
+    CHECK(string_is_equal_cstr(&replaced, "<abcd> aX dog."));
+    string_free(&replaced);
+
+    CHECK(string_matcher_replace_all(&replaced, matcher, &string_literal("none"), replacements));
+    CHECK(string_is_equal_cstr(&replaced, "none"));
+    string_free(&replaced);
+
+    CHECK(string_matcher_replace_all(&replaced, matcher, &string_literal("bc"),
+                                     (struct string[]){{NULL, 0}, {NULL, 0}, {NULL, 0}}));
+    CHECK(replaced.size == 0);
+    string_matcher_free(matcher);
+}
+
+
+static void test_string_prefix_matcher()
+{
+    struct string prefixes[] = {string_literal("/api/"), string_literal("/api/v2/"),
+                                string_literal("/static/"), string_literal("/api/v2/users"),
+                                string_literal("/api/"), string_literal("/a")};
+    struct string_prefix_matcher * matcher =
+        string_prefix_matcher_make(prefixes, ARRAY_SIZE(prefixes));
+    CHECK(matcher != NULL);
+
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("/api/v2/users/7")) == 3);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("/api/v2/user")) == 1);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("/api/v1")) == 0);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("/ap")) == 5);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("/static/x.css")) == 2);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("/stat")) == STRING_NPOS);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("")) == STRING_NPOS);
+
+    // Every match is found, shortest first, and duplicates are reported once.
+    size_t matches[4];
+    struct string text = string_literal("/api/v2/users");
+    CHECK(string_prefix_matcher_all(matches, ARRAY_SIZE(matches), matcher, &text) == 4);
+    CHECK(matches[0] == 5 && matches[1] == 0 && matches[2] == 1 && matches[3] == 3);
+
+    // Matches beyond the capacity are counted but not stored.
+    matches[1] = SIZE_MAX;
+    CHECK(string_prefix_matcher_all(matches, 1, matcher, &text) == 4);
+    CHECK(matches[0] == 5 && matches[1] == SIZE_MAX);
+    CHECK(string_prefix_matcher_all(NULL, 0, matcher, &string_literal("/x")) == 0);
+    string_prefix_matcher_free(matcher);
+
+    // An empty prefix matches everything.
+    struct string odd[] = {string_literal("b"), string_literal("")};
+    matcher = string_prefix_matcher_make(odd, ARRAY_SIZE(odd));
+    CHECK(matcher != NULL);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("")) == 1);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("abc")) == 1);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("bc")) == 0);
+    string_prefix_matcher_free(matcher);
+
+    matcher = string_prefix_matcher_make(NULL, 0);
+    CHECK(matcher != NULL);
+    CHECK(string_prefix_matcher_longest(matcher, &string_literal("abc")) == STRING_NPOS);
+    string_prefix_matcher_free(matcher);
+}
+
+
+static void test_string_prefix_matcher_random()
+{
+    // Few letters give deep tries, prefixes of other prefixes and duplicates,
+    // which are checked against testing every prefix in turn.
+    unsigned seed = 1;
+    char prefix_data[300][10];
+    struct string prefixes[300];
+    char text_data[12];
+    for (size_t round = 0; round < 30; ++round)
+    {
+        size_t count = 1 + round * 10;
+        size_t letters = 2 + round % 3;
+        for (size_t p = 0; p < count; ++p)
+        {
+            seed = seed * 1103515245u + 12345u;
+            size_t size = (seed >> 16) % sizeof(prefix_data[p]);
+            fill_pseudo_random(prefix_data[p], size, letters, &seed);
+            prefixes[p] = (struct string){prefix_data[p], size};
+        }
+
+        struct string_prefix_matcher * matcher = string_prefix_matcher_make(prefixes, count);
+        CHECK(matcher != NULL);
+        for (size_t t = 0; t < 200; ++t)
+        {
+            seed = seed * 1103515245u + 12345u;
+            struct string text = {text_data, (seed >> 16) % sizeof(text_data)};
+            fill_pseudo_random(text_data, text.size, letters, &seed);
+
+            // The first of each distinct matching prefix, by length.
+            size_t expected[sizeof(text_data)];
+            size_t expected_count = 0;
+            for (size_t size = 0; size <= text.size; ++size)
+                for (size_t p = 0; p < count; ++p)
+                    if (prefixes[p].size == size &&
+                        (size == 0 || memcmp(text.data, prefixes[p].data, size) == 0))
+                    {
+                        expected[expected_count++] = p;
+                        break;
+                    }
+
+            size_t matches[sizeof(text_data)];
+            CHECK(string_prefix_matcher_all(matches, ARRAY_SIZE(matches), matcher, &text) ==
+                  expected_count);
+            CHECK(memcmp(matches, expected, expected_count * sizeof(size_t)) == 0);
+            CHECK(string_prefix_matcher_longest(matcher, &text) ==
+                  (expected_count > 0 ? expected[expected_count - 1] : STRING_NPOS));
+        }
+        string_prefix_matcher_free(matcher);
+    }
+}
+
+
+int main()
+{
+    test_string_matcher_find_all();
+    test_string_matcher_random();
+    test_string_matcher_replace_all();
+    test_string_prefix_matcher();
+    test_string_prefix_matcher_random();
+    success("All tests passed :-)");
+    return 0;
+}
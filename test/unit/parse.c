@@ -19,6 +19,13 @@ static void test_parse_bool()
     CHECK(parse_bool("on", &result));
     CHECK(result == true);
 
+    // Letters can be in either case.
+    CHECK(parse_bool("TRUE", &result));
+    CHECK(result == true);
+
+    CHECK(parse_bool("Off", &result));
+    CHECK(result == false);
+
     CHECK(parse_bool("false", &result));
     CHECK(result == false);
 
@@ -0,0 +1,239 @@
+#include <regex.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/regex.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+// Check that `pattern` first matches `text` from `start` to `end`, or
+// doesn't match if `start` is negative.
+static void check_find(struct string const * pattern, struct string const * text, int start,
+                       int end)
+{
+    struct string_regex * regex = string_regex_make(pattern);
+    CHECK(regex != NULL);
+    struct string match;
+    if (start < 0)
+    {
+        CHECK(!string_regex_find(&match, regex, text));
+        CHECK(!string_regex_is_match(regex, text));
+    }
+    else
+    {
+        CHECK(string_regex_find(&match, regex, text));
+        CHECK(match.data == text->data + start && match.size == (size_t)(end - start));
+        CHECK(string_regex_is_match(regex, text));
+    }
+    string_regex_free(regex);
+}
+
+
+static void test_string_regex_find()
+{
+    struct
+    {
+        char const * pattern;
+        char const * text;
+        int start;
+        int end;
+    } const cases[] = {
+        {"abc", "xxabcxx", 2, 5},
+        {"a+", "baaab", 1, 4},
+        {"a*", "baaa", 0, 0},
+        {"a+?", "aaa", 0, 1},
+        {"a*?b", "aaab", 0, 4},
+        {"(a*?)*a", "aab", 0, 1},
+        {"(a?\?)*b?", "aab", 0, 0},
+        {"((a)*?)*", "aab", 0, 0},
+        {"(|a)*", "aab", 0, 0},
+        {"(a|)*b", "aab", 0, 3},
+        {"(a*?)+a", "aab", 0, 1},
+        {"b|abc", "abc", 0, 3},
+        {"abc|b", "xbc", 1, 2},
+        {"(a|ab)(c|bcd)", "abcd", 0, 4},
+        {"(ab|a)(c|bcd)", "abcd", 0, 3},
+        {"^abc", "abcabc", 0, 3},
+        {"^abc", "xabc", -1, -1},
+        {"abc$", "abcabc", 3, 6},
+        {"^$", "", 0, 0},
+        {"^$", "a", -1, -1},
+        {"$", "abc", 3, 3},
+        {"x*$", "abxx", 2, 4},
+        {"[a-c]+", "xxbcaz", 2, 5},
+        {"[^a-c]+", "abxyc", 2, 4},
+        {"[]]", "a]", 1, 2},
+        {"[a-]+", "x-a-", 1, 4},
+        {"\\d{3}-\\d{4}", "call 555-1234 now", 5, 13},
+        {"\\w+@\\w+\\.com", "mail bob@example.com.", 5, 20},
+        {"a{2,3}", "aaaa", 0, 3},
+        {"a{2,}", "aaaaa", 0, 5},
+        {"a{2}", "a aa", 2, 4},
+        {"a{2,3}?", "aaaa", 0, 2},
+        {"a{,2}", "a{,2}", 0, 5},
+        {".", "\n", -1, -1},
+        {"a.c", "a\nc abc", 4, 7},
+        {"\\x41\\t", "zA\t", 1, 3},
+        {"(?:ab)+", "ababa", 0, 4},
+        {"", "abc", 0, 0},
+        {"a|", "b", 0, 0},
+        {"took (\\d+)ms", "GET / took 25ms", 6, 15},
+        {"ERROR.*timeout", "INFO ok ERROR: db timeout after 5s, timeout", 8, 43},
+        {"ERROR.*timeout", "INFO ok ERROR: db refused, ERROR", -1, -1},
+        {"[\\d\\s]+x", "a 1 2x", 1, 6},
+        {"\\S+\\s*$", "a bc  ", 2, 6},
+        {"(a*)*b", "aab", 0, 3},
+        {"(a|b)*?c", "abc", 0, 3},
+        {"ab|cd|ef", "xxefcd", 2, 4},
+        {"\\.\\*", "a.*b", 1, 3},
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(cases); ++i)
+    {
+        struct string pattern;
+        struct string text;
+        string_view_cstr(&pattern, (char *)cases[i].pattern);
+        string_view_cstr(&text, (char *)cases[i].text);
+        check_find(&pattern, &text, cases[i].start, cases[i].end);
+    }
+
+    // Neither the pattern nor the text needs to be null-terminated.
+    check_find(&string_literal("a\\x00b"), &string_literal("xa\0b"), 1, 4);
+    check_find(&(struct string){"abcd", 2}, &(struct string){"xxabcd", 3}, -1, -1);
+}
+
+
+static void test_string_regex_invalid()
+{
+    char const * const patterns[] = {
+        "(", "(a", "a)", "[a", "[]", "[b-a]", "*", "a**", "a+*", "+a", "a|*", "^*",
+        "a{3,2}", "a{1001}", "a{2}{3}", "\\", "\\q", "\\1", "\\x4", "\\xzz", "(?a)", "[a-\\d]",
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(patterns); ++i)
+    {
+        struct string pattern;
+        string_view_cstr(&pattern, (char *)patterns[i]);
+        CHECK(string_regex_make(&pattern) == NULL);
+    }
+
+    // Programs over the size limit are refused too, even when what's repeated
+    // is empty, as they are while they're parsed.
+    CHECK(string_regex_make(&string_literal("((a{1000}){1000}){1000}")) == NULL);
+    CHECK(string_regex_make(&string_literal("(((){1000}){1000}){1000}")) == NULL);
+    CHECK(string_regex_make(&string_literal("((a{0}){1000}){1000}")) == NULL);
+    CHECK(string_regex_make(&string_literal("(a{100}|b{100}){1000}")) == NULL);
+    struct string_regex * regex = string_regex_make(&string_literal("x(){1000}y"));
+    CHECK(regex != NULL);
+    CHECK(string_regex_is_match(regex, &string_literal("-xy-")));
+    string_regex_free(regex);
+
+    // So are programs with too many repetitions of what can match nothing
+    // nested around them, which are tracked at each level.
+    char nested[1024];
+    size_t const depths[] = {10, 200};
+    for (size_t i = 0; i < ARRAY_SIZE(depths); ++i)
+    {
+        size_t size = 0;
+        memset(nested + size, '(', depths[i]);
+        size += depths[i];
+        memcpy(nested + size, "a{0,1000}", 9);
+        size += 9;
+        for (size_t j = 0; j < depths[i]; ++j, size += 2)
+            memcpy(nested + size, ")*", 2);
+        regex = string_regex_make(&(struct string){nested, size});
+        CHECK((regex != NULL) == (depths[i] == 10));
+        if (regex != NULL)
+            CHECK(string_regex_is_match(regex, &string_literal("aaa")));
+        string_regex_free(regex);
+    }
+}
+
+
+static void test_string_regex_posix()
+{
+    // Whether there's a match doesn't depend on which match is chosen, so
+    // it can be compared with the C library for patterns both understand.
+    char const * const patterns[] = {
+        "ab+c", "(a|bc)*d", "^a.b", "c$", "[ab]{2,3}c", "a(b|c)*d|e", "(ab|b)*c?d$", "^(a|b)+$",
+        "b{2}", "((a|b)c|d)+e", "^$|ab",
+    };
+    char text[24];
+    unsigned seed = 1;
+    for (size_t p = 0; p < ARRAY_SIZE(patterns); ++p)
+    {
+        regex_t posix;
+        CHECK(regcomp(&posix, patterns[p], REG_EXTENDED | REG_NOSUB) == 0);
+        struct string pattern;
+        string_view_cstr(&pattern, (char *)patterns[p]);
+        struct string_regex * regex = string_regex_make(&pattern);
+        CHECK(regex != NULL);
+
+        for (size_t round = 0; round < 2000; ++round)
+        {
+            seed = seed * 1103515245u + 12345u;
+            size_t const size = (seed >> 16) % (sizeof(text) - 1);
+            for (size_t i = 0; i < size; ++i)
+            {
+                seed = seed * 1103515245u + 12345u;
+                text[i] = (char)('a' + (seed >> 16) % 5);
+            }
+            text[size] = '\0';
+
+            struct string const view = {text, size};
+            struct string match;
+            bool const expected = regexec(&posix, text, 0, NULL, 0) == 0;
+            CHECK(string_regex_is_match(regex, &view) == expected);
+            CHECK(string_regex_find(&match, regex, &view) == expected);
+        }
+        string_regex_free(regex);
+        regfree(&posix);
+    }
+}
+
+
+static void test_string_regex_cache()
+{
+    // Every run of 15 bytes starting with an `a` and 14 others leads to a
+    // different state, which is many more than fit in the cache, so it's
+    // cleared over and over while searching.
+    size_t const size = 100000;
+    char * text = malloc(size);
+    CHECK(text != NULL);
+    unsigned seed = 1;
+    size_t last = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        text[i] = ((seed >> 16) % 2) ? 'a' : 'b';
+        if (text[i] == 'a' && i + 15 <= size)
+            last = i;
+    }
+
+    struct string_regex * regex = string_regex_make(&string_literal("(a|b)*a(a|b){14}"));
+    CHECK(regex != NULL);
+    struct string const view = {text, size};
+    struct string match;
+    CHECK(string_regex_find(&match, regex, &view));
+    CHECK(match.data == text && match.size == last + 15);
+
+    memset(text, 'b', size);
+    CHECK(!string_regex_is_match(regex, &view));
+    CHECK(!string_regex_find(&match, regex, &view));
+    string_regex_free(regex);
+    free(text);
+}
+
+
+int main()
+{
+    test_string_regex_find();
+    test_string_regex_invalid();
+    test_string_regex_posix();
+    test_string_regex_cache();
+    success("All tests passed :-)");
+    return 0;
+}
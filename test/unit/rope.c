@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/rope.h"
+#include "util/string.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+// Check that \p rope holds exactly \p expected.
+static void check_rope(struct rope const * rope, struct string const * expected)
+{
+    CHECK(rope_size(rope) == expected->size);
+
+    struct string flat;
+    CHECK(rope_flatten(&flat, rope));
+    CHECK(string_is_equal(&flat, expected));
+    string_free(&flat);
+}
+
+
+// Check that no two neighbouring pieces of \p rope would fit in one, so that
+// there are never many more pieces than the string needs.
+static void check_pieces(struct rope const * rope)
+{
+    // The most bytes a piece holds, as in rope.c.
+    size_t const leaf_size = 4096;
+
+    struct rope_iter iter;
+    struct string piece;
+    size_t previous = leaf_size + 1;
+    size_t pieces = 0;
+    rope_iter_init(&iter, rope, 0, rope_size(rope));
+    while (rope_iter_next(&iter, &piece))
+    {
+        CHECK(piece.size <= leaf_size);
+        CHECK(previous + piece.size > leaf_size);
+        previous = piece.size;
+        ++pieces;
+    }
+    CHECK(pieces <= 2 * rope_size(rope) / leaf_size + 1);
+}
+
+
+static void test_rope_edits()
+{
+    struct rope rope;
+    rope_init(&rope);
+    CHECK(rope_size(&rope) == 0);
+    check_rope(&rope, &string_literal(""));
+
+    CHECK(rope_insert(&rope, 0, &string_literal("world")));
+    CHECK(rope_insert(&rope, 0, &string_literal("hello ")));
+    CHECK(rope_insert(&rope, 11, &string_literal("!")));
+    CHECK(rope_insert(&rope, 5, &string_literal("")));
+    check_rope(&rope, &string_literal("hello world!"));
+
+    rope_erase(&rope, 5, 11);
+    check_rope(&rope, &string_literal("hello!"));
+    rope_erase(&rope, 3, 3);
+    check_rope(&rope, &string_literal("hello!"));
+
+    struct string slice;
+    CHECK(rope_copy_slice(&slice, &rope, 1, 4));
+    CHECK(string_is_equal_cstr(&slice, "ell"));
+    string_free(&slice);
+
+    rope_erase(&rope, 0, rope_size(&rope));
+    check_rope(&rope, &string_literal(""));
+    rope_free(&rope);
+}
+
+
+static void test_rope_large()
+{
+    // Inserting more than a piece holds splits it across several.
+    struct string large;
+    string_make(&large, 100000);
+    CHECK(large.data != NULL);
+    for (size_t i = 0; i < large.size; ++i)
+        large.data[i] = (char)('a' + i % 26);
+
+    struct rope rope;
+    rope_init(&rope);
+    CHECK(rope_insert(&rope, 0, &large));
+    CHECK(rope_insert(&rope, 50000, &large));
+    CHECK(rope_size(&rope) == 2 * large.size);
+
+    char * expected = malloc(2 * large.size);
+    CHECK(expected != NULL);
+    memcpy(expected, large.data, 50000);
+    memcpy(expected + 50000, large.data, large.size);
+    memcpy(expected + 50000 + large.size, large.data + 50000, large.size - 50000);
+
+    // Every piece is a view of the rope in order.
+    struct rope_iter iter;
+    struct string piece;
+    size_t offset = 0;
+    size_t pieces = 0;
+    rope_iter_init(&iter, &rope, 0, rope_size(&rope));
+    while (rope_iter_next(&iter, &piece))
+    {
+        CHECK(piece.size > 0);
+        CHECK(memcmp(piece.data, expected + offset, piece.size) == 0);
+        offset += piece.size;
+        ++pieces;
+    }
+    CHECK(offset == rope_size(&rope));
+    CHECK(pieces > 1);
+    free(expected);
+
+    // Iterating over a range stops at its end.
+    rope_iter_init(&iter, &rope, 10, 20);
+    CHECK(rope_iter_next(&iter, &piece));
+    CHECK(piece.size == 10);
+    CHECK(memcmp(piece.data, large.data + 10, 10) == 0);
+    CHECK(!rope_iter_next(&iter, &piece));
+
+    check_pieces(&rope);
+    rope_erase(&rope, 50000, 150000);
+    check_rope(&rope, &large);
+    check_pieces(&rope);
+    rope_free(&rope);
+    string_free(&large);
+}
+
+
+static void test_rope_random()
+{
+    // Compare random edits against the same edits on a flat buffer.
+    enum { capacity = 200000 };
+    char * expected = malloc(capacity);
+    char * buffer = malloc(capacity);
+    CHECK(expected != NULL && buffer != NULL);
+    size_t size = 0;
+
+    struct rope rope;
+    rope_init(&rope);
+    unsigned seed = 1;
+    for (size_t round = 0; round < 2000; ++round)
+    {
+        seed = seed * 1103515245u + 12345u;
+        unsigned random = seed >> 8;
+        if (size == 0 || random % 3 != 0)
+        {
+            // Mostly short insertions, with an occasional one of several pieces.
+            size_t length = (random % 50 == 0) ? random % 10000 : random % 100;
+            if (size + length > capacity)
+                length = capacity - size;
+            size_t position = (size_t)(random / 7) % (size + 1);
+            for (size_t i = 0; i < length; ++i)
+                buffer[i] = (char)('a' + (round + i) % 26);
+
+            CHECK(rope_insert(&rope, position, &(struct string){buffer, length}));
+            memmove(expected + position + length, expected + position, size - position);
+            memcpy(expected + position, buffer, length);
+            size += length;
+        }
+        else
+        {
+            size_t from = (size_t)(random / 7) % (size + 1);
+            size_t length = (random % 20 == 0) ? random % 20000 : random % 200;
+            size_t to = (from + length < size) ? from + length : size;
+
+            rope_erase(&rope, from, to);
+            memmove(expected + from, expected + to, size - to);
+            size -= to - from;
+        }
+        CHECK(rope_size(&rope) == size);
+        check_pieces(&rope);
+
+        if (round % 100 == 0)
+        {
+            check_rope(&rope, &(struct string){expected, size});
+
+            size_t from = (size_t)(random / 3) % (size + 1);
+            size_t to = from + (size_t)(random / 5) % (size - from + 1);
+            struct string slice;
+            CHECK(rope_copy_slice(&slice, &rope, from, to));
+            CHECK(string_is_equal(&slice, &(struct string){expected + from, to - from}));
+            string_free(&slice);
+        }
+    }
+    check_rope(&rope, &(struct string){expected, size});
+
+    rope_free(&rope);
+    free(buffer);
+    free(expected);
+}
+
+
+int main()
+{
+    test_rope_edits();
+    test_rope_large();
+    test_rope_random();
+    success("All tests passed :-)");
+    return 0;
+}
@@ -1,3 +1,9 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/arena.h"
+#include "util/cpu.h"
 #include "util/string.h"
 #include "util/util.h"
 
@@ -44,6 +50,39 @@ static void test_string_copy_cstr()
 }
 
 
+static void test_string_arena()
+{
+    struct arena arena;
+    arena_init(&arena, 0);
+
+    struct string to_copy = string_literal("abcdef");
+    struct string copy;
+    string_copy_arena(&copy, &to_copy, &arena);
+    CHECK(copy.data != to_copy.data);
+    CHECK(string_is_equal(&copy, &to_copy));
+
+    string_copy_cstr_arena(&copy, "xyz", &arena);
+    CHECK(string_is_equal_cstr(&copy, "xyz"));
+
+    string_copy_slice_arena(&copy, &to_copy, 1, 4, &arena);
+    CHECK(string_is_equal_cstr(&copy, "bcd"));
+
+    struct string array[] = {{"abc", 3}, {"", 0}, {"def", 3}};
+    string_join_array_arena(&copy, array, ARRAY_SIZE(array), &arena);
+    CHECK(string_is_equal_cstr(&copy, "abcdef"));
+
+    struct string input = {"a,bc,,d", 7};
+    struct string * out = NULL;
+    CHECK(string_copy_split_arena(&out, &input, ',', &arena) == 4);
+    CHECK(string_is_equal_cstr(out + 0, "a"));
+    CHECK(string_is_equal_cstr(out + 1, "bc"));
+    CHECK(string_is_equal_cstr(out + 2, ""));
+    CHECK(string_is_equal_cstr(out + 3, "d"));
+
+    arena_free(&arena);
+}
+
+
 // Comparing.
 
 
@@ -84,6 +123,22 @@ static void test_string_is_equal()
 }
 
 
+static void test_string_compare()
+{
+    CHECK(string_compare(&string_literal("abc"), &string_literal("abc")) == 0);
+    CHECK(string_compare(&string_literal("abc"), &string_literal("abd")) < 0);
+    CHECK(string_compare(&string_literal("abd"), &string_literal("abc")) > 0);
+    CHECK(string_compare(&string_literal("ab"), &string_literal("abc")) < 0);
+    CHECK(string_compare(&string_literal("abc"), &string_literal("ab")) > 0);
+    CHECK(string_compare(&string_literal(""), &string_literal("")) == 0);
+    CHECK(string_compare(&string_literal(""), &string_literal("a")) < 0);
+
+    // Bytes compare as unsigned, and a zero byte is an ordinary byte.
+    CHECK(string_compare(&string_literal("\xFF"), &string_literal("a")) > 0);
+    CHECK(string_compare(&string_literal("a"), &string_literal("a\0")) < 0);
+}
+
+
 static void test_string_starts_with()
 {
     struct string one = {"abc", 3};
@@ -108,6 +163,144 @@ static void test_string_end_with()
 }
 
 
+// Searching.
+
+
+// Fill \p buffer with a pseudo-random mix of 'a', 'b' and pivot characters
+// so that matches land at every offset of the vectorized blocks.
+static void fill_pseudo_random(char * buffer, size_t size, unsigned seed)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        buffer[i] = "aab\n"[(seed >> 16) % 4];
+    }
+}
+
+
+static void test_string_count_char()
+{
+    struct string one = {"a\nb\n\nc", 6};
+    CHECK(string_count_char(&one, '\n') == 3);
+    CHECK(string_count_char(&one, 'a') == 1);
+    CHECK(string_count_char(&one, 'z') == 0);
+
+    // Every supported instruction set should agree with the scalar reference
+    // for every size, including the bytes that don't fill a whole block.
+    char buffer[300];
+    for (size_t size = 0; size <= sizeof(buffer); ++size)
+    {
+        fill_pseudo_random(buffer, size, (unsigned)size);
+        struct string input = {buffer, size};
+
+        CHECK(cpu_isa_set(CPU_ISA_SCALAR));
+        size_t expected = string_count_char(&input, '\n');
+        for (int isa = CPU_ISA_SSE2; cpu_isa_set(isa); ++isa)
+            CHECK(string_count_char(&input, '\n') == expected);
+    }
+    cpu_isa_set(cpu_isa_supported());
+}
+
+
+// The offset of the first (or last) match of needle in haystack found by brute force.
+static size_t naive_find(char const * haystack, size_t size, char const * needle,
+                         size_t needle_size, bool last)
+{
+    size_t found = STRING_NPOS;
+    for (size_t i = 0; i + needle_size <= size; ++i)
+        if (memcmp(haystack + i, needle, needle_size) == 0)
+        {
+            found = i;
+            if (!last)
+                break;
+        }
+    return found;
+}
+
+
+static void test_string_find()
+{
+    struct string haystack = string_literal("abcabcabd");
+    CHECK(string_find(&haystack, &string_literal("abc")) == 0);
+    CHECK(string_rfind(&haystack, &string_literal("abc")) == 3);
+    CHECK(string_find(&haystack, &string_literal("abd")) == 6);
+    CHECK(string_find(&haystack, &string_literal("abe")) == STRING_NPOS);
+    CHECK(string_rfind(&haystack, &string_literal("abe")) == STRING_NPOS);
+    CHECK(string_find(&haystack, &string_literal("")) == 0);
+    CHECK(string_rfind(&haystack, &string_literal("")) == haystack.size);
+    CHECK(string_find(&string_literal("ab"), &string_literal("abc")) == STRING_NPOS);
+
+    // Needles up to 40 bytes cover both the vectorized search and Two-Way.
+    // Needles cut from a haystack of few distinct characters have many
+    // partial matches, and the runs of 'a' make some of them periodic.
+    char buffer[300];
+    char needle[40];
+    for (size_t size = 0; size <= sizeof(buffer); size += 7)
+    {
+        fill_pseudo_random(buffer, size, (unsigned)size);
+        struct string input = {buffer, size};
+        for (size_t needle_size = 1; needle_size <= sizeof(needle); ++needle_size)
+        {
+            if (size >= needle_size && needle_size % 2 == 0)
+                memcpy(needle, buffer + (size - needle_size) / 2, needle_size);
+            else
+                fill_pseudo_random(needle, needle_size, (unsigned)needle_size);
+            needle[needle_size - 1] = (needle_size % 3 == 0) ? 'b' : needle[needle_size - 1];
+            struct string pattern = {needle, needle_size};
+
+            size_t first = naive_find(buffer, size, needle, needle_size, false);
+            size_t last = naive_find(buffer, size, needle, needle_size, true);
+            for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+            {
+                CHECK(string_find(&input, &pattern) == first);
+                CHECK(string_rfind(&input, &pattern) == last);
+            }
+        }
+    }
+    cpu_isa_set(cpu_isa_supported());
+
+    // Highly periodic needles are the worst case for Two-Way's shifts.
+    memset(buffer, 'a', sizeof(buffer));
+    memset(needle, 'a', sizeof(needle));
+    needle[0] = 'b';
+    buffer[57] = 'b';
+    buffer[250] = 'b';
+    struct string input = {buffer, sizeof(buffer)};
+    struct string pattern = {needle, sizeof(needle)};
+    CHECK(string_find(&input, &pattern) == 57);
+    CHECK(string_rfind(&input, &pattern) == 250);
+    needle[0] = 'a';
+    needle[sizeof(needle) - 1] = 'b';
+    CHECK(string_find(&input, &pattern) == 57 - sizeof(needle) + 1);
+    CHECK(string_rfind(&input, &pattern) == 250 - sizeof(needle) + 1);
+}
+
+
+static void test_string_find_all()
+{
+    size_t * offsets;
+    struct string haystack = string_literal("aaaaa,b,aa");
+    CHECK(string_find_all(&offsets, &haystack, &string_literal("aa")) == 3);
+    CHECK(offsets[0] == 0);
+    CHECK(offsets[1] == 2);
+    CHECK(offsets[2] == 8);
+    free(offsets);
+
+    CHECK(string_find_all(&offsets, &haystack, &string_literal("c")) == 0);
+    CHECK(offsets == NULL);
+    CHECK(string_find_all(&offsets, &haystack, &string_literal("")) == 0);
+    CHECK(offsets == NULL);
+
+    // Enough matches to grow the output a few times.
+    char buffer[1000];
+    memset(buffer, ',', sizeof(buffer));
+    struct string input = {buffer, sizeof(buffer)};
+    CHECK(string_find_all(&offsets, &input, &string_literal(",")) == sizeof(buffer));
+    CHECK(offsets[sizeof(buffer) - 1] == sizeof(buffer) - 1);
+    free(offsets);
+}
+
+
 // Joining.
 
 
@@ -132,6 +325,84 @@ static void test_string_join()
 }
 
 
+static void test_string_join_memcpy()
+{
+    // Empty pieces may have NULL data.
+    struct string pieces[] = {{NULL, 0}, string_literal("ab"), {NULL, 0}, string_literal("c")};
+    struct string out;
+    string_join_array(&out, pieces, ARRAY_SIZE(pieces));
+    CHECK(string_is_equal_cstr(&out, "abc"));
+    string_free(&out);
+}
+
+
+// Building.
+
+
+static void test_string_builder()
+{
+    struct string_builder builder;
+    string_builder_init(&builder);
+    CHECK(builder.size == 0);
+    CHECK(builder.data == NULL);
+
+    CHECK(string_builder_append(&builder, &string_literal("key")));
+    CHECK(string_builder_append_char(&builder, '='));
+    CHECK(string_builder_append_int(&builder, -42));
+    CHECK(string_builder_append_cstr(&builder, ", "));
+    CHECK(string_builder_append_uint(&builder, 0));
+    CHECK(string_builder_append(&builder, &(struct string){NULL, 0}));
+
+    // The memory is handed over as is.
+    char * data = builder.data;
+    struct string result;
+    string_builder_finish(&builder, &result);
+    CHECK(result.data == data);
+    CHECK(string_is_equal_cstr(&result, "key=-42, 0"));
+    CHECK(builder.data == NULL && builder.size == 0 && builder.capacity == 0);
+    string_free(&result);
+
+    // The extremes of the integer types.
+    CHECK(string_builder_append_int(&builder, INT64_MIN));
+    CHECK(string_builder_append_char(&builder, ' '));
+    CHECK(string_builder_append_int(&builder, INT64_MAX));
+    CHECK(string_builder_append_char(&builder, ' '));
+    CHECK(string_builder_append_uint(&builder, UINT64_MAX));
+    CHECK(string_is_equal_cstr(&(struct string){builder.data, builder.size},
+                               "-9223372036854775808 9223372036854775807 18446744073709551615"));
+
+    // Capacity grows geometrically and is kept when cleared.
+    string_builder_clear(&builder);
+    size_t grows = 0;
+    size_t capacity = builder.capacity;
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        CHECK(string_builder_append_char(&builder, (char)('a' + i % 26)));
+        grows += builder.capacity != capacity;
+        capacity = builder.capacity;
+    }
+    CHECK(builder.size == 100000);
+    CHECK(grows < 20);
+    CHECK(builder.data[99999] == (char)('a' + 99999 % 26));
+
+    CHECK(string_builder_shrink(&builder));
+    CHECK(builder.capacity == builder.size);
+    CHECK(string_builder_reserve(&builder, 1000));
+    CHECK(builder.capacity >= builder.size + 1000);
+    capacity = builder.capacity;
+    CHECK(string_builder_reserve(&builder, 10));
+    CHECK(builder.capacity == capacity);
+    CHECK(!string_builder_reserve(&builder, SIZE_MAX));
+    string_builder_free(&builder);
+    CHECK(builder.data == NULL && builder.capacity == 0);
+
+    // Finishing an empty builder gives an empty string.
+    CHECK(string_builder_reserve(&builder, 10));
+    string_builder_finish(&builder, &result);
+    CHECK(result.size == 0 && result.data == NULL);
+}
+
+
 // Slicing.
 
 
@@ -168,6 +439,15 @@ static void test_string_copy_split()
     CHECK(out[0].data != input.data + 0);
     CHECK(out[1].data != input.data + 2);
     free(out);
+
+    // Every piece after the second pivot should still be copied correctly.
+    input = (struct string){"a,bc,,d", 7};
+    CHECK(string_copy_split(&out, &input, ',') == 4);
+    CHECK(string_is_equal_cstr(out + 0, "a"));
+    CHECK(string_is_equal_cstr(out + 1, "bc"));
+    CHECK(string_is_equal_cstr(out + 2, ""));
+    CHECK(string_is_equal_cstr(out + 3, "d"));
+    free(out);
 }
 
 
@@ -196,6 +476,609 @@ static void test_string_view_split()
         CHECK(out[0].size == 3);
         free(out);
     }
+
+    {
+        // Every supported instruction set should produce the same views as
+        // the scalar reference.
+        char buffer[300];
+        for (size_t size = 0; size <= sizeof(buffer); ++size)
+        {
+            fill_pseudo_random(buffer, size, (unsigned)size);
+            struct string input = {buffer, size};
+
+            CHECK(cpu_isa_set(CPU_ISA_SCALAR));
+            struct string * expected = NULL;
+            size_t expected_size = string_view_split(&expected, &input, '\n');
+            for (int isa = CPU_ISA_SSE2; cpu_isa_set(isa); ++isa)
+            {
+                struct string * out = NULL;
+                CHECK(string_view_split(&out, &input, '\n') == expected_size);
+                for (size_t i = 0; i < expected_size; ++i)
+                    CHECK(string_is_same(out + i, expected + i));
+                free(out);
+            }
+            free(expected);
+        }
+        cpu_isa_set(cpu_isa_supported());
+    }
+}
+
+
+static void test_string_view_split_parallel()
+{
+    // Inputs large enough to be split into several chunks, with pivots
+    // everywhere, nowhere, only in some chunks and right at the cuts.
+    size_t const size = ((size_t)9 << 20) + 123;
+    struct string input;
+    string_make(&input, size);
+    CHECK(input.data != NULL);
+
+    size_t const thread_counts[] = {1, 2, 3, 8, 64};
+    for (int pattern = 0; pattern < 4; ++pattern)
+    {
+        if (pattern == 0)
+            fill_pseudo_random(input.data, size, 1);
+        else
+            memset(input.data, 'a', size);
+        if (pattern == 2)
+        {
+            input.data[(size_t)5 << 20] = '\n';
+            input.data[size - 1] = '\n';
+        }
+        if (pattern == 3)
+            for (size_t i = 1; i < 8; ++i)
+            {
+                input.data[size / 8 * i - 1] = '\n';
+                input.data[size / 8 * i] = '\n';
+            }
+
+        struct string * expected = NULL;
+        size_t expected_size = string_view_split(&expected, &input, '\n');
+        CHECK(expected != NULL);
+        for (size_t t = 0; t < ARRAY_SIZE(thread_counts); ++t)
+        {
+            struct string * out = NULL;
+            CHECK(string_view_split_parallel(&out, &input, '\n', thread_counts[t]) ==
+                  expected_size);
+            for (size_t i = 0; i < expected_size; ++i)
+                CHECK(string_is_same(out + i, expected + i));
+            free(out);
+        }
+        free(expected);
+    }
+    string_free(&input);
+
+    // Small inputs are split on the calling thread.
+    struct string * out = NULL;
+    CHECK(string_view_split_parallel(&out, &string_literal("a,b,"), ',', 4) == 3);
+    CHECK(string_is_equal_cstr(out + 1, "b"));
+    CHECK(out[2].size == 0);
+    free(out);
+}
+
+
+// Check the iterator over `input` yields exactly the views string_view_split() makes.
+static void check_string_split_iter(struct string const * input)
+{
+    struct string * expected = NULL;
+    size_t expected_size = string_view_split(&expected, input, ',');
+
+    struct string_split_iter iter;
+    struct string piece;
+    size_t count = 0;
+    string_split_iter_init(&iter, input, ',');
+    while (string_split_iter_next(&iter, &piece))
+    {
+        CHECK(count < expected_size);
+        CHECK(string_is_same(&piece, expected + count));
+        ++count;
+    }
+    CHECK(count == expected_size);
+    CHECK(string_split_iter_next(&iter, &piece) == false);
+    free(expected);
+}
+
+
+static void test_string_split_iter()
+{
+    char const * inputs[] = {"", ",", "abc", "a,bc,,d", ",a,"};
+
+    // Longer inputs span several blocks, with pivots on either side of each
+    // block boundary and runs of blocks without any.
+    char long_input[300];
+    memset(long_input, 'a', sizeof(long_input));
+    size_t const pivots[] = {0, 62, 63, 64, 65, 127, 128, 191, 255, 256, 299};
+    for (size_t i = 0; i < ARRAY_SIZE(pivots); ++i)
+        long_input[pivots[i]] = ',';
+    size_t const sizes[] = {63, 64, 65, 128, 129, 200, 256, 257, 300};
+
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(inputs); ++i)
+        {
+            struct string input;
+            string_view_cstr(&input, (char *)inputs[i]);
+            check_string_split_iter(&input);
+        }
+        for (size_t i = 0; i < ARRAY_SIZE(sizes); ++i)
+        {
+            check_string_split_iter(&(struct string){long_input, sizes[i]});
+            check_string_split_iter(&(struct string){long_input + 1, sizes[i] - 1});
+        }
+    }
+    cpu_isa_set(cpu_isa_supported());
+}
+
+
+// Check the index of `input` has exactly the views string_view_split() makes.
+static void check_string_split_index(struct string const * input, size_t offset_size)
+{
+    struct string * expected = NULL;
+    size_t expected_size = string_view_split(&expected, input, ',');
+
+    struct string_split_index index;
+    CHECK(string_split_index_make(&index, input, ','));
+    CHECK(index.offset_size == offset_size);
+    CHECK(index.count == expected_size);
+    struct string piece;
+    for (size_t i = 0; i < index.count; ++i)
+    {
+        string_split_index_get(&piece, &index, i);
+        CHECK(string_is_same(&piece, expected + i));
+    }
+
+    // Ranges stop at the last piece, whatever size the batches are.
+    struct string batch[7];
+    size_t const batch_sizes[] = {1, 3, 7};
+    for (size_t b = 0; b < ARRAY_SIZE(batch_sizes); ++b)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < index.count; i += count)
+        {
+            count = string_split_index_get_range(batch, &index, i, batch_sizes[b]);
+            CHECK(count > 0 && count <= batch_sizes[b] && i + count <= index.count);
+            for (size_t j = 0; j < count; ++j)
+                CHECK(string_is_same(batch + j, expected + i + j));
+        }
+    }
+    CHECK(string_split_index_get_range(batch, &index, index.count, 7) == 0);
+    string_split_index_free(&index);
+    CHECK(index.ends == NULL && index.count == 0);
+    free(expected);
+}
+
+
+static void test_string_split_index()
+{
+    char const * inputs[] = {"", ",", "abc", "a,bc,,d", ",a,"};
+    for (size_t i = 0; i < ARRAY_SIZE(inputs); ++i)
+    {
+        struct string input;
+        string_view_cstr(&input, (char *)inputs[i]);
+        check_string_split_index(&input, 2);
+    }
+
+    // Random fields either side of the 64 KiB limit for 2-byte offsets, with
+    // pivots at the ends of blocks and of the input.
+    struct string input;
+    string_make(&input, 100000);
+    CHECK(input.data != NULL);
+    unsigned seed = 1;
+    for (size_t i = 0; i < input.size; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        input.data[i] = ((seed >> 16) % 9 == 0 || i % 64 == 63) ? ',' : 'a';
+    }
+    input.data[input.size - 1] = ',';
+
+    size_t const sizes[] = {63, 64, 65, UINT16_MAX, (size_t)UINT16_MAX + 1, input.size};
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(sizes); ++i)
+        {
+            struct string const prefix = {input.data, sizes[i]};
+            check_string_split_index(&prefix, (sizes[i] <= UINT16_MAX) ? 2 : 4);
+        }
+    }
+    cpu_isa_set(cpu_isa_supported());
+    string_free(&input);
+}
+
+
+// Character sets.
+
+
+static void test_string_char_set()
+{
+    struct string_char_set set;
+    string_char_set_init_cstr(&set, " ,\xff");
+    CHECK(set.contains[' '] && set.contains[','] && set.contains[0xff]);
+    CHECK(!set.contains['a'] && !set.contains[0] && !set.contains[0xfe]);
+    CHECK(set.has_high);
+
+    struct string input = string_literal("a, b,,\xff c");
+    CHECK(string_count_any(&input, &set) == 6);
+}
+
+
+static void test_string_view_split_any()
+{
+    struct string_char_set set;
+    string_char_set_init_cstr(&set, " \t\n");
+
+    struct string input = string_literal(" ab\tc  d\n");
+    struct string * out = NULL;
+    CHECK(string_view_split_any(&out, &input, &set, false) == 6);
+    CHECK(string_is_equal_cstr(out + 0, ""));
+    CHECK(string_is_equal_cstr(out + 1, "ab"));
+    CHECK(string_is_equal_cstr(out + 2, "c"));
+    CHECK(string_is_equal_cstr(out + 3, ""));
+    CHECK(string_is_equal_cstr(out + 4, "d"));
+    CHECK(string_is_equal_cstr(out + 5, ""));
+    free(out);
+
+    CHECK(string_view_split_any(&out, &input, &set, true) == 3);
+    CHECK(string_is_equal_cstr(out + 0, "ab"));
+    CHECK(string_is_equal_cstr(out + 1, "c"));
+    CHECK(string_is_equal_cstr(out + 2, "d"));
+    CHECK(out[0].data == input.data + 1);
+    free(out);
+
+    // Every supported instruction set should agree with the scalar reference,
+    // including for delimiters with the high bit set.
+    string_char_set_init_cstr(&set, "b\n\x80");
+    char buffer[300];
+    for (size_t size = 0; size <= sizeof(buffer); ++size)
+    {
+        fill_pseudo_random(buffer, size, (unsigned)size);
+        for (size_t i = 0; i < size; i += 7)
+            buffer[i] = (char)0x80;
+        input = (struct string){buffer, size};
+
+        for (int collapse = 0; collapse < 2; ++collapse)
+        {
+            CHECK(cpu_isa_set(CPU_ISA_SCALAR));
+            struct string * expected = NULL;
+            size_t expected_size = string_view_split_any(&expected, &input, &set, collapse);
+            size_t expected_count = string_count_any(&input, &set);
+            for (int isa = CPU_ISA_SSE2; cpu_isa_set(isa); ++isa)
+            {
+                CHECK(string_count_any(&input, &set) == expected_count);
+                CHECK(string_view_split_any(&out, &input, &set, collapse) == expected_size);
+                for (size_t i = 0; i < expected_size; ++i)
+                    CHECK(string_is_same(out + i, expected + i));
+                free(out);
+            }
+            free(expected);
+        }
+    }
+    cpu_isa_set(cpu_isa_supported());
+}
+
+
+// Case.
+
+
+// The reference conversion of one byte to lower case.
+static char naive_to_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+
+static void test_string_case()
+{
+    struct string lower;
+    string_copy_lower(&lower, &string_literal("Hello, World! 123 \xC3\x89"));
+    CHECK(string_is_equal_cstr(&lower, "hello, world! 123 \xC3\x89"));
+    string_to_upper(&lower);
+    CHECK(string_is_equal_cstr(&lower, "HELLO, WORLD! 123 \xC3\x89"));
+    string_free(&lower);
+
+    // Every byte value at every offset, and every size up to a few blocks.
+    char buffer[300];
+    for (size_t i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (char)(i * 7);
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        for (size_t size = 0; size <= sizeof(buffer); size += 13)
+        {
+            struct string input = {buffer, size};
+            struct string upper;
+            string_copy_lower(&lower, &input);
+            string_copy_upper(&upper, &input);
+            CHECK(lower.size == size && upper.size == size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                CHECK(lower.data[i] == naive_to_lower(buffer[i]));
+                CHECK(upper.data[i] == ((buffer[i] >= 'a' && buffer[i] <= 'z')
+                                            ? (char)(buffer[i] - 'a' + 'A')
+                                            : buffer[i]));
+            }
+
+            // Converting in place gives the same result.
+            string_to_upper(&lower);
+            CHECK(string_is_equal(&lower, &upper));
+            string_to_lower(&upper);
+            CHECK(string_is_equal_ignore_case(&upper, &input));
+            string_free(&lower);
+            string_free(&upper);
+        }
+    cpu_isa_set(cpu_isa_supported());
+}
+
+
+static void test_string_is_equal_ignore_case()
+{
+    struct string one = string_literal("Content-Type");
+    CHECK(string_is_equal_ignore_case(&one, &string_literal("content-type")));
+    CHECK(string_is_equal_ignore_case(&one, &string_literal("CONTENT-TYPE")));
+    CHECK(!string_is_equal_ignore_case(&one, &string_literal("content-typ")));
+    CHECK(!string_is_equal_ignore_case(&one, &string_literal("content_type")));
+    CHECK(string_starts_with_ignore_case(&one, &string_literal("CONTENT")));
+    CHECK(string_starts_with_ignore_case(&one, &string_literal("")));
+    CHECK(!string_starts_with_ignore_case(&one, &string_literal("type")));
+    CHECK(!string_starts_with_ignore_case(&string_literal("con"), &string_literal("CONTENT")));
+
+    // Bytes that differ only in the case bit but aren't letters are different,
+    // in every position of a block and past the last whole block.
+    char const pairs[][2] = {{'a', 'A'}, {'z', 'Z'}, {'@', '`'}, {'[', '{'}, {'^', '~'},
+                             {'\x01', '!'}, {'\xC1', '\xE1'}, {'\xDA', '\xFA'}};
+    char a[150];
+    char b[150];
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        for (size_t p = 0; p < ARRAY_SIZE(pairs); ++p)
+            for (size_t i = 0; i < sizeof(a); ++i)
+            {
+                memset(a, 'x', sizeof(a));
+                memset(b, 'X', sizeof(b));
+                a[i] = pairs[p][0];
+                b[i] = pairs[p][1];
+                struct string left = {a, sizeof(a)};
+                struct string right = {b, sizeof(b)};
+                bool letters = p < 2;
+                CHECK(string_is_equal_ignore_case(&left, &right) == letters);
+                CHECK(string_starts_with_ignore_case(&left, &right) == letters);
+                right.size = i + 1;
+                CHECK(string_starts_with_ignore_case(&left, &right) == letters);
+                right.size = i;
+                CHECK(string_starts_with_ignore_case(&left, &right));
+            }
+    cpu_isa_set(cpu_isa_supported());
+}
+
+
+// The offset of the first match of needle in haystack ignoring case found by brute force.
+static size_t naive_find_ignore_case(char const * haystack, size_t size, char const * needle,
+                                     size_t needle_size)
+{
+    for (size_t i = 0; i + needle_size <= size; ++i)
+    {
+        size_t j = 0;
+        while (j < needle_size && naive_to_lower(haystack[i + j]) == naive_to_lower(needle[j]))
+            ++j;
+        if (j == needle_size)
+            return i;
+    }
+    return STRING_NPOS;
+}
+
+
+static void test_string_find_ignore_case()
+{
+    struct string haystack = string_literal("Accept: text/HTML, Text/Plain");
+    CHECK(string_find_ignore_case(&haystack, &string_literal("text/plain")) == 19);
+    CHECK(string_find_ignore_case(&haystack, &string_literal("TEXT")) == 8);
+    CHECK(string_find_ignore_case(&haystack, &string_literal("html,")) == 13);
+    CHECK(string_find_ignore_case(&haystack, &string_literal("xml")) == STRING_NPOS);
+    CHECK(string_find_ignore_case(&haystack, &string_literal("")) == 0);
+
+    // As in test_string_find(), but with both cases of each letter, so the
+    // needles match in either case.
+    char buffer[300];
+    char needle[40];
+    for (size_t size = 0; size <= sizeof(buffer); size += 7)
+    {
+        fill_pseudo_random(buffer, size, (unsigned)size);
+        for (size_t i = 0; i < size; i += 3)
+            buffer[i] = (char)(buffer[i] == '\n' ? '\n' : buffer[i] - 'a' + 'A');
+        struct string input = {buffer, size};
+        for (size_t needle_size = 1; needle_size <= sizeof(needle); ++needle_size)
+        {
+            if (size >= needle_size && needle_size % 2 == 0)
+                memcpy(needle, buffer + (size - needle_size) / 2, needle_size);
+            else
+                fill_pseudo_random(needle, needle_size, (unsigned)needle_size);
+            for (size_t i = 0; i < needle_size; i += 2)
+                needle[i] = (char)(needle[i] == '\n' ? '\n' : (needle[i] | 0x20) - 'a' + 'A');
+            struct string pattern = {needle, needle_size};
+
+            size_t first = naive_find_ignore_case(buffer, size, needle, needle_size);
+            for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+                CHECK(string_find_ignore_case(&input, &pattern) == first);
+        }
+    }
+    cpu_isa_set(cpu_isa_supported());
+}
+
+
+// Sorting.
+
+
+// Order strings by their contents and then by address, which is the order
+// a stable sort gives strings whose addresses increase with their index.
+static int compare_contents_then_address(void const * lhs, void const * rhs)
+{
+    struct string const * string = lhs;
+    struct string const * other = rhs;
+    int result = string_compare(string, other);
+    if (result != 0)
+        return result;
+    return (string->data > other->data) - (string->data < other->data);
+}
+
+
+static void test_string_sort()
+{
+    // Strings with many duplicates, zero and high bytes, long shared
+    // prefixes, already sorted, and all the same, each stored after the one
+    // before it so that addresses give their original order.
+    size_t const counts[] = {0, 1, 2, 11, 12, 63, 64, 65, 1000, 300000};
+    // One thread is string_sort() itself.
+    size_t const thread_counts[] = {1, 2, 3, 8};
+    size_t const max_count = 300000;
+    char * pool = malloc(max_count * 64);
+    struct string * strings = malloc(max_count * sizeof(*strings));
+    struct string * expected = malloc(max_count * sizeof(*expected));
+    struct string * sorted = malloc(max_count * sizeof(*sorted));
+    CHECK(pool != NULL && strings != NULL && expected != NULL && sorted != NULL);
+
+    for (int pattern = 0; pattern < 4; ++pattern)
+    {
+        unsigned seed = 1;
+        char * next = pool;
+        for (size_t i = 0; i < max_count; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            size_t size = 0;
+            if (pattern == 0)
+                size = (seed >> 16) % 12;
+            if (pattern == 1)
+            {
+                memset(next, 'p', 40);
+                size = 40 + (seed >> 16) % 5;
+            }
+            for (size_t j = (pattern == 1) ? 40 : 0; j < size; ++j)
+            {
+                seed = seed * 1103515245u + 12345u;
+                next[j] = "ab\0\xFF"[(seed >> 16) % 4];
+            }
+            if (pattern == 2)
+                size = (size_t)snprintf(next, 64, "%08zu", i / 3);
+            if (pattern == 3)
+            {
+                memcpy(next, "same", 4);
+                size = 4;
+            }
+            strings[i] = (struct string){next, size};
+            next += size + 1;
+        }
+
+        for (size_t c = 0; c < ARRAY_SIZE(counts); ++c)
+        {
+            size_t const count = counts[c];
+            memcpy(expected, strings, count * sizeof(*strings));
+            qsort(expected, count, sizeof(*expected), compare_contents_then_address);
+
+            for (int stable = 0; stable < 2; ++stable)
+                for (size_t t = 0; t < ARRAY_SIZE(thread_counts); ++t)
+                {
+                    memcpy(sorted, strings, count * sizeof(*strings));
+                    CHECK(string_sort_parallel(sorted, count, stable, thread_counts[t]));
+                    for (size_t i = 0; i < count; ++i)
+                        CHECK(stable ? string_is_same(sorted + i, expected + i)
+                                     : string_is_equal(sorted + i, expected + i));
+                }
+        }
+    }
+
+    free(sorted);
+    free(expected);
+    free(strings);
+    free(pool);
+}
+
+
+// Small strings.
+
+
+static void test_sso_string_copy()
+{
+    struct sso_string small;
+    sso_string_copy_cstr(&small, "abc");
+    CHECK(sso_string_is_inline(&small));
+    CHECK(string_is_equal_cstr(&small.string, "abc"));
+
+    // Contents that fill the inline buffer exactly shouldn't allocate.
+    struct sso_string full;
+    sso_string_copy_cstr(&full, "0123456789abcdef01234567");
+    CHECK(full.string.size == SSO_STRING_CAPACITY);
+    CHECK(sso_string_is_inline(&full));
+
+    struct sso_string large;
+    sso_string_copy_cstr(&large, "0123456789abcdef012345678");
+    CHECK(!sso_string_is_inline(&large));
+    CHECK(string_is_equal_cstr(&large.string, "0123456789abcdef012345678"));
+    CHECK(sso_string_is_equal(&large, &large));
+    CHECK(!sso_string_is_equal(&large, &full));
+    CHECK(string_starts_with(&large.string, &full.string));
+
+    struct sso_string slice;
+    sso_string_copy_slice(&slice, &large.string, 10, 16);
+    CHECK(sso_string_is_inline(&slice));
+    CHECK(string_is_equal_cstr(&slice.string, "abcdef"));
+
+    sso_string_free(&small);
+    sso_string_free(&full);
+    sso_string_free(&large);
+    sso_string_free(&slice);
+    CHECK(large.string.size == 0);
+    CHECK(sso_string_is_inline(&large));
+}
+
+
+static void test_sso_string_join_array()
+{
+    struct string array[] = {{"abc", 3}, {"def", 3}};
+    struct sso_string out;
+    sso_string_join_array(&out, array, ARRAY_SIZE(array));
+    CHECK(sso_string_is_inline(&out));
+    CHECK(string_is_equal_cstr(&out.string, "abcdef"));
+    sso_string_free(&out);
+
+    struct string long_array[] = {{"0123456789", 10}, {"0123456789", 10}, {"0123456789", 10}};
+    sso_string_join_array(&out, long_array, ARRAY_SIZE(long_array));
+    CHECK(!sso_string_is_inline(&out));
+    CHECK(string_is_equal_cstr(&out.string, "012345678901234567890123456789"));
+    sso_string_free(&out);
+}
+
+
+static void test_sso_string_move()
+{
+    struct sso_string from;
+    struct sso_string to;
+
+    sso_string_make(&to, 0);
+    sso_string_copy_cstr(&from, "abc");
+    sso_string_move(&to, &from);
+    CHECK(sso_string_is_inline(&to));
+    CHECK(string_is_equal_cstr(&to.string, "abc"));
+    CHECK(from.string.size == 0);
+
+    sso_string_copy_cstr(&from, "0123456789abcdef0123456789abcdef");
+    char * heap = from.string.data;
+    sso_string_move(&to, &from);
+    CHECK(to.string.data == heap);
+    CHECK(from.string.size == 0);
+    CHECK(sso_string_is_inline(&from));
+
+    // The contents the destination held are freed, whether inline or not.
+    sso_string_copy_cstr(&from, "fedcba9876543210fedcba9876543210");
+    sso_string_move(&to, &from);
+    CHECK(string_is_equal_cstr(&to.string, "fedcba9876543210fedcba9876543210"));
+    sso_string_copy_cstr(&from, "xyz");
+    sso_string_move(&to, &from);
+    CHECK(sso_string_is_inline(&to));
+    CHECK(string_is_equal_cstr(&to.string, "xyz"));
+
+    // Moving a string into itself leaves it as it was.
+    sso_string_copy_cstr(&from, "0123456789abcdef0123456789abcdef");
+    heap = from.string.data;
+    sso_string_move(&from, &from);
+    CHECK(from.string.data == heap);
+    CHECK(string_is_equal_cstr(&from.string, "0123456789abcdef0123456789abcdef"));
+    sso_string_free(&from);
+    sso_string_free(&to);
 }
 
 
@@ -204,16 +1087,35 @@ int main()
     test_string_make();
     test_string_copy();
     test_string_copy_cstr();
+    test_string_arena();
     test_string_is_same();
     test_string_is_equal();
+    test_string_compare();
     test_string_starts_with();
     test_string_end_with();
+    test_string_count_char();
+    test_string_find();
+    test_string_find_all();
     test_string_join();
     test_string_join_array();
+    test_string_join_memcpy();
+    test_string_builder();
     test_string_copy_slice();
     test_string_view_slice();
     test_string_copy_split();
     test_string_view_split();
+    test_string_view_split_parallel();
+    test_string_split_iter();
+    test_string_split_index();
+    test_string_char_set();
+    test_string_view_split_any();
+    test_string_case();
+    test_string_is_equal_ignore_case();
+    test_string_find_ignore_case();
+    test_string_sort();
+    test_sso_string_copy();
+    test_sso_string_join_array();
+    test_sso_string_move();
     success("All tests passed :-)");
     return 0;
 }
@@ -0,0 +1,235 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/cpu.h"
+#include "util/string.h"
+#include "util/utf8.h"
+#include "util/util.h"
+
+#include "test/unit_test.h"
+
+
+// Decode every code point of `data` and check its value, independently of
+// the library's tables.
+static bool reference_is_valid(unsigned char const * data, size_t size)
+{
+    for (size_t i = 0; i < size;)
+    {
+        unsigned char lead = data[i];
+        size_t length;
+        uint32_t value;
+        if (lead < 0x80)
+            length = 1, value = lead;
+        else if ((lead & 0xE0) == 0xC0)
+            length = 2, value = lead & 0x1F;
+        else if ((lead & 0xF0) == 0xE0)
+            length = 3, value = lead & 0x0F;
+        else if ((lead & 0xF8) == 0xF0)
+            length = 4, value = lead & 0x07;
+        else
+            return false;
+
+        if (i + length > size)
+            return false;
+        for (size_t j = 1; j < length; ++j)
+        {
+            if ((data[i + j] & 0xC0) != 0x80)
+                return false;
+            value = (value << 6) | (data[i + j] & 0x3F);
+        }
+
+        uint32_t const min_value[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (value < min_value[length] || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+            return false;
+        i += length;
+    }
+    return true;
+}
+
+
+static size_t reference_count(unsigned char const * data, size_t size)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i)
+        count += (data[i] & 0xC0) != 0x80;
+    return count;
+}
+
+
+static void test_utf8_is_valid()
+{
+    struct
+    {
+        char const * bytes;
+        bool valid;
+    } const cases[] = {
+        {"", true},
+        {"plain ascii", true},
+        {"\xC2\xA3", true},                   // U+00A3
+        {"\xDF\xBF", true},                   // U+07FF
+        {"\xE0\xA0\x80", true},               // U+0800
+        {"\xED\x9F\xBF", true},               // U+D7FF
+        {"\xEE\x80\x80", true},               // U+E000
+        {"\xEF\xBF\xBF", true},               // U+FFFF
+        {"\xF0\x90\x80\x80", true},           // U+10000
+        {"\xF4\x8F\xBF\xBF", true},           // U+10FFFF
+        {"\xE4\xBD\xA0\xE5\xA5\xBD", true},   // Two CJK characters.
+        {"\xC0\xAF", false},                  // Overlong '/'.
+        {"\xC1\xBF", false},                  // Overlong U+007F.
+        {"\xE0\x9F\xBF", false},              // Overlong U+07FF.
+        {"\xF0\x8F\xBF\xBF", false},          // Overlong U+FFFF.
+        {"\xED\xA0\x80", false},              // U+D800, a surrogate.
+        {"\xED\xBF\xBF", false},              // U+DFFF, a surrogate.
+        {"\xF4\x90\x80\x80", false},          // U+110000.
+        {"\xF5\x80\x80\x80", false},          // Lead byte above 0xF4.
+        {"\xFF", false},                      // Never valid.
+        {"\x80", false},                      // Stray continuation.
+        {"\xC2\xA3\xA3", false},              // Too many continuations.
+        {"\xC2", false},                      // Truncated.
+        {"\xE4\xBD", false},                  // Truncated.
+        {"\xF0\x90\x80", false},              // Truncated.
+        {"\xE4\xBDx", false},                 // Interrupted.
+        {"\xF0\x90\x80\x80\x80", false},      // Five bytes.
+    };
+
+    // Put each case at every offset in ASCII padding, so it falls on every
+    // position in a block and straddles the boundaries between blocks.
+    enum { padding = 140 };
+    char buffer[padding + 8];
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        for (size_t c = 0; c < ARRAY_SIZE(cases); ++c)
+        {
+            size_t const size = strlen(cases[c].bytes);
+            for (size_t offset = 0; offset <= padding - size; ++offset)
+                for (size_t end = offset + size; end <= padding; end += 37)
+                {
+                    memset(buffer, 'a', sizeof(buffer));
+                    memcpy(buffer + offset, cases[c].bytes, size);
+                    struct string string = {buffer, end};
+                    CHECK(utf8_is_valid(&string) == cases[c].valid);
+                }
+        }
+    cpu_isa_set(cpu_isa_supported());
+}
+
+
+static void test_utf8_random()
+{
+    // Random strings of mostly valid code points with the odd random byte,
+    // checked against the reference decoder.
+    enum { max_size = 300 };
+    unsigned char buffer[max_size];
+    unsigned seed = 1;
+    size_t valid_count = 0;
+    for (size_t round = 0; round < 20000; ++round)
+    {
+        size_t size = 0;
+        while (size < max_size - 4)
+        {
+            seed = seed * 1103515245u + 12345u;
+            unsigned random = seed >> 8;
+            if (random % 64 == 0)
+                break;
+            else if (random % 128 == 1)
+                buffer[size++] = (unsigned char)(random >> 7);
+            else if (random % 4 == 0)
+                buffer[size++] = (unsigned char)('a' + random % 26);
+            else
+            {
+                // Pick a code point of 1 to 4 bytes, skipping surrogates.
+                static uint32_t const ranges[][2] = {
+                    {0x20, 0x7F}, {0x80, 0x7FF}, {0x800, 0xD7FF}, {0xE000, 0xFFFF},
+                    {0x10000, 0x10FFFF}};
+                uint32_t const * range = ranges[(random >> 2) % ARRAY_SIZE(ranges)];
+                seed = seed * 1103515245u + 12345u;
+                uint32_t value = range[0] + (seed >> 4) % (range[1] - range[0] + 1);
+                if (value < 0x80)
+                    buffer[size++] = (unsigned char)value;
+                else if (value < 0x800)
+                {
+                    buffer[size++] = (unsigned char)(0xC0 | (value >> 6));
+                    buffer[size++] = (unsigned char)(0x80 | (value & 0x3F));
+                }
+                else if (value < 0x10000)
+                {
+                    buffer[size++] = (unsigned char)(0xE0 | (value >> 12));
+                    buffer[size++] = (unsigned char)(0x80 | ((value >> 6) & 0x3F));
+                    buffer[size++] = (unsigned char)(0x80 | (value & 0x3F));
+                }
+                else
+                {
+                    buffer[size++] = (unsigned char)(0xF0 | (value >> 18));
+                    buffer[size++] = (unsigned char)(0x80 | ((value >> 12) & 0x3F));
+                    buffer[size++] = (unsigned char)(0x80 | ((value >> 6) & 0x3F));
+                    buffer[size++] = (unsigned char)(0x80 | (value & 0x3F));
+                }
+            }
+        }
+
+        bool const expected = reference_is_valid(buffer, size);
+        valid_count += expected;
+        struct string string = {(char *)buffer, size};
+        for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+        {
+            CHECK(utf8_is_valid(&string) == expected);
+            CHECK(utf8_count_codepoints(&string) == reference_count(buffer, size));
+        }
+        cpu_isa_set(cpu_isa_supported());
+    }
+
+    // Both outcomes were tested often.
+    CHECK(valid_count > 1000 && valid_count < 19000);
+}
+
+
+static void test_utf8_count_codepoints()
+{
+    for (int isa = CPU_ISA_SCALAR; cpu_isa_set(isa); ++isa)
+    {
+        CHECK(utf8_count_codepoints(&string_literal("")) == 0);
+        CHECK(utf8_count_codepoints(&string_literal("abc")) == 3);
+        CHECK(utf8_count_codepoints(&string_literal("\xC2\xA3" "1 = \xE2\x82\xAC" "1.17")) == 10);
+        CHECK(utf8_count_codepoints(&string_literal("\xF0\x9F\x98\x80\xF0\x9F\x98\x80")) == 2);
+
+        // Counts across many blocks.
+        char buffer[1000];
+        for (size_t i = 0; i + 3 <= sizeof(buffer); i += 3)
+            memcpy(buffer + i, "\xE4\xBD\xA0", 3);
+        buffer[999] = 'x';
+        for (size_t size = 0; size <= sizeof(buffer); size += 37)
+        {
+            struct string string = {buffer, size};
+            CHECK(utf8_count_codepoints(&string) == reference_count((unsigned char *)buffer, size));
+        }
+    }
+    cpu_isa_set(cpu_isa_supported());
+}
+
+
+static void test_utf8_view_truncate()
+{
+    // 'a', U+00A3, U+20AC, U+1F600: sequences of 1 to 4 bytes.
+    struct string string = string_literal("a\xC2\xA3\xE2\x82\xAC\xF0\x9F\x98\x80");
+    size_t const expected[] = {0, 1, 1, 3, 3, 3, 6, 6, 6, 6, 10, 10, 10};
+    for (size_t max_size = 0; max_size < ARRAY_SIZE(expected); ++max_size)
+    {
+        struct string result;
+        utf8_view_truncate(&result, &string, max_size);
+        CHECK(result.data == string.data);
+        CHECK(result.size == expected[max_size]);
+        CHECK(utf8_is_valid(&result));
+    }
+}
+
+
+int main()
+{
+    test_utf8_is_valid();
+    test_utf8_random();
+    test_utf8_count_codepoints();
+    test_utf8_view_truncate();
+    success("All tests passed :-)");
+    return 0;
+}